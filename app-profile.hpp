@@ -0,0 +1,446 @@
+#ifndef SIGHTSPEAK_APP_PROFILE_HPP
+#define SIGHTSPEAK_APP_PROFILE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwctype>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "text-fingerprint.hpp"
+#include "traversal-budget.hpp"
+
+// One level of the path from a top-level window down to a hovered element
+// Names are kept as fingerprints, which match across launches while runtime ids do not
+struct PathStep {
+    int32_t controlType{ 0 };
+    uint64_t name{ 0 }; // TextFingerprintSet::Fingerprint of the element name
+
+    bool operator==(const PathStep& other) const { return controlType == other.controlType && name == other.name; }
+};
+
+// Element hovered again and again in an application
+struct HotPath {
+    std::vector<PathStep> steps; // From the child of the top-level window down to the element
+    uint32_t hits{ 0 }; // Hovers that started a traversal there
+};
+
+// Text spoken again and again in an application
+struct SpokenString {
+    std::wstring text;
+    uint32_t count{ 0 };
+};
+
+// What the reader learned about one application, keyed by its executable file name
+struct AppProfile {
+    static constexpr uint32_t MinTraversals = 20; // Traversals learned from before the limits are trusted
+    static constexpr int DepthMargin = 2; // Levels read below the deepest text seen so far
+
+    std::wstring executable; // Lower case file name, such as outlook.exe
+    uint32_t traversals{ 0 }; // Traversals learned from
+    uint32_t depth{ 0 }; // Deepest level below a hovered element a text was found at
+    uint32_t texts{ 0 }; // Most texts a single traversal found
+    std::vector<HotPath> paths; // Most hovered first after Trim
+    std::vector<SpokenString> strings; // Most spoken first after Trim
+
+    // Record the outcome of a traversal
+    void Learn(int deepest, size_t found) {
+        ++traversals;
+        depth = (std::max)(depth, static_cast<uint32_t>((std::max)(deepest, 0)));
+        texts = (std::max)(texts, static_cast<uint32_t>((std::min)(found, size_t{ UINT32_MAX })));
+    }
+
+    // Record a hover that started a traversal at the end of a path
+    void Hover(const std::vector<PathStep>& steps) {
+        if (steps.empty()) return;
+        for (HotPath& path : paths) {
+            if (path.steps == steps) {
+                ++path.hits;
+                return;
+            }
+        }
+        paths.push_back({ steps, 1 });
+    }
+
+    // Record a text queued for speech
+    void Spoke(std::wstring_view text) {
+        for (SpokenString& spoken : strings) {
+            if (spoken.text == text) {
+                ++spoken.count;
+                return;
+            }
+        }
+        strings.push_back({ std::wstring(text), 1 });
+    }
+
+    // Budget for traversals in the application: defaults until enough traversals were seen, then limited to the
+    // learned depth and twice the largest text count, never beyond the defaults
+    TraversalBudget Budget(const TraversalBudget& defaults) const {
+        TraversalBudget budget = defaults;
+        if (traversals < MinTraversals) return budget;
+        budget.maxDepth = (std::min)(defaults.maxDepth, static_cast<int>(depth) + DepthMargin + 1);
+        budget.maxNodes = (std::min)(defaults.maxNodes, (std::max)(size_t{ 64 }, size_t{ texts } * 2));
+        return budget;
+    }
+
+    // Keep the most used paths and strings
+    void Trim(size_t maxPaths, size_t maxStrings) {
+        std::stable_sort(paths.begin(), paths.end(), [](const HotPath& a, const HotPath& b) { return a.hits > b.hits; });
+        std::stable_sort(strings.begin(), strings.end(), [](const SpokenString& a, const SpokenString& b) { return a.count > b.count; });
+        if (paths.size() > maxPaths) paths.resize(maxPaths);
+        if (strings.size() > maxStrings) strings.resize(maxStrings);
+    }
+
+    // Lower case file name of an executable path, the key profiles are stored under
+    static std::wstring KeyOf(std::wstring_view imagePath) {
+        size_t slash = imagePath.find_last_of(L"\\/");
+        std::wstring key(slash == std::wstring_view::npos ? imagePath : imagePath.substr(slash + 1));
+        for (wchar_t& c : key) c = static_cast<wchar_t>(std::towlower(c));
+        return key;
+    }
+};
+
+// Profiles laid out for memory mapping: a header, an index sorted by executable hash, then one record per profile
+// Opening a pack only checks the header and the index checksum, so loading costs the same however many apps it holds;
+// each record carries its own checksum and is bounds checked when read, so a damaged record is skipped on its own
+// and a damaged header or index, or an unknown version, leaves the reader starting cold rather than failing
+class ProfilePack {
+public:
+    static constexpr uint32_t Magic = 0x46505353; // "SSPF"
+    static constexpr uint32_t Version = 1;
+
+    // Serialize profiles into a pack
+    static std::vector<uint8_t> Serialize(const std::vector<AppProfile>& profiles) {
+        std::vector<const AppProfile*> sorted;
+        for (const AppProfile& profile : profiles) sorted.push_back(&profile);
+        std::sort(sorted.begin(), sorted.end(), [](auto* a, auto* b) { return Hash(a->executable) < Hash(b->executable); });
+
+        std::vector<uint8_t> out;
+        Put<uint32_t>(out, Magic);
+        Put<uint32_t>(out, Version);
+        Put<uint32_t>(out, static_cast<uint32_t>(sorted.size()));
+        Put<uint32_t>(out, 0); // Index checksum, filled in below
+        size_t indexStart = out.size();
+        out.resize(indexStart + sorted.size() * IndexEntrySize);
+
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            const AppProfile& profile = *sorted[i];
+            uint64_t offset = out.size();
+            size_t pathCount = (std::min)(profile.paths.size(), size_t{ UINT16_MAX });
+            size_t stringCount = (std::min)(profile.strings.size(), size_t{ UINT16_MAX });
+            Put<uint32_t>(out, profile.traversals);
+            Put<uint32_t>(out, profile.depth);
+            Put<uint32_t>(out, profile.texts);
+            Put<uint16_t>(out, static_cast<uint16_t>(pathCount));
+            Put<uint16_t>(out, static_cast<uint16_t>(stringCount));
+            PutText(out, profile.executable);
+            for (size_t p = 0; p < pathCount; ++p) {
+                const HotPath& path = profile.paths[p];
+                size_t stepCount = (std::min)(path.steps.size(), size_t{ UINT16_MAX });
+                Put<uint32_t>(out, path.hits);
+                Put<uint16_t>(out, static_cast<uint16_t>(stepCount));
+                for (size_t s = 0; s < stepCount; ++s) {
+                    Put<int32_t>(out, path.steps[s].controlType);
+                    Put<uint64_t>(out, path.steps[s].name);
+                }
+            }
+            for (size_t s = 0; s < stringCount; ++s) {
+                Put<uint32_t>(out, profile.strings[s].count);
+                PutText(out, profile.strings[s].text);
+            }
+
+            uint8_t* slot = out.data() + indexStart + i * IndexEntrySize;
+            uint64_t hash = Hash(profile.executable);
+            uint32_t size = static_cast<uint32_t>(out.size() - offset);
+            uint32_t checksum = Checksum(out.data() + offset, size);
+            std::memcpy(slot, &hash, 8);
+            std::memcpy(slot + 8, &offset, 8);
+            std::memcpy(slot + 16, &size, 4);
+            std::memcpy(slot + 20, &checksum, 4);
+        }
+        uint32_t indexChecksum = Checksum(out.data() + indexStart, sorted.size() * IndexEntrySize);
+        std::memcpy(out.data() + 12, &indexChecksum, 4);
+        return out;
+    }
+
+    ProfilePack() = default;
+
+    // View a serialized pack; the bytes must stay valid until the view is reset
+    ProfilePack(const uint8_t* data, size_t size) {
+        if (!data || size < HeaderSize || Get<uint32_t>(data) != Magic || Get<uint32_t>(data + 4) != Version) return;
+        uint32_t entries = Get<uint32_t>(data + 8);
+        if ((size - HeaderSize) / IndexEntrySize < entries) return;
+        if (Checksum(data + HeaderSize, size_t{ entries } * IndexEntrySize) != Get<uint32_t>(data + 12)) return;
+        this->data = data;
+        this->size = size;
+        count = entries;
+    }
+
+    // True if the bytes held an intact pack of a supported version
+    bool Valid() const { return data != nullptr; }
+
+    // Number of profiles in the pack
+    size_t Size() const { return count; }
+
+    // Decode the profile of an executable, if the pack holds an intact one
+    std::optional<AppProfile> Find(std::wstring_view executable) const {
+        if (!data) return std::nullopt;
+        uint64_t hash = Hash(executable);
+        size_t low = 0, high = count;
+        while (low < high) { // Lower bound on the sorted hashes
+            size_t middle = (low + high) / 2;
+            if (IndexHash(middle) < hash) low = middle + 1;
+            else high = middle;
+        }
+        for (size_t i = low; i < count && IndexHash(i) == hash; ++i) {
+            AppProfile profile;
+            if (Read(i, profile) && profile.executable == executable) return profile;
+        }
+        return std::nullopt;
+    }
+
+    // Decode every intact profile in the pack
+    std::vector<AppProfile> All() const {
+        std::vector<AppProfile> profiles;
+        for (size_t i = 0; i < count; ++i) {
+            AppProfile profile;
+            if (Read(i, profile)) profiles.push_back(std::move(profile));
+        }
+        return profiles;
+    }
+
+    // 32-bit FNV-1a over a byte range
+    static uint32_t Checksum(const uint8_t* bytes, size_t length) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+private:
+    static constexpr size_t HeaderSize = 16;
+    static constexpr size_t IndexEntrySize = 24; // Hash, record offset, record size and record checksum
+    static constexpr size_t RecordHeaderSize = 16;
+
+    static uint64_t Hash(std::wstring_view executable) { return TextFingerprintSet::Fingerprint(executable); }
+
+    template <typename T>
+    static void Put(std::vector<uint8_t>& out, T value) {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    static void PutText(std::vector<uint8_t>& out, std::wstring_view text) {
+        size_t length = (std::min)(text.size(), size_t{ UINT16_MAX });
+        Put<uint16_t>(out, static_cast<uint16_t>(length));
+        for (size_t i = 0; i < length; ++i) Put<uint16_t>(out, static_cast<uint16_t>(text[i]));
+    }
+
+    template <typename T>
+    static T Get(const uint8_t* p) {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    uint64_t IndexHash(size_t i) const { return Get<uint64_t>(data + HeaderSize + i * IndexEntrySize); }
+
+    // Reads a record front to back, refusing to step past its end
+    struct Cursor {
+        const uint8_t* p;
+        const uint8_t* end;
+
+        template <typename T>
+        bool Take(T& value) {
+            if (static_cast<size_t>(end - p) < sizeof(T)) return false;
+            value = Get<T>(p);
+            p += sizeof(T);
+            return true;
+        }
+
+        bool TakeText(std::wstring& text) {
+            uint16_t length = 0;
+            if (!Take(length) || static_cast<size_t>(end - p) < size_t{ length } * 2) return false;
+            text.resize(length);
+            for (wchar_t& c : text) {
+                c = static_cast<wchar_t>(Get<uint16_t>(p));
+                p += 2;
+            }
+            return true;
+        }
+    };
+
+    // Decode one record, checking its checksum and every length against the record size since the file may be damaged
+    bool Read(size_t i, AppProfile& profile) const {
+        const uint8_t* slot = data + HeaderSize + i * IndexEntrySize;
+        uint64_t offset = Get<uint64_t>(slot + 8);
+        uint32_t length = Get<uint32_t>(slot + 16);
+        if (offset > size || length > size - offset || length < RecordHeaderSize) return false;
+        if (Checksum(data + offset, length) != Get<uint32_t>(slot + 20)) return false;
+
+        Cursor cursor{ data + offset, data + offset + length };
+        uint16_t pathCount = 0, stringCount = 0;
+        if (!cursor.Take(profile.traversals) || !cursor.Take(profile.depth) || !cursor.Take(profile.texts) ||
+            !cursor.Take(pathCount) || !cursor.Take(stringCount) || !cursor.TakeText(profile.executable)) return false;
+        profile.paths.resize(pathCount);
+        for (HotPath& path : profile.paths) {
+            uint16_t stepCount = 0;
+            if (!cursor.Take(path.hits) || !cursor.Take(stepCount)) return false;
+            path.steps.resize(stepCount);
+            for (PathStep& step : path.steps) {
+                if (!cursor.Take(step.controlType) || !cursor.Take(step.name)) return false;
+            }
+        }
+        profile.strings.resize(stringCount);
+        for (SpokenString& spoken : profile.strings) {
+            if (!cursor.Take(spoken.count) || !cursor.TakeText(spoken.text)) return false;
+        }
+        return cursor.p == cursor.end;
+    }
+
+    const uint8_t* data{ nullptr }; // Start of the mapped pack
+    size_t size{ 0 }; // Length of the mapped pack in bytes
+    size_t count{ 0 }; // Number of index entries
+};
+
+// Bounds of the profiles a ProfileStore persists
+struct ProfileLimits {
+    size_t maxProfiles{ 256 }; // Applications kept, the most used first
+    size_t maxPaths{ 32 }; // Hot paths kept per application
+    size_t maxStrings{ 64 }; // Spoken strings kept per application
+};
+
+// Profiles of every application seen, read from a mapped pack on first use and learned from as the reader runs
+// A profile is decoded from the pack only when its application is first hovered, so startup maps the file and nothing more
+class ProfileStore {
+public:
+    explicit ProfileStore(ProfileLimits limits = ProfileLimits()) : limits(limits) {}
+
+    // Serve profiles not learned from yet out of a mapped pack; the bytes must stay valid until DetachDisk
+    // Returns false if the bytes hold no intact pack of this version
+    bool AttachDisk(const uint8_t* data, size_t size) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        disk = ProfilePack(data, size);
+        return disk.Valid();
+    }
+
+    // Stop reading from the mapped pack; profiles decoded from it so far stay
+    void DetachDisk() {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        disk = ProfilePack();
+    }
+
+    // Traversal budget for an application, the defaults for an unknown one
+    TraversalBudget Budget(const std::wstring& executable, const TraversalBudget& defaults) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        AppProfile* profile = FindLocked(executable);
+        return profile ? profile->Budget(defaults) : defaults;
+    }
+
+    // Record the outcome of a traversal in an application and the texts it queued
+    void Learn(const std::wstring& executable, int deepest, const std::vector<std::wstring_view>& spoken) {
+        if (executable.empty()) return;
+        std::lock_guard<std::mutex> lock(storeMutex);
+        AppProfile& profile = CreateLocked(executable);
+        profile.Learn(deepest, spoken.size());
+        for (std::wstring_view text : spoken) profile.Spoke(text);
+        if (profile.strings.size() > limits.maxStrings * 4) profile.Trim(limits.maxPaths * 4, limits.maxStrings * 2); // Bound the work per text
+    }
+
+    // Record a hover at the end of a path in an application
+    void Hover(const std::wstring& executable, const std::vector<PathStep>& steps) {
+        if (executable.empty()) return;
+        std::lock_guard<std::mutex> lock(storeMutex);
+        AppProfile& profile = CreateLocked(executable);
+        profile.Hover(steps);
+        if (profile.paths.size() > limits.maxPaths * 4) profile.Trim(limits.maxPaths * 2, limits.maxStrings * 4);
+    }
+
+    // Copy of the profile of an application, trimmed to its most used paths and strings, if it has one
+    std::optional<AppProfile> Snapshot(const std::wstring& executable) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        AppProfile* profile = FindLocked(executable);
+        if (!profile) return std::nullopt;
+        AppProfile copy = *profile;
+        copy.Trim(limits.maxPaths, limits.maxStrings);
+        return copy;
+    }
+
+    // True the first time it is asked about an application since the last ResetWarmed
+    bool MarkWarmed(const std::wstring& executable) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        return warmed.insert(executable).second;
+    }
+
+    // Let every application be warmed again, after the caches the warming fills were dropped
+    void ResetWarmed() {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        warmed.clear();
+    }
+
+    // Every profile, learned or still on disk, trimmed to the limits; copied out so the pack can be unmapped
+    std::vector<AppProfile> Persistable() {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        std::vector<AppProfile> result;
+        for (AppProfile& profile : disk.All()) {
+            if (!profiles.count(profile.executable)) result.push_back(std::move(profile));
+        }
+        for (const auto& [executable, profile] : profiles) result.push_back(profile);
+        std::stable_sort(result.begin(), result.end(), [](const AppProfile& a, const AppProfile& b) { return a.traversals > b.traversals; });
+        if (result.size() > limits.maxProfiles) result.resize(limits.maxProfiles);
+        for (AppProfile& profile : result) profile.Trim(limits.maxPaths, limits.maxStrings);
+        return result;
+    }
+
+    // Short human readable summary for the debug log
+    std::wstring Describe() {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        return L"on-disk=" + std::to_wstring(disk.Size()) + L" in-use=" + std::to_wstring(profiles.size()) +
+            L" loaded=" + std::to_wstring(loaded) + L" new=" + std::to_wstring(created);
+    }
+
+private:
+    // Profile of an application, decoded from the pack on first use; null for an unknown application
+    AppProfile* FindLocked(const std::wstring& executable) {
+        auto found = profiles.find(executable);
+        if (found != profiles.end()) return &found->second;
+        if (executable.empty() || missing.count(executable)) return nullptr;
+        std::optional<AppProfile> stored = disk.Find(executable);
+        if (!stored) {
+            missing.insert(executable); // Only the first hover of an unknown application searches the pack
+            return nullptr;
+        }
+        ++loaded;
+        return &profiles.emplace(executable, std::move(*stored)).first->second;
+    }
+
+    AppProfile& CreateLocked(const std::wstring& executable) {
+        if (AppProfile* profile = FindLocked(executable)) return *profile;
+        missing.erase(executable);
+        ++created;
+        AppProfile& profile = profiles[executable];
+        profile.executable = executable;
+        return profile;
+    }
+
+    ProfileLimits limits; // Bounds of the persisted profiles
+    std::mutex storeMutex; // Guards everything below
+    ProfilePack disk; // Mapped profiles of earlier sessions
+    std::unordered_map<std::wstring, AppProfile> profiles; // Profiles in use, learned from this session
+    std::unordered_set<std::wstring> missing; // Applications the pack has no profile for
+    std::unordered_set<std::wstring> warmed; // Applications whose caches were warmed from their profile
+    uint64_t loaded{ 0 }; // Profiles decoded from the pack
+    uint64_t created{ 0 }; // Profiles of applications seen for the first time
+};
+
+#endif // SIGHTSPEAK_APP_PROFILE_HPP
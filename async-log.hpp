@@ -0,0 +1,376 @@
+#ifndef SIGHTSPEAK_ASYNC_LOG_HPP
+#define SIGHTSPEAK_ASYNC_LOG_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Severity of a log record
+enum class LogLevel : uint8_t {
+    Trace,
+    Debug,
+    Info,
+    Warning,
+    Error
+};
+
+// Records below this level are compiled out; define SIGHTSPEAK_LOG_LEVEL to the numeric level to change it
+#ifndef SIGHTSPEAK_LOG_LEVEL
+#define SIGHTSPEAK_LOG_LEVEL 1
+#endif
+constexpr LogLevel CompiledLogLevel = static_cast<LogLevel>(SIGHTSPEAK_LOG_LEVEL);
+
+// Where and how an AsyncLog writes
+struct LogSettings {
+    std::filesystem::path path{ "debug.log" }; // Current log file; rotated files get .1, .2, ... appended
+    uint64_t maxFileBytes{ 4 * 1024 * 1024 }; // Size at which the file is rotated
+    int keepFiles{ 3 }; // Rotated files kept besides the current one
+    size_t ringBytes{ 64 * 1024 }; // Buffer per logging thread; records that do not fit are dropped
+    std::chrono::milliseconds flushInterval{ 50 }; // Longest time a record waits for the writer
+    std::function<void(const std::wstring& line)> echo; // Also hands every formatted line to this, on the writer thread
+};
+
+// Logger whose callers only copy the message into a lock-free buffer of their own thread
+// A background writer drains the buffers, formats the records as UTF-8 lines and appends them to a rotating file,
+// so logging never waits on formatting, the file system or other threads
+class AsyncLog {
+public:
+    explicit AsyncLog(LogSettings settings = LogSettings())
+        : settings(std::move(settings)), id(nextId.fetch_add(1) + 1), start(std::chrono::steady_clock::now()), writer(&AsyncLog::Run, this) {
+    }
+
+    ~AsyncLog() { Stop(); }
+
+    AsyncLog(const AsyncLog&) = delete;
+    AsyncLog& operator=(const AsyncLog&) = delete;
+
+    // Queue a record; never blocks, drops the record if the calling thread's buffer is full
+    void Write(LogLevel level, std::wstring_view message) {
+        Ring* ring = ThreadRing();
+        if (!ring) return;
+        if (!ring->Push(level, Elapsed(), message)) ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); // Only the owning thread counts
+    }
+
+    // Block until every record queued before the call is written
+    void Flush() {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        uint64_t target = ++flushRequests;
+        wakeCv.notify_one();
+        flushedCv.wait(lock, [&] { return flushesDone >= target || stopped; });
+    }
+
+    // Write what is queued and stop the writer; later records are dropped
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            if (stopping) return;
+            stopping = true;
+        }
+        wakeCv.notify_one();
+        if (writer.joinable()) writer.join();
+    }
+
+    // Number of records written to the file
+    uint64_t Written() const { return written.load(std::memory_order_relaxed); }
+
+    // Number of records dropped because a buffer was full
+    uint64_t Dropped() {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        uint64_t total = retiredDropped;
+        for (const std::shared_ptr<Ring>& ring : rings) total += ring->dropped.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    // Short name of a level as written to the file
+    static const wchar_t* LevelName(LogLevel level) {
+        switch (level) {
+        case LogLevel::Trace: return L"TRACE";
+        case LogLevel::Debug: return L"DEBUG";
+        case LogLevel::Info: return L"INFO";
+        case LogLevel::Warning: return L"WARN";
+        case LogLevel::Error: return L"ERROR";
+        }
+        return L"?";
+    }
+
+private:
+    static constexpr size_t MaxMessageUnits = 1024; // Longer messages are truncated
+    static constexpr uint8_t PaddingRecord = 0xFF; // Level marking the unused end of the buffer before a wrap
+
+    struct RecordHeader {
+        int64_t time; // Nanoseconds since the log was created
+        uint32_t units; // Message length in code units
+        uint8_t level; // LogLevel, or PaddingRecord
+        uint8_t reserved[3];
+    };
+
+    // Single-producer single-consumer byte ring holding the records of one thread
+    struct Ring {
+        explicit Ring(size_t minBytes, uint32_t thread) : thread(thread) {
+            size_t capacity = 4096;
+            while (capacity < minBytes) capacity *= 2;
+            mask = capacity - 1;
+            data = std::make_unique<uint8_t[]>(capacity);
+        }
+
+        static size_t RecordBytes(size_t units) {
+            return (sizeof(RecordHeader) + units * sizeof(wchar_t) + 7) & ~size_t{ 7 }; // Keep headers aligned
+        }
+
+        bool Push(LogLevel level, int64_t time, std::wstring_view message) {
+            size_t units = message.size() < MaxMessageUnits ? message.size() : MaxMessageUnits;
+            size_t bytes = RecordBytes(units);
+            uint64_t position = head.load(std::memory_order_relaxed);
+            size_t offset = static_cast<size_t>(position) & mask;
+            size_t untilEnd = mask + 1 - offset;
+            size_t needed = bytes <= untilEnd ? bytes : bytes + untilEnd; // A record never wraps, the end is skipped instead
+            if (position + needed - tail.load(std::memory_order_acquire) > mask + 1) return false;
+
+            if (bytes > untilEnd) {
+                RecordHeader padding{ 0, static_cast<uint32_t>(untilEnd), PaddingRecord, {} };
+                if (untilEnd >= sizeof(RecordHeader)) std::memcpy(&data[offset], &padding, sizeof(padding));
+                position += untilEnd;
+                offset = 0;
+            }
+            RecordHeader header{ time, static_cast<uint32_t>(units), static_cast<uint8_t>(level), {} };
+            std::memcpy(&data[offset], &header, sizeof(header));
+            std::memcpy(&data[offset + sizeof(header)], message.data(), units * sizeof(wchar_t));
+            head.store(position + bytes, std::memory_order_release);
+            return true;
+        }
+
+        // Hand every complete record to the visitor and free its space
+        template <typename Visitor>
+        void Drain(Visitor&& visit) {
+            uint64_t position = tail.load(std::memory_order_relaxed);
+            uint64_t end = head.load(std::memory_order_acquire);
+            while (position < end) {
+                size_t offset = static_cast<size_t>(position) & mask;
+                size_t untilEnd = mask + 1 - offset;
+                RecordHeader header;
+                if (untilEnd < sizeof(RecordHeader)) { // Too short for even a padding header
+                    position += untilEnd;
+                    continue;
+                }
+                std::memcpy(&header, &data[offset], sizeof(header));
+                if (header.level == PaddingRecord) {
+                    position += untilEnd;
+                    continue;
+                }
+                visit(static_cast<LogLevel>(header.level), header.time, thread,
+                    std::wstring_view(reinterpret_cast<const wchar_t*>(&data[offset + sizeof(header)]), header.units));
+                position += RecordBytes(header.units);
+            }
+            tail.store(position, std::memory_order_release);
+        }
+
+        std::unique_ptr<uint8_t[]> data; // Record storage
+        size_t mask{ 0 }; // Capacity minus one
+        uint32_t thread; // Small id of the owning thread
+        std::atomic<bool> retired{ false }; // The owning thread has exited
+        std::atomic<uint64_t> dropped{ 0 }; // Records that did not fit, written by the owning thread
+        alignas(64) std::atomic<uint64_t> head{ 0 }; // Written by the owning thread
+        alignas(64) std::atomic<uint64_t> tail{ 0 }; // Written by the writer thread
+    };
+
+    // Releases a thread's ring to the writer when the thread exits
+    struct ThreadSlot {
+        uint64_t owner{ 0 }; // Id of the log the ring belongs to; a later log may reuse the address of an earlier one
+        std::shared_ptr<Ring> ring;
+        ~ThreadSlot() {
+            if (ring) ring->retired.store(true, std::memory_order_release);
+        }
+    };
+
+    Ring* ThreadRing() {
+        thread_local ThreadSlot slot;
+        if (slot.owner == id) return slot.ring.get();
+
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        if (stopping) return nullptr;
+        if (slot.ring) slot.ring->retired.store(true, std::memory_order_release); // Thread moved on to another log
+        slot.ring = std::make_shared<Ring>(settings.ringBytes, ++threadCount);
+        slot.owner = id;
+        rings.push_back(slot.ring);
+        return slot.ring.get();
+    }
+
+    int64_t Elapsed() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        for (;;) {
+            wakeCv.wait_for(lock, settings.flushInterval, [&] { return stopping || flushRequests > flushesDone; });
+            bool last = stopping;
+            uint64_t requested = flushRequests;
+            lock.unlock();
+            WritePass();
+            lock.lock();
+            flushesDone = requested;
+            if (last) {
+                stopped = true;
+                flushedCv.notify_all();
+                return;
+            }
+            flushedCv.notify_all();
+        }
+    }
+
+    // Drain every ring once and append the formatted records to the file
+    void WritePass() {
+        std::vector<std::shared_ptr<Ring>> current;
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            current = rings;
+        }
+        std::string buffer;
+        uint64_t records = 0;
+        for (const std::shared_ptr<Ring>& ring : current) {
+            bool retired = ring->retired.load(std::memory_order_acquire); // Read first, so nothing pushed before retiring is missed
+            ring->Drain([&](LogLevel level, int64_t time, uint32_t thread, std::wstring_view message) {
+                FormatRecord(level, time, thread, message, buffer);
+                ++records;
+            });
+            if (retired) {
+                std::lock_guard<std::mutex> lock(ringsMutex);
+                retiredDropped += ring->dropped.load(std::memory_order_relaxed);
+                rings.erase(std::remove(rings.begin(), rings.end(), ring), rings.end());
+            }
+        }
+        if (buffer.empty()) return;
+        AppendToFile(buffer);
+        written.fetch_add(records, std::memory_order_relaxed);
+    }
+
+    void FormatRecord(LogLevel level, int64_t time, uint32_t thread, std::wstring_view message, std::string& out) {
+        char prefix[64];
+        int64_t micros = time / 1000;
+        std::snprintf(prefix, sizeof(prefix), "[%8lld.%06lld] %-5ls t%u ", static_cast<long long>(micros / 1000000),
+            static_cast<long long>(micros % 1000000), LevelName(level), thread);
+        out += prefix;
+        AppendUtf8(message, out);
+        out += '\n';
+        if (settings.echo) {
+            std::wstring line(prefix, prefix + std::strlen(prefix)); // The prefix is plain ASCII
+            line.append(message);
+            line += L'\n';
+            settings.echo(line);
+        }
+    }
+
+    // Append UTF-16 or UTF-32 text, depending on the size of wchar_t, as UTF-8
+    static void AppendUtf8(std::wstring_view text, std::string& out) {
+        for (size_t i = 0; i < text.size(); ++i) {
+            uint32_t code = static_cast<uint32_t>(text[i]);
+            if (sizeof(wchar_t) == 2 && code >= 0xD800 && code <= 0xDBFF && i + 1 < text.size()) {
+                uint32_t low = static_cast<uint32_t>(text[i + 1]);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    ++i;
+                }
+            }
+            if (code >= 0xD800 && code <= 0xDFFF) code = 0xFFFD; // Unpaired surrogate
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            }
+            else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+    }
+
+    void AppendToFile(const std::string& buffer) {
+        if (!file.is_open()) {
+            file.open(settings.path, std::ios::binary | std::ios::app);
+            std::error_code error;
+            uint64_t size = std::filesystem::file_size(settings.path, error);
+            fileBytes = error ? 0 : size;
+        }
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        file.flush();
+        fileBytes += buffer.size();
+        if (fileBytes >= settings.maxFileBytes) Rotate();
+    }
+
+    // Shift debug.log to debug.log.1, debug.log.1 to debug.log.2 and so on, dropping the oldest
+    void Rotate() {
+        file.close();
+        std::error_code error;
+        auto numbered = [&](int index) {
+            std::string suffix(".");
+            suffix.append(std::to_string(index)); // Appended rather than concatenated, which trips -Wrestrict in GCC 12
+            std::filesystem::path rotated = settings.path;
+            rotated += suffix;
+            return rotated;
+        };
+        if (settings.keepFiles <= 0) {
+            std::filesystem::remove(settings.path, error);
+        }
+        else {
+            std::filesystem::remove(numbered(settings.keepFiles), error);
+            for (int index = settings.keepFiles - 1; index >= 1; --index) {
+                std::filesystem::rename(numbered(index), numbered(index + 1), error);
+            }
+            std::filesystem::rename(settings.path, numbered(1), error);
+        }
+        fileBytes = 0;
+    }
+
+    static inline std::atomic<uint64_t> nextId{ 0 }; // Last id handed to a log
+    LogSettings settings; // Destination and limits
+    const uint64_t id; // Identifies this log to the thread slots
+    std::chrono::steady_clock::time_point start; // Origin of record timestamps
+    std::mutex ringsMutex; // Guards rings and threadCount
+    std::vector<std::shared_ptr<Ring>> rings; // Buffers of the threads that logged
+    uint32_t threadCount{ 0 }; // Last thread id handed out
+    uint64_t retiredDropped{ 0 }; // Drops counted by rings already released
+    std::mutex wakeMutex; // Guards the writer state below
+    std::condition_variable wakeCv; // Wakes the writer early
+    std::condition_variable flushedCv; // Signals finished write passes
+    uint64_t flushRequests{ 0 }; // Flush calls so far
+    uint64_t flushesDone{ 0 }; // Flush calls covered by a finished pass
+    bool stopping{ false }; // Stop was called
+    bool stopped{ false }; // The writer has exited
+    std::ofstream file; // Current log file, used by the writer only
+    uint64_t fileBytes{ 0 }; // Size of the current log file
+    std::atomic<uint64_t> written{ 0 }; // Records written
+    std::thread writer; // Writer thread, started last so every member is ready
+};
+
+// Queue a record at a level known at compile time; levels below CompiledLogLevel cost nothing
+template <LogLevel Level>
+inline void Log(AsyncLog& log, std::wstring_view message) {
+    if constexpr (Level >= CompiledLogLevel) log.Write(Level, message);
+}
+
+#endif // SIGHTSPEAK_ASYNC_LOG_HPP
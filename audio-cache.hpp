@@ -0,0 +1,417 @@
+#ifndef SIGHTSPEAK_AUDIO_CACHE_HPP
+#define SIGHTSPEAK_AUDIO_CACHE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "latency-histogram.hpp"
+
+// PCM layout of a synthesized clip
+struct AudioFormat {
+    uint32_t samplesPerSecond{ 22050 };
+    uint16_t bitsPerSample{ 16 };
+    uint16_t channels{ 1 };
+
+    uint32_t BytesPerSecond() const { return samplesPerSecond * channels * (bitsPerSample / 8); }
+};
+
+// Synthesized audio for one text
+struct AudioClip {
+    AudioFormat format;
+    std::vector<uint8_t> samples; // Raw PCM data
+};
+
+// Everything that changes the synthesized audio of a text
+struct AudioCacheKey {
+    std::wstring text;
+    std::wstring voice; // Voice token id
+    long rate{ 0 };
+    unsigned short volume{ 100 };
+
+    bool operator==(const AudioCacheKey& other) const {
+        return rate == other.rate && volume == other.volume && text == other.text && voice == other.voice;
+    }
+
+    // 64-bit FNV-1a hash over all fields
+    uint64_t Hash() const {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](uint64_t value) {
+            hash ^= value;
+            hash *= 1099511628211ull;
+        };
+        for (wchar_t c : text) mix(static_cast<uint64_t>(c));
+        mix(0xFFFF); // Separator so text and voice cannot shift into each other
+        for (wchar_t c : voice) mix(static_cast<uint64_t>(c));
+        mix(static_cast<uint64_t>(rate));
+        mix(volume);
+        return hash;
+    }
+};
+
+struct AudioCacheKeyHash {
+    size_t operator()(const AudioCacheKey& key) const { return static_cast<size_t>(key.Hash()); }
+};
+
+// Produces the audio of a text without playing it
+// Backed by a second SAPI voice in the reader and by StubAudioRenderer for portable runs
+class AudioRenderer {
+public:
+    virtual ~AudioRenderer() = default;
+
+    // Synthesize the text of a key into a clip
+    virtual bool Render(const AudioCacheKey& key, AudioClip& clip) = 0;
+};
+
+// Renderer producing silence of a deterministic length
+class StubAudioRenderer : public AudioRenderer {
+public:
+    explicit StubAudioRenderer(std::chrono::milliseconds perCharacter = std::chrono::milliseconds(60)) : perCharacter(perCharacter) {}
+
+    bool Render(const AudioCacheKey& key, AudioClip& clip) override {
+        clip.format = AudioFormat();
+        auto length = perCharacter * static_cast<long long>(key.text.size());
+        size_t bytes = static_cast<size_t>(clip.format.BytesPerSecond() * length.count() / 1000);
+        clip.samples.assign(bytes - bytes % 2, 0);
+        ++renders;
+        return true;
+    }
+
+    // Number of clips rendered
+    uint64_t Renders() const { return renders; }
+
+private:
+    std::chrono::milliseconds perCharacter; // Playback length per character
+    uint64_t renders{ 0 }; // Clips rendered
+};
+
+// Versioned on-disk layout of persisted clips, read in place from a memory-mapped file
+// Header, then an index sorted by key hash, then one record per clip:
+// rate, volume, format, text and voice as UTF-16 code units, then the samples
+class AudioPack {
+public:
+    static constexpr uint32_t Magic = 0x43415353; // "SSAC"
+    static constexpr uint32_t Version = 1;
+
+    using Entries = std::vector<std::pair<AudioCacheKey, std::shared_ptr<const AudioClip>>>;
+
+    // Serialize clips into a pack
+    static std::vector<uint8_t> Serialize(const Entries& entries) {
+        std::vector<const std::pair<AudioCacheKey, std::shared_ptr<const AudioClip>>*> sorted;
+        for (const auto& entry : entries) sorted.push_back(&entry);
+        std::sort(sorted.begin(), sorted.end(), [](auto* a, auto* b) { return a->first.Hash() < b->first.Hash(); });
+
+        std::vector<uint8_t> out;
+        Put<uint32_t>(out, Magic);
+        Put<uint32_t>(out, Version);
+        Put<uint32_t>(out, static_cast<uint32_t>(sorted.size()));
+        Put<uint32_t>(out, 0);
+        size_t indexStart = out.size();
+        out.resize(indexStart + sorted.size() * IndexEntrySize);
+
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            const AudioCacheKey& key = sorted[i]->first;
+            const AudioClip& clip = *sorted[i]->second;
+            uint64_t offset = out.size();
+            Put<int32_t>(out, static_cast<int32_t>(key.rate));
+            Put<uint16_t>(out, key.volume);
+            Put<uint16_t>(out, clip.format.channels);
+            Put<uint32_t>(out, clip.format.samplesPerSecond);
+            Put<uint16_t>(out, clip.format.bitsPerSample);
+            Put<uint16_t>(out, 0);
+            Put<uint32_t>(out, static_cast<uint32_t>(key.text.size()));
+            Put<uint32_t>(out, static_cast<uint32_t>(key.voice.size()));
+            Put<uint64_t>(out, clip.samples.size());
+            for (wchar_t c : key.text) Put<uint16_t>(out, static_cast<uint16_t>(c));
+            for (wchar_t c : key.voice) Put<uint16_t>(out, static_cast<uint16_t>(c));
+            out.insert(out.end(), clip.samples.begin(), clip.samples.end());
+
+            uint8_t* slot = out.data() + indexStart + i * IndexEntrySize;
+            uint64_t hash = key.Hash();
+            uint64_t size = out.size() - offset;
+            std::memcpy(slot, &hash, 8);
+            std::memcpy(slot + 8, &offset, 8);
+            std::memcpy(slot + 16, &size, 8);
+        }
+        return out;
+    }
+
+    AudioPack() = default;
+
+    // View a serialized pack; the bytes must stay valid until the view is reset
+    AudioPack(const uint8_t* data, size_t size) {
+        if (!data || size < HeaderSize || Get<uint32_t>(data) != Magic || Get<uint32_t>(data + 4) != Version) return;
+        uint32_t entries = Get<uint32_t>(data + 8);
+        if ((size - HeaderSize) / IndexEntrySize < entries) return;
+        this->data = data;
+        this->size = size;
+        count = entries;
+    }
+
+    // True if the bytes held a pack of a supported version
+    bool Valid() const { return data != nullptr; }
+
+    // Number of clips in the pack
+    size_t Size() const { return count; }
+
+    // Copy out the clip stored for a key
+    std::shared_ptr<const AudioClip> Find(const AudioCacheKey& key) const {
+        if (!data) return nullptr;
+        uint64_t hash = key.Hash();
+        size_t low = 0, high = count;
+        while (low < high) { // Lower bound on the sorted hashes
+            size_t middle = (low + high) / 2;
+            if (IndexHash(middle) < hash) low = middle + 1;
+            else high = middle;
+        }
+        for (size_t i = low; i < count && IndexHash(i) == hash; ++i) {
+            AudioCacheKey stored;
+            auto clip = std::make_shared<AudioClip>();
+            if (Read(i, stored, *clip) && stored == key) return clip;
+        }
+        return nullptr;
+    }
+
+    // Copy out every clip in the pack
+    Entries All() const {
+        Entries entries;
+        for (size_t i = 0; i < count; ++i) {
+            AudioCacheKey key;
+            auto clip = std::make_shared<AudioClip>();
+            if (Read(i, key, *clip)) entries.emplace_back(std::move(key), std::move(clip));
+        }
+        return entries;
+    }
+
+private:
+    static constexpr size_t HeaderSize = 16;
+    static constexpr size_t IndexEntrySize = 24; // Hash, record offset and record size
+    static constexpr size_t RecordHeaderSize = 32;
+
+    template <typename T>
+    static void Put(std::vector<uint8_t>& out, T value) {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    static T Get(const uint8_t* p) {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    uint64_t IndexHash(size_t i) const { return Get<uint64_t>(data + HeaderSize + i * IndexEntrySize); }
+
+    // Decode one record, checking every length against the mapped size since the file may be damaged
+    bool Read(size_t i, AudioCacheKey& key, AudioClip& clip) const {
+        const uint8_t* slot = data + HeaderSize + i * IndexEntrySize;
+        uint64_t offset = Get<uint64_t>(slot + 8);
+        uint64_t length = Get<uint64_t>(slot + 16);
+        if (offset > size || length > size - offset || length < RecordHeaderSize) return false;
+        const uint8_t* record = data + offset;
+
+        key.rate = Get<int32_t>(record);
+        key.volume = Get<uint16_t>(record + 4);
+        clip.format.channels = Get<uint16_t>(record + 6);
+        clip.format.samplesPerSecond = Get<uint32_t>(record + 8);
+        clip.format.bitsPerSample = Get<uint16_t>(record + 12);
+        uint64_t textLength = Get<uint32_t>(record + 16);
+        uint64_t voiceLength = Get<uint32_t>(record + 20);
+        uint64_t sampleBytes = Get<uint64_t>(record + 24);
+        uint64_t available = length - RecordHeaderSize;
+        if (textLength * 2 > available || voiceLength * 2 > available - textLength * 2) return false;
+        if (sampleBytes != available - (textLength + voiceLength) * 2) return false; // Compared this way round so a huge count cannot wrap
+
+        const uint8_t* p = record + RecordHeaderSize;
+        key.text.resize(static_cast<size_t>(textLength));
+        for (auto& c : key.text) {
+            c = static_cast<wchar_t>(Get<uint16_t>(p));
+            p += 2;
+        }
+        key.voice.resize(static_cast<size_t>(voiceLength));
+        for (auto& c : key.voice) {
+            c = static_cast<wchar_t>(Get<uint16_t>(p));
+            p += 2;
+        }
+        clip.samples.assign(p, p + sampleBytes);
+        return true;
+    }
+
+    const uint8_t* data{ nullptr }; // Start of the mapped pack
+    size_t size{ 0 }; // Length of the mapped pack in bytes
+    size_t count{ 0 }; // Number of index entries
+};
+
+// Counters reported by AudioCache
+struct AudioCacheStats {
+    uint64_t hits{ 0 }; // Lookups served from memory
+    uint64_t diskHits{ 0 }; // Lookups served from the on-disk pack
+    uint64_t misses{ 0 }; // Lookups that found nothing
+    uint64_t evictions{ 0 }; // Clips dropped to stay within the byte budget
+    size_t bytes{ 0 }; // Sample bytes held in memory
+    size_t clips{ 0 }; // Clips held in memory
+
+    // Fraction of lookups served from either tier
+    double HitRate() const {
+        uint64_t lookups = hits + diskHits + misses;
+        return lookups ? static_cast<double>(hits + diskHits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+// Two-tier cache of synthesized audio
+// Memory tier is an LRU list within a byte budget, the disk tier a read-only pack mapped at startup
+class AudioCache {
+public:
+    explicit AudioCache(size_t byteBudget = 16 * 1024 * 1024) : byteBudget(byteBudget) {}
+
+    // Look up the audio of a key, promoting disk hits into memory
+    std::shared_ptr<const AudioClip> Find(const AudioCacheKey& key) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto found = entries.find(key);
+        if (found != entries.end()) {
+            recency.splice(recency.begin(), recency, found->second);
+            ++stats.hits;
+            return found->second->clip;
+        }
+        std::shared_ptr<const AudioClip> clip = disk.Find(key);
+        if (!clip) {
+            ++stats.misses;
+            return nullptr;
+        }
+        ++stats.diskHits;
+        InsertLocked(key, clip);
+        return clip;
+    }
+
+    // True if either tier holds the key; does not count as a lookup
+    bool Contains(const AudioCacheKey& key) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        return entries.count(key) || disk.Find(key);
+    }
+
+    // Store a clip in the memory tier, evicting the least recently used clips beyond the budget
+    void Insert(const AudioCacheKey& key, std::shared_ptr<const AudioClip> clip) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        InsertLocked(key, std::move(clip));
+    }
+
+    // Render and store the audio of a key unless it is cached already
+    // Renders are serialized so the same text queued twice is synthesized once
+    bool Warm(AudioRenderer& renderer, const AudioCacheKey& key) {
+        std::lock_guard<std::mutex> renderLock(renderMutex);
+        if (Contains(key)) return true;
+        auto clip = std::make_shared<AudioClip>();
+        if (!renderer.Render(key, *clip) || clip->samples.empty()) return false;
+        Insert(key, std::move(clip));
+        return true;
+    }
+
+    // Serve misses from a serialized pack, typically a memory-mapped file
+    // Returns false if the bytes are not a pack of a supported version
+    bool AttachDisk(const uint8_t* data, size_t size) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        disk = AudioPack(data, size);
+        return disk.Valid();
+    }
+
+    // Stop reading from the pack so its mapping can be released
+    void DetachDisk() {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        disk = AudioPack();
+    }
+
+    // Clips worth persisting, most recently used first, up to a byte limit
+    // Clips still only on disk follow the memory tier so rarely used strings survive a short session
+    AudioPack::Entries Persistable(size_t byteLimit) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        AudioPack::Entries result;
+        std::unordered_set<AudioCacheKey, AudioCacheKeyHash> taken;
+        size_t total = 0;
+        auto take = [&](const AudioCacheKey& key, const std::shared_ptr<const AudioClip>& clip) {
+            if (total + clip->samples.size() > byteLimit || !taken.insert(key).second) return;
+            total += clip->samples.size();
+            result.emplace_back(key, clip);
+        };
+        for (const Entry& entry : recency) take(entry.key, entry.clip);
+        for (const auto& [key, clip] : disk.All()) take(key, clip);
+        return result;
+    }
+
+    // Record the delay from requesting an utterance to its first sample playing
+    void RecordFirstSample(bool cached, std::chrono::nanoseconds latency) {
+        (cached ? hitFirstSample : missFirstSample).Record(latency);
+    }
+
+    // Snapshot of the counters
+    AudioCacheStats Stats() {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        AudioCacheStats snapshot = stats;
+        snapshot.bytes = bytes;
+        snapshot.clips = entries.size();
+        return snapshot;
+    }
+
+    // Time to first sample for cached and synthesized utterances
+    const LatencyHistogram& HitFirstSample() const { return hitFirstSample; }
+    const LatencyHistogram& MissFirstSample() const { return missFirstSample; }
+
+    // Short human readable summary for the debug log
+    std::wstring Describe() {
+        AudioCacheStats snapshot = Stats();
+        return L"hit rate=" + std::to_wstring(static_cast<int>(snapshot.HitRate() * 100.0 + 0.5)) + L"%" +
+            L" memory=" + std::to_wstring(snapshot.hits) + L" disk=" + std::to_wstring(snapshot.diskHits) +
+            L" miss=" + std::to_wstring(snapshot.misses) + L" evicted=" + std::to_wstring(snapshot.evictions) +
+            L" bytes=" + std::to_wstring(snapshot.bytes) +
+            L"; first sample cached " + hitFirstSample.Describe() + L", synthesized " + missFirstSample.Describe();
+    }
+
+private:
+    struct Entry {
+        AudioCacheKey key;
+        std::shared_ptr<const AudioClip> clip;
+    };
+
+    void InsertLocked(const AudioCacheKey& key, std::shared_ptr<const AudioClip> clip) {
+        if (!clip || clip->samples.size() > byteBudget) return; // Would evict everything and still not fit
+        auto found = entries.find(key);
+        if (found != entries.end()) {
+            bytes -= found->second->clip->samples.size();
+            recency.erase(found->second);
+            entries.erase(found);
+        }
+        bytes += clip->samples.size();
+        recency.push_front({ key, std::move(clip) });
+        entries.emplace(key, recency.begin());
+        while (bytes > byteBudget) {
+            Entry& oldest = recency.back();
+            bytes -= oldest.clip->samples.size();
+            entries.erase(oldest.key);
+            recency.pop_back();
+            ++stats.evictions;
+        }
+    }
+
+    size_t byteBudget; // Sample bytes the memory tier may hold
+    std::mutex cacheMutex; // Guards the memory tier, the pack view and the counters
+    std::mutex renderMutex; // Serializes Warm
+    std::list<Entry> recency; // Memory tier, most recently used first
+    std::unordered_map<AudioCacheKey, std::list<Entry>::iterator, AudioCacheKeyHash> entries; // Position of each key in recency
+    size_t bytes{ 0 }; // Sample bytes held in memory
+    AudioPack disk; // On-disk tier
+    AudioCacheStats stats; // Lookup and eviction counters
+    LatencyHistogram hitFirstSample; // Time to first sample when the clip was cached
+    LatencyHistogram missFirstSample; // Time to first sample when the text was synthesized
+};
+
+#endif // SIGHTSPEAK_AUDIO_CACHE_HPP
@@ -0,0 +1,25 @@
+#include <cstring>
+#include <iostream>
+#include "benchmark-suite.hpp"
+
+// Portable benchmark runner, writes one JSON line per measurement to standard output
+// Needs no desktop session; --quick shrinks every workload, --cursor-trace replays a recorded mouse path
+int main(int argc, char** argv) {
+    BenchmarkSettings settings;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            std::string trace = settings.cursorTrace;
+            settings = BenchmarkSettings::Quick();
+            settings.cursorTrace = trace;
+        }
+        else if (std::strcmp(argv[i], "--cursor-trace") == 0 && i + 1 < argc) {
+            settings.cursorTrace = argv[++i];
+        }
+        else {
+            std::cerr << "usage: sightspeak-bench [--quick] [--cursor-trace file]\n";
+            return 2;
+        }
+    }
+    BenchmarkSuite::Run(std::cout, settings);
+    return 0;
+}
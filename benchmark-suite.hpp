@@ -0,0 +1,1482 @@
+#ifndef SIGHTSPEAK_BENCHMARK_SUITE_HPP
+#define SIGHTSPEAK_BENCHMARK_SUITE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "app-profile.hpp"
+#include "async-log.hpp"
+#include "cancellation.hpp"
+#include "component-holder.hpp"
+#include "cursor-prediction.hpp"
+#include "element-provider.hpp"
+#include "hover-scheduler.hpp"
+#include "latency-histogram.hpp"
+#include "parallel-traversal.hpp"
+#include "spatial-index.hpp"
+#include "speech-backend.hpp"
+#include "task-lanes.hpp"
+#include "text-arena.hpp"
+#include "text-fingerprint.hpp"
+#include "text-normalize.hpp"
+#include "traversal-budget.hpp"
+#include "tree-mirror.hpp"
+#include "utterance-batch.hpp"
+#include "work-queue.hpp"
+
+// Layout of a generated accessibility tree
+enum class TreeShape {
+    Wide, // Few levels, thousands of children per element, like a huge list or grid
+    Deep, // Long chains with occasional forks, like nested groups or a deep file tree
+    Application, // Windows of toolbars, lists, trees and documents with the label repetition of real applications
+    Browser, // Long web page of sections, mostly scrolled out of view, with collapsed menus that have no area
+    Form // Fields nested a dozen layout panels deep, like a WPF form
+};
+
+// Builds deterministic accessibility trees of a given shape and size in a MockElementProvider
+class SyntheticTree {
+public:
+    // Control type identifiers as UI Automation reports them
+    static constexpr int ButtonControl = 50000;
+    static constexpr int EditControl = 50004;
+    static constexpr int HyperlinkControl = 50005;
+    static constexpr int ImageControl = 50006;
+    static constexpr int ListItemControl = 50007;
+    static constexpr int ListControl = 50008;
+    static constexpr int MenuControl = 50009;
+    static constexpr int MenuItemControl = 50011;
+    static constexpr int ScrollBarControl = 50014;
+    static constexpr int TextControl = 50020;
+    static constexpr int ToolBarControl = 50021;
+    static constexpr int TreeControl = 50023;
+    static constexpr int TreeItemControl = 50024;
+    static constexpr int GroupControl = 50026;
+    static constexpr int ThumbControl = 50027;
+    static constexpr int DocumentControl = 50030;
+    static constexpr int WindowControl = 50032;
+    static constexpr int PaneControl = 50033;
+
+    // Add a tree of the given shape with exactly nodes elements and return the index of its root
+    // The same shape, size and seed always produce the same tree
+    static int Build(MockElementProvider& provider, TreeShape shape, size_t nodes, uint32_t seed = 1) {
+        Generator generator{ provider, seed, provider.Size() + (nodes ? nodes : 1) };
+        int root = generator.Add(-1, L"Desktop", PaneControl);
+        switch (shape) {
+        case TreeShape::Wide: generator.BuildWide(root); break;
+        case TreeShape::Deep: generator.BuildDeep(root); break;
+        case TreeShape::Application: generator.BuildApplication(root); break;
+        case TreeShape::Browser: generator.BuildBrowser(root); break;
+        case TreeShape::Form: generator.BuildForm(root); break;
+        }
+        return root;
+    }
+
+    static const char* ShapeName(TreeShape shape) {
+        switch (shape) {
+        case TreeShape::Wide: return "wide";
+        case TreeShape::Deep: return "deep";
+        case TreeShape::Application: return "application";
+        case TreeShape::Browser: return "browser";
+        case TreeShape::Form: return "form";
+        }
+        return "unknown";
+    }
+
+private:
+    struct Generator {
+        MockElementProvider& provider;
+        uint32_t state; // Linear congruential generator state
+        size_t limit; // Provider size at which generation stops
+
+        bool Full() const { return provider.Size() >= limit; }
+
+        uint32_t Next(uint32_t bound) {
+            state = state * 1664525u + 1013904223u;
+            return bound ? (state >> 8) % bound : 0;
+        }
+
+        int Add(int parent, std::wstring name, int controlType, std::wstring text = std::wstring()) {
+            long index = static_cast<long>(provider.Size());
+            ElementRect rect{ (index % 64) * 30, (index / 64 % 64) * 20, (index % 64) * 30 + 28, (index / 64 % 64) * 20 + 18 };
+            return provider.AddElement(parent, std::move(name), rect, controlType, std::move(text));
+        }
+
+        int AddAt(int parent, std::wstring name, int controlType, ElementRect rect) {
+            return provider.AddElement(parent, std::move(name), rect, controlType);
+        }
+
+        void BuildWide(int root) {
+            const size_t fanout = 4096;
+            std::vector<int> parents{ root };
+            for (size_t next = 0; !Full(); ++next) {
+                int parent = parents[next / fanout];
+                parents.push_back(Add(parent, L"Cell " + std::to_wstring(provider.Size()), ListItemControl));
+            }
+        }
+
+        void BuildDeep(int root) {
+            std::vector<int> recent{ root }; // Forks attach to one of the last few elements, so chains stay long
+            while (!Full()) {
+                size_t back = Next(3);
+                int parent = recent[recent.size() - 1 - (back < recent.size() ? back : recent.size() - 1)];
+                recent.push_back(Add(parent, L"Group " + std::to_wstring(provider.Size()), PaneControl));
+                if (recent.size() > 8) recent.erase(recent.begin());
+            }
+        }
+
+        void BuildBrowser(int root) {
+            const long viewport = 1080; // Elements starting below this are scrolled out of view
+            int window = AddAt(root, L"Browser", WindowControl, { 0, 0, 1920, viewport });
+            int scrollBar = AddAt(window, L"Vertical", ScrollBarControl, { 1900, 0, 1920, viewport });
+            AddAt(scrollBar, L"Thumb", ThumbControl, { 1900, 0, 1920, 40 });
+            int page = AddAt(window, L"Page", DocumentControl, { 0, 0, 1900, viewport });
+            long y = 0;
+            for (int section = 1; !Full(); ++section) {
+                if (Next(4) == 0) { // Collapsed navigation menu, present in the tree but without area
+                    int menu = AddAt(page, L"", MenuControl, {});
+                    for (uint32_t i = 10 + Next(20); i > 0 && !Full(); --i) AddAt(menu, L"Menu entry", MenuItemControl, {});
+                    continue;
+                }
+                int group = AddAt(page, L"", GroupControl, { 0, y, 1900, y + 400 });
+                if (y >= viewport) provider.SetOffscreen(group, true);
+                for (uint32_t i = 4 + Next(12); i > 0 && !Full(); --i) {
+                    int kind = static_cast<int>(Next(3));
+                    int element = AddAt(group, kind == 0 ? L"Link " + std::to_wstring(section) + L"." + std::to_wstring(i) :
+                        kind == 1 ? L"Paragraph of section " + std::to_wstring(section) : L"Picture",
+                        kind == 0 ? HyperlinkControl : kind == 1 ? TextControl : ImageControl, { 20, y, 1880, y + 24 });
+                    if (y >= viewport) provider.SetOffscreen(element, true);
+                    y += 28;
+                }
+            }
+        }
+
+        void BuildForm(int root) {
+            int window = AddAt(root, L"Settings", WindowControl, { 0, 0, 1920, 1080 });
+            long y = 0;
+            for (int field = 1; !Full(); ++field) {
+                int panel = window;
+                for (uint32_t level = 6 + Next(8); level > 0 && !Full(); --level) { // Layout panels carry no name
+                    panel = AddAt(panel, L"", level % 2 ? PaneControl : GroupControl, { 10, y % 1000, 1900, y % 1000 + 40 });
+                }
+                if (!Full()) AddAt(panel, L"Option " + std::to_wstring(field), TextControl, { 20, y % 1000, 400, y % 1000 + 30 });
+                if (!Full()) AddAt(panel, L"Value " + std::to_wstring(field), EditControl, { 420, y % 1000, 900, y % 1000 + 30 });
+                y += 40;
+            }
+        }
+
+        void BuildApplication(int root) {
+            static const wchar_t* const commonLabels[] = { L"OK", L"Cancel", L"Apply", L"Save", L"Open", L"Close", L"Back",
+                L"Forward", L"Refresh", L"Search", L"Settings", L"Help", L"New", L"Delete", L"Edit", L"View" };
+            const size_t labelCount = sizeof(commonLabels) / sizeof(commonLabels[0]);
+            for (int window = 1; !Full(); ++window) {
+                int windowIndex = Add(root, L"Window " + std::to_wstring(window), WindowControl);
+                uint32_t panes = 3 + Next(6);
+                for (uint32_t pane = 0; pane < panes && !Full(); ++pane) {
+                    int paneIndex = Add(windowIndex, L"Pane", PaneControl);
+                    switch (Next(4)) {
+                    case 0: { // Toolbar of buttons sharing the same few labels across windows
+                        int toolbar = Add(paneIndex, L"Toolbar", ToolBarControl);
+                        for (uint32_t i = 5 + Next(16); i > 0 && !Full(); --i) {
+                            Add(toolbar, commonLabels[Next(labelCount)], ButtonControl);
+                        }
+                        break;
+                    }
+                    case 1: { // Long list of mostly distinct items
+                        int list = Add(paneIndex, L"List", ListControl);
+                        for (uint32_t i = 0, count = 20 + Next(480); i < count && !Full(); ++i) {
+                            Add(list, L"Item " + std::to_wstring(i), ListItemControl);
+                        }
+                        break;
+                    }
+                    case 2: { // Tree view with groups of items
+                        int tree = Add(paneIndex, L"Tree", TreeControl);
+                        for (uint32_t group = 0, groups = 5 + Next(16); group < groups && !Full(); ++group) {
+                            int groupIndex = Add(tree, L"Folder " + std::to_wstring(group), TreeItemControl);
+                            for (uint32_t i = 0, count = 5 + Next(26); i < count && !Full(); ++i) {
+                                Add(groupIndex, L"File " + std::to_wstring(group) + L"." + std::to_wstring(i), TreeItemControl);
+                            }
+                        }
+                        break;
+                    }
+                    default: { // Document with labels around it
+                        for (uint32_t i = 3 + Next(8); i > 0 && !Full(); --i) {
+                            Add(paneIndex, L"Status: ready", TextControl);
+                        }
+                        if (!Full()) {
+                            Add(paneIndex, L"Document", DocumentControl,
+                                L"First paragraph of window " + std::to_wstring(window) + L".\n\nSecond paragraph, a little longer than the first one.");
+                        }
+                        break;
+                    }
+                    }
+                }
+            }
+        }
+    };
+};
+
+// Generates mouse paths made of pointing movements between targets
+// Each reach follows the bell-shaped speed profile of human pointing, takes longer for far and small targets as
+// Fitts' law predicts, and now and then falls short and ends with a corrective submovement
+class SyntheticCursorTrace {
+public:
+    // Path visiting randomly chosen targets, resting on each one for the given time; the same seed gives the same path
+    static std::vector<CursorSample> Reaches(const std::vector<ElementRect>& targets, size_t reaches, std::chrono::milliseconds rest,
+        uint32_t seed = 1, std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::time_point()) {
+        std::vector<CursorSample> samples;
+        if (targets.empty()) return samples;
+        uint32_t state = seed;
+        auto next = [&state](uint32_t bound) {
+            state = state * 1664525u + 1013904223u;
+            return bound ? (state >> 8) % bound : 0;
+        };
+        double x = 0.0, y = 0.0;
+        double now = 0.0; // Milliseconds since origin
+        for (size_t reach = 0; reach < reaches; ++reach) {
+            const ElementRect& target = targets[next(static_cast<uint32_t>(targets.size()))];
+            double width = static_cast<double>(target.right - target.left);
+            double height = static_cast<double>(target.bottom - target.top);
+            double goalX = target.left + width * (0.25 + next(51) / 100.0); // Somewhere in the middle half of the target
+            double goalY = target.top + height * (0.25 + next(51) / 100.0);
+            if (next(3) == 0) { // Undershoot by a tenth, then correct
+                Move(samples, origin, now, x, y, x + (goalX - x) * 0.9, y + (goalY - y) * 0.9, width, next);
+            }
+            Move(samples, origin, now, x, y, goalX, goalY, width, next);
+            now += static_cast<double>(rest.count()); // Resting cursors report nothing
+        }
+        return samples;
+    }
+
+private:
+    template <typename Random>
+    static void Move(std::vector<CursorSample>& samples, std::chrono::steady_clock::time_point origin, double& now,
+        double& x, double& y, double toX, double toY, double width, Random& next) {
+        const double period = 8.0; // Milliseconds between reports of a 125 Hz mouse
+        double distance = std::sqrt((toX - x) * (toX - x) + (toY - y) * (toY - y));
+        double duration = 100.0 + 120.0 * std::log2(distance / (width > 1.0 ? width : 1.0) + 1.0);
+        double bend = (static_cast<double>(next(41)) - 20.0) / 200.0; // Hands move on slightly curved paths
+        double fromX = x, fromY = y;
+        for (double t = period; t < duration + period; t += period) {
+            double tau = t < duration ? t / duration : 1.0;
+            double s = tau * tau * tau * (10.0 - 15.0 * tau + 6.0 * tau * tau); // Minimum jerk position along the path
+            double arc = bend * distance * 4.0 * s * (1.0 - s);
+            double px = fromX + (toX - fromX) * s - (toY - fromY) / (distance > 0 ? distance : 1.0) * arc;
+            double py = fromY + (toY - fromY) * s + (toX - fromX) / (distance > 0 ? distance : 1.0) * arc;
+            samples.push_back({ std::lround(px), std::lround(py),
+                origin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(now + t)) });
+        }
+        now += duration + period;
+        x = toX;
+        y = toY;
+    }
+};
+
+// Builds deterministic screen layouts of overlapping windows, each split into panes of list rows and toolbar buttons
+// Long lists run past the bottom of their window, as scrolled content does, and every window spans many grid cells
+class SyntheticLayout {
+public:
+    // Rectangles of a layout with exactly the given count, in the order a traversal would index them
+    static std::vector<ElementRect> Build(size_t count, uint32_t seed = 1) {
+        std::vector<ElementRect> rects;
+        rects.reserve(count);
+        uint32_t state = seed;
+        auto next = [&state](uint32_t bound) {
+            state = state * 1664525u + 1013904223u;
+            return bound ? static_cast<long>((state >> 8) % bound) : 0L;
+        };
+        while (rects.size() < count) {
+            long left = next(3840 + 1920) - 1920; // A second monitor left of the primary one has negative coordinates
+            long top = next(2160 - 200);
+            long width = 400 + next(1200), height = 300 + next(700);
+            rects.push_back({ left, top, left + width, top + height });
+            long half = width / 2;
+            for (int pane = 0; pane < 2 && rects.size() < count; ++pane) {
+                long paneLeft = left + pane * half;
+                rects.push_back({ paneLeft, top + 30, paneLeft + half, top + height });
+                long rows = 20 + next(400); // Items of the pane, most of them scrolled below the window
+                for (long row = 0; row < rows && rects.size() < count; ++row) {
+                    long rowTop = top + 60 + row * 22;
+                    if (pane == 0) {
+                        for (long button = 0; button < 3 && rects.size() < count; ++button) {
+                            rects.push_back({ paneLeft + 4 + button * 60, rowTop, paneLeft + 60 + button * 60, rowTop + 20 });
+                        }
+                    }
+                    else {
+                        rects.push_back({ paneLeft + 4, rowTop, paneLeft + half - 4, rowTop + 20 });
+                    }
+                }
+            }
+        }
+        return rects;
+    }
+};
+
+// One measurement, written as a single JSON object per line so runs can be diffed and compared by scripts
+struct BenchmarkRecord {
+    std::string benchmark; // Name of the benchmark
+    std::vector<std::pair<std::string, std::string>> labels; // Parameters the measurement was taken with
+    std::vector<std::pair<std::string, double>> metrics; // Measured values
+
+    void Write(std::ostream& out) const {
+        out << "{\"benchmark\":\"" << benchmark << "\"";
+        for (const auto& [key, value] : labels) out << ",\"" << key << "\":\"" << value << "\"";
+        for (const auto& [key, value] : metrics) out << ",\"" << key << "\":" << value;
+        out << "}\n";
+        out.flush();
+    }
+};
+
+// Settings of a benchmark run
+struct BenchmarkSettings {
+    std::vector<TreeShape> shapes{ TreeShape::Wide, TreeShape::Deep, TreeShape::Application };
+    std::vector<size_t> sizes{ 1000, 10000, 100000, 1000000 }; // Elements per generated tree
+    int repetitions{ 3 }; // Runs per measurement, the median is reported
+    size_t queueItems{ 1000000 }; // Texts pushed through the speech queue per run
+    int cancelRounds{ 200 }; // Cancellations timed against speech in progress
+    size_t parallelNodes{ 2000 }; // Elements of the application tree walked with injected call latency
+    std::chrono::microseconds callLatency{ 20 }; // Latency of every simulated round trip in the parallel walk
+    std::vector<size_t> parallelHelpers{ 1, 3, 7 }; // Helper counts the parallel walk is timed with
+    size_t budgetNodes{ 5000 }; // Elements of the trees walked with and without a traversal budget
+    size_t predictionReaches{ 20 }; // Pointing movements in the synthetic mouse trace, replayed in real time
+    std::chrono::microseconds hitTestLatency{ 5000 }; // Time to resolve the element under a point in the replayed layout
+    std::string cursorTrace; // Recorded mouse path to replay instead of the synthetic one, as written by CursorTrace
+    size_t profileApps{ 256 }; // Applications in the generated profile pack, the most a ProfileStore persists
+    std::string profileFile{ "benchmark-profiles.bin" }; // Scratch file the profile pack is saved to and loaded from
+    int corruptionRounds{ 200 }; // Damaged copies of the profile pack opened per run
+    std::chrono::milliseconds componentStartup{ 25 }; // Construction time of each stub component, like creating UI Automation or a voice
+    int swapRounds{ 20 }; // Rebuilds of the stub component while readers call it, per strategy
+    unsigned swapReaders{ 4 }; // Threads calling the stub component during the rebuilds
+    size_t batchItems{ 96 }; // Toolbar labels spoken per run, each on its own and merged
+    std::chrono::microseconds speechStartup{ 3000 }; // Time the fake backend takes to start each utterance
+    int preemptRounds{ 40 }; // Merged utterances stopped midway per preemption policy
+    std::vector<size_t> spatialSizes{ 10000, 100000, 1000000 }; // Rectangles per generated screen layout
+    size_t spatialQueries{ 100000 }; // Points resolved per layout through the index
+    size_t scanQueries{ 200 }; // Points resolved per layout by scanning every rectangle, for comparison
+    size_t normalizeUnits{ 1 << 23 }; // UTF-16 code units in each generated normalization corpus
+    size_t laneTasks{ 1000 }; // Interactive tasks timed against a flood of background tasks, per pool layout
+    std::chrono::microseconds backgroundBlock{ 2000 }; // Time each background task blocks, like a call into a hung application
+    size_t logCalls{ 200000 }; // Records each logging thread writes through the asynchronous log
+    size_t naiveLogCalls{ 2000 }; // Records each thread appends by reopening the file, as the reader logged before
+    std::string logFile{ "benchmark.log" }; // Scratch file both loggers append to
+
+    // Every workload shrunk to run in seconds, for smoke runs on build machines
+    static BenchmarkSettings Quick() {
+        BenchmarkSettings quick;
+        quick.sizes = { 1000, 10000 };
+        quick.repetitions = 1;
+        quick.queueItems = 100000;
+        quick.cancelRounds = 20;
+        quick.parallelNodes = 300;
+        quick.parallelHelpers = { 1, 3 };
+        quick.budgetNodes = 1000;
+        quick.predictionReaches = 4;
+        quick.profileApps = 32;
+        quick.corruptionRounds = 20;
+        quick.swapRounds = 4;
+        quick.batchItems = 32;
+        quick.preemptRounds = 8;
+        quick.spatialSizes = { 10000, 100000 };
+        quick.spatialQueries = 10000;
+        quick.scanQueries = 50;
+        quick.normalizeUnits = 1 << 20;
+        quick.laneTasks = 100;
+        quick.logCalls = 20000;
+        quick.naiveLogCalls = 200;
+        return quick;
+    }
+};
+
+// Benchmarks of the platform independent core, run against generated trees, the mock provider and the fake speech backend
+// Needs no desktop session, so regressions can be caught on any build machine
+class BenchmarkSuite {
+public:
+    // Run every benchmark and write one JSON line per measurement
+    static void Run(std::ostream& out, const BenchmarkSettings& settings = BenchmarkSettings()) {
+        for (TreeShape shape : settings.shapes) {
+            for (size_t size : settings.sizes) {
+                MockElementProvider provider;
+                ElementHandle root = provider.Handle(SyntheticTree::Build(provider, shape, size));
+                Traversal(out, settings, provider, root, shape, TraversalMode::Live);
+                Traversal(out, settings, provider, root, shape, TraversalMode::Batched);
+                Dedup(out, settings, provider, root, shape);
+                Mirror(out, settings, provider, root, shape);
+                Arena(out, settings, provider, root, shape);
+            }
+        }
+        for (size_t helpers : settings.parallelHelpers) ParallelTraversal(out, settings, helpers);
+        for (TreeShape shape : { TreeShape::Browser, TreeShape::Form, TreeShape::Application }) Budget(out, settings, shape);
+        for (size_t size : settings.spatialSizes) Spatial(out, settings, size);
+        Prediction(out, settings);
+        Profiles(out, settings);
+        HotSwap(out, settings);
+        Queue(out, settings, 1);
+        Queue(out, settings, 4);
+        Lanes(out, settings, true);
+        Lanes(out, settings, false);
+        Logging(out, settings, 1);
+        Logging(out, settings, 4);
+        Cancellation(out, settings);
+        Batching(out, settings);
+        for (const char* corpus : { "prose", "labels", "mixed" }) Normalization(out, settings, corpus);
+    }
+
+    // Walk a whole tree the way CollectElementsBFS does, recording each name in a fingerprint set
+    static void Traversal(std::ostream& out, const BenchmarkSettings& settings, MockElementProvider& provider, const ElementHandle& root,
+        TreeShape shape, TraversalMode mode) {
+        TextFingerprintSet processedTexts;
+        size_t visited = 0;
+        size_t queued = 0;
+        std::vector<double> runs;
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            processedTexts.Reset();
+            provider.ResetRoundTrips();
+            visited = 0;
+            queued = 0;
+            auto started = std::chrono::steady_clock::now();
+            TraverseSubtree(provider, root, std::numeric_limits<int>::max(), mode, [&](const ElementSnapshot& element) {
+                ++visited;
+                if (!element.name.empty() && processedTexts.Insert(element.name)) ++queued;
+                return true;
+            });
+            runs.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+        }
+        double median = Median(runs);
+        BenchmarkRecord record{ "traversal", TreeLabels(shape, provider.Size()), {} };
+        record.labels.push_back({ "mode", mode == TraversalMode::Live ? "live" : "batched" });
+        record.metrics = { { "ns_per_node", visited ? median / static_cast<double>(visited) : 0.0 }, { "total_ms", median / 1e6 },
+            { "visited", static_cast<double>(visited) }, { "queued_texts", static_cast<double>(queued) },
+            { "round_trips", static_cast<double>(provider.RoundTrips()) } };
+        record.Write(out);
+    }
+
+    // Walk an application tree over a provider with per-call latency, serially and with helpers stealing work
+    // Reports the speedup of the whole walk and how soon the first elements reach the visitor
+    static void ParallelTraversal(std::ostream& out, const BenchmarkSettings& settings, size_t helpers) {
+        MockElementProvider provider;
+        ElementHandle root = provider.Handle(SyntheticTree::Build(provider, TreeShape::Application, settings.parallelNodes));
+        provider.SetCallLatency(settings.callLatency);
+        const size_t firstItems = 50; // Elements a reader needs before speech can start
+
+        auto walk = [&](bool parallel, double& firstMs) {
+            std::vector<std::thread> threads;
+            ParallelFrontier::Launcher launch = [&threads](std::function<void()> help) { threads.emplace_back(std::move(help)); };
+            size_t visited = 0;
+            firstMs = 0.0;
+            auto started = std::chrono::steady_clock::now();
+            auto visit = [&](const ElementSnapshot&) {
+                if (++visited == firstItems) firstMs = Nanoseconds(std::chrono::steady_clock::now() - started) / 1e6;
+                return true;
+            };
+            if (parallel) ParallelTraverseSubtree(provider, root, std::numeric_limits<int>::max(), helpers, launch, visit);
+            else TraverseSubtree(provider, root, std::numeric_limits<int>::max(), TraversalMode::Live, visit);
+            double totalMs = Nanoseconds(std::chrono::steady_clock::now() - started) / 1e6;
+            for (std::thread& thread : threads) thread.join();
+            return totalMs;
+        };
+
+        std::vector<double> serialRuns, parallelRuns, serialFirst, parallelFirst;
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            double first = 0.0;
+            serialRuns.push_back(walk(false, first));
+            serialFirst.push_back(first);
+            parallelRuns.push_back(walk(true, first));
+            parallelFirst.push_back(first);
+        }
+        double serial = Median(serialRuns);
+        double parallel = Median(parallelRuns);
+        BenchmarkRecord record{ "parallel_traversal", TreeLabels(TreeShape::Application, provider.Size()), {} };
+        record.labels.push_back({ "helpers", std::to_string(helpers) });
+        record.labels.push_back({ "call_latency_us", std::to_string(settings.callLatency.count()) });
+        record.metrics = { { "serial_ms", serial }, { "parallel_ms", parallel }, { "speedup", parallel > 0 ? serial / parallel : 0.0 },
+            { "serial_first_ms", Median(serialFirst) }, { "parallel_first_ms", Median(parallelFirst) } };
+        record.Write(out);
+    }
+
+    // Walk a tree from its root once with the fixed depth the reader used to stop at and once under a traversal budget,
+    // both live with per-call latency and batched; reports how much each walk read, what the budget pruned and how long it took
+    // Batched walks under a budget also report the round trips of the unbudgeted whole-subtree request they should match
+    static void Budget(std::ostream& out, const BenchmarkSettings& settings, TreeShape shape) {
+        MockElementProvider provider;
+        ElementHandle root = provider.Handle(SyntheticTree::Build(provider, shape, settings.budgetNodes));
+        provider.SetCallLatency(settings.callLatency);
+        const int fixedDepth = 6; // Depth limit the reader used before traversals had a budget
+        TraversalBudget budget;
+        ElementFilter filter;
+        filter.skipOffscreen = true;
+        filter.skipEmpty = true;
+        for (int type = SyntheticTree::ButtonControl; type <= SyntheticTree::ButtonControl + 40; ++type) { // Every control type but the text-free ones
+            if (type != SyntheticTree::ScrollBarControl && type != SyntheticTree::ThumbControl && type != SyntheticTree::ButtonControl + 38) filter.controlTypes.push_back(type);
+        }
+        provider.ResetRoundTrips();
+        TraverseSubtree(provider, root, std::numeric_limits<int>::max(), TraversalMode::Batched, [](const ElementSnapshot&) { return true; });
+        size_t subtreeRoundTrips = provider.RoundTrips();
+
+        for (TraversalMode mode : { TraversalMode::Live, TraversalMode::Batched }) {
+            for (bool budgeted : { false, true }) {
+                provider.SetQueryFilter(budgeted ? filter : ElementFilter());
+                provider.ResetRoundTrips();
+                size_t visited = 0;
+                size_t texts = 0;
+                auto visit = [&](const ElementSnapshot& element) {
+                    ++visited;
+                    if (!element.name.empty()) ++texts;
+                    return true;
+                };
+                TraversalGovernor governor(budget, filter);
+                auto started = std::chrono::steady_clock::now();
+                if (budgeted) TraverseWithinBudget(provider, root, mode, governor, visit);
+                else TraverseSubtree(provider, root, fixedDepth, mode, visit);
+                double ms = Nanoseconds(std::chrono::steady_clock::now() - started) / 1e6;
+                const TraversalReport& report = governor.Finish();
+
+                BenchmarkRecord record{ "budget", TreeLabels(shape, provider.Size()), {} };
+                record.labels.push_back({ "mode", mode == TraversalMode::Live ? "live" : "batched" });
+                record.labels.push_back({ "limit", budgeted ? "budget" : "depth" });
+                record.metrics = { { "visited", static_cast<double>(visited) }, { "texts", static_cast<double>(texts) }, { "ms", ms },
+                    { "round_trips", static_cast<double>(provider.RoundTrips()) } };
+                if (budgeted) {
+                    record.metrics.push_back({ "pruned_offscreen", static_cast<double>(report.Pruned(PruneReason::Offscreen)) });
+                    record.metrics.push_back({ "pruned_empty", static_cast<double>(report.Pruned(PruneReason::Empty)) });
+                    record.metrics.push_back({ "pruned_control_type", static_cast<double>(report.Pruned(PruneReason::ControlType)) });
+                    record.metrics.push_back({ "pruned_budget", static_cast<double>(report.Pruned(PruneReason::Budget)) });
+                    if (mode == TraversalMode::Batched) record.metrics.push_back({ "subtree_round_trips", static_cast<double>(subtreeRoundTrips) });
+                }
+                record.Write(out);
+            }
+        }
+        provider.SetQueryFilter(ElementFilter());
+    }
+
+    // Replay a mouse path through the hover scheduler in real time, once resolving every hit test on the spot and once
+    // claiming it from speculations started along the way; reports the hit rate and hover-to-hit-test latency of both
+    // The layout is a window of toolbars whose buttons the synthetic path points at; a recorded path is replayed over it as is
+    static void Prediction(std::ostream& out, const BenchmarkSettings& settings) {
+        MockElementProvider provider;
+        int root = provider.AddElement(-1, L"Window", { 0, 0, 1920, 1080 }, SyntheticTree::WindowControl);
+        std::vector<ElementRect> buttons;
+        for (long row = 0; row < 8; ++row) {
+            long top = 60 + row * 125;
+            int toolbar = provider.AddElement(root, L"Toolbar", { 40, top, 1880, top + 48 }, SyntheticTree::ToolBarControl);
+            for (long column = 0; column < 14; ++column) {
+                ElementRect rect{ 48 + column * 130, top + 8, 48 + column * 130 + 110, top + 40 };
+                provider.AddElement(toolbar, L"Button " + std::to_wstring(buttons.size()), rect, SyntheticTree::ButtonControl);
+                buttons.push_back(rect);
+            }
+        }
+        SpatialIndex layout; // Stands in for ElementFromPoint, the smallest element under a point is the deepest one
+        for (size_t index = 0; index < provider.Size(); ++index) {
+            ElementSnapshot snapshot;
+            provider.FetchElement(provider.Handle(static_cast<int>(index)), snapshot);
+            layout.Insert(static_cast<uint32_t>(index), snapshot.rect);
+        }
+        auto elementAt = [&](long x, long y) {
+            std::optional<uint32_t> id = layout.Query(x, y);
+            return id ? provider.Handle(static_cast<int>(*id)) : ElementHandle();
+        };
+
+        HoverPolicy hoverPolicy;
+        std::vector<CursorSample> trace;
+        std::string source = "synthetic";
+        if (!settings.cursorTrace.empty()) {
+            std::ifstream file(settings.cursorTrace);
+            trace = CursorTrace::Read(file);
+            source = "recorded";
+        }
+        if (trace.empty()) trace = SyntheticCursorTrace::Reaches(buttons, settings.predictionReaches, hoverPolicy.maxDelay * 2);
+
+        auto replay = [&](HoverSpeculator* speculator, uint64_t& wrong) {
+            wrong = 0;
+            HoverScheduler scheduler([&](const CursorSample& sample) {
+                ElementHandle element = speculator ? speculator->Claim(sample.x, sample.y, 1) : nullptr;
+                ElementHandle actual = elementAt(sample.x, sample.y);
+                if (!element) {
+                    std::this_thread::sleep_for(settings.hitTestLatency); // Ask the target process
+                    element = actual;
+                }
+                if (element != actual) ++wrong; // Read only after the scheduler has stopped
+                }, hoverPolicy);
+            auto origin = trace.front().time;
+            auto started = std::chrono::steady_clock::now();
+            for (const CursorSample& sample : trace) {
+                std::this_thread::sleep_until(started + (sample.time - origin));
+                scheduler.Post(sample.x, sample.y);
+                if (speculator) speculator->Post(sample.x, sample.y);
+            }
+            std::this_thread::sleep_for(hoverPolicy.maxDelay * 2); // Let the last rest be hit-tested
+            scheduler.Stop();
+            return std::make_pair(scheduler.Latency().PercentileMicros(0.50), scheduler.Latency().PercentileMicros(0.99));
+        };
+
+        std::vector<std::thread> workers;
+        HoverSpeculator speculator(
+            [&](long x, long y, const CancellationToken& token, SpeculatedArea& area) {
+                if (token.WaitFor(settings.hitTestLatency)) return false; // Cancelled while asking the target process
+                ElementHandle element = elementAt(x, y);
+                area.surface = 1;
+                return element && provider.FetchSubtree(element, std::numeric_limits<int>::max(), area.elements);
+            },
+            [&workers](std::function<void()> speculation) { workers.emplace_back(std::move(speculation)); });
+
+        uint64_t wrongOnDemand = 0, wrongSpeculated = 0;
+        auto onDemand = replay(nullptr, wrongOnDemand);
+        auto speculated = replay(&speculator, wrongSpeculated);
+        speculator.Stop();
+        for (std::thread& worker : workers) worker.join();
+
+        BenchmarkRecord record{ "prediction", { { "trace", source }, { "samples", std::to_string(trace.size()) },
+            { "hit_test_latency_us", std::to_string(settings.hitTestLatency.count()) } }, {} };
+        record.metrics = { { "hit_rate", speculator.HitRate() }, { "saved_p50_us", static_cast<double>(speculator.Saved().PercentileMicros(0.50)) },
+            { "on_demand_p50_us", static_cast<double>(onDemand.first) }, { "on_demand_p99_us", static_cast<double>(onDemand.second) },
+            { "speculated_p50_us", static_cast<double>(speculated.first) }, { "speculated_p99_us", static_cast<double>(speculated.second) },
+            { "speculations", static_cast<double>(workers.size()) }, { "wrong_elements", static_cast<double>(wrongOnDemand + wrongSpeculated) } };
+        record.Write(out);
+    }
+
+    // Index a synthetic layout, resolve random points through the index and by scanning every rectangle,
+    // then remove and reinsert a tenth of it the way an invalidated subtree is; points the two disagree on are counted
+    static void Spatial(std::ostream& out, const BenchmarkSettings& settings, size_t count) {
+        std::vector<ElementRect> rects = SyntheticLayout::Build(count);
+        std::vector<std::pair<long, long>> points;
+        uint32_t state = 3;
+        for (size_t i = 0; i < settings.spatialQueries; ++i) {
+            state = state * 1664525u + 1013904223u;
+            long x = static_cast<long>((state >> 8) % (3840 + 1920)) - 1920;
+            state = state * 1664525u + 1013904223u;
+            points.push_back({ x, static_cast<long>((state >> 8) % 2160) });
+        }
+
+        std::vector<double> insertRuns, queryRuns, removeRuns;
+        size_t hits = 0;
+        size_t mismatches = 0;
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            SpatialIndex index;
+            auto started = std::chrono::steady_clock::now();
+            for (size_t id = 0; id < rects.size(); ++id) index.Insert(static_cast<uint32_t>(id), rects[id]);
+            insertRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+
+            hits = 0;
+            started = std::chrono::steady_clock::now();
+            for (const auto& [x, y] : points) {
+                if (index.Query(x, y)) ++hits;
+            }
+            queryRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+
+            started = std::chrono::steady_clock::now();
+            for (size_t id = 0; id < rects.size(); id += 10) index.Remove(static_cast<uint32_t>(id));
+            for (size_t id = 0; id < rects.size(); id += 10) index.Insert(static_cast<uint32_t>(id), rects[id]);
+            removeRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+
+            if (run > 0) continue;
+            for (size_t i = 0; i < settings.scanQueries && i < points.size(); ++i) { // The index must still agree with a full scan
+                if (index.Query(points[i].first, points[i].second) != ScanSmallest(rects, points[i].first, points[i].second)) ++mismatches;
+            }
+        }
+
+        size_t scanned = std::min(settings.scanQueries, points.size());
+        auto scanStarted = std::chrono::steady_clock::now();
+        size_t scanHits = 0;
+        for (size_t i = 0; i < scanned; ++i) {
+            if (ScanSmallest(rects, points[i].first, points[i].second)) ++scanHits;
+        }
+        double scanNs = Nanoseconds(std::chrono::steady_clock::now() - scanStarted);
+
+        double queryNs = points.empty() ? 0.0 : Median(queryRuns) / static_cast<double>(points.size());
+        double scanQueryNs = scanned ? scanNs / static_cast<double>(scanned) : 0.0;
+        size_t churned = (rects.size() + 9) / 10;
+        BenchmarkRecord record{ "spatial_index", { { "layout", "windows" }, { "rects", std::to_string(rects.size()) } }, {} };
+        record.metrics = { { "insert_ns_per_rect", rects.empty() ? 0.0 : Median(insertRuns) / static_cast<double>(rects.size()) },
+            { "query_ns", queryNs }, { "scan_query_ns", scanQueryNs }, { "speedup", queryNs > 0 ? scanQueryNs / queryNs : 0.0 },
+            { "churn_ns_per_rect", Median(removeRuns) / static_cast<double>(2 * churned) },
+            { "hit_rate", points.empty() ? 0.0 : static_cast<double>(hits) / static_cast<double>(points.size()) },
+            { "scan_hit_rate", scanned ? static_cast<double>(scanHits) / static_cast<double>(scanned) : 0.0 },
+            { "mismatches", static_cast<double>(mismatches) } };
+        record.Write(out);
+    }
+
+    // Normalize a generated UTF-16 corpus with the vector path compiled in and one unit at a time, then split it into sentences
+    // Throughput counts input bytes; prose and labels are mostly ASCII, mixed interleaves the units that leave the fast path
+    static void Normalization(std::ostream& out, const BenchmarkSettings& settings, const std::string& corpus) {
+        std::u16string text = NormalizationCorpus(corpus, settings.normalizeUnits);
+        std::u16string normalized;
+        std::vector<std::u16string_view> sentences;
+        std::vector<double> vectorRuns, scalarRuns, splitRuns;
+        bool identical = true;
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            auto started = std::chrono::steady_clock::now();
+            TextNormalizer::Normalize(std::u16string_view(text), normalized);
+            vectorRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+
+            std::u16string reference;
+            started = std::chrono::steady_clock::now();
+            TextNormalizer::NormalizeScalar(std::u16string_view(text), reference);
+            scalarRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+            identical = identical && reference == normalized;
+
+            sentences.clear();
+            started = std::chrono::steady_clock::now();
+            TextNormalizer::SplitSentences(std::u16string_view(normalized), 300, sentences);
+            splitRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+        }
+        double bytes = static_cast<double>(text.size() * sizeof(char16_t));
+        auto gigabytesPerSecond = [bytes](double ns) { return ns > 0 ? bytes / ns : 0.0; }; // Bytes per nanosecond is GB/s
+        BenchmarkRecord record{ "normalize", { { "corpus", corpus }, { "path", TextNormalizer::VectorPath() }, { "units", std::to_string(text.size()) } }, {} };
+        record.metrics = { { "vector_gb_per_s", gigabytesPerSecond(Median(vectorRuns)) }, { "scalar_gb_per_s", gigabytesPerSecond(Median(scalarRuns)) },
+            { "split_gb_per_s", gigabytesPerSecond(Median(splitRuns)) }, { "sentences", static_cast<double>(sentences.size()) },
+            { "output_ratio", text.empty() ? 0.0 : static_cast<double>(normalized.size()) / static_cast<double>(text.size()) },
+            { "identical", identical ? 1.0 : 0.0 } };
+        record.Write(out);
+    }
+
+    // Patch a whole tree into an empty mirror and again into a full one, read it back, repair it after change
+    // notifications dirtied one element in a hundred of the deeper half, and patch it with a tenth of its elements gone
+    // The repair refetches only the dirty subtrees; it is compared with refetching and patching the whole tree
+    static void Mirror(std::ostream& out, const BenchmarkSettings& settings, MockElementProvider& provider, const ElementHandle& root, TreeShape shape) {
+        const int depth = std::numeric_limits<int>::max();
+        std::vector<ElementSnapshot> snapshots;
+        provider.FetchSubtree(root, depth, snapshots);
+        if (snapshots.empty()) return;
+        size_t capacity = snapshots.size() * 2; // Never starts over while measuring
+        std::vector<double> coldRuns, warmRuns, collectRuns;
+        size_t collected = 0;
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            TreeMirror mirror(capacity);
+            auto started = std::chrono::steady_clock::now();
+            mirror.Patch(snapshots, depth);
+            coldRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+            started = std::chrono::steady_clock::now();
+            mirror.Patch(snapshots, depth);
+            warmRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+
+            std::vector<ElementSnapshot> read, stale;
+            started = std::chrono::steady_clock::now();
+            mirror.Collect(snapshots[0].runtimeId, depth, read, stale);
+            collectRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+            collected = read.size();
+        }
+
+        TreeMirror mirror(capacity);
+        mirror.Patch(snapshots, depth);
+        for (size_t i = snapshots.size() / 2; i < snapshots.size(); i += 50) mirror.MarkDirty(snapshots[i].runtimeId); // Items and leaves change, not windows
+        size_t refetched = 0;
+        auto started = std::chrono::steady_clock::now();
+        std::vector<ElementSnapshot> read, stale, subtree;
+        mirror.Collect(snapshots[0].runtimeId, depth, read, stale);
+        size_t dirtySubtrees = stale.size();
+        for (const ElementSnapshot& element : stale) {
+            subtree.clear();
+            provider.FetchSubtree(element.handle, depth, subtree);
+            mirror.Patch(subtree, depth);
+            refetched += subtree.size();
+        }
+        read.clear();
+        stale.clear();
+        mirror.Collect(snapshots[0].runtimeId, depth, read, stale);
+        double repairNs = Nanoseconds(std::chrono::steady_clock::now() - started);
+        bool repaired = stale.empty() && read.size() == snapshots.size();
+
+        started = std::chrono::steady_clock::now();
+        subtree.clear();
+        provider.FetchSubtree(root, depth, subtree);
+        mirror.Patch(subtree, depth);
+        double refetchNs = Nanoseconds(std::chrono::steady_clock::now() - started);
+
+        size_t kept = snapshots.size() - snapshots.size() / 10; // Breadth-first order, so the parents of the kept elements are kept too
+        std::vector<ElementSnapshot> shrunk(snapshots.begin(), snapshots.begin() + kept);
+        started = std::chrono::steady_clock::now();
+        MirrorPatchStats shrink = mirror.Patch(shrunk, depth);
+        double shrinkNs = Nanoseconds(std::chrono::steady_clock::now() - started);
+
+        double perNode = 1.0 / static_cast<double>(snapshots.size());
+        BenchmarkRecord record{ "mirror", TreeLabels(shape, provider.Size()), {} };
+        record.metrics = { { "cold_patch_ns_per_node", Median(coldRuns) * perNode }, { "warm_patch_ns_per_node", Median(warmRuns) * perNode },
+            { "collect_ns_per_node", Median(collectRuns) * perNode }, { "collected", static_cast<double>(collected) },
+            { "dirty_subtrees", static_cast<double>(dirtySubtrees) }, { "repair_refetched", static_cast<double>(refetched) },
+            { "repair_ms", repairNs / 1e6 }, { "full_refetch_ms", refetchNs / 1e6 }, { "repaired", repaired ? 1.0 : 0.0 },
+            { "shrink_removed", static_cast<double>(shrink.removed) }, { "shrink_ns_per_node", shrinkNs / static_cast<double>(kept) } };
+        record.Write(out);
+    }
+
+    // Insert the names of a tree into a fresh generation of the fingerprint set, and into the set of strings it replaced;
+    // a new generation costs one increment where clearing the strings frees every node
+    static void Dedup(std::ostream& out, const BenchmarkSettings& settings, MockElementProvider& provider, const ElementHandle& root, TreeShape shape) {
+        std::vector<ElementSnapshot> snapshots;
+        provider.FetchSubtree(root, std::numeric_limits<int>::max(), snapshots);
+        TextFingerprintSet processedTexts;
+        std::unordered_set<std::wstring> processedStrings; // What the traversal kept before the fingerprint set
+        size_t fresh = 0;
+        size_t freshStrings = 0;
+        uint64_t overflows = 0;
+        std::vector<double> runs, stringRuns, resets, clears;
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            fresh = 0;
+            uint64_t overflowsBefore = processedTexts.Overflows();
+            auto started = std::chrono::steady_clock::now();
+            for (const ElementSnapshot& snapshot : snapshots) {
+                if (processedTexts.Insert(snapshot.name)) ++fresh;
+            }
+            runs.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+            overflows = processedTexts.Overflows() - overflowsBefore; // Texts the fixed budget could not hold
+            started = std::chrono::steady_clock::now();
+            processedTexts.Reset(); // Forget the full set, as the next traversal does
+            resets.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+
+            freshStrings = 0;
+            started = std::chrono::steady_clock::now();
+            for (const ElementSnapshot& snapshot : snapshots) {
+                if (processedStrings.insert(snapshot.name).second) ++freshStrings;
+            }
+            stringRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+            started = std::chrono::steady_clock::now();
+            processedStrings.clear();
+            clears.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+        }
+        double perInsert = snapshots.empty() ? 0.0 : Median(runs) / static_cast<double>(snapshots.size());
+        double perStringInsert = snapshots.empty() ? 0.0 : Median(stringRuns) / static_cast<double>(snapshots.size());
+        BenchmarkRecord record{ "dedup", TreeLabels(shape, provider.Size()), {} };
+        record.metrics = { { "ns_per_insert", perInsert }, { "unordered_set_ns_per_insert", perStringInsert },
+            { "speedup", perInsert > 0.0 ? perStringInsert / perInsert : 0.0 }, { "reset_ns", Median(resets) }, { "clear_ns", Median(clears) },
+            { "new_texts", static_cast<double>(fresh) }, { "unordered_set_new_texts", static_cast<double>(freshStrings) },
+            { "overflows", static_cast<double>(overflows) } };
+        record.Write(out);
+    }
+
+    // Carry the new texts of a tree through the speech queue to a consumer, once copied into a string per entry
+    // and once interned in a per-traversal arena; allocations and peak bytes are counted exactly for both
+    static void Arena(std::ostream& out, const BenchmarkSettings& settings, MockElementProvider& provider, const ElementHandle& root, TreeShape shape) {
+        std::vector<ElementSnapshot> snapshots;
+        provider.FetchSubtree(root, std::numeric_limits<int>::max(), snapshots);
+        TextFingerprintSet processedTexts;
+
+        struct CopiedText {
+            CountedString text;
+            ElementRect rect;
+        };
+        AllocationCount copyCount;
+        std::vector<double> copyRuns;
+        size_t texts = 0;
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            processedTexts.Reset();
+            copyCount.Reset();
+            auto started = std::chrono::steady_clock::now();
+            texts = Carry<CopiedText>(snapshots, processedTexts, [&](const ElementSnapshot& snapshot) {
+                return CopiedText{ CountedString(snapshot.name.begin(), snapshot.name.end(), CountingAllocator<wchar_t>(&copyCount)), snapshot.rect };
+            }, [](const CopiedText& text) { return text.text.size(); });
+            copyRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+        }
+
+        struct InternedText {
+            std::wstring_view text;
+            ElementRect rect;
+            std::shared_ptr<const TextArena> arena;
+        };
+        auto pool = std::make_shared<TextBlockPool>();
+        TextArenaStats cold, warm; // First run with an empty pool, last run with the blocks of the previous one
+        std::vector<double> arenaRuns;
+        for (int run = 0; run < Repetitions(settings) + 1; ++run) {
+            processedTexts.Reset();
+            auto started = std::chrono::steady_clock::now();
+            auto arena = std::make_shared<TextArena>(pool);
+            Carry<InternedText>(snapshots, processedTexts, [&](const ElementSnapshot& snapshot) {
+                return InternedText{ arena->Intern(snapshot.name), snapshot.rect, arena };
+            }, [](const InternedText& text) { return text.text.size(); });
+            (run == 0 ? cold : warm) = arena->Stats();
+            arena.reset(); // The last queued entry is gone too, so the blocks go back to the pool here
+            if (run > 0) arenaRuns.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+        }
+
+        BenchmarkRecord record{ "arena", TreeLabels(shape, provider.Size()), {} };
+        double perText = texts ? 1.0 / static_cast<double>(texts) : 0.0;
+        record.metrics = { { "texts", static_cast<double>(texts) },
+            { "copy_ns_per_text", Median(copyRuns) * perText }, { "arena_ns_per_text", Median(arenaRuns) * perText },
+            { "copy_allocations", static_cast<double>(copyCount.allocations.load()) }, { "copy_peak_bytes", static_cast<double>(copyCount.peakBytes.load()) },
+            { "arena_allocations_cold", static_cast<double>(cold.allocations) }, { "arena_allocations_warm", static_cast<double>(warm.allocations) },
+            { "arena_reused_warm", static_cast<double>(warm.reused) }, { "arena_peak_bytes", static_cast<double>(warm.reservedBytes) } };
+        record.Write(out);
+    }
+
+    // Save a full pack of application profiles, load it back as the reader does at startup and first hover,
+    // then open damaged copies to count the profiles that survive
+    static void Profiles(std::ostream& out, const BenchmarkSettings& settings) {
+        ProfileLimits limits;
+        std::vector<AppProfile> profiles;
+        uint32_t state = 7;
+        auto next = [&state](uint32_t bound) {
+            state = state * 1664525u + 1013904223u;
+            return bound ? (state >> 8) % bound : 0;
+        };
+        for (size_t app = 0; app < settings.profileApps; ++app) {
+            AppProfile profile;
+            profile.executable = L"application" + std::to_wstring(app) + L".exe";
+            for (int traversal = 0; traversal < 40; ++traversal) profile.Learn(static_cast<int>(next(12)), next(400));
+            for (size_t p = 0; p < limits.maxPaths; ++p) {
+                HotPath path;
+                for (uint32_t step = 2 + next(10); step > 0; --step) path.steps.push_back({ static_cast<int32_t>(50000 + next(40)), uint64_t{ next(UINT32_MAX) } << 16 });
+                path.hits = 1 + next(100);
+                profile.paths.push_back(std::move(path));
+            }
+            for (size_t t = 0; t < limits.maxStrings; ++t) profile.strings.push_back({ L"Spoken string " + std::to_wstring(next(100000)), 1 + next(50) });
+            profiles.push_back(std::move(profile));
+        }
+        const std::wstring probe = profiles[profiles.size() / 2].executable; // Looked up like the first hover over an application
+
+        std::vector<double> saves, reads, opens, finds;
+        std::vector<uint8_t> loaded;
+        bool learned = false; // The looked up profile changed the budget, so it was found and decoded
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            auto started = std::chrono::steady_clock::now();
+            std::vector<uint8_t> pack = ProfilePack::Serialize(profiles);
+            {
+                std::ofstream file(settings.profileFile, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char*>(pack.data()), static_cast<std::streamsize>(pack.size()));
+            }
+            saves.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+
+            started = std::chrono::steady_clock::now();
+            {
+                std::ifstream file(settings.profileFile, std::ios::binary | std::ios::ate);
+                loaded.resize(static_cast<size_t>((std::max)(std::streamoff{ 0 }, static_cast<std::streamoff>(file.tellg()))));
+                file.seekg(0);
+                file.read(reinterpret_cast<char*>(loaded.data()), static_cast<std::streamsize>(loaded.size()));
+            }
+            reads.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+
+            started = std::chrono::steady_clock::now();
+            ProfileStore store(limits);
+            store.AttachDisk(loaded.data(), loaded.size()); // What the reader does once the file is mapped
+            opens.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+
+            started = std::chrono::steady_clock::now();
+            TraversalBudget budget = store.Budget(probe, TraversalBudget());
+            finds.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+            learned = budget.maxDepth != TraversalBudget().maxDepth;
+        }
+        std::remove(settings.profileFile.c_str());
+
+        // Damage a few bytes at random, in records or anywhere; opening must never fail hard
+        size_t survived = 0, intact = 0, rejected = 0;
+        ProfilePack reference(loaded.data(), loaded.size());
+        for (int round = 0; round < settings.corruptionRounds && reference.Valid(); ++round) {
+            std::vector<uint8_t> damaged = loaded;
+            bool anywhere = round % 4 == 0;
+            size_t from = anywhere ? 0 : 16 + reference.Size() * 24; // Past the header and index
+            for (int flip = 0; flip < 4; ++flip) damaged[from + next(static_cast<uint32_t>(damaged.size() - from))] ^= static_cast<uint8_t>(1 + next(255));
+            ProfilePack pack(damaged.data(), damaged.size());
+            if (!pack.Valid()) {
+                ++rejected;
+                continue;
+            }
+            survived += pack.All().size();
+            intact += reference.Size();
+        }
+
+        BenchmarkRecord record{ "profiles", { { "apps", std::to_string(settings.profileApps) } }, {} };
+        record.metrics = { { "pack_bytes", static_cast<double>(loaded.size()) },
+            { "save_us", Median(saves) / 1000.0 }, { "read_file_us", Median(reads) / 1000.0 },
+            { "open_us", Median(opens) / 1000.0 }, { "first_lookup_us", Median(finds) / 1000.0 }, { "profile_found", learned ? 1.0 : 0.0 },
+            { "damaged_packs_rejected", static_cast<double>(rejected) },
+            { "profiles_kept_when_damaged", intact ? static_cast<double>(survived) / static_cast<double>(intact) : 0.0 } };
+        record.Write(out);
+    }
+
+    // Start two stub components one after the other and side by side, then rebuild one over and over while readers
+    // keep calling it, once published through a ComponentHolder and once released before its replacement is built
+    static void HotSwap(std::ostream& out, const BenchmarkSettings& settings) {
+        struct StubComponent {
+            explicit StubComponent(std::chrono::milliseconds startup) { std::this_thread::sleep_for(startup); }
+            void Call() { calls.fetch_add(1, std::memory_order_relaxed); }
+            std::atomic<uint64_t> calls{ 0 };
+        };
+        auto build = [&settings]() { return std::make_shared<StubComponent>(settings.componentStartup); };
+
+        std::vector<double> serial, parallel;
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            auto started = std::chrono::steady_clock::now();
+            std::shared_ptr<StubComponent> automation = build(), voice = build();
+            serial.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+
+            started = std::chrono::steady_clock::now();
+            std::thread voiceThread([&voice, &build]() { voice = build(); });
+            automation = build();
+            voiceThread.join();
+            parallel.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+        }
+
+        struct SwapResult {
+            uint64_t calls{ 0 }; // Calls made during the rebuilds
+            uint64_t failed{ 0 }; // Calls that found no instance to run on
+            size_t retiring{ 0 }; // Most replaced instances still in use at once
+        };
+        auto swap = [&settings, &build](bool hot) {
+            SwapResult result;
+            ComponentHolder<StubComponent> holder;
+            std::mutex releaseMutex; // Guards released, the way pVoiceMtx guards the voice
+            std::shared_ptr<StubComponent> released; // Instance of the release-first strategy
+            if (hot) holder.Publish(build());
+            else released = build();
+            std::atomic<uint64_t> calls{ 0 }, failed{ 0 };
+            std::atomic<bool> stopping{ false };
+            std::vector<std::thread> readers;
+            for (unsigned reader = 0; reader < settings.swapReaders; ++reader) {
+                readers.emplace_back([&]() {
+                    while (!stopping.load()) {
+                        std::shared_ptr<StubComponent> component;
+                        if (hot) {
+                            component = holder.Acquire();
+                        }
+                        else {
+                            std::lock_guard<std::mutex> lock(releaseMutex);
+                            component = released;
+                        }
+                        if (component) component->Call();
+                        else failed.fetch_add(1);
+                        calls.fetch_add(1);
+                        std::this_thread::sleep_for(std::chrono::microseconds(100)); // About the rate hovers and speech reach a component
+                    }
+                });
+            }
+            for (int round = 0; round < settings.swapRounds; ++round) {
+                std::this_thread::sleep_for(settings.componentStartup / 5);
+                if (hot) {
+                    holder.Rebuild(build);
+                    result.retiring = (std::max)(result.retiring, holder.Retiring());
+                }
+                else {
+                    {
+                        std::lock_guard<std::mutex> lock(releaseMutex);
+                        released.reset();
+                    }
+                    std::shared_ptr<StubComponent> rebuilt = build();
+                    std::lock_guard<std::mutex> lock(releaseMutex);
+                    released = std::move(rebuilt);
+                }
+            }
+            stopping.store(true);
+            for (std::thread& reader : readers) reader.join();
+            result.calls = calls.load();
+            result.failed = failed.load();
+            return result;
+        };
+        SwapResult hot = swap(true);
+        SwapResult releaseFirst = swap(false);
+
+        BenchmarkRecord record{ "hot_swap", { { "readers", std::to_string(settings.swapReaders) } }, {} };
+        record.metrics = { { "startup_serial_ms", Median(serial) / 1e6 }, { "startup_parallel_ms", Median(parallel) / 1e6 },
+            { "hot_swap_calls", static_cast<double>(hot.calls) }, { "hot_swap_failed_calls", static_cast<double>(hot.failed) },
+            { "hot_swap_retiring_peak", static_cast<double>(hot.retiring) },
+            { "release_first_calls", static_cast<double>(releaseFirst.calls) },
+            { "release_first_failed_calls", static_cast<double>(releaseFirst.failed) } };
+        record.Write(out);
+    }
+
+    // Push texts from several producers into the speech queue while one consumer drains it in batches
+    static void Queue(std::ostream& out, const BenchmarkSettings& settings, unsigned producers) {
+        struct QueuedText {
+            std::wstring text;
+            uint64_t sequence;
+        };
+        std::vector<double> runs;
+        uint64_t blocked = 0;
+        size_t perProducer = settings.queueItems / producers;
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            WorkQueue<QueuedText> queue(1024);
+            auto started = std::chrono::steady_clock::now();
+            std::thread consumer([&queue, expected = perProducer * producers]() {
+                std::vector<QueuedText> batch;
+                size_t received = 0;
+                while (received < expected && queue.WaitDrain(batch, 16)) {
+                    received += batch.size();
+                    batch.clear();
+                }
+            });
+            std::vector<std::thread> threads;
+            for (unsigned producer = 0; producer < producers; ++producer) {
+                threads.emplace_back([&queue, perProducer]() {
+                    for (size_t i = 0; i < perProducer; ++i) queue.Push({ L"Item", i });
+                });
+            }
+            for (std::thread& thread : threads) thread.join();
+            consumer.join();
+            runs.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+            blocked = queue.Blocked();
+        }
+        double median = Median(runs);
+        BenchmarkRecord record{ "queue", { { "producers", std::to_string(producers) } }, {} };
+        record.metrics = { { "items_per_second", median > 0 ? static_cast<double>(perProducer * producers) * 1e9 / median : 0.0 },
+            { "ns_per_item", perProducer ? median / static_cast<double>(perProducer * producers) : 0.0 },
+            { "producer_waits", static_cast<double>(blocked) } };
+        record.Write(out);
+    }
+
+    // Queue wait of short interactive tasks while background tasks that block keep every background worker busy,
+    // with the two lanes on their own workers and with every task sharing one pool of the same total size
+    static void Lanes(std::ostream& out, const BenchmarkSettings& settings, bool dedicated) {
+        TaskLanes lanes(dedicated ? 2 : 4, 2);
+        TaskLane backgroundLane = dedicated ? TaskLane::Background : TaskLane::Interactive;
+        LatencyHistogram wait; // Interactive tasks only, the shared lane's own histogram mixes in background tasks
+        std::atomic<bool> stopping{ false };
+        std::atomic<uint64_t> blocked{ 0 };
+        std::thread flood([&]() {
+            while (!stopping.load()) {
+                if (lanes.Queued(backgroundLane) >= 8) { // Keep a backlog without queueing without bound
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    continue;
+                }
+                lanes.Detach(backgroundLane, [&settings, &blocked]() {
+                    std::this_thread::sleep_for(settings.backgroundBlock);
+                    blocked.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+        });
+        std::this_thread::sleep_for(settings.backgroundBlock * 2); // Let the backlog build up
+        for (size_t task = 0; task < settings.laneTasks; ++task) {
+            lanes.Detach(TaskLane::Interactive, [&wait, queued = std::chrono::steady_clock::now()]() { wait.Record(std::chrono::steady_clock::now() - queued); });
+            std::this_thread::sleep_for(std::chrono::microseconds(500)); // Hovers arrive one at a time
+        }
+        stopping.store(true);
+        flood.join();
+        lanes.Wait();
+
+        BenchmarkRecord record{ "lanes", { { "pools", dedicated ? "dedicated" : "shared" } }, {} };
+        record.metrics = { { "interactive_tasks", static_cast<double>(wait.Count()) }, { "p50_us", static_cast<double>(wait.PercentileMicros(0.50)) },
+            { "p99_us", static_cast<double>(wait.PercentileMicros(0.99)) }, { "max_us", static_cast<double>(wait.MaxMicros()) },
+            { "background_tasks", static_cast<double>(blocked.load()) } };
+        record.Write(out);
+    }
+
+    // Cost per call of logging a hover line from several threads, through the asynchronous log and by opening,
+    // appending to and closing the file on every call; each ring holds a whole run, so no record is dropped for lack of room
+    static void Logging(std::ostream& out, const BenchmarkSettings& settings, unsigned threads) {
+        const std::wstring message(L"Hover element Save as (button) at 512,384 depth 3");
+        auto timeThreads = [threads](const std::function<void()>& warmUp, const std::function<void()>& work) { // Mean time of a thread's calls
+            std::vector<std::thread> workers;
+            std::vector<double> times(threads);
+            for (unsigned thread = 0; thread < threads; ++thread) {
+                workers.emplace_back([&, thread]() {
+                    warmUp(); // Creates the thread's ring outside the timed calls
+                    auto started = std::chrono::steady_clock::now();
+                    work();
+                    times[thread] = Nanoseconds(std::chrono::steady_clock::now() - started);
+                });
+            }
+            for (std::thread& worker : workers) worker.join();
+            double total = 0.0;
+            for (double time : times) total += time;
+            return total / threads;
+        };
+
+        std::vector<double> runs, flushes, naiveRuns;
+        uint64_t written = 0, dropped = 0;
+        for (int run = 0; run < Repetitions(settings); ++run) {
+            std::remove(settings.logFile.c_str());
+            LogSettings logSettings;
+            logSettings.path = settings.logFile;
+            logSettings.maxFileBytes = std::numeric_limits<uint64_t>::max();
+            logSettings.ringBytes = (settings.logCalls + 1) * (message.size() * sizeof(wchar_t) + 32);
+            AsyncLog log(logSettings);
+            runs.push_back(timeThreads([&]() { log.Write(LogLevel::Debug, message); }, [&]() {
+                for (size_t i = 0; i < settings.logCalls; ++i) log.Write(LogLevel::Debug, message);
+            }));
+            auto started = std::chrono::steady_clock::now();
+            log.Flush(); // Until every record is formatted and on disk
+            flushes.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+            written = log.Written();
+            dropped = log.Dropped();
+
+            std::remove(settings.logFile.c_str());
+            naiveRuns.push_back(timeThreads([]() {}, [&]() {
+                for (size_t i = 0; i < settings.naiveLogCalls; ++i) {
+                    std::wstringstream line;
+                    line << L"[DEBUG] " << message << std::endl;
+                    std::wofstream file(settings.logFile, std::ios::app);
+                    file << line.str();
+                }
+            }));
+        }
+        std::remove(settings.logFile.c_str());
+
+        double perCall = Median(runs) / static_cast<double>(settings.logCalls);
+        double naivePerCall = Median(naiveRuns) / static_cast<double>(settings.naiveLogCalls);
+        BenchmarkRecord record{ "logging", { { "threads", std::to_string(threads) } }, {} };
+        record.metrics = { { "ns_per_call", perCall }, { "naive_ns_per_call", naivePerCall }, { "speedup", perCall > 0.0 ? naivePerCall / perCall : 0.0 },
+            { "flush_ms", Median(flushes) / 1e6 }, { "written", static_cast<double>(written) }, { "dropped", static_cast<double>(dropped) } };
+        record.Write(out);
+    }
+
+    // Time from a cancellation request until the speaking task has returned, with speech in progress
+    static void Cancellation(std::ostream& out, const BenchmarkSettings& settings) {
+        FakeSpeechBackend backend(std::chrono::microseconds(100));
+        CancellationSource cancellation;
+        LatencyHistogram latency;
+        std::atomic<uint64_t> silenced{ 0 }; // Utterances ended by a cancellation
+        std::atomic<int64_t> silencedAt{ 0 }; // When the last one returned, in steady clock ticks
+        std::atomic<bool> stopping{ false };
+        std::thread speaker([&]() {
+            const std::wstring text(L"A long sentence that keeps the fake synthesizer busy for a good while before it ends.");
+            while (!stopping.load()) {
+                CancellationToken token = cancellation.Token();
+                if (!token.IsCancelled()) SpeakAndWait(backend, text); // Checked first, as SpeakTextTask does
+                if (token.IsCancelled()) {
+                    silencedAt.store(std::chrono::steady_clock::now().time_since_epoch().count());
+                    silenced.fetch_add(1);
+                }
+            }
+        });
+        for (int round = 0; round < settings.cancelRounds; ++round) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1 + round % 4)); // Land at varying points of the utterance
+            uint64_t before = silenced.load();
+            auto requested = std::chrono::steady_clock::now();
+            cancellation.Cancel();
+            backend.Purge();
+            while (silenced.load() == before) std::this_thread::yield();
+            auto returned = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(silencedAt.load()));
+            latency.Record(returned - requested);
+        }
+        stopping.store(true);
+        backend.Purge();
+        speaker.join();
+
+        BenchmarkRecord record{ "cancellation", { { "backend", "fake" } }, {} };
+        record.metrics = { { "rounds", static_cast<double>(latency.Count()) }, { "p50_us", static_cast<double>(latency.PercentileMicros(0.50)) },
+            { "p99_us", static_cast<double>(latency.PercentileMicros(0.99)) }, { "max_us", static_cast<double>(latency.MaxMicros()) } };
+        record.Write(out);
+    }
+
+    // Speak a toolbar's worth of short labels through the fake backend, each on its own and merged into utterances,
+    // then stop merged utterances midway under each preemption policy
+    static void Batching(std::ostream& out, const BenchmarkSettings& settings) {
+        static const wchar_t* labels[] = { L"Bold", L"Italic", L"Underline", L"Strikethrough", L"Font color", L"Highlight", L"Align left",
+            L"Center", L"Align right", L"Justify", L"Bullets", L"Numbering", L"Decrease indent", L"Increase indent", L"Line spacing", L"Styles" };
+        const std::chrono::microseconds perCharacter(100);
+        std::vector<std::wstring> items;
+        size_t spokenChars = 0; // Characters the labels themselves take to speak
+        for (size_t i = 0; i < settings.batchItems; ++i) {
+            items.emplace_back(labels[i % (sizeof(labels) / sizeof(labels[0]))]);
+            spokenChars += static_cast<size_t>(std::count_if(items.back().begin(), items.back().end(), [](wchar_t c) { return c != L' '; }));
+        }
+        double speechNs = static_cast<double>(spokenChars) * std::chrono::duration<double, std::nano>(perCharacter).count();
+
+        for (size_t maxItems : { size_t{ 1 }, BatchPolicy().maxItems }) {
+            BatchPolicy policy;
+            policy.maxItems = maxItems;
+            std::vector<double> runs;
+            uint64_t utterances = 0;
+            std::atomic<size_t> moves{ 0 }; // Items highlighted as their speech started
+            for (int run = 0; run < Repetitions(settings); ++run) {
+                FakeSpeechBackend backend(perCharacter, settings.speechStartup);
+                CancellationSource cancellation;
+                UtteranceBatch batch(policy);
+                moves = 0;
+                auto flush = [&]() {
+                    SpeakBatch(backend, batch, cancellation.Token(), [&moves](size_t) { moves.fetch_add(1); });
+                    batch.Clear();
+                };
+                auto started = std::chrono::steady_clock::now();
+                for (const std::wstring& item : items) { // The consumer loop of the reader, without highlights
+                    if (!batch.Accepts(item)) {
+                        moves.fetch_add(1);
+                        SpeakAndWait(backend, item);
+                        continue;
+                    }
+                    if (!batch.Add(item)) {
+                        flush();
+                        batch.Add(item);
+                    }
+                }
+                if (!batch.Empty()) flush();
+                runs.push_back(Nanoseconds(std::chrono::steady_clock::now() - started));
+                utterances = backend.Spoken();
+            }
+            double median = Median(runs);
+            BenchmarkRecord record{ "batching", { { "max_items", std::to_string(maxItems) } }, {} };
+            record.metrics = { { "items_per_second", median > 0 ? static_cast<double>(items.size()) * 1e9 / median : 0.0 },
+                { "utterances_per_second", median > 0 ? static_cast<double>(utterances) * 1e9 / median : 0.0 },
+                { "overhead_per_item_us", items.empty() ? 0.0 : (median - speechNs) / static_cast<double>(items.size()) / 1000.0 },
+                { "utterances", static_cast<double>(utterances) }, { "highlight_moves", static_cast<double>(moves.load()) } };
+            record.Write(out);
+        }
+
+        for (Preemption preemption : { Preemption::Interrupt, Preemption::FinishItem }) {
+            BatchPolicy policy;
+            policy.preemption = preemption;
+            UtteranceBatch batch(policy);
+            for (size_t i = 0; batch.Add(labels[i % (sizeof(labels) / sizeof(labels[0]))]); ++i) {}
+            FakeSpeechBackend backend(perCharacter, settings.speechStartup);
+            LatencyHistogram latency;
+            for (int round = 0; round < settings.preemptRounds; ++round) {
+                CancellationSource cancellation;
+                std::atomic<int64_t> returnedAt{ 0 };
+                std::thread speaker([&]() {
+                    SpeakBatch(backend, batch, cancellation.Token(), nullptr);
+                    returnedAt.store(std::chrono::steady_clock::now().time_since_epoch().count());
+                });
+                std::this_thread::sleep_for(settings.speechStartup + std::chrono::milliseconds(1 + round % 4)); // A newer hover at varying points
+                auto requested = std::chrono::steady_clock::now();
+                cancellation.Cancel();
+                if (preemption == Preemption::Interrupt) backend.Purge(); // What StopCurrentProcesses does under this policy
+                speaker.join();
+                auto returned = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(returnedAt.load()));
+                if (returned > requested) latency.Record(returned - requested); // Rounds whose utterance ended first stopped nothing
+            }
+            BenchmarkRecord record{ "preemption", { { "policy", preemption == Preemption::Interrupt ? "interrupt" : "finish_item" } }, {} };
+            record.metrics = { { "rounds", static_cast<double>(latency.Count()) }, { "p50_us", static_cast<double>(latency.PercentileMicros(0.50)) },
+                { "p99_us", static_cast<double>(latency.PercentileMicros(0.99)) }, { "max_us", static_cast<double>(latency.MaxMicros()) } };
+            record.Write(out);
+        }
+    }
+
+private:
+    // Heap traffic of the strings built with a CountingAllocator
+    struct AllocationCount {
+        std::atomic<uint64_t> allocations{ 0 }; // Calls to allocate
+        std::atomic<size_t> liveBytes{ 0 }; // Bytes allocated and not yet freed
+        std::atomic<size_t> peakBytes{ 0 }; // Highest liveBytes seen
+
+        void Reset() {
+            allocations = 0;
+            liveBytes = 0;
+            peakBytes = 0;
+        }
+    };
+
+    // Allocator that counts into an AllocationCount, used by producer and consumer threads at once
+    template <typename T>
+    struct CountingAllocator {
+        using value_type = T;
+        AllocationCount* count;
+
+        explicit CountingAllocator(AllocationCount* count) : count(count) {}
+        template <typename U>
+        CountingAllocator(const CountingAllocator<U>& other) : count(other.count) {}
+
+        T* allocate(size_t n) {
+            size_t bytes = n * sizeof(T);
+            count->allocations.fetch_add(1, std::memory_order_relaxed);
+            size_t live = count->liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            size_t peak = count->peakBytes.load(std::memory_order_relaxed);
+            while (live > peak && !count->peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* p, size_t n) {
+            count->liveBytes.fetch_sub(n * sizeof(T), std::memory_order_relaxed);
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        template <typename U>
+        bool operator==(const CountingAllocator<U>& other) const { return count == other.count; }
+        template <typename U>
+        bool operator!=(const CountingAllocator<U>& other) const { return count != other.count; }
+    };
+
+    using CountedString = std::basic_string<wchar_t, std::char_traits<wchar_t>, CountingAllocator<wchar_t>>;
+
+    // Queue every name not seen before, as ReadElementText does, while a consumer drains the queue in batches
+    // Returns the number of texts queued
+    template <typename Entry, typename Make, typename Read>
+    static size_t Carry(const std::vector<ElementSnapshot>& snapshots, TextFingerprintSet& processedTexts, Make make, Read read) {
+        WorkQueue<Entry> queue(1024);
+        std::atomic<size_t> consumed{ 0 };
+        std::thread consumer([&queue, &consumed, read]() {
+            std::vector<Entry> batch;
+            size_t chars = 0;
+            while (queue.WaitDrain(batch, 16)) {
+                for (const Entry& entry : batch) chars += read(entry);
+                batch.clear(); // Frees the entries, as the speech consumer does after each batch
+            }
+            consumed.store(chars);
+        });
+        size_t queued = 0;
+        for (const ElementSnapshot& snapshot : snapshots) {
+            if (snapshot.name.empty() || !processedTexts.Insert(snapshot.name)) continue;
+            queue.Push(make(snapshot));
+            ++queued;
+        }
+        queue.Close();
+        consumer.join();
+        return queued;
+    }
+
+    // Deterministic text of about the given number of units: prose sentences, one UI label per line,
+    // or prose interleaved with non-breaking and zero-width spaces, CJK, emoji, box drawing and repeated punctuation
+    static std::u16string NormalizationCorpus(const std::string& corpus, size_t units) {
+        static const char16_t* const words[] = { u"the", u"reader", u"speaks", u"every", u"element", u"under", u"cursor", u"and",
+            u"window", u"of", u"a", u"toolbar", u"with", u"Save", u"Open", u"settings", u"Document1", u"2024", u"page", u"list" };
+        static const char16_t* const labels[] = { u"OK", u"Cancel", u"File", u"Edit", u"View", u"Insert", u"Format", u"Tools",
+            u"Help", u"Bold", u"Italic", u"Font size", u"Zoom 100%", u"Page 1 of 12", u"Search...", u"Close tab" };
+        static const char16_t* const noise[] = { u"\u00A0", u"\u200B", u"\u4E2D\u6587\u3002", u"\xD83D\xDE00", u"\u2500\u2500\u2500",
+            u"!!!", u"...", u"\u2026", u"\t\n", u"  ", u"\u00AD", u"\uFF01" };
+        std::u16string text;
+        text.reserve(units + 64);
+        uint32_t state = 11;
+        auto next = [&state](uint32_t bound) {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) % bound;
+        };
+        while (text.size() < units) {
+            if (corpus == "labels") {
+                text += labels[next(16)];
+                text += u'\n';
+                continue;
+            }
+            size_t length = 6 + next(14);
+            for (size_t word = 0; word < length; ++word) {
+                if (word) text += u' ';
+                text += words[next(20)];
+                if (corpus == "mixed" && next(4) == 0) text += noise[next(12)];
+            }
+            text += next(5) ? u". " : u"? ";
+        }
+        text.resize(units);
+        return text;
+    }
+
+    // Smallest rectangle containing a point by looking at every one, later ids winning ties like SpatialIndex::Query
+    static std::optional<uint32_t> ScanSmallest(const std::vector<ElementRect>& rects, long x, long y) {
+        std::optional<uint32_t> best;
+        long long bestArea = 0;
+        for (size_t id = 0; id < rects.size(); ++id) {
+            const ElementRect& rect = rects[id];
+            if (x < rect.left || x >= rect.right || y < rect.top || y >= rect.bottom) continue;
+            long long area = static_cast<long long>(rect.right - rect.left) * (rect.bottom - rect.top);
+            if (!best || area <= bestArea) {
+                best = static_cast<uint32_t>(id);
+                bestArea = area;
+            }
+        }
+        return best;
+    }
+
+    static int Repetitions(const BenchmarkSettings& settings) { return settings.repetitions > 0 ? settings.repetitions : 1; }
+
+    static double Nanoseconds(std::chrono::steady_clock::duration duration) {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    }
+
+    static double Median(std::vector<double> values) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    static std::vector<std::pair<std::string, std::string>> TreeLabels(TreeShape shape, size_t nodes) {
+        return { { "shape", SyntheticTree::ShapeName(shape) }, { "nodes", std::to_string(nodes) } };
+    }
+};
+
+#endif // SIGHTSPEAK_BENCHMARK_SUITE_HPP
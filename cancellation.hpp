@@ -0,0 +1,81 @@
+#ifndef SIGHTSPEAK_CANCELLATION_HPP
+#define SIGHTSPEAK_CANCELLATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+class CancellationToken;
+
+// Shared cancellation state of a pipeline
+// Cancel bumps a generation counter; tokens remember the generation they were taken in
+class CancellationSource {
+public:
+    // Token for work started now, cancelled by the next call to Cancel
+    CancellationToken Token() const;
+
+    // Cancel every token handed out so far and wake the tokens sleeping in WaitFor
+    // Returns the new generation
+    uint64_t Cancel() {
+        uint64_t next;
+        {
+            std::lock_guard<std::mutex> lock(waitMutex); // Orders the bump against waiters checking before they sleep
+            next = generation.fetch_add(1, std::memory_order_release) + 1;
+        }
+        waitCv.notify_all();
+        return next;
+    }
+
+    // Current generation
+    uint64_t Generation() const { return generation.load(std::memory_order_acquire); }
+
+private:
+    friend class CancellationToken;
+
+    std::atomic<uint64_t> generation{ 0 }; // Bumped by every Cancel
+    mutable std::mutex waitMutex; // Guards sleeping in WaitFor
+    mutable std::condition_variable waitCv; // Wakes tokens sleeping in WaitFor
+};
+
+// Cheap copyable handle telling work whether it was cancelled
+// Polling is a single relaxed load, so it can be checked per element without cost
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    // True once the source was cancelled after this token was taken; a default token is never cancelled
+    bool IsCancelled() const {
+        return source && source->generation.load(std::memory_order_relaxed) != generation;
+    }
+
+    // Sleep for up to timeout, waking early on cancellation; returns true if cancelled
+    template <typename Rep, typename Period>
+    bool WaitFor(std::chrono::duration<Rep, Period> timeout) const {
+        if (!source) {
+            std::this_thread::sleep_for(timeout);
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(source->waitMutex);
+        return source->waitCv.wait_for(lock, timeout, [this] { return IsCancelled(); });
+    }
+
+    // Generation the token was taken in
+    uint64_t Generation() const { return generation; }
+
+private:
+    friend class CancellationSource;
+
+    CancellationToken(const CancellationSource* source, uint64_t generation) : source(source), generation(generation) {}
+
+    const CancellationSource* source{ nullptr }; // Source the token belongs to
+    uint64_t generation{ 0 }; // Generation of the source when the token was taken
+};
+
+inline CancellationToken CancellationSource::Token() const {
+    return CancellationToken(this, generation.load(std::memory_order_acquire));
+}
+
+#endif // SIGHTSPEAK_CANCELLATION_HPP
@@ -0,0 +1,73 @@
+#ifndef SIGHTSPEAK_COMPONENT_HOLDER_HPP
+#define SIGHTSPEAK_COMPONENT_HOLDER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Current instance of a component that may be rebuilt while it is in use
+// Users take a snapshot, a shared reference to whatever instance is current, and keep it for one operation;
+// a replacement is built elsewhere and published in one atomic step, and the instance it replaces retires
+// when the last snapshot of it is dropped, so rebuilding never leaves a moment without a usable instance
+template <typename T>
+class ComponentHolder {
+public:
+    using Snapshot = std::shared_ptr<T>;
+
+    // Instance current at the time of the call, null before the first Publish
+    Snapshot Acquire() const { return current.load(std::memory_order_acquire); }
+
+    // Make an instance current and return the one it replaces, which stays alive for its remaining users
+    Snapshot Publish(Snapshot next) {
+        Snapshot previous = current.exchange(std::move(next), std::memory_order_acq_rel);
+        published.fetch_add(1, std::memory_order_relaxed);
+        if (previous) {
+            std::lock_guard<std::mutex> lock(retiredMutex);
+            PruneLocked();
+            retired.push_back(previous);
+        }
+        return previous;
+    }
+
+    // Build a replacement while the current instance keeps serving, then publish it
+    // Returns false and keeps the current instance if the factory returns null
+    template <typename Factory>
+    bool Rebuild(Factory&& build) {
+        Snapshot next = build();
+        if (!next) {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Publish(std::move(next));
+        return true;
+    }
+
+    // Replaced instances some user still holds a snapshot of
+    size_t Retiring() const {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        PruneLocked();
+        return retired.size();
+    }
+
+    // Number of instances published, and of rebuilds whose factory failed
+    uint64_t Published() const { return published.load(std::memory_order_relaxed); }
+    uint64_t Failed() const { return failed.load(std::memory_order_relaxed); }
+
+private:
+    void PruneLocked() const {
+        retired.erase(std::remove_if(retired.begin(), retired.end(), [](const std::weak_ptr<T>& instance) { return instance.expired(); }), retired.end());
+    }
+
+    std::atomic<Snapshot> current; // Instance handed to new users
+    mutable std::mutex retiredMutex; // Guards retired
+    mutable std::vector<std::weak_ptr<T>> retired; // Replaced instances, tracked until their last user lets go
+    std::atomic<uint64_t> published{ 0 }; // Calls to Publish
+    std::atomic<uint64_t> failed{ 0 }; // Rebuilds whose factory returned null
+};
+
+#endif // SIGHTSPEAK_COMPONENT_HOLDER_HPP
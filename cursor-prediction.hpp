@@ -0,0 +1,344 @@
+#ifndef SIGHTSPEAK_CURSOR_PREDICTION_HPP
+#define SIGHTSPEAK_CURSOR_PREDICTION_HPP
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "cancellation.hpp"
+#include "element-provider.hpp"
+#include "hover-scheduler.hpp"
+#include "latency-histogram.hpp"
+#include "spatial-index.hpp"
+
+// Settings deciding where a moving cursor is expected to come to rest and when that is worth resolving ahead of time
+struct PredictionPolicy {
+    std::chrono::milliseconds window{ 60 }; // Samples this recent feed the velocity estimate
+    std::chrono::milliseconds horizon{ 250 }; // Landing points further ahead than this are not predicted
+    double minSpeed{ 0.2 }; // Pixels per millisecond below which the cursor counts as resting
+    long retarget{ 24 }; // Predictions moving less than this in pixels keep the speculation they started
+    std::chrono::milliseconds minInterval{ 16 }; // New speculations are started at most this often
+    std::chrono::milliseconds maxAge{ 2000 }; // Finished speculations older than this are not trusted any more
+};
+
+// Point a moving cursor is expected to come to rest at
+struct LandingPrediction {
+    long x{ 0 };
+    long y{ 0 };
+    std::chrono::steady_clock::time_point at; // When the cursor is expected to get there
+};
+
+// Extrapolates where the cursor will stop from the recent mouse samples
+// Pointing movements slow down steadily towards their target, so once the cursor decelerates the distance left is
+// estimated as speed squared over twice the deceleration; accelerating or resting cursors yield no prediction
+// Pure state machine driven by sample timestamps, so recorded traces can be replayed with synthetic clocks
+class TrajectoryPredictor {
+public:
+    explicit TrajectoryPredictor(PredictionPolicy policy = PredictionPolicy()) : policy(policy) {}
+
+    // Add the newest cursor sample
+    void Observe(const CursorSample& sample) {
+        if (count && sample.time < samples[(next + Capacity - 1) % Capacity].time) Reset(); // Clock went back, start over
+        samples[next] = sample;
+        next = (next + 1) % Capacity;
+        if (count < Capacity) ++count;
+    }
+
+    // Landing point of the current movement, if the cursor is slowing down towards one
+    std::optional<LandingPrediction> Predict() const {
+        if (count < 4) return std::nullopt;
+        const CursorSample& newest = At(0);
+        size_t used = 1;
+        while (used < count && newest.time - At(used).time <= policy.window) ++used;
+        if (used < 4) return std::nullopt;
+
+        // Average velocity over the older and the newer half of the window; their difference is the deceleration
+        const CursorSample& oldest = At(used - 1);
+        const CursorSample& middle = At(used / 2);
+        double early = Millis(middle.time - oldest.time);
+        double late = Millis(newest.time - middle.time);
+        if (early <= 0.0 || late <= 0.0) return std::nullopt;
+        double vx = (newest.x - middle.x) / late;
+        double vy = (newest.y - middle.y) / late;
+        double speed = std::sqrt(vx * vx + vy * vy);
+        if (speed < policy.minSpeed) return std::nullopt;
+        double earlyX = (middle.x - oldest.x) / early;
+        double earlyY = (middle.y - oldest.y) / early;
+        double slowing = (std::sqrt(earlyX * earlyX + earlyY * earlyY) - speed) / ((early + late) / 2.0);
+        if (slowing <= 0.0) return std::nullopt; // Still speeding up, the target is anyone's guess
+
+        double remaining = speed / slowing; // Milliseconds until the cursor stops
+        double horizon = static_cast<double>(policy.horizon.count());
+        if (remaining > horizon) return std::nullopt;
+        double distance = speed * remaining / 2.0;
+        LandingPrediction landing;
+        landing.x = newest.x + std::lround(vx / speed * distance);
+        landing.y = newest.y + std::lround(vy / speed * distance);
+        landing.at = newest.time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(remaining));
+        return landing;
+    }
+
+    // Forget the samples seen so far
+    void Reset() {
+        count = 0;
+        next = 0;
+    }
+
+private:
+    static constexpr size_t Capacity = 32; // Enough for the window at the fastest mouse report rates
+
+    const CursorSample& At(size_t age) const { return samples[(next + Capacity - 1 - age) % Capacity]; }
+
+    static double Millis(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    PredictionPolicy policy; // Window and thresholds
+    std::array<CursorSample, Capacity> samples; // Ring of the most recent samples
+    size_t next{ 0 }; // Slot the next sample goes to
+    size_t count{ 0 }; // Samples in the ring
+};
+
+// Elements found by a speculation, the one under the predicted point followed by its subtree
+struct SpeculatedArea {
+    uintptr_t surface{ 0 }; // Top-level window the elements belong to, a claim from another window misses
+    std::vector<ElementSnapshot> elements;
+};
+
+// Resolves the element a moving cursor is heading for before it gets there
+// Every mouse sample updates the landing prediction; when it moves away from the point being speculated on, that
+// speculation is cancelled through its token and a new one is launched on a low-priority worker. The hit test then
+// claims the element from the finished speculation instead of asking the target process, provided the cursor came
+// to rest inside the area that was resolved
+class HoverSpeculator {
+public:
+    using Launcher = std::function<void(std::function<void()>)>; // Runs a speculation on some worker
+    using Resolve = std::function<bool(long x, long y, const CancellationToken& token, SpeculatedArea& area)>; // Finds the elements at a point
+    using Warm = std::function<void(const SpeculatedArea& area, const CancellationToken& token)>; // Prepares the speech for an area once it can be claimed
+
+    HoverSpeculator(Resolve resolve, Launcher launch, Warm warm = nullptr, PredictionPolicy policy = PredictionPolicy(), size_t maxRecorded = 16384)
+        : resolve(std::move(resolve)), launch(std::move(launch)), warm(std::move(warm)), policy(policy), predictor(policy),
+        recorded(maxRecorded ? maxRecorded : 1) {
+    }
+
+    ~HoverSpeculator() { Stop(); }
+
+    HoverSpeculator(const HoverSpeculator&) = delete;
+    HoverSpeculator& operator=(const HoverSpeculator&) = delete;
+
+    // Record the latest cursor position; cheap enough for a low-level mouse hook
+    void Post(long x, long y) { Observe({ x, y, std::chrono::steady_clock::now() }); }
+
+    // Feed a cursor sample, possibly replacing the speculation in flight
+    void Observe(const CursorSample& sample) {
+        std::shared_ptr<Speculation> started;
+        {
+            std::lock_guard<std::mutex> lock(speculationMutex);
+            if (stopping) return;
+            recorded[samplesSeen % recorded.size()] = sample;
+            ++samplesSeen;
+            predictor.Observe(sample);
+            std::optional<LandingPrediction> landing = predictor.Predict();
+            if (!landing || !RetargetLocked(*landing, sample.time)) return;
+
+            if (current && !current->done) ++cancelled; // Its token reads as cancelled from here on
+            cancellation.Cancel();
+            started = std::make_shared<Speculation>();
+            started->x = landing->x;
+            started->y = landing->y;
+            started->started = sample.time;
+            started->token = cancellation.Token();
+            current = started;
+            lastStart = sample.time;
+            ++speculations;
+            ++running;
+        }
+        launch([this, started]() { Run(started); });
+    }
+
+    // Element under a point the cursor came to rest at, taken from a finished speculation; null if none covers it
+    // The surface is the top-level window under the point, so an area covered by another window never matches
+    ElementHandle Claim(long x, long y, uintptr_t surface) {
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        if (!current) {
+            ++unpredicted;
+            return nullptr;
+        }
+        if (!current->done) {
+            ++late; // Started too late to help, and now pointless
+            ++cancelled;
+            current.reset();
+            cancellation.Cancel();
+            return nullptr;
+        }
+        std::optional<uint32_t> id;
+        if (current->area.surface == surface && std::chrono::steady_clock::now() - current->finished <= policy.maxAge) {
+            id = current->index.Query(x, y);
+        }
+        if (!id) {
+            ++misses;
+            current.reset(); // The cursor stopped elsewhere, the area is of no further use
+            return nullptr;
+        }
+        ++hits;
+        saved.Record(current->cost); // The hit test skips the resolution the speculation already paid for
+        return current->area.elements[*id].handle; // Kept, later rests inside the same area hit as well
+    }
+
+    // Drop the speculation in flight or finished, typically after the tree changed
+    void Invalidate() {
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        if (current && !current->done) ++cancelled;
+        current.reset();
+        cancellation.Cancel();
+    }
+
+    // Cancel speculations and wait for those running on workers
+    void Stop() {
+        std::unique_lock<std::mutex> lock(speculationMutex);
+        stopping = true;
+        current.reset();
+        cancellation.Cancel();
+        idleCv.wait(lock, [this] { return running == 0; });
+    }
+
+    // Resolution time hits saved the hit test
+    const LatencyHistogram& Saved() const { return saved; }
+
+    // Share of claims served from a speculation
+    double HitRate() {
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        uint64_t claims = hits + misses + late + unpredicted;
+        return claims ? static_cast<double>(hits) / static_cast<double>(claims) : 0.0;
+    }
+
+    // Most recent cursor samples, oldest first, for export as a replayable trace
+    std::vector<CursorSample> Recent() {
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        size_t retained = samplesSeen < recorded.size() ? static_cast<size_t>(samplesSeen) : recorded.size();
+        std::vector<CursorSample> samples;
+        samples.reserve(retained);
+        for (uint64_t i = samplesSeen - retained; i < samplesSeen; ++i) samples.push_back(recorded[i % recorded.size()]);
+        return samples;
+    }
+
+    // Short human readable summary for the debug log
+    std::wstring Describe() {
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        uint64_t claims = hits + misses + late + unpredicted;
+        return L"speculations=" + std::to_wstring(speculations) + L" cancelled=" + std::to_wstring(cancelled) +
+            L" hits=" + std::to_wstring(hits) + L" misses=" + std::to_wstring(misses) + L" late=" + std::to_wstring(late) +
+            L" unpredicted=" + std::to_wstring(unpredicted) + L" hit rate=" + std::to_wstring(claims ? hits * 100 / claims : 0) +
+            L"% saved " + saved.Describe();
+    }
+
+private:
+    struct Speculation {
+        long x{ 0 }; // Predicted landing point being resolved
+        long y{ 0 };
+        std::chrono::steady_clock::time_point started; // Sample that started it
+        CancellationToken token; // Cancelled once the prediction moves elsewhere
+        bool done{ false }; // Area and index are filled in, guarded by speculationMutex
+        SpeculatedArea area; // Elements found, valid once done
+        SpatialIndex index; // Rectangles of area.elements by position, valid once done
+        std::chrono::steady_clock::duration cost{}; // Time the resolution took
+        std::chrono::steady_clock::time_point finished; // When it was done
+    };
+
+    // Decide whether a prediction is far enough from the current speculation to replace it
+    bool RetargetLocked(const LandingPrediction& landing, std::chrono::steady_clock::time_point now) const {
+        if (!current) return true;
+        if (now - lastStart < policy.minInterval) return false;
+        long dx = landing.x > current->x ? landing.x - current->x : current->x - landing.x;
+        long dy = landing.y > current->y ? landing.y - current->y : current->y - landing.y;
+        if ((dx > dy ? dx : dy) <= policy.retarget) return false;
+        return !(current->done && current->index.Query(landing.x, landing.y)); // Still heading into the resolved area
+    }
+
+    void Run(const std::shared_ptr<Speculation>& speculation) {
+        SpeculatedArea area;
+        auto began = std::chrono::steady_clock::now();
+        bool found = !speculation->token.IsCancelled() && resolve(speculation->x, speculation->y, speculation->token, area);
+        auto ended = std::chrono::steady_clock::now();
+
+        bool published = false;
+        if (found && !speculation->token.IsCancelled()) {
+            SpatialIndex index;
+            for (size_t i = 0; i < area.elements.size(); ++i) index.Insert(static_cast<uint32_t>(i), area.elements[i].rect); // Built outside the lock
+            std::lock_guard<std::mutex> lock(speculationMutex);
+            if (current == speculation) {
+                speculation->area = std::move(area);
+                speculation->index = std::move(index);
+                speculation->cost = ended - began;
+                speculation->finished = ended;
+                speculation->done = true;
+                published = true;
+            }
+        }
+        if (published && warm && !speculation->token.IsCancelled()) warm(speculation->area, speculation->token); // Area is no longer written
+
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        if (!published && current == speculation) current.reset(); // Nothing at that point, let the next prediction try again
+        --running;
+        idleCv.notify_all();
+    }
+
+    Resolve resolve; // Finds the elements at a predicted point
+    Launcher launch; // Runs speculations on low-priority workers
+    Warm warm; // Prepares speech for a resolved area, if set
+    PredictionPolicy policy; // Prediction and speculation settings
+    std::mutex speculationMutex; // Guards everything below
+    std::condition_variable idleCv; // Signals finished speculations to Stop
+    TrajectoryPredictor predictor; // Landing point of the current movement
+    CancellationSource cancellation; // Cancels the speculation in flight when the prediction moves
+    std::shared_ptr<Speculation> current; // Newest speculation, in flight or finished
+    std::chrono::steady_clock::time_point lastStart; // When the newest speculation was started
+    std::vector<CursorSample> recorded; // Ring of recent samples kept for export
+    uint64_t samplesSeen{ 0 }; // Samples observed so far
+    size_t running{ 0 }; // Speculations launched and not returned
+    uint64_t speculations{ 0 }; // Speculations started
+    uint64_t cancelled{ 0 }; // Speculations abandoned before finishing
+    uint64_t hits{ 0 }; // Claims answered from a speculation
+    uint64_t misses{ 0 }; // Claims outside the resolved area
+    uint64_t late{ 0 }; // Claims made while the speculation was still running
+    uint64_t unpredicted{ 0 }; // Claims without any speculation
+    bool stopping{ false }; // Set once Stop has been requested
+    LatencyHistogram saved; // Resolution time saved per hit
+};
+
+// Plain text form of a mouse path, one "milliseconds x y" line per sample, replayable on any platform
+class CursorTrace {
+public:
+    // Write samples with times relative to the first one
+    static void Write(std::ostream& out, const std::vector<CursorSample>& samples) {
+        if (samples.empty()) return;
+        auto origin = samples.front().time;
+        for (const CursorSample& sample : samples) {
+            out << std::chrono::duration<double, std::milli>(sample.time - origin).count() << ' ' << sample.x << ' ' << sample.y << '\n';
+        }
+    }
+
+    // Read samples written by Write, placing the first one at origin; stops at the first malformed line
+    static std::vector<CursorSample> Read(std::istream& in, std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::time_point()) {
+        std::vector<CursorSample> samples;
+        double millis = 0.0;
+        long x = 0, y = 0;
+        while (in >> millis >> x >> y) {
+            samples.push_back({ x, y, origin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(millis)) });
+        }
+        return samples;
+    }
+};
+
+#endif // SIGHTSPEAK_CURSOR_PREDICTION_HPP
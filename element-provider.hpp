@@ -0,0 +1,405 @@
+#ifndef SIGHTSPEAK_ELEMENT_PROVIDER_HPP
+#define SIGHTSPEAK_ELEMENT_PROVIDER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Screen rectangle of an element in physical pixels
+// Mirrors the layout of the Win32 RECT so the provider interface stays platform independent
+struct ElementRect {
+    long left{ 0 };
+    long top{ 0 };
+    long right{ 0 };
+    long bottom{ 0 };
+};
+
+// Runtime identifier of an element, unique among the elements currently on the desktop
+using RuntimeId = std::vector<int>;
+
+// Opaque reference to a live element owned by a provider
+// The UI Automation provider stores a COM element here, the mock provider a node index
+using ElementHandle = std::shared_ptr<void>;
+
+// Properties of a single element, read either one by one or from a batched cache request
+struct ElementSnapshot {
+    ElementHandle handle; // Live element used for follow-up calls such as reading document text
+    RuntimeId runtimeId; // Identity of the element across traversals
+    std::wstring name; // Name property of the element
+    ElementRect rect; // Bounding rectangle of the element
+    int controlType{ 0 }; // Control type identifier of the element
+    bool hasTextPattern{ false }; // True if the element exposes the text pattern
+    bool offscreen{ false }; // True if the element reported itself scrolled or hidden out of view; only read where it comes with other properties
+    int depth{ 0 }; // Depth of the element below the traversal root
+    int parent{ -1 }; // Index of the parent snapshot in a fetched subtree, -1 for the root
+};
+
+// Elements next to an element in the control view, each null where there is none
+struct ElementNeighbors {
+    ElementHandle parent;
+    ElementHandle firstChild;
+    ElementHandle nextSibling;
+    ElementHandle previousSibling;
+};
+
+// Why a traversal left an element and everything below it out
+enum class PruneReason : uint8_t {
+    None,
+    Offscreen, // Scrolled or hidden out of view
+    Empty, // Bounding rectangle without area
+    ControlType, // Control type not on the allow-list
+    Budget, // Deadline or node budget spent before the element was reached
+    Count
+};
+
+// Elements a traversal neither reads nor descends into
+// Providers apply what their query can express, traversals check the rest on the elements that come back
+struct ElementFilter {
+    bool skipOffscreen{ false }; // Leave out elements scrolled or hidden out of view
+    bool skipEmpty{ false }; // Leave out elements without area, which no cursor can point at
+    std::vector<int> controlTypes; // Control types worth reading, empty allows every type
+
+    // Reason the filter rejects an element, None if it passes; unknown control types (0) pass
+    PruneReason Check(const ElementSnapshot& element) const {
+        if (skipOffscreen && element.offscreen) return PruneReason::Offscreen;
+        if (skipEmpty && (element.rect.right <= element.rect.left || element.rect.bottom <= element.rect.top)) return PruneReason::Empty;
+        if (!controlTypes.empty() && element.controlType != 0 &&
+            std::find(controlTypes.begin(), controlTypes.end(), element.controlType) == controlTypes.end()) return PruneReason::ControlType;
+        return PruneReason::None;
+    }
+};
+
+// Unit a document is read in
+// Named apart from the UI Automation TextUnit enumeration it maps onto
+enum class ChunkUnit {
+    Paragraph,
+    Line
+};
+
+// Piece of a document together with the screen area it occupies
+struct TextChunk {
+    std::wstring text; // Text of the chunk
+    ElementRect rect; // Bounds of the chunk on screen, empty when it is scrolled out of view
+};
+
+// Forward-only cursor over the text of a document, read one chunk per call
+// Only one call may run at a time, though consecutive calls may come from different threads
+class TextRangeSource {
+public:
+    virtual ~TextRangeSource() = default;
+
+    // Read the next chunk; returns false at the end of the document or when the document went away
+    virtual bool Next(TextChunk& chunk) = 0;
+};
+
+// How a subtree is walked
+// Live issues per-node calls as the walk proceeds, Batched fetches the whole subtree in one request
+enum class TraversalMode {
+    Live,
+    Batched
+};
+
+// Interface to the accessibility tree
+// Implemented on top of UI Automation in the reader and by MockElementProvider for portable runs
+class ElementProvider {
+public:
+    virtual ~ElementProvider() = default;
+
+    // Read the properties of a single element, one call per property
+    virtual bool FetchElement(const ElementHandle& element, ElementSnapshot& snapshot) = 0;
+
+    // Collect the children of an element in the control view
+    virtual bool FetchChildren(const ElementHandle& element, std::vector<ElementHandle>& children) = 0;
+
+    // Fetch an element and its descendants less than maxDepth levels down in a single request
+    // Snapshots are appended in breadth-first order with parent indices filled in
+    virtual bool FetchSubtree(const ElementHandle& root, int maxDepth, std::vector<ElementSnapshot>& snapshots) = 0;
+
+    // Read the full document text of an element exposing the text pattern
+    virtual bool GetDocumentText(const ElementSnapshot& element, std::wstring& text) = 0;
+
+    // Read the runtime identifier of an element
+    virtual bool GetRuntimeId(const ElementHandle& element, RuntimeId& runtimeId) = 0;
+
+    // Find the parent, first child and both siblings of an element in the control view
+    virtual bool FetchNeighbors(const ElementHandle& element, ElementNeighbors& neighbors) = 0;
+
+    // Open the document of an element exposing the text pattern for reading chunk by chunk
+    // No chunk longer than maxChunkChars is returned; returns nullptr if the element has no document
+    virtual std::unique_ptr<TextRangeSource> OpenDocument(const ElementSnapshot& element, ChunkUnit unit, size_t maxChunkChars) = 0;
+
+    // Filter FetchSubtree and FetchChildren apply inside their query, as far as the provider's query can express it
+    // Elements left out that way never reach the caller; set it before the first traversal
+    void SetQueryFilter(ElementFilter filter) { queryFilter = std::move(filter); }
+
+    // Filter applied inside queries
+    const ElementFilter& QueryFilter() const { return queryFilter; }
+
+    // Number of cross-process round trips issued through this provider
+    size_t RoundTrips() const { return roundTrips.load(std::memory_order_relaxed); }
+
+    // Reset the round trip counter, typically at the start of a traversal
+    void ResetRoundTrips() { roundTrips.store(0, std::memory_order_relaxed); }
+
+protected:
+    // Record round trips made by an implementation
+    void CountRoundTrips(size_t count = 1) { roundTrips.fetch_add(count, std::memory_order_relaxed); }
+
+private:
+    std::atomic<size_t> roundTrips{ 0 }; // Running count of cross-process calls
+    ElementFilter queryFilter; // Pushed into queries, everything passes by default
+};
+
+// Walk the subtree below root and hand each element to the visitor in breadth-first order
+// Elements at maxDepth or deeper are skipped; the walk stops early when the visitor returns false
+// Batched mode falls back to the live walk if the provider cannot build the subtree cache
+template <typename Visitor>
+bool TraverseSubtree(ElementProvider& provider, const ElementHandle& root, int maxDepth, TraversalMode mode, Visitor&& visit) {
+    if (!root || maxDepth <= 0) return true;
+
+    if (mode == TraversalMode::Batched) {
+        std::vector<ElementSnapshot> snapshots;
+        if (provider.FetchSubtree(root, maxDepth, snapshots)) {
+            for (const ElementSnapshot& snapshot : snapshots) {
+                if (!visit(snapshot)) return false;
+            }
+            return true;
+        }
+    }
+
+    struct PendingElement {
+        ElementHandle handle; // Element still to be read
+        int depth{ 0 }; // Depth of the element below the root
+    };
+
+    std::queue<PendingElement> pending;
+    pending.push({ root, 0 });
+    std::vector<ElementHandle> children;
+
+    while (!pending.empty()) {
+        PendingElement current = std::move(pending.front());
+        pending.pop();
+
+        ElementSnapshot snapshot;
+        if (!provider.FetchElement(current.handle, snapshot)) continue; // Skip elements that vanished mid-walk
+        snapshot.depth = current.depth;
+        if (!visit(snapshot)) return false;
+
+        if (current.depth + 1 >= maxDepth) continue; // Children would be too deep
+        children.clear();
+        if (!provider.FetchChildren(current.handle, children)) continue;
+        for (ElementHandle& child : children) {
+            pending.push({ std::move(child), current.depth + 1 });
+        }
+    }
+    return true;
+}
+
+// Text source over an in-memory document
+// Splits at line breaks, treating blank lines as paragraph breaks, and gives every chunk the same rectangle
+class MockTextRangeSource : public TextRangeSource {
+public:
+    MockTextRangeSource(std::shared_ptr<const std::wstring> document, ChunkUnit unit, size_t maxChunkChars, ElementRect rect,
+        std::chrono::microseconds callLatency = std::chrono::microseconds(0))
+        : document(std::move(document)), unit(unit), maxChunkChars(maxChunkChars ? maxChunkChars : 1), rect(rect), callLatency(callLatency) {
+    }
+
+    bool Next(TextChunk& chunk) override {
+        const std::wstring& text = *document;
+        if (position >= text.size()) return false;
+        ++calls;
+        if (callLatency.count() > 0) std::this_thread::sleep_for(callLatency);
+
+        size_t end = position;
+        while (end < text.size() && end - position < maxChunkChars) {
+            if (text[end] == L'\n') {
+                bool blank = end + 1 < text.size() && (text[end + 1] == L'\n' || text[end + 1] == L'\r');
+                ++end; // The break belongs to the chunk it ends
+                if (unit == ChunkUnit::Line || blank) break;
+                continue;
+            }
+            ++end;
+        }
+        chunk.text.assign(text, position, end - position);
+        chunk.rect = rect;
+        position = end;
+        return true;
+    }
+
+    // Number of chunks read so far
+    size_t Calls() const { return calls; }
+
+private:
+    std::shared_ptr<const std::wstring> document; // Document shared with the provider
+    ChunkUnit unit; // Unit chunks end at
+    size_t maxChunkChars; // Longest chunk returned
+    ElementRect rect; // Rectangle reported for every chunk
+    std::chrono::microseconds callLatency; // Simulated latency of reading one chunk
+    size_t position{ 0 }; // Offset of the next chunk
+    size_t calls{ 0 }; // Chunks read
+};
+
+// In-memory element provider that counts round trips the way UI Automation would incur them
+// Used to exercise and time traversal code without a desktop session
+class MockElementProvider : public ElementProvider {
+public:
+    // Add an element below parent (-1 for a root) and return its index
+    int AddElement(int parent, std::wstring name, ElementRect rect, int controlType = 0, std::wstring text = std::wstring()) {
+        int index = static_cast<int>(nodes.size());
+        Node node;
+        node.snapshot.handle = std::make_shared<int>(index);
+        node.snapshot.runtimeId = { MockRuntimeIdPrefix, index };
+        node.snapshot.name = std::move(name);
+        node.snapshot.rect = rect;
+        node.snapshot.controlType = controlType;
+        node.snapshot.hasTextPattern = !text.empty();
+        node.text = std::make_shared<const std::wstring>(std::move(text));
+        node.parent = parent;
+        if (parent >= 0) node.indexInParent = nodes[parent].children.size();
+        nodes.push_back(std::move(node));
+        if (parent >= 0) nodes[parent].children.push_back(index);
+        return index;
+    }
+
+    // Handle of the element at the given index
+    ElementHandle Handle(int index) const { return nodes[index].snapshot.handle; }
+
+    // Number of elements in the mock tree
+    size_t Size() const { return nodes.size(); }
+
+    // Report an element as scrolled out of view
+    void SetOffscreen(int index, bool offscreen) { nodes[index].snapshot.offscreen = offscreen; }
+
+    // Delay applied to every simulated round trip to model cross-process latency
+    void SetCallLatency(std::chrono::microseconds latency) { callLatency = latency; }
+
+    bool FetchElement(const ElementHandle& element, ElementSnapshot& snapshot) override {
+        const Node* node = Find(element);
+        if (!node) return false;
+        RoundTrip(5); // Name, bounding rectangle, control type, text pattern availability and runtime id
+        snapshot = node->snapshot;
+        return true;
+    }
+
+    bool FetchChildren(const ElementHandle& element, std::vector<ElementHandle>& children) override {
+        const Node* node = Find(element);
+        if (!node) return false;
+        std::vector<int> visible;
+        ViewChildren(static_cast<int>(node - nodes.data()), visible);
+        for (int child : visible) children.push_back(nodes[child].snapshot.handle);
+        RoundTrip(visible.size() + 1); // First child, then one call per sibling until the end is reached
+        return true;
+    }
+
+    bool FetchSubtree(const ElementHandle& root, int maxDepth, std::vector<ElementSnapshot>& snapshots) override {
+        const Node* rootNode = Find(root);
+        if (!rootNode) return false;
+        RoundTrip(1); // The whole subtree arrives with one cache request
+
+        int rootIndex = *static_cast<const int*>(root.get());
+        std::queue<std::pair<int, int>> pending; // Node index and index of its parent snapshot
+        pending.push({ rootIndex, -1 });
+        std::vector<int> visible;
+        while (!pending.empty()) {
+            auto [index, parentSnapshot] = pending.front();
+            pending.pop();
+
+            ElementSnapshot snapshot = nodes[index].snapshot;
+            snapshot.depth = parentSnapshot >= 0 ? snapshots[parentSnapshot].depth + 1 : 0;
+            snapshot.parent = parentSnapshot;
+            snapshots.push_back(std::move(snapshot));
+
+            int self = static_cast<int>(snapshots.size()) - 1;
+            if (snapshots[self].depth + 1 >= maxDepth) continue;
+            visible.clear();
+            ViewChildren(index, visible); // As the cache request's tree filter shapes the view
+            for (int child : visible) pending.push({ child, self });
+        }
+        return true;
+    }
+
+    bool GetDocumentText(const ElementSnapshot& element, std::wstring& text) override {
+        const Node* node = Find(element.handle);
+        if (!node || !node->snapshot.hasTextPattern) return false;
+        RoundTrip(2); // Document range, then its text
+        text = *node->text;
+        return true;
+    }
+
+    std::unique_ptr<TextRangeSource> OpenDocument(const ElementSnapshot& element, ChunkUnit unit, size_t maxChunkChars) override {
+        const Node* node = Find(element.handle);
+        if (!node || !node->snapshot.hasTextPattern) return nullptr;
+        RoundTrip(2); // Text pattern, then its document range
+        return std::make_unique<MockTextRangeSource>(node->text, unit, maxChunkChars, node->snapshot.rect, callLatency);
+    }
+
+    bool GetRuntimeId(const ElementHandle& element, RuntimeId& runtimeId) override {
+        const Node* node = Find(element);
+        if (!node) return false;
+        RoundTrip(1);
+        runtimeId = node->snapshot.runtimeId;
+        return true;
+    }
+
+    bool FetchNeighbors(const ElementHandle& element, ElementNeighbors& neighbors) override {
+        const Node* node = Find(element);
+        if (!node) return false;
+        RoundTrip(4); // One tree walker call per direction
+        neighbors = ElementNeighbors();
+        if (!node->children.empty()) neighbors.firstChild = nodes[node->children.front()].snapshot.handle;
+        if (node->parent < 0) return true;
+        const std::vector<int>& siblings = nodes[node->parent].children;
+        neighbors.parent = nodes[node->parent].snapshot.handle;
+        if (node->indexInParent + 1 < siblings.size()) neighbors.nextSibling = nodes[siblings[node->indexInParent + 1]].snapshot.handle;
+        if (node->indexInParent > 0) neighbors.previousSibling = nodes[siblings[node->indexInParent - 1]].snapshot.handle;
+        return true;
+    }
+
+private:
+    static constexpr int MockRuntimeIdPrefix = 42; // First runtime id component shared by all mock elements
+
+    struct Node {
+        ElementSnapshot snapshot; // Properties returned for this element
+        std::shared_ptr<const std::wstring> text; // Document text served through the text pattern, shared with open sources
+        std::vector<int> children; // Indices of child elements in document order
+        int parent{ -1 }; // Index of the parent element, -1 for a root
+        size_t indexInParent{ 0 }; // Position among the children of the parent
+    };
+
+    // True if the query filter rejects an element; its descendants stay in the view, see ViewChildren
+    bool Hidden(int index) const { return QueryFilter().skipOffscreen && nodes[index].snapshot.offscreen; }
+
+    // Children of an element in the view the query filter defines, in document order
+    // A rejected child is replaced by its own children in that view, the way a UI Automation walker or cache request
+    // with a condition promotes the descendants of an element the condition rejects
+    void ViewChildren(int index, std::vector<int>& visible) const {
+        for (int child : nodes[index].children) {
+            if (Hidden(child)) ViewChildren(child, visible);
+            else visible.push_back(child);
+        }
+    }
+
+    const Node* Find(const ElementHandle& element) const {
+        if (!element) return nullptr;
+        int index = *static_cast<const int*>(element.get());
+        return index >= 0 && index < static_cast<int>(nodes.size()) ? &nodes[index] : nullptr;
+    }
+
+    void RoundTrip(size_t count) {
+        CountRoundTrips(count);
+        if (callLatency.count() > 0) std::this_thread::sleep_for(callLatency * static_cast<long long>(count));
+    }
+
+    std::vector<Node> nodes; // All elements, roots and descendants alike
+    std::chrono::microseconds callLatency{ 0 }; // Simulated latency per round trip
+};
+
+#endif // SIGHTSPEAK_ELEMENT_PROVIDER_HPP
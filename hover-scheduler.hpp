@@ -0,0 +1,160 @@
+#ifndef SIGHTSPEAK_HOVER_SCHEDULER_HPP
+#define SIGHTSPEAK_HOVER_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include "latency-histogram.hpp"
+
+// Cursor position reported by the mouse hook together with its arrival time
+struct CursorSample {
+    long x{ 0 };
+    long y{ 0 };
+    std::chrono::steady_clock::time_point time; // When the mouse event was observed
+};
+
+// Settings deciding when a moving cursor is worth a hit test
+struct HoverPolicy {
+    std::chrono::milliseconds dwell{ 30 }; // Cursor must rest this long before the element under it is resolved
+    std::chrono::milliseconds maxDelay{ 120 }; // Upper bound on how long a slow continuous move defers the hit test
+    long moveTolerance{ 3 }; // Movement in pixels that still counts as resting
+};
+
+// Single-slot "latest position wins" mailbox with dwell detection
+// Pure state machine driven by sample timestamps, so recorded traces can be replayed with synthetic clocks
+class HoverDebouncer {
+public:
+    explicit HoverDebouncer(HoverPolicy policy = HoverPolicy()) : policy(policy) {}
+
+    // Offer a new cursor sample, replacing any sample that has not been hit-tested yet
+    void Offer(const CursorSample& sample) {
+        if (!latest) {
+            firstPending = sample.time;
+            anchor = sample;
+        }
+        else {
+            ++dropped; // The waiting sample is superseded before any UI Automation work started
+            if (Distance(sample, anchor) > policy.moveTolerance) anchor = sample; // Cursor moved on, restart the dwell
+        }
+        latest = sample;
+    }
+
+    // Time at which the pending sample becomes due, if there is one
+    std::optional<std::chrono::steady_clock::time_point> Deadline() const {
+        if (!latest) return std::nullopt;
+        auto rested = anchor.time + policy.dwell;
+        auto capped = firstPending + policy.maxDelay;
+        return rested < capped ? rested : capped;
+    }
+
+    // Take the newest sample if its deadline has passed
+    std::optional<CursorSample> TakeDue(std::chrono::steady_clock::time_point now) {
+        auto deadline = Deadline();
+        if (!deadline || now < *deadline) return std::nullopt;
+        std::optional<CursorSample> due = latest;
+        latest.reset();
+        return due;
+    }
+
+    // Number of samples discarded in favour of a newer one
+    uint64_t Dropped() const { return dropped; }
+
+private:
+    static long Distance(const CursorSample& a, const CursorSample& b) {
+        long dx = a.x > b.x ? a.x - b.x : b.x - a.x;
+        long dy = a.y > b.y ? a.y - b.y : b.y - a.y;
+        return dx > dy ? dx : dy;
+    }
+
+    HoverPolicy policy; // Dwell and debounce settings
+    std::optional<CursorSample> latest; // Newest sample still waiting for its hit test
+    CursorSample anchor; // Sample where the current resting period started
+    std::chrono::steady_clock::time_point firstPending; // Arrival of the oldest sample folded into the pending one
+    uint64_t dropped{ 0 }; // Samples superseded before being hit-tested
+};
+
+// Runs hit tests for the newest cursor position on a dedicated thread
+// Post is cheap enough for a low-level mouse hook; only one hit test is ever in flight
+class HoverScheduler {
+public:
+    using HitTest = std::function<void(const CursorSample&)>;
+
+    HoverScheduler(HitTest hitTest, HoverPolicy policy = HoverPolicy())
+        : hitTest(std::move(hitTest)), debouncer(policy), worker(&HoverScheduler::Run, this) {
+    }
+
+    ~HoverScheduler() { Stop(); }
+
+    HoverScheduler(const HoverScheduler&) = delete;
+    HoverScheduler& operator=(const HoverScheduler&) = delete;
+
+    // Record the latest cursor position
+    void Post(long x, long y) {
+        {
+            std::lock_guard<std::mutex> lock(mailboxMutex);
+            debouncer.Offer({ x, y, std::chrono::steady_clock::now() });
+        }
+        mailboxCv.notify_one();
+    }
+
+    // Stop the worker thread, dropping any pending sample
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mailboxMutex);
+            stopping = true;
+        }
+        mailboxCv.notify_one();
+        if (worker.joinable()) worker.join();
+    }
+
+    // Time from a mouse event to the completion of its hit test
+    const LatencyHistogram& Latency() const { return latency; }
+
+    // Number of mouse events dropped before reaching the hit tester
+    uint64_t Dropped() {
+        std::lock_guard<std::mutex> lock(mailboxMutex);
+        return debouncer.Dropped();
+    }
+
+    // Number of hit tests performed
+    uint64_t HitTests() const { return hitTests.load(std::memory_order_relaxed); }
+
+private:
+    void Run() {
+        std::unique_lock<std::mutex> lock(mailboxMutex);
+        while (!stopping) {
+            auto deadline = debouncer.Deadline();
+            if (!deadline) {
+                mailboxCv.wait(lock); // Nothing pending, sleep until the next mouse event
+                continue;
+            }
+            if (mailboxCv.wait_until(lock, *deadline) == std::cv_status::no_timeout) continue; // A newer sample may have moved the deadline
+
+            std::optional<CursorSample> due = debouncer.TakeDue(std::chrono::steady_clock::now());
+            if (!due) continue;
+
+            lock.unlock();
+            hitTest(*due); // Newer samples keep landing in the mailbox meanwhile
+            latency.Record(std::chrono::steady_clock::now() - due->time);
+            hitTests.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+    }
+
+    HitTest hitTest; // Resolves the element under a cursor position
+    std::mutex mailboxMutex; // Guards the debouncer and stop flag
+    std::condition_variable mailboxCv; // Signals new samples and shutdown
+    HoverDebouncer debouncer; // Single-slot mailbox with dwell detection
+    bool stopping{ false }; // Set once Stop has been requested
+    LatencyHistogram latency; // Hover-to-hit-test latency
+    std::atomic<uint64_t> hitTests{ 0 }; // Hit tests performed
+    std::thread worker; // Dedicated hit-test thread, started last so every member is ready
+};
+
+#endif // SIGHTSPEAK_HOVER_SCHEDULER_HPP
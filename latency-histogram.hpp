@@ -0,0 +1,110 @@
+#ifndef SIGHTSPEAK_LATENCY_HISTOGRAM_HPP
+#define SIGHTSPEAK_LATENCY_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Lock-free latency histogram with log-linear buckets
+// Each power of two is split into eight sub-buckets, so any recorded value is reported within 12.5%
+class LatencyHistogram {
+public:
+    // Record one latency sample
+    void Record(std::chrono::nanoseconds latency) {
+        int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        uint64_t value = micros > 0 ? static_cast<uint64_t>(micros) : 0;
+        buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(value, std::memory_order_relaxed);
+        uint64_t seen = maximum.load(std::memory_order_relaxed);
+        while (value > seen && !maximum.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Number of recorded samples
+    uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+
+    // Largest recorded sample in microseconds
+    uint64_t MaxMicros() const { return maximum.load(std::memory_order_relaxed); }
+
+    // Mean of all samples in microseconds
+    uint64_t MeanMicros() const {
+        uint64_t samples = Count();
+        return samples ? total.load(std::memory_order_relaxed) / samples : 0;
+    }
+
+    // Upper bound in microseconds below which the given fraction (0.0 to 1.0) of samples fall
+    uint64_t PercentileMicros(double fraction) const {
+        uint64_t samples = Count();
+        if (samples == 0) return 0;
+        uint64_t target = static_cast<uint64_t>(fraction * static_cast<double>(samples) + 0.5);
+        if (target == 0) target = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BucketCount; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= target) {
+                uint64_t upper = BucketUpperBound(i);
+                uint64_t largest = MaxMicros();
+                return upper < largest ? upper : largest;
+            }
+        }
+        return MaxMicros();
+    }
+
+    // Clear all samples
+    void Reset() {
+        for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        maximum.store(0, std::memory_order_relaxed);
+    }
+
+    // Short human readable summary for the debug log
+    std::wstring Describe() const {
+        return L"n=" + std::to_wstring(Count()) +
+            L" p50=" + std::to_wstring(PercentileMicros(0.50)) + L"us" +
+            L" p90=" + std::to_wstring(PercentileMicros(0.90)) + L"us" +
+            L" p99=" + std::to_wstring(PercentileMicros(0.99)) + L"us" +
+            L" max=" + std::to_wstring(MaxMicros()) + L"us";
+    }
+
+private:
+    static constexpr int SubBucketBits = 3; // Eight sub-buckets per power of two
+    static constexpr uint64_t SubBuckets = uint64_t{ 1 } << SubBucketBits;
+    static constexpr size_t BucketCount = 62 * SubBuckets; // Covers every 64-bit microsecond value
+
+    static int HighestBit(uint64_t value) {
+        int bit = 0;
+        while (value >>= 1) ++bit;
+        return bit;
+    }
+
+    // Values below eight map to themselves, larger ones by magnitude and their next three bits
+    static size_t BucketIndex(uint64_t value) {
+        if (value < SubBuckets) return static_cast<size_t>(value);
+        int top = HighestBit(value);
+        int shift = top - SubBucketBits;
+        uint64_t magnitude = static_cast<uint64_t>(top - SubBucketBits + 1);
+        uint64_t sub = (value >> shift) - SubBuckets;
+        size_t index = static_cast<size_t>(magnitude * SubBuckets + sub);
+        return index < BucketCount ? index : BucketCount - 1;
+    }
+
+    static uint64_t BucketUpperBound(size_t index) {
+        if (index < SubBuckets) return index;
+        uint64_t magnitude = index / SubBuckets;
+        uint64_t sub = index % SubBuckets;
+        int shift = static_cast<int>(magnitude) - 1;
+        return ((SubBuckets + sub + 1) << shift) - 1;
+    }
+
+    std::array<std::atomic<uint64_t>, BucketCount> buckets{}; // Sample counts per bucket
+    std::atomic<uint64_t> count{ 0 }; // Total number of samples
+    std::atomic<uint64_t> total{ 0 }; // Sum of all samples in microseconds
+    std::atomic<uint64_t> maximum{ 0 }; // Largest sample in microseconds
+};
+
+#endif // SIGHTSPEAK_LATENCY_HISTOGRAM_HPP
@@ -0,0 +1,270 @@
+#ifndef SIGHTSPEAK_LATENCY_TRACE_HPP
+#define SIGHTSPEAK_LATENCY_TRACE_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "latency-histogram.hpp"
+
+// Stage of the path from an input event to the first audio sample
+enum class TraceStage : uint8_t {
+    Debounce, // Mouse event until its hit test starts, dwell and coalescing included
+    HitTest, // Resolving the element under the cursor
+    Navigate, // Walking the tree for a keyboard navigation command
+    Dispatch, // Waiting in the interactive lane for the traversal to start
+    Traversal, // Collecting the texts below the element
+    Enqueue, // Handing one text to the speech queue, back pressure included
+    Queued, // Waiting in the speech queue
+    Synthesis, // Asking the backend to speak until its first sample
+    Count
+};
+
+// What started an interaction
+enum class TraceOrigin : uint8_t {
+    Hover,
+    Navigate,
+    Count
+};
+
+// One input event followed through the pipeline, shared by every task working on its behalf
+struct TraceInteraction {
+    uint64_t id; // Sequence number, also the id of the interaction in the exported trace
+    TraceOrigin origin; // Kind of input that started it
+    std::chrono::steady_clock::time_point started; // When the input event was observed
+    std::atomic<bool> answered{ false }; // The first audio sample has been reported
+
+    TraceInteraction(uint64_t id, TraceOrigin origin, std::chrono::steady_clock::time_point started)
+        : id(id), origin(origin), started(started) {
+    }
+};
+
+using InteractionRef = std::shared_ptr<TraceInteraction>;
+
+// Records how long each stage between an input event and the first audio sample takes
+// Every stage feeds a histogram, and the most recent spans are kept for export as a Chrome trace (chrome://tracing, Perfetto)
+// The interaction being worked on travels with the tasks: threads adopt it through TraceScope and spans pick it up from there
+class LatencyTracer {
+public:
+    explicit LatencyTracer(size_t maxEvents = 65536)
+        : start(std::chrono::steady_clock::now()), events(maxEvents ? maxEvents : 1) {
+    }
+
+    LatencyTracer(const LatencyTracer&) = delete;
+    LatencyTracer& operator=(const LatencyTracer&) = delete;
+
+    // Start following an input event observed at the given time
+    InteractionRef Begin(TraceOrigin origin, std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now()) {
+        return std::make_shared<TraceInteraction>(nextInteraction.fetch_add(1, std::memory_order_relaxed) + 1, origin, started);
+    }
+
+    // Interaction the calling thread is working on, null if none
+    static InteractionRef Current() { return CurrentSlot(); }
+
+    // Record a stage that began and ended at the given times
+    void Record(TraceStage stage, const InteractionRef& interaction, std::chrono::steady_clock::time_point begin,
+        std::chrono::steady_clock::time_point end) {
+        stages[static_cast<size_t>(stage)].Record(end - begin);
+        Store({ EventKind::Span, static_cast<uint8_t>(stage), interaction ? interaction->id : 0, Offset(begin), Offset(end), ThreadId() });
+    }
+
+    // Report the first audio sample of an interaction; later samples of the same interaction are ignored
+    void Answer(const InteractionRef& interaction, std::chrono::steady_clock::time_point at = std::chrono::steady_clock::now()) {
+        if (!interaction || interaction->answered.exchange(true)) return;
+        firstAudio[static_cast<size_t>(interaction->origin)].Record(at - interaction->started);
+        Store({ EventKind::Interaction, static_cast<uint8_t>(interaction->origin), interaction->id,
+            Offset(interaction->started), Offset(at), ThreadId() });
+    }
+
+    // Durations of one stage
+    const LatencyHistogram& Stage(TraceStage stage) const { return stages[static_cast<size_t>(stage)]; }
+
+    // Input-to-first-audio latency of interactions started by one kind of input
+    const LatencyHistogram& FirstAudio(TraceOrigin origin) const { return firstAudio[static_cast<size_t>(origin)]; }
+
+    // Short human readable summary of every stage seen so far
+    std::wstring Describe() const {
+        std::wstring summary;
+        for (size_t origin = 0; origin < firstAudio.size(); ++origin) {
+            if (!firstAudio[origin].Count()) continue;
+            if (!summary.empty()) summary += L"; ";
+            summary += OriginNameW(static_cast<TraceOrigin>(origin)) + L" to first audio " + firstAudio[origin].Describe();
+        }
+        for (size_t stage = 0; stage < stages.size(); ++stage) {
+            if (!stages[stage].Count()) continue;
+            if (!summary.empty()) summary += L"; ";
+            summary += StageNameW(static_cast<TraceStage>(stage)) + L" " + stages[stage].Describe();
+        }
+        return summary;
+    }
+
+    // Write the retained spans as Chrome trace JSON; interactions show up as async tracks from input to first audio
+    void WriteChromeTrace(std::ostream& out) const {
+        std::vector<Event> snapshot = Snapshot();
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        auto separate = [&]() {
+            if (!first) out << ",\n";
+            first = false;
+        };
+        for (const Event& event : snapshot) {
+            separate();
+            if (event.kind == EventKind::Span) {
+                out << "{\"name\":\"" << StageName(static_cast<TraceStage>(event.code)) << "\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                    << event.thread << ",\"ts\":" << Micros(event.begin) << ",\"dur\":" << Micros(event.end - event.begin)
+                    << ",\"args\":{\"interaction\":" << event.interaction << "}}";
+            }
+            else {
+                const char* name = OriginName(static_cast<TraceOrigin>(event.code));
+                out << "{\"name\":\"" << name << "\",\"cat\":\"interaction\",\"ph\":\"b\",\"pid\":1,\"tid\":" << event.thread
+                    << ",\"id\":" << event.interaction << ",\"ts\":" << Micros(event.begin) << "},\n"
+                    << "{\"name\":\"" << name << "\",\"cat\":\"interaction\",\"ph\":\"e\",\"pid\":1,\"tid\":" << event.thread
+                    << ",\"id\":" << event.interaction << ",\"ts\":" << Micros(event.end) << "}";
+            }
+        }
+        out << "]}\n";
+    }
+
+    // Number of spans and interactions recorded, including those no longer retained
+    uint64_t Recorded() {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        return stored;
+    }
+
+    static const char* StageName(TraceStage stage) {
+        switch (stage) {
+        case TraceStage::Debounce: return "Debounce";
+        case TraceStage::HitTest: return "HitTest";
+        case TraceStage::Navigate: return "Navigate";
+        case TraceStage::Dispatch: return "Dispatch";
+        case TraceStage::Traversal: return "Traversal";
+        case TraceStage::Enqueue: return "Enqueue";
+        case TraceStage::Queued: return "Queued";
+        case TraceStage::Synthesis: return "Synthesis";
+        case TraceStage::Count: break;
+        }
+        return "Unknown";
+    }
+
+    static const char* OriginName(TraceOrigin origin) {
+        switch (origin) {
+        case TraceOrigin::Hover: return "Hover";
+        case TraceOrigin::Navigate: return "Navigate";
+        case TraceOrigin::Count: break;
+        }
+        return "Unknown";
+    }
+
+private:
+    friend class TraceScope;
+
+    enum class EventKind : uint8_t { Span, Interaction };
+
+    struct Event {
+        EventKind kind; // Stage span or whole interaction
+        uint8_t code; // TraceStage or TraceOrigin, depending on kind
+        uint64_t interaction; // Interaction id, 0 when recorded outside any interaction
+        int64_t begin; // Nanoseconds since the tracer was created
+        int64_t end;
+        uint32_t thread; // Small id of the recording thread
+    };
+
+    static InteractionRef& CurrentSlot() {
+        thread_local InteractionRef current;
+        return current;
+    }
+
+    static uint32_t ThreadId() {
+        static std::atomic<uint32_t> threads{ 0 };
+        thread_local uint32_t id = threads.fetch_add(1, std::memory_order_relaxed) + 1;
+        return id;
+    }
+
+    static std::wstring StageNameW(TraceStage stage) {
+        const char* name = StageName(stage);
+        return std::wstring(name, name + std::char_traits<char>::length(name));
+    }
+
+    static std::wstring OriginNameW(TraceOrigin origin) {
+        const char* name = OriginName(origin);
+        return std::wstring(name, name + std::char_traits<char>::length(name));
+    }
+
+    // Nanoseconds as microseconds with three decimals, the unit of Chrome traces
+    static std::string Micros(int64_t nanos) {
+        if (nanos < 0) nanos = 0;
+        std::string fraction = std::to_string(nanos % 1000);
+        return std::to_string(nanos / 1000) + "." + std::string(3 - fraction.size(), '0') + fraction;
+    }
+
+    int64_t Offset(std::chrono::steady_clock::time_point at) const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(at - start).count();
+    }
+
+    void Store(const Event& event) {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        events[stored % events.size()] = event; // Overwrite the oldest once full
+        ++stored;
+    }
+
+    std::vector<Event> Snapshot() const {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        std::vector<Event> snapshot;
+        size_t retained = stored < events.size() ? static_cast<size_t>(stored) : events.size();
+        snapshot.reserve(retained);
+        for (uint64_t i = stored - retained; i < stored; ++i) snapshot.push_back(events[i % events.size()]);
+        return snapshot;
+    }
+
+    std::chrono::steady_clock::time_point start; // Origin of exported timestamps
+    std::array<LatencyHistogram, static_cast<size_t>(TraceStage::Count)> stages; // Duration of each stage
+    std::array<LatencyHistogram, static_cast<size_t>(TraceOrigin::Count)> firstAudio; // Input to first audio, by origin
+    std::atomic<uint64_t> nextInteraction{ 0 }; // Last interaction id handed out
+    mutable std::mutex eventsMutex; // Guards events and stored
+    std::vector<Event> events; // Ring of the most recent events
+    uint64_t stored{ 0 }; // Events recorded so far
+};
+
+// Makes an interaction current on the calling thread for the lifetime of the scope
+class TraceScope {
+public:
+    explicit TraceScope(InteractionRef interaction)
+        : previous(std::exchange(LatencyTracer::CurrentSlot(), std::move(interaction))) {
+    }
+
+    ~TraceScope() { LatencyTracer::CurrentSlot() = std::move(previous); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    InteractionRef previous; // Interaction restored when the scope ends
+};
+
+// Times a stage from construction to destruction on behalf of the current interaction
+class TraceSpan {
+public:
+    TraceSpan(LatencyTracer& tracer, TraceStage stage)
+        : tracer(tracer), stage(stage), interaction(LatencyTracer::Current()), begin(std::chrono::steady_clock::now()) {
+    }
+
+    ~TraceSpan() { tracer.Record(stage, interaction, begin, std::chrono::steady_clock::now()); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    LatencyTracer& tracer;
+    TraceStage stage;
+    InteractionRef interaction; // Interaction current when the span started
+    std::chrono::steady_clock::time_point begin;
+};
+
+#endif // SIGHTSPEAK_LATENCY_TRACE_HPP
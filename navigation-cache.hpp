@@ -0,0 +1,280 @@
+#ifndef SIGHTSPEAK_NAVIGATION_CACHE_HPP
+#define SIGHTSPEAK_NAVIGATION_CACHE_HPP
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "element-provider.hpp"
+#include "latency-histogram.hpp"
+#include "latency-trace.hpp"
+
+// Step of a keyboard navigation command through the control view
+enum class NavigationMove : uint8_t {
+    Parent,
+    FirstChild,
+    NextSibling,
+    PreviousSibling
+};
+
+// Moves a navigation cursor through the control view without making the keyboard hook wait on UI Automation
+// Queue only appends the keypress; a dedicated thread applies moves in order from a graph of prefetched neighbors,
+// and after every move the neighbors of the new element and of each element next to it are fetched on workers,
+// so the next keypress usually finds its target already known
+class NavigationCache {
+public:
+    using Arrive = std::function<void(const ElementHandle& element)>; // Called on the navigation thread when a move lands
+    using Launcher = std::function<void(std::function<void()>)>; // Runs a prefetch on some worker
+
+    // Without a launcher prefetches run on the navigation thread after each move
+    NavigationCache(ElementProvider& provider, Arrive arrive, Launcher launch = nullptr, LatencyTracer* tracer = nullptr)
+        : provider(provider), arrive(std::move(arrive)), launch(std::move(launch)), tracer(tracer), worker(&NavigationCache::Run, this) {
+    }
+
+    ~NavigationCache() { Stop(); }
+
+    NavigationCache(const NavigationCache&) = delete;
+    NavigationCache& operator=(const NavigationCache&) = delete;
+
+    // Make an element the cursor position, typically the one under the mouse; prefetching starts only if asked for
+    void SetCurrent(ElementHandle element, bool prefetch) {
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            if (stopping) return;
+            ResetLocked(std::move(element));
+        }
+        if (prefetch) Refill();
+    }
+
+    // Drop every prefetched neighbor, keeping the cursor where it is; used after the tree changed
+    void Invalidate() {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (stopping || current == NoNode) return;
+        ResetLocked(nodes[current].handle);
+    }
+
+    // Fetch the neighbors around the cursor ahead of the next keypress
+    void Refill() {
+        uint64_t generation;
+        uint32_t from;
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            if (stopping || current == NoNode) return;
+            generation = cacheGeneration;
+            from = current;
+            ++prefetching;
+        }
+        auto prefetch = [this, generation, from]() {
+            PrefetchAround(generation, from);
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            --prefetching;
+            cacheCv.notify_all();
+        };
+        if (launch) launch(prefetch);
+        else prefetch();
+    }
+
+    // Queue a move from the keyboard hook; constant time, never touches UI Automation
+    // The interaction is made current while the move is applied, so the speech it causes is traced to the keypress
+    bool Queue(NavigationMove move, InteractionRef interaction = nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            if (stopping || current == NoNode) return false;
+            moves.push_back({ move, std::chrono::steady_clock::now(), std::move(interaction) });
+        }
+        cacheCv.notify_all();
+        return true;
+    }
+
+    // Stop the navigation thread and wait for prefetches in flight
+    void Stop() {
+        {
+            std::unique_lock<std::mutex> lock(cacheMutex);
+            if (stopping) return;
+            stopping = true;
+            moves.clear();
+            cacheCv.notify_all();
+        }
+        if (worker.joinable()) worker.join();
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        cacheCv.wait(lock, [this] { return prefetching == 0; }); // Prefetches queued on workers skip their work once they see stopping
+    }
+
+    // Time from a keypress to the arrival of its move
+    const LatencyHistogram& Latency() const { return latency; }
+
+    // Short human readable summary for the debug log
+    std::wstring Describe() {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        return L"hits=" + std::to_wstring(hits) + L" misses=" + std::to_wstring(misses) + L" blocked=" + std::to_wstring(blocked) +
+            L" fetches=" + std::to_wstring(fetches) + L" keypress-to-move " + latency.Describe();
+    }
+
+private:
+    static constexpr uint32_t NoNode = UINT32_MAX;
+    static constexpr int32_t Unknown = -2; // Link not fetched yet
+    static constexpr int32_t None = -1; // No element in that direction
+    static constexpr size_t MaxNodes = 1024; // Graph is rebuilt from the cursor once it grows past this
+
+    struct Node {
+        ElementHandle handle; // Element the node stands for
+        std::array<int32_t, 4> links{ Unknown, Unknown, Unknown, Unknown }; // Neighbor node per NavigationMove
+        bool fetching{ false }; // Neighbors are being fetched
+    };
+
+    struct QueuedMove {
+        NavigationMove move;
+        std::chrono::steady_clock::time_point queued; // When the key was pressed
+        InteractionRef interaction; // Traced interaction the keypress started
+    };
+
+    void ResetLocked(ElementHandle element) {
+        ++cacheGeneration; // Fetches still in flight land in a graph that no longer exists and are dropped
+        nodes.clear();
+        nodes.push_back({ std::move(element) });
+        current = 0;
+        cacheCv.notify_all();
+    }
+
+    static int32_t& Link(Node& node, NavigationMove move) { return node.links[static_cast<size_t>(move)]; }
+
+    bool KnownLocked(uint32_t node) const {
+        for (int32_t link : nodes[node].links) {
+            if (link == Unknown) return false;
+        }
+        return true;
+    }
+
+    // Fetch the neighbors of a node unless they are known or being fetched; blocks on UI Automation without the lock
+    void FetchNeighbors(std::unique_lock<std::mutex>& lock, uint64_t generation, uint32_t node) {
+        if (generation != cacheGeneration || KnownLocked(node) || nodes[node].fetching) return;
+        nodes[node].fetching = true;
+        ElementHandle handle = nodes[node].handle;
+        lock.unlock();
+        ElementNeighbors neighbors;
+        bool found = provider.FetchNeighbors(handle, neighbors);
+        lock.lock();
+        ++fetches;
+        if (generation != cacheGeneration) return;
+        nodes[node].fetching = false;
+        cacheCv.notify_all();
+        if (!found) return;
+
+        // Each new node already knows its way back, which saves fetches and keeps identities stable
+        auto attach = [&](NavigationMove move, const ElementHandle& neighbor) {
+            int32_t& link = Link(nodes[node], move);
+            if (link != Unknown) return int32_t{ None }; // Known from the other side
+            if (!neighbor) {
+                link = None;
+                return int32_t{ None };
+            }
+            int32_t added = static_cast<int32_t>(nodes.size());
+            link = added;
+            nodes.push_back({ neighbor }); // Invalidates link
+            return added;
+        };
+        int32_t parent = Link(nodes[node], NavigationMove::Parent) == Unknown ? attach(NavigationMove::Parent, neighbors.parent) : Link(nodes[node], NavigationMove::Parent);
+        int32_t child = attach(NavigationMove::FirstChild, neighbors.firstChild);
+        int32_t next = attach(NavigationMove::NextSibling, neighbors.nextSibling);
+        int32_t previous = attach(NavigationMove::PreviousSibling, neighbors.previousSibling);
+        if (child >= 0) {
+            Link(nodes[child], NavigationMove::Parent) = static_cast<int32_t>(node);
+            Link(nodes[child], NavigationMove::PreviousSibling) = None; // A first child has nothing before it
+        }
+        if (next >= 0) {
+            Link(nodes[next], NavigationMove::PreviousSibling) = static_cast<int32_t>(node);
+            Link(nodes[next], NavigationMove::Parent) = parent;
+        }
+        if (previous >= 0) {
+            Link(nodes[previous], NavigationMove::NextSibling) = static_cast<int32_t>(node);
+            Link(nodes[previous], NavigationMove::Parent) = parent;
+        }
+    }
+
+    // Fetch the neighbors of a node and of every node next to it
+    void PrefetchAround(uint64_t generation, uint32_t from) {
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        if (stopping) return;
+        FetchNeighbors(lock, generation, from);
+        for (size_t move = 0; move < 4 && !stopping && generation == cacheGeneration; ++move) {
+            int32_t neighbor = nodes[from].links[move];
+            if (neighbor >= 0) FetchNeighbors(lock, generation, static_cast<uint32_t>(neighbor));
+        }
+    }
+
+    // Resolve one move from the graph, fetching the neighbors of the cursor first if no prefetch got there yet
+    // Returns the element moved to, or null if there is nothing in that direction
+    ElementHandle Apply(std::unique_lock<std::mutex>& lock, NavigationMove move) {
+        uint64_t generation = cacheGeneration;
+        uint32_t from = current;
+        if (Link(nodes[from], move) != Unknown) {
+            ++hits;
+        }
+        else if (nodes[from].fetching) {
+            ++blocked; // A prefetch is on its way, waiting for it beats a second round trip
+            cacheCv.wait(lock, [&] { return stopping || generation != cacheGeneration || !nodes[from].fetching; });
+        }
+        else {
+            ++misses;
+            FetchNeighbors(lock, generation, from);
+        }
+        if (stopping || generation != cacheGeneration) return nullptr; // The cursor was moved by the mouse meanwhile
+        int32_t target = Link(nodes[from], move);
+        if (target < 0) return nullptr;
+        current = static_cast<uint32_t>(target);
+        return nodes[current].handle;
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        for (;;) {
+            cacheCv.wait(lock, [this] { return stopping || !moves.empty(); });
+            if (stopping) return;
+            QueuedMove queued = std::move(moves.front());
+            moves.pop_front();
+
+            TraceScope scope(queued.interaction);
+            auto resolving = std::chrono::steady_clock::now();
+            ElementHandle target = Apply(lock, queued.move);
+            if (!target) continue;
+            if (nodes.size() > MaxNodes) ResetLocked(target); // Keep the graph small, the cursor is all that matters
+
+            lock.unlock();
+            auto arrived = std::chrono::steady_clock::now();
+            latency.Record(arrived - queued.queued);
+            if (tracer) tracer->Record(TraceStage::Navigate, queued.interaction, resolving, arrived);
+            arrive(target);
+            Refill(); // Get ahead of the next keypress
+            lock.lock();
+        }
+    }
+
+    ElementProvider& provider; // Source of the neighbors, used from the navigation thread and workers
+    Arrive arrive; // Receives each element moved to
+    Launcher launch; // Runs prefetches on workers
+    LatencyTracer* tracer; // Receives a Navigate span per move, if set
+    std::mutex cacheMutex; // Guards everything below
+    std::condition_variable cacheCv; // Signals queued moves, finished fetches and shutdown
+    std::vector<Node> nodes; // Graph of the elements around the cursor
+    uint32_t current{ NoNode }; // Node of the cursor
+    uint64_t cacheGeneration{ 0 }; // Bumped whenever the graph is rebuilt
+    std::deque<QueuedMove> moves; // Keypresses not yet applied
+    size_t prefetching{ 0 }; // Prefetches launched and not finished
+    uint64_t hits{ 0 }; // Moves resolved from the graph
+    uint64_t misses{ 0 }; // Moves that had to fetch on the navigation thread
+    uint64_t blocked{ 0 }; // Moves that waited for a prefetch in flight
+    uint64_t fetches{ 0 }; // Neighbor fetches issued
+    bool stopping{ false }; // Set once Stop has been requested
+    LatencyHistogram latency; // Keypress to arrival
+    std::thread worker; // Navigation thread, started last so every member is ready
+};
+
+#endif // SIGHTSPEAK_NAVIGATION_CACHE_HPP
@@ -0,0 +1,303 @@
+#ifndef SIGHTSPEAK_OVERLAY_COMPOSITOR_HPP
+#define SIGHTSPEAK_OVERLAY_COMPOSITOR_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "element-provider.hpp"
+#include "latency-histogram.hpp"
+
+// Outline drawn around an element on the overlay
+struct OverlayHighlight {
+    uint32_t id{ 0 }; // Caller chosen identity, showing the same id again moves the outline
+    ElementRect rect; // Outer bounds in screen pixels
+    uint32_t color{ 0xFF000000 }; // Premultiplied 0xAARRGGBB
+    long thickness{ 2 }; // Width of the outline in pixels
+};
+
+// Screen area covered by the outline of a highlight, split into its four edges
+// Only these strips are ever painted, so they are all a change has to repaint
+inline std::vector<ElementRect> OutlineStrips(const ElementRect& rect, long thickness) {
+    std::vector<ElementRect> strips;
+    if (rect.right <= rect.left || rect.bottom <= rect.top || thickness <= 0) return strips;
+    long width = rect.right - rect.left;
+    long height = rect.bottom - rect.top;
+    if (thickness * 2 >= width || thickness * 2 >= height) {
+        strips.push_back(rect); // Outline fills the whole rectangle
+        return strips;
+    }
+    strips.push_back({ rect.left, rect.top, rect.right, rect.top + thickness }); // Top
+    strips.push_back({ rect.left, rect.bottom - thickness, rect.right, rect.bottom }); // Bottom
+    strips.push_back({ rect.left, rect.top + thickness, rect.left + thickness, rect.bottom - thickness }); // Left
+    strips.push_back({ rect.right - thickness, rect.top + thickness, rect.right, rect.bottom - thickness }); // Right
+    return strips;
+}
+
+// Intersection of two rectangles, empty when they do not overlap
+inline ElementRect ClipRect(const ElementRect& a, const ElementRect& b) {
+    ElementRect result{ (std::max)(a.left, b.left), (std::max)(a.top, b.top), (std::min)(a.right, b.right), (std::min)(a.bottom, b.bottom) };
+    if (result.right <= result.left || result.bottom <= result.top) return ElementRect();
+    return result;
+}
+
+// Surface a compositor presents its frames on
+// Present receives every visible highlight and the areas changed since the previous frame;
+// pixels outside those areas must be left untouched
+class OverlaySurface {
+public:
+    virtual ~OverlaySurface() = default;
+    virtual void Present(const std::vector<OverlayHighlight>& scene, const std::vector<ElementRect>& dirty) = 0;
+};
+
+// Surface rendering into 32-bit premultiplied ARGB memory
+// Owns its pixels for portable runs, or renders into memory supplied by a platform surface such as a DIB section
+class FramebufferSurface : public OverlaySurface {
+public:
+    // Framebuffer of its own covering width by height pixels whose top left corner is at origin on screen
+    FramebufferSurface(long originX, long originY, long width, long height)
+        : owned(static_cast<size_t>(width > 0 ? width : 0) * static_cast<size_t>(height > 0 ? height : 0), 0) {
+        Bind(owned.data(), originX, originY, width, height);
+    }
+
+    // Render a frame: clear the dirty areas, then paint every outline clipped to them
+    void Present(const std::vector<OverlayHighlight>& scene, const std::vector<ElementRect>& dirty) override {
+        for (const ElementRect& area : dirty) {
+            ElementRect clipped = ClipRect(area, bounds);
+            if (clipped.right == clipped.left) continue;
+            Fill(clipped, 0); // Transparent
+            for (const OverlayHighlight& highlight : scene) {
+                for (const ElementRect& strip : OutlineStrips(highlight.rect, highlight.thickness)) {
+                    ElementRect painted = ClipRect(strip, clipped);
+                    if (painted.right != painted.left) Fill(painted, highlight.color);
+                }
+            }
+        }
+    }
+
+    // Pixel at a screen position, zero outside the framebuffer
+    uint32_t Pixel(long x, long y) const {
+        if (x < bounds.left || x >= bounds.right || y < bounds.top || y >= bounds.bottom) return 0;
+        return pixels[static_cast<size_t>(y - bounds.top) * static_cast<size_t>(stride) + static_cast<size_t>(x - bounds.left)];
+    }
+
+    // Number of pixels written since creation, clears included
+    uint64_t PixelsWritten() const { return written; }
+
+    // Screen area covered by the framebuffer
+    const ElementRect& Bounds() const { return bounds; }
+
+protected:
+    // Point the surface at external pixel memory; stride is in pixels
+    void Bind(uint32_t* memory, long originX, long originY, long width, long height, long rowStride = 0) {
+        pixels = memory;
+        stride = rowStride ? rowStride : width;
+        bounds = { originX, originY, originX + (width > 0 ? width : 0), originY + (height > 0 ? height : 0) };
+    }
+
+    FramebufferSurface() = default;
+
+private:
+    void Fill(const ElementRect& area, uint32_t color) {
+        for (long y = area.top; y < area.bottom; ++y) {
+            uint32_t* row = pixels + static_cast<size_t>(y - bounds.top) * static_cast<size_t>(stride);
+            std::fill(row + (area.left - bounds.left), row + (area.right - bounds.left), color);
+        }
+        written += static_cast<uint64_t>(area.right - area.left) * static_cast<uint64_t>(area.bottom - area.top);
+    }
+
+    std::vector<uint32_t> owned; // Pixels when the surface owns them
+    uint32_t* pixels{ nullptr }; // First pixel of the top row
+    long stride{ 0 }; // Pixels per row
+    ElementRect bounds; // Screen area covered
+    uint64_t written{ 0 }; // Pixels written
+};
+
+// Retained-mode highlight compositor
+// Callers only edit the scene; changes are coalesced and the next frame repaints just the outline
+// strips that appeared, moved or disappeared, so many rapid changes cost a single small frame
+class OverlayCompositor {
+public:
+    // requestFrame is called, at most once per pending frame, when the scene changed and ComposeFrame should run soon
+    explicit OverlayCompositor(OverlaySurface& surface, std::function<void()> requestFrame = nullptr)
+        : surface(surface), requestFrame(std::move(requestFrame)) {
+    }
+
+    OverlayCompositor(const OverlayCompositor&) = delete;
+    OverlayCompositor& operator=(const OverlayCompositor&) = delete;
+
+    // Show a highlight, or move and restyle the one already shown under its id
+    void Show(const OverlayHighlight& highlight) {
+        {
+            std::lock_guard<std::mutex> lock(sceneMutex);
+            Entry& entry = scene[highlight.id];
+            entry.wanted = highlight;
+            entry.visible = true;
+            ++changes;
+        }
+        RequestFrame();
+    }
+
+    // Remove a highlight
+    void Hide(uint32_t id) {
+        {
+            std::lock_guard<std::mutex> lock(sceneMutex);
+            auto found = scene.find(id);
+            if (found == scene.end() || !found->second.visible) return;
+            found->second.visible = false;
+            ++changes;
+        }
+        RequestFrame();
+    }
+
+    // Remove every highlight
+    void HideAll() {
+        bool changed = false;
+        {
+            std::lock_guard<std::mutex> lock(sceneMutex);
+            for (auto& [id, entry] : scene) {
+                if (entry.visible) {
+                    entry.visible = false;
+                    ++changes;
+                    changed = true;
+                }
+            }
+        }
+        if (changed) RequestFrame();
+    }
+
+    // Present one frame covering every change since the previous one
+    // Returns false if nothing changed; must not run concurrently with itself
+    bool ComposeFrame() {
+        framePending.store(false, std::memory_order_release); // Changes from now on request another frame
+        auto started = std::chrono::steady_clock::now();
+
+        std::vector<OverlayHighlight> visible;
+        std::vector<ElementRect> dirty;
+        uint64_t coalesced;
+        {
+            std::lock_guard<std::mutex> lock(sceneMutex);
+            if (changes == 0) return false;
+            coalesced = std::exchange(changes, 0);
+            for (auto entry = scene.begin(); entry != scene.end();) {
+                Entry& e = entry->second;
+                bool moved = e.presented != e.visible || !Same(e.wanted, e.shown);
+                if (moved && e.presented) Append(dirty, OutlineStrips(e.shown.rect, e.shown.thickness));
+                if (moved && e.visible) Append(dirty, OutlineStrips(e.wanted.rect, e.wanted.thickness));
+                e.shown = e.wanted;
+                e.presented = e.visible;
+                if (e.visible) visible.push_back(e.wanted);
+                if (!e.visible) entry = scene.erase(entry);
+                else ++entry;
+            }
+        }
+        MergeDirty(dirty);
+        if (!dirty.empty()) surface.Present(visible, dirty);
+
+        uint64_t area = 0;
+        for (const ElementRect& rect : dirty) area += static_cast<uint64_t>(rect.right - rect.left) * static_cast<uint64_t>(rect.bottom - rect.top);
+        frames.fetch_add(1, std::memory_order_relaxed);
+        changesComposed.fetch_add(coalesced, std::memory_order_relaxed);
+        dirtyPixels.fetch_add(area, std::memory_order_relaxed);
+        frameCost.Record(std::chrono::steady_clock::now() - started);
+        return true;
+    }
+
+    // Number of frames presented
+    uint64_t Frames() const { return frames.load(std::memory_order_relaxed); }
+
+    // Number of scene changes the presented frames covered
+    uint64_t Changes() const { return changesComposed.load(std::memory_order_relaxed); }
+
+    // Total area repainted, in pixels
+    uint64_t DirtyPixels() const { return dirtyPixels.load(std::memory_order_relaxed); }
+
+    // Time spent composing and presenting each frame
+    const LatencyHistogram& FrameCost() const { return frameCost; }
+
+    // Short human readable summary for the debug log
+    std::wstring Describe() const {
+        return L"frames=" + std::to_wstring(Frames()) + L" changes=" + std::to_wstring(Changes()) +
+            L" dirtyPixels=" + std::to_wstring(DirtyPixels()) + L" cost " + frameCost.Describe();
+    }
+
+private:
+    struct Entry {
+        OverlayHighlight wanted; // Highlight as last requested
+        OverlayHighlight shown; // Highlight as last presented
+        bool visible{ false }; // Requested to be visible
+        bool presented{ false }; // Visible in the last presented frame
+    };
+
+    static constexpr size_t MaxDirtyRects = 32; // Beyond this the dirty areas are presented as their bounding box
+
+    static bool Same(const OverlayHighlight& a, const OverlayHighlight& b) {
+        return a.rect.left == b.rect.left && a.rect.top == b.rect.top && a.rect.right == b.rect.right && a.rect.bottom == b.rect.bottom &&
+            a.color == b.color && a.thickness == b.thickness;
+    }
+
+    static void Append(std::vector<ElementRect>& out, const std::vector<ElementRect>& rects) {
+        out.insert(out.end(), rects.begin(), rects.end());
+    }
+
+    static bool Touching(const ElementRect& a, const ElementRect& b) {
+        return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+    }
+
+    static ElementRect Union(const ElementRect& a, const ElementRect& b) {
+        return { (std::min)(a.left, b.left), (std::min)(a.top, b.top), (std::max)(a.right, b.right), (std::max)(a.bottom, b.bottom) };
+    }
+
+    static uint64_t Area(const ElementRect& rect) {
+        return static_cast<uint64_t>(rect.right - rect.left) * static_cast<uint64_t>(rect.bottom - rect.top);
+    }
+
+    // Merge touching rectangles whose union adds little area, so overlapping strips are painted once
+    static void MergeDirty(std::vector<ElementRect>& dirty) {
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (size_t i = 0; i < dirty.size() && !merged; ++i) {
+                for (size_t j = i + 1; j < dirty.size(); ++j) {
+                    if (!Touching(dirty[i], dirty[j])) continue;
+                    ElementRect both = Union(dirty[i], dirty[j]);
+                    if (Area(both) > (Area(dirty[i]) + Area(dirty[j])) * 2) continue; // Corner contact of distant strips
+                    dirty[i] = both;
+                    dirty[j] = dirty.back();
+                    dirty.pop_back();
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        if (dirty.size() > MaxDirtyRects) {
+            ElementRect all = dirty.front();
+            for (const ElementRect& rect : dirty) all = Union(all, rect);
+            dirty.assign(1, all);
+        }
+    }
+
+    void RequestFrame() {
+        if (requestFrame && !framePending.exchange(true, std::memory_order_acq_rel)) requestFrame();
+    }
+
+    OverlaySurface& surface; // Where frames are presented
+    std::function<void()> requestFrame; // Schedules ComposeFrame
+    std::mutex sceneMutex; // Guards scene and changes
+    std::map<uint32_t, Entry> scene; // Retained highlights by id
+    uint64_t changes{ 0 }; // Scene changes since the last frame
+    std::atomic<bool> framePending{ false }; // A frame was requested and has not started yet
+    std::atomic<uint64_t> frames{ 0 }; // Frames presented
+    std::atomic<uint64_t> changesComposed{ 0 }; // Scene changes covered by presented frames
+    std::atomic<uint64_t> dirtyPixels{ 0 }; // Area repainted
+    LatencyHistogram frameCost; // Compose and present time per frame
+};
+
+#endif // SIGHTSPEAK_OVERLAY_COMPOSITOR_HPP
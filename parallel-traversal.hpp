@@ -0,0 +1,206 @@
+#ifndef SIGHTSPEAK_PARALLEL_TRAVERSAL_HPP
+#define SIGHTSPEAK_PARALLEL_TRAVERSAL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "element-provider.hpp"
+
+// Elements of a live walk still to be fetched, spread over per-worker queues that idle workers steal from
+// Every element carries an order key, its depth followed by the child index at each level, which sorts exactly
+// in breadth-first order; each queue hands out its smallest key first, so fetches run just ahead of the reader
+class ParallelFrontier {
+public:
+    using Launcher = std::function<void(std::function<void()>)>; // Runs a helper on some worker
+
+    enum : uint8_t { Pending, Fetched, Vanished };
+
+    struct Node {
+        ElementHandle handle; // Element to fetch
+        std::vector<uint32_t> key; // Child index at each level below the root; its length is the depth
+        std::atomic<bool> claimed{ false }; // Some thread has started fetching the element
+        std::atomic<uint8_t> state{ Pending }; // Pending until the fetch ends
+        ElementSnapshot snapshot; // Properties, valid once Fetched
+        std::vector<std::shared_ptr<Node>> children; // Children in document order, valid once Fetched
+    };
+
+    // Elements below the root the filter rejects are fetched but not expanded
+    ParallelFrontier(ElementProvider& provider, int maxDepth, size_t helpers, ElementFilter filter = ElementFilter())
+        : provider(provider), maxDepth(maxDepth), filter(std::move(filter)), queues(helpers + 1) {
+    }
+
+    // Schedule the root; the caller of Fetch and Await owns the last queue
+    std::shared_ptr<Node> Start(const ElementHandle& root) {
+        auto node = std::make_shared<Node>();
+        node->handle = root;
+        Push(CallerQueue(), node);
+        return node;
+    }
+
+    // Helper loop run on a worker: fetch the smallest key of the own queue, else steal one, until the walk ends
+    void Help(size_t self) {
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            if (stopped) return; // Started after the walk ended, the provider may be gone
+            ++active;
+        }
+        for (;;) {
+            std::shared_ptr<Node> node = Take(self);
+            if (node) {
+                Fetch(node, self);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(idleMutex);
+            idleCv.wait(lock, [this] { return stopped || queued.load(std::memory_order_acquire) > 0; });
+            if (stopped) {
+                --active;
+                idleCv.notify_all();
+                return;
+            }
+        }
+    }
+
+    // Block until a node is fetched, fetching it on the calling thread if no worker has claimed it yet
+    // The reader therefore never waits for a worker to become free
+    void Await(const std::shared_ptr<Node>& node) {
+        while (node->state.load(std::memory_order_acquire) == Pending) {
+            if (!node->claimed.load(std::memory_order_acquire)) {
+                Fetch(node, CallerQueue());
+                continue;
+            }
+            node->state.wait(Pending, std::memory_order_acquire); // Woken when the worker finishes the fetch
+        }
+    }
+
+    // End the walk and wait for fetches in flight; queued elements are dropped
+    void Stop() {
+        std::unique_lock<std::mutex> lock(idleMutex);
+        stopped = true;
+        idleCv.notify_all();
+        idleCv.wait(lock, [this] { return active == 0; });
+    }
+
+    // Number of elements fetched by a thread other than the one that discovered them
+    uint64_t Stolen() const { return stolen.load(std::memory_order_relaxed); }
+
+private:
+    struct KeyAfter {
+        bool operator()(const std::shared_ptr<Node>& a, const std::shared_ptr<Node>& b) const {
+            if (a->key.size() != b->key.size()) return a->key.size() > b->key.size(); // Shallower first
+            return a->key > b->key; // Then in document order
+        }
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex; // Guards nodes
+        std::priority_queue<std::shared_ptr<Node>, std::vector<std::shared_ptr<Node>>, KeyAfter> nodes; // Smallest key on top
+    };
+
+    size_t CallerQueue() const { return queues.size() - 1; }
+
+    void Push(size_t self, std::shared_ptr<Node> node) {
+        {
+            std::lock_guard<std::mutex> lock(queues[self].mutex);
+            queues[self].nodes.push(std::move(node));
+        }
+        queued.fetch_add(1, std::memory_order_release);
+    }
+
+    std::shared_ptr<Node> Take(size_t self) {
+        for (size_t offset = 0; offset < queues.size(); ++offset) {
+            size_t victim = (self + offset) % queues.size();
+            std::lock_guard<std::mutex> lock(queues[victim].mutex);
+            if (queues[victim].nodes.empty()) continue;
+            std::shared_ptr<Node> node = queues[victim].nodes.top();
+            queues[victim].nodes.pop();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            if (offset) stolen.fetch_add(1, std::memory_order_relaxed);
+            return node;
+        }
+        return nullptr;
+    }
+
+    // Fetch an element and its child list, then queue the children on the fetching thread's queue
+    void Fetch(const std::shared_ptr<Node>& node, size_t self) {
+        if (node->claimed.exchange(true, std::memory_order_acq_rel)) return; // Taken by the reader or another worker
+        bool found = !stopped.load(std::memory_order_acquire) && provider.FetchElement(node->handle, node->snapshot);
+        bool expand = found && static_cast<int>(node->key.size()) + 1 < maxDepth &&
+            (node->key.empty() || filter.Check(node->snapshot) == PruneReason::None); // The root is always read
+        std::vector<ElementHandle> handles;
+        if (expand) provider.FetchChildren(node->handle, handles);
+
+        for (uint32_t index = 0; index < handles.size(); ++index) {
+            auto child = std::make_shared<Node>();
+            child->handle = std::move(handles[index]);
+            child->key.reserve(node->key.size() + 1);
+            child->key = node->key;
+            child->key.push_back(index);
+            node->children.push_back(child);
+        }
+        for (const std::shared_ptr<Node>& child : node->children) Push(self, child);
+        if (!node->children.empty()) {
+            std::lock_guard<std::mutex> lock(idleMutex); // Pairs with the predicate check of idle helpers
+            idleCv.notify_all();
+        }
+
+        node->state.store(found ? Fetched : Vanished, std::memory_order_release);
+        node->state.notify_all();
+    }
+
+    ElementProvider& provider; // Source of the elements, used concurrently by every helper
+    int maxDepth; // Elements at this depth or deeper are not fetched
+    ElementFilter filter; // Elements it rejects are not expanded
+    std::vector<WorkerQueue> queues; // One queue per helper, the last one belongs to the reader
+    std::atomic<size_t> queued{ 0 }; // Nodes waiting in any queue
+    std::atomic<uint64_t> stolen{ 0 }; // Nodes taken from another thread's queue
+    std::mutex idleMutex; // Guards active and changes of stopped
+    std::condition_variable idleCv; // Wakes idle helpers and the thread waiting in Stop
+    std::atomic<bool> stopped{ false }; // The walk is over, also read by fetches without the lock
+    size_t active{ 0 }; // Helpers inside Help
+};
+
+// Walk the subtree below root like the live mode of TraverseSubtree, with the per-element calls spread over helpers
+// The visitor runs on the calling thread and sees the elements in exactly the same breadth-first order as a
+// serial walk, each as soon as it and everything before it has been fetched, so its output can stream while the walk goes on
+// The calling thread fetches whatever no helper has claimed yet, so the walk completes even if no helper ever starts
+// Elements below the root the filter rejects still reach the visitor, so it can record them, but their children are never fetched
+template <typename Visitor>
+bool ParallelTraverseSubtree(ElementProvider& provider, const ElementHandle& root, int maxDepth, size_t helpers,
+    const ParallelFrontier::Launcher& launch, Visitor&& visit, const ElementFilter& filter = ElementFilter()) {
+    if (!root || maxDepth <= 0) return true;
+
+    auto frontier = std::make_shared<ParallelFrontier>(provider, maxDepth, launch ? helpers : 0, filter);
+    std::queue<std::shared_ptr<ParallelFrontier::Node>> order;
+    order.push(frontier->Start(root));
+    if (launch) {
+        for (size_t helper = 0; helper < helpers; ++helper) {
+            launch([frontier, helper]() { frontier->Help(helper); }); // Shared, a helper may start after the walk ended
+        }
+    }
+
+    bool completed = true;
+    while (!order.empty()) {
+        std::shared_ptr<ParallelFrontier::Node> node = std::move(order.front());
+        order.pop();
+        frontier->Await(node);
+        if (node->state.load(std::memory_order_acquire) == ParallelFrontier::Vanished) continue; // Skip elements that vanished mid-walk
+        node->snapshot.depth = static_cast<int>(node->key.size());
+        if (!visit(node->snapshot)) {
+            completed = false;
+            break;
+        }
+        for (std::shared_ptr<ParallelFrontier::Node>& child : node->children) order.push(std::move(child));
+        node->children.clear();
+    }
+    frontier->Stop();
+    return completed;
+}
+
+#endif // SIGHTSPEAK_PARALLEL_TRAVERSAL_HPP
@@ -14,11 +14,10 @@
 #include <fcntl.h>
 #include <io.h>
 #include <algorithm>
+#include <mmsystem.h>
 #include <sapi.h>
 #include <atomic>
-#include <unordered_set>
 #include <iostream>
-#include <sstream>
 #include <fstream>
 #include <queue>
 #include <functional>
@@ -26,6 +25,30 @@
 #include <future>
 #include "external/BS_thread_pool.hpp"
 #include "external/BS_thread_pool_utils.hpp"
+#include "cursor-prediction.hpp"
+#include "element-provider.hpp"
+#include "hover-scheduler.hpp"
+#include "latency-trace.hpp"
+#include "navigation-cache.hpp"
+#include "overlay-compositor.hpp"
+#include "parallel-traversal.hpp"
+#include "app-profile.hpp"
+#include "async-log.hpp"
+#include "audio-cache.hpp"
+#include "cancellation.hpp"
+#include "component-holder.hpp"
+#include "spatial-index.hpp"
+#include "task-lanes.hpp"
+#include "speech-backend.hpp"
+#include "text-arena.hpp"
+#include "text-fingerprint.hpp"
+#include "text-normalize.hpp"
+#include "text-stream.hpp"
+#include "tree-invalidation.hpp"
+#include "traversal-budget.hpp"
+#include "tree-mirror.hpp"
+#include "utterance-batch.hpp"
+#include "work-queue.hpp"
 
 
 // Utility function to convert UTF-8 string to wide string
@@ -51,131 +74,122 @@ std::string WstringToUtf8(const std::wstring& wstr) {
 // Structure to hold text and its associated rectangle
 // Used to link textual content with its screen location for processing and drawing
 struct TextRect {
-    std::wstring text;
+    std::wstring_view text; // Interned in arena
     RECT rect{ 0, 0, 0, 0 };
+    std::shared_ptr<TextStream> stream; // Document read chunk by chunk in place of text, if set
+    std::shared_ptr<const TextArena> arena; // Owner of text, freed with the last entry of its traversal
 };
 
 // Global variables for UI Automation and speech synthesis
 HHOOK hMouseHook; // Hook for mouse input
-CComPtr<IUIAutomation> pAutomation = NULL; // UI Automation instance
+ComponentHolder<IUIAutomation> automation; // UI Automation instance, replaced while in use when it is recreated
 CComPtr<IUIAutomationElement> pPrevElement = NULL; // Previous UI element for comparison
 RECT prevRect = { 0, 0, 0, 0 }; // Rectangle of the previous UI element
-std::shared_mutex mtx; // Mutex for thread-safe access to shared resources
-CComPtr<ISpVoice> pVoice = NULL; // SAPI voice instance for speech synthesis
+CComPtr<ISpVoice> pVoice = NULL; // SAPI voice instance for speech synthesis, swapped under pVoiceMtx rather than held in a ComponentHolder, see RecreateVoice
 std::mutex pVoiceMtx; // Mutex for thread-safe access to speech synthesis
 std::atomic<bool> speaking(false); // Atomic flag indicating if speech is in progress
-std::atomic<bool> rectangleDrawn(false); // Atomic flag indicating if a rectangle is drawn
-const int MAX_DEPTH = 6; // Maximum depth for UI element traversal
+const long SPEECH_RATE = 2; // Rate of the speech synthesis
+const USHORT SPEECH_VOLUME = 100; // Volume of the speech synthesis
+std::wstring speechVoiceId; // Token id of the voice in use, guarded by pVoiceMtx
+AudioCache audioCache(16 * 1024 * 1024); // Synthesized audio of recently spoken strings, keyed by text and voice settings
+const size_t MAX_CACHED_TEXT = 256; // Longer texts are documents rather than UI labels and are not cached
+const size_t MAX_SENTENCE_CHARS = 400; // Longest piece of a long text spoken as one utterance
+const wchar_t* AUDIO_CACHE_FILE = L"speech-cache.bin"; // On-disk tier of the audio cache, mapped at startup
+TraversalBudget traversalBudget; // Deadline and node budget of each hovered subtree read
+const size_t MAX_CHUNK_CHARS = 2000; // Longest piece of a document spoken as one utterance
+const size_t DOCUMENT_LOOKAHEAD = 4; // Document chunks read ahead of the one being spoken
+TraversalMode traversalMode = TraversalMode::Batched; // Fetch each hovered subtree with a single cache request
 COLORREF highlightColor = GetSysColor(COLOR_HIGHLIGHT); // Color used for highlighting elements
-HPEN hPen = CreatePen(PS_SOLID, 2, highlightColor); // Pen used for drawing rectangles
-HBRUSH hBrush = (HBRUSH)GetStockObject(HOLLOW_BRUSH); // Brush used for hollow rectangles
-RECT currentRect; // Currently active rectangle
-std::mutex rectMtx; // Mutex for thread-safe access to rectangle drawing
+const long HIGHLIGHT_THICKNESS = 2; // Width of the highlight outline in pixels
 std::atomic<bool> capsLockOverride(false); // Atomic flag for CAPSLOCK override
 std::atomic<bool> capsLockFirstPress{ false }; // Atomic flag for first CAPSLOCK press detection
 std::chrono::time_point<std::chrono::steady_clock> lastCapsLockPress; // Timestamp of last CAPSLOCK press
 std::shared_mutex elementMutex; // Shared mutex for UI element access
 //boost::asio::io_context io_context; // Boost.Asio io_context for managing asynchronous tasks
-BS::thread_pool pool(std::thread::hardware_concurrency());
+const unsigned int WORKER_THREADS = std::thread::hardware_concurrency() > 2 ? std::thread::hardware_concurrency() : 2; // Workers of the interactive lane
+const size_t TRAVERSAL_HELPERS = WORKER_THREADS - 1; // Workers of the helper lane, lent to live walks; interactive workers are never lent
+TaskLanes pool(WORKER_THREADS, WORKER_THREADS / 2, [](TaskLane lane) {
+    if (lane == TaskLane::Background) SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+    CoInitialize(NULL); // Every worker joins COM once, for its whole life, so no task ever initializes it again
+    }, TRAVERSAL_HELPERS); // Interactive, background and helper lanes
+HoverPolicy hoverPolicy; // Dwell and debounce settings for cursor hit tests
+std::unique_ptr<HoverScheduler> hoverScheduler; // Coalesces mouse moves so only the newest position is hit-tested
+PredictionPolicy predictionPolicy; // When a moving cursor's landing point is worth resolving ahead of the hit test
+std::unique_ptr<HoverSpeculator> speculator; // Resolves the element the cursor is heading for before it gets there
+std::unique_ptr<NavigationCache> navigation; // Applies CAPSLOCK navigation from prefetched neighbors off the keyboard hook
 
 std::atomic<int> taskVersion{ 0 };// Global atomic version counter to track task validity
-std::unordered_set<std::wstring> processedTexts; // Set to keep track of processed texts
-
-float scaleX = 1.0f;
-float scaleY = 1.0f;
+TextFingerprintSet processedTexts; // Fingerprints of the texts already queued by the current traversal
+std::shared_ptr<TextBlockPool> textBlocks = std::make_shared<TextBlockPool>(); // Blocks of released text arenas, reused by later traversals
+
+ComponentHealth automationHealth(10); // Health of the UI Automation instance, rebuilt only once found broken
+ComponentHealth speechHealth(3); // Health of the SAPI voice, rebuilt only once found broken
+std::atomic<bool> repairScheduled(false); // Atomic flag set while a component repair task is queued
+InvalidationHub invalidationHub; // Routes tree change notifications to the caches they affect
+
+CancellationSource cancellation; // Cancels every task started before the last StopCurrentProcesses
+BatchPolicy batchPolicy; // Which queued texts are merged into one utterance, and when a newer hover cuts speech off
+LatencyHistogram cancelToSilence; // Time from a cancellation request until speech has stopped
+LatencyTracer tracer; // Follows each hover and navigation command through the pipeline to its first audio sample
+const char* TRACE_FILE = "sightspeak-trace.json"; // Chrome trace written on CAPSLOCK+T
+const char* CURSOR_TRACE_FILE = "sightspeak-cursor.txt"; // Recent mouse path written on CAPSLOCK+T, replayable by the benchmark suite
+ProfileStore appProfiles; // Traversal limits, hot paths and spoken strings learned per application
+const wchar_t* PROFILE_FILE = L"app-profiles.bin"; // Mapped at startup, rewritten at shutdown
+const wchar_t* PROFILE_TEMP_FILE = L"app-profiles.tmp"; // Written first, so a crash while saving keeps the old profiles
+const size_t WARMED_PATHS = 4; // Hot paths of an application mirrored when it is first hovered
+const size_t WARMED_STRINGS = 16; // Spoken strings of an application rendered when it is first hovered
+std::atomic<HWND> hoveredWindow{ NULL }; // Top-level window of the last fresh hit test
+std::atomic<bool> recordingPath{ false }; // Set while the path of a hovered element is being recorded
+
+// Settings of the application log
+// Lines are written to a rotating debug.log and echoed to the debug output window by the writer thread
+LogSettings DebugLogSettings() {
+    LogSettings settings;
+    settings.echo = [](const std::wstring& line) { OutputDebugStringW(line.c_str()); };
+    return settings;
+}
 
-std::mutex cancelMtx; // Mutex for canceling tasks
-std::promise<void> cancelPromise; // Promise to signal cancellation
-std::shared_future<void> cancelFuture = cancelPromise.get_future().share(); // Future to share cancellation state
+AsyncLog logger(DebugLogSettings()); // Buffers log records per thread and writes them in the background
 
 // Logging function to output debug messages to both debug console and log file
+// Only copies the message into the calling thread's log buffer, formatting and file I/O happen on the log writer
 void DebugLog(const std::wstring& message) {
-    std::wstringstream ws;
-    ws << L"[DEBUG] " << message << std::endl;
-    OutputDebugString(ws.str().c_str()); // Log to the debug output window
-    std::wofstream logFile("debug.log", std::ios::app); // Log to a file for persistence
-    logFile << ws.str();
+    Log<LogLevel::Debug>(logger, message);
 }
 
 // Function to toggle CAPSLOCK override state
 // Allows CAPSLOCK to be used for navigation commands instead of its usual function
 void ToggleCapsLockOverride() {
     capsLockOverride.store(!capsLockOverride.load()); // Toggle the override state
+    if (capsLockOverride.load() && navigation) {
+        navigation->Refill(); // Fetch the neighbors of the current element before the first navigation key
+    }
 }
 
 // Forward declaration of ProcessNewElement function
 void ProcessNewElement(CComPtr<IUIAutomationElement> pElement);
 void StopCurrentProcesses();
-
-// Function to move to the parent element
-// Used for navigating up the UI Automation tree
-void MoveToParentElement() {
-    std::shared_lock<std::shared_mutex> lock(elementMutex);  // Use shared_lock for read-only access
-    if (!pPrevElement) return;
-
-    CComPtr<IUIAutomationTreeWalker> pControlWalker;
-    HRESULT hr = pAutomation->get_ControlViewWalker(&pControlWalker); // Get the tree walker for UI Automation
-    if (SUCCEEDED(hr)) {
-        CComPtr<IUIAutomationElement> pParent;
-        hr = pControlWalker->GetParentElement(pPrevElement, &pParent); // Navigate to the parent element
-        if (SUCCEEDED(hr) && pParent) {
-            pPrevElement = pParent; // Update the current element to the parent
-            ProcessNewElement(pPrevElement); // Process the new parent element
-        }
-    }
-}
-
-// Function to move to the first child element
-// Used for navigating down the UI Automation tree to the first child
-void MoveToFirstChildElement() {
-    std::shared_lock<std::shared_mutex> lock(elementMutex);  // Use shared_lock for read-only access
-    if (!pPrevElement) return;
-
-    CComPtr<IUIAutomationTreeWalker> pControlWalker;
-    HRESULT hr = pAutomation->get_ControlViewWalker(&pControlWalker); // Get the tree walker for UI Automation
-    if (SUCCEEDED(hr)) {
-        CComPtr<IUIAutomationElement> pChild;
-        hr = pControlWalker->GetFirstChildElement(pPrevElement, &pChild); // Navigate to the first child element
-        if (SUCCEEDED(hr) && pChild) {
-            pPrevElement = pChild; // Update the current element to the first child
-            ProcessNewElement(pPrevElement); // Process the new child element
-        }
-    }
-}
-
-// Function to move to the next sibling element
-// Used for navigating across the UI Automation tree to the next sibling
-void MoveToNextSiblingElement() {
-    std::shared_lock<std::shared_mutex> lock(elementMutex);  // Use shared_lock for read-only access
-    if (!pPrevElement) return;
-
-    CComPtr<IUIAutomationTreeWalker> pControlWalker;
-    HRESULT hr = pAutomation->get_ControlViewWalker(&pControlWalker); // Get the tree walker for UI Automation
-    if (SUCCEEDED(hr)) {
-        CComPtr<IUIAutomationElement> pNextSibling;
-        hr = pControlWalker->GetNextSiblingElement(pPrevElement, &pNextSibling); // Navigate to the next sibling element
-        if (SUCCEEDED(hr) && pNextSibling) {
-            pPrevElement = pNextSibling; // Update the current element to the next sibling
-            ProcessNewElement(pPrevElement); // Process the new sibling element
-        }
+void ReportAutomationResult(HRESULT hr);
+void ReportSpeechResult(HRESULT hr);
+IUIAutomationElement* UnwrapElement(const ElementHandle& handle);
+
+// Make an element reached by keyboard navigation the current one and read it
+// Runs on the navigation thread once a queued move lands
+void ArriveAtElement(const ElementHandle& element) {
+    CComPtr<IUIAutomationElement> pElement = UnwrapElement(element);
+    if (!pElement) return;
+    {
+        std::unique_lock<std::shared_mutex> lock(elementMutex);
+        pPrevElement = pElement; // Update the current element to the one navigated to
     }
+    ProcessNewElement(pElement); // Process the new element
 }
 
-// Function to move to the previous sibling element
-// Used for navigating across the UI Automation tree to the previous sibling
-void MoveToPreviousSiblingElement() {
-    std::shared_lock<std::shared_mutex> lock(elementMutex);  // Use shared_lock for read-only access
-    if (!pPrevElement) return;
-
-    CComPtr<IUIAutomationTreeWalker> pControlWalker;
-    HRESULT hr = pAutomation->get_ControlViewWalker(&pControlWalker); // Get the tree walker for UI Automation
-    if (SUCCEEDED(hr)) {
-        CComPtr<IUIAutomationElement> pPreviousSibling;
-        hr = pControlWalker->GetPreviousSiblingElement(pPrevElement, &pPreviousSibling); // Navigate to the previous sibling element
-        if (SUCCEEDED(hr) && pPreviousSibling) {
-            pPrevElement = pPreviousSibling; // Update the current element to the previous sibling
-            ProcessNewElement(pPrevElement); // Process the new sibling element
-        }
+// Queue a navigation move from the keyboard hook
+// Only appends to the navigation queue, so the hook never waits on UI Automation
+void QueueNavigation(NavigationMove move) {
+    if (navigation) {
+        navigation->Queue(move, tracer.Begin(TraceOrigin::Navigate)); // Keypress-to-speech is traced from here
     }
 }
 
@@ -187,6 +201,33 @@ void RedoCurrentElement() {
         ProcessNewElement(pPrevElement); // Reprocess the current element
     }
 }
+// Run a navigation command as a traced interaction
+// Its time to first audio is measured the same way as for a hover
+void RunNavigationCommand(void (*command)()) {
+    TraceScope scope(tracer.Begin(TraceOrigin::Navigate));
+    TraceSpan span(tracer, TraceStage::Navigate);
+    command();
+}
+
+// Write the recent stage timings as a Chrome trace
+// Load the file in chrome://tracing or ui.perfetto.dev to see which stage a slow interaction spent its time in
+void ExportLatencyTrace() {
+    std::ofstream traceFile(TRACE_FILE, std::ios::binary | std::ios::trunc);
+    if (!traceFile) {
+        DebugLog(L"Failed to open latency trace file");
+        return;
+    }
+    tracer.WriteChromeTrace(traceFile);
+    DebugLog(L"Latency trace written: " + tracer.Describe());
+
+    if (!speculator) return;
+    std::ofstream cursorFile(CURSOR_TRACE_FILE, std::ios::trunc);
+    if (!cursorFile) {
+        DebugLog(L"Failed to open cursor trace file");
+        return;
+    }
+    CursorTrace::Write(cursorFile, speculator->Recent()); // Lets prediction changes be measured against real mouse paths
+}
 
 
 // Low-level keyboard procedure to handle keyboard shortcuts
@@ -220,19 +261,22 @@ LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam) {
             if (capsLockOverride.load()) { // Check if CAPSLOCK override is enabled
                 switch (pKeyBoard->vkCode) {
                 case 'W':
-                    MoveToParentElement(); // Navigate to parent element on CAPSLOCK+W
+                    QueueNavigation(NavigationMove::Parent); // Navigate to parent element on CAPSLOCK+W
                     break;
                 case 'S':
-                    MoveToFirstChildElement(); // Navigate to first child element on CAPSLOCK+S
+                    QueueNavigation(NavigationMove::FirstChild); // Navigate to first child element on CAPSLOCK+S
                     break;
                 case 'D':
-                    MoveToNextSiblingElement(); // Navigate to next sibling element on CAPSLOCK+D
+                    QueueNavigation(NavigationMove::NextSibling); // Navigate to next sibling element on CAPSLOCK+D
                     break;
                 case 'A':
-                    MoveToPreviousSiblingElement(); // Navigate to previous sibling element on CAPSLOCK+A
+                    QueueNavigation(NavigationMove::PreviousSibling); // Navigate to previous sibling element on CAPSLOCK+A
                     break;
                 case 'E':
-                    RedoCurrentElement(); // Redo the current element on CAPSLOCK+E
+                    RunNavigationCommand(RedoCurrentElement); // Redo the current element on CAPSLOCK+E
+                    break;
+                case 'T':
+                    ExportLatencyTrace(); // Write the latency trace on CAPSLOCK+T
                     break;
                 }
             }
@@ -275,320 +319,1643 @@ void SetConsoleBufferSize() {
     }
 }
 
-// Function to process a rectangle on the screen
-// Draws or clears a rectangle around the specified area
-void ProcessRectangle(const RECT& rect, bool draw, std::shared_future<void> cancelFuture) {
-    if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) { return; } // Exit if cancellation is requested
+// Overlay surface backed by a layered, click-through window covering the virtual screen
+// Frames are rendered into a DIB section and only the dirty part is pushed to the window,
+// so highlights never touch the desktop DC or force other windows to repaint
+class LayeredOverlaySurface : public FramebufferSurface {
+public:
+    // Create the window on the calling thread, which must pump its messages
+    bool Create() {
+        long x = GetSystemMetrics(SM_XVIRTUALSCREEN);
+        long y = GetSystemMetrics(SM_YVIRTUALSCREEN);
+        long width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+        long height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
+
+        WNDCLASSEX wc = { sizeof(WNDCLASSEX) };
+        wc.lpfnWndProc = WindowProc;
+        wc.hInstance = GetModuleHandle(NULL);
+        wc.lpszClassName = L"SightSpeakOverlay";
+        RegisterClassEx(&wc);
+        hwnd = CreateWindowEx(WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_TOPMOST | WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE,
+            wc.lpszClassName, L"", WS_POPUP, x, y, width, height, NULL, NULL, wc.hInstance, NULL);
+        if (!hwnd) {
+            DebugLog(L"Failed to create overlay window: " + std::to_wstring(GetLastError()));
+            return false;
+        }
+
+        BITMAPINFO bmi = {};
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = width;
+        bmi.bmiHeader.biHeight = -height; // Top-down rows, as the framebuffer expects
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        void* bits = NULL;
+        memoryDC = CreateCompatibleDC(NULL);
+        bitmap = CreateDIBSection(memoryDC, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+        if (!memoryDC || !bitmap || !bits) {
+            DebugLog(L"Failed to create overlay bitmap: " + std::to_wstring(GetLastError()));
+            Destroy();
+            return false;
+        }
+        oldBitmap = SelectObject(memoryDC, bitmap);
+        Bind(static_cast<uint32_t*>(bits), x, y, width, height); // DIB sections start zeroed, fully transparent
+        ShowWindow(hwnd, SW_SHOWNOACTIVATE);
+        return true;
+    }
+
+    // Release the window and the bitmap
+    void Destroy() {
+        if (memoryDC && oldBitmap) SelectObject(memoryDC, oldBitmap);
+        if (bitmap) DeleteObject(bitmap);
+        if (memoryDC) DeleteDC(memoryDC);
+        if (hwnd) DestroyWindow(hwnd);
+        Bind(nullptr, 0, 0, 0, 0);
+        oldBitmap = NULL;
+        bitmap = NULL;
+        memoryDC = NULL;
+        hwnd = NULL;
+    }
+
+    // Render into the bitmap, then hand the bounding box of the dirty areas to the window manager
+    void Present(const std::vector<OverlayHighlight>& scene, const std::vector<ElementRect>& dirty) override {
+        if (!hwnd) return;
+        FramebufferSurface::Present(scene, dirty);
+
+        const ElementRect& screen = Bounds();
+        RECT changed = { 0, 0, 0, 0 };
+        for (const ElementRect& area : dirty) {
+            RECT local = { area.left - screen.left, area.top - screen.top, area.right - screen.left, area.bottom - screen.top };
+            UnionRect(&changed, &changed, &local);
+        }
+        RECT window = { 0, 0, screen.right - screen.left, screen.bottom - screen.top };
+        IntersectRect(&changed, &changed, &window);
+
+        POINT position = { screen.left, screen.top };
+        SIZE size = { screen.right - screen.left, screen.bottom - screen.top };
+        POINT source = { 0, 0 };
+        BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+        UPDATELAYEREDWINDOWINFO info = { sizeof(UPDATELAYEREDWINDOWINFO) };
+        info.pptDst = &position;
+        info.psize = &size;
+        info.hdcSrc = memoryDC;
+        info.pptSrc = &source;
+        info.pblend = &blend;
+        info.dwFlags = ULW_ALPHA;
+        info.prcDirty = &changed; // Only the changed strips are copied and recomposed
+        if (!UpdateLayeredWindowIndirect(hwnd, &info)) {
+            DebugLog(L"Failed to update overlay window: " + std::to_wstring(GetLastError()));
+        }
+    }
+
+    // Ask the window thread to compose a frame
+    void RequestFrame() {
+        HWND target = hwnd;
+        if (target) PostMessage(target, WM_OVERLAY_FRAME, 0, 0);
+    }
+
+    // Window of the overlay, NULL until created
+    HWND Window() const { return hwnd; }
+
+    static const UINT WM_OVERLAY_FRAME = WM_APP + 1; // Posted when the scene changed
+
+private:
+    static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+    std::atomic<HWND> hwnd{ NULL }; // Overlay window, read by threads requesting frames
+    HDC memoryDC = NULL; // Memory DC holding the bitmap
+    HBITMAP bitmap = NULL; // 32-bit premultiplied ARGB pixels of the overlay
+    HGDIOBJ oldBitmap = NULL; // Bitmap selected into memoryDC before ours
+};
+
+LayeredOverlaySurface overlaySurface; // Layered window the highlights are composed on
+OverlayCompositor overlay(overlaySurface, []() { overlaySurface.RequestFrame(); }); // Retained highlights, coalesced into frames
+std::thread overlayThread; // Owns the overlay window and composes its frames
+const uint32_t SPOKEN_HIGHLIGHT = 1; // Highlight id of the element being spoken
+
+// Compose on the window thread, so every change posted before the message is handled shares one frame
+LRESULT CALLBACK LayeredOverlaySurface::WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+    case WM_OVERLAY_FRAME:
+        overlay.ComposeFrame();
+        return 0;
+    case WM_CLOSE:
+        overlaySurface.Destroy();
+        return 0;
+    case WM_DESTROY:
+        PostQuitMessage(0);
+        return 0;
+    }
+    return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+// Overlay thread function
+// Creates the overlay window and pumps its messages until it is closed
+void OverlayThread() {
+    if (!overlaySurface.Create()) return;
+    overlay.ComposeFrame(); // Show whatever was requested before the window existed
+
+    MSG msg;
+    while (GetMessage(&msg, NULL, 0, 0) > 0) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg); // Process Windows messages
+    }
+}
+
+// Highlight the element being spoken
+void ShowHighlight(const RECT& rect) {
+    BYTE red = GetRValue(highlightColor), green = GetGValue(highlightColor), blue = GetBValue(highlightColor);
+    overlay.Show({ SPOKEN_HIGHLIGHT, { rect.left, rect.top, rect.right, rect.bottom },
+        0xFF000000u | (static_cast<uint32_t>(red) << 16) | (static_cast<uint32_t>(green) << 8) | blue, HIGHLIGHT_THICKNESS });
+}
+
+
+// Function to print text to the console and log it
+// Outputs text to the console and also logs it for debugging
+void PrintText(const std::wstring& text) {
+    std::wcout << text << std::endl; // Output the text to the console
+    std::wcout.flush(); // Flush the console output
+}
+
+// Token id of the voice a SAPI voice object speaks with, empty if unknown
+std::wstring VoiceIdOf(ISpVoice* voice) {
+    CComPtr<ISpObjectToken> pToken;
+    LPWSTR id = NULL;
+    if (!voice || FAILED(voice->GetVoice(&pToken)) || !pToken || FAILED(pToken->GetId(&id)) || !id) return std::wstring();
+    std::wstring result(id);
+    CoTaskMemFree(id);
+    return result;
+}
+
+// Wave format SAPI reads and writes for a clip format
+WAVEFORMATEX ToWaveFormat(const AudioFormat& format) {
+    WAVEFORMATEX wave = {};
+    wave.wFormatTag = WAVE_FORMAT_PCM;
+    wave.nChannels = format.channels;
+    wave.nSamplesPerSec = format.samplesPerSecond;
+    wave.wBitsPerSample = format.bitsPerSample;
+    wave.nBlockAlign = static_cast<WORD>(format.channels * format.bitsPerSample / 8);
+    wave.nAvgBytesPerSec = format.BytesPerSecond();
+    return wave;
+}
+
+// SAPI stream over an in-memory copy of a clip, or over an empty buffer to render into
+CComPtr<ISpStream> CreateAudioStream(const AudioFormat& format, const std::vector<uint8_t>* samples, CComPtr<IStream>& pMemory) {
+    CComPtr<ISpStream> pStream;
+    if (FAILED(CreateStreamOnHGlobal(NULL, TRUE, &pMemory))) return NULL;
+    if (samples && !samples->empty()) {
+        ULONG written = 0;
+        LARGE_INTEGER start = {};
+        if (FAILED(pMemory->Write(samples->data(), static_cast<ULONG>(samples->size()), &written)) ||
+            FAILED(pMemory->Seek(start, STREAM_SEEK_SET, NULL))) return NULL;
+    }
+    WAVEFORMATEX wave = ToWaveFormat(format);
+    if (FAILED(CoCreateInstance(CLSID_SpStream, NULL, CLSCTX_ALL, IID_PPV_ARGS(&pStream))) ||
+        FAILED(pStream->SetBaseStream(pMemory, SPDFID_WaveFormatEx, &wave))) return NULL;
+    return pStream;
+}
+
+// Speech backend driven by SAPI notifications
+// A dedicated thread sleeps on the voice's notification event, so waiting for an utterance costs no CPU
+class SapiSpeechBackend : public SpeechBackend {
+public:
+    // Route the events of the current voice to this backend
+    // Called with pVoiceMtx held whenever a voice has been created
+    void Attach() {
+        if (!pVoice) return;
+        ULONGLONG interest = SPFEI(SPEI_START_INPUT_STREAM) | SPFEI(SPEI_WORD_BOUNDARY) | SPFEI(SPEI_END_INPUT_STREAM);
+        HRESULT hr = pVoice->SetInterest(interest, interest); // None of these events carries a parameter that must be freed
+        if (SUCCEEDED(hr)) hr = pVoice->SetNotifyWin32Event();
+        if (FAILED(hr)) {
+            DebugLog(L"Failed to subscribe to speech events: " + std::to_wstring(hr));
+            return;
+        }
+        streamUtterance = 0; // An utterance on a replaced voice never reports its end
+        speechVoiceId = VoiceIdOf(pVoice); // Part of the audio cache key
+        if (!hWake) hWake = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (!eventThread.joinable()) {
+            eventThread = std::thread(&SapiSpeechBackend::Run, this);
+        }
+        else {
+            SetEvent(hWake); // Pick up the notification event of the new voice
+        }
+    }
+
+    // Stop the event thread; the current utterance ends as interrupted
+    void Stop() {
+        stopping.store(true);
+        if (hWake) SetEvent(hWake);
+        if (eventThread.joinable()) eventThread.join();
+        EndUtterance(CurrentUtterance(), false);
+    }
+
+    bool Speak(const std::wstring& text, SpeechCallbacks callbacks) override {
+        uint64_t id = BeginUtterance(std::move(callbacks));
+        HRESULT hr = E_FAIL;
+        {
+            std::lock_guard<std::mutex> lock(pVoiceMtx);
+            if (pVoice) { // Check if the speech synthesis object is valid
+                ULONG streamNumber = 0;
+                hr = pVoice->Speak(text.c_str(), SPF_ASYNC | SPF_PURGEBEFORESPEAK, &streamNumber); // Replace anything still playing
+                ReportSpeechResult(hr); // Track whether the voice still works
+                if (SUCCEEDED(hr)) {
+                    currentStream = streamNumber; // Recorded before the event thread can drain events for it
+                    streamUtterance = id;
+                }
+                else {
+                    DebugLog(L"Failed to speak text: " + text + L" Error: " + std::to_wstring(hr)); // Log failure to speak
+                }
+            }
+        }
+        if (FAILED(hr)) EndUtterance(id, false);
+        return SUCCEEDED(hr);
+    }
+
+    bool Play(const AudioClip& clip, SpeechCallbacks callbacks) override {
+        uint64_t id = BeginUtterance(std::move(callbacks));
+        CComPtr<IStream> pMemory;
+        CComPtr<ISpStream> pStream = CreateAudioStream(clip.format, &clip.samples, pMemory); // Built before taking the voice lock
+        HRESULT hr = E_FAIL;
+        if (pStream) {
+            std::lock_guard<std::mutex> lock(pVoiceMtx);
+            if (pVoice) {
+                ULONG streamNumber = 0;
+                hr = pVoice->SpeakStream(pStream, SPF_ASYNC | SPF_PURGEBEFORESPEAK, &streamNumber); // Straight to the audio device, no synthesis
+                ReportSpeechResult(hr); // Track whether the voice still works
+                if (SUCCEEDED(hr)) {
+                    currentStream = streamNumber;
+                    streamUtterance = id;
+                }
+                else {
+                    DebugLog(L"Failed to play cached speech: " + std::to_wstring(hr));
+                }
+            }
+        }
+        if (FAILED(hr)) EndUtterance(id, false);
+        return SUCCEEDED(hr);
+    }
+
+    bool Purge() override {
+        uint64_t id = CurrentUtterance();
+        HRESULT hr = S_OK;
+        {
+            std::lock_guard<std::mutex> lock(pVoiceMtx);
+            if (pVoice) {
+                hr = pVoice->Speak(nullptr, SPF_PURGEBEFORESPEAK, nullptr); // Purge any ongoing speech
+                ReportSpeechResult(hr); // Track whether the voice still works
+                if (FAILED(hr)) {
+                    DebugLog(L"Failed to stop speech: " + std::to_wstring(hr)); // Log failure to stop speech
+                }
+            }
+            streamUtterance = 0;
+        }
+        EndUtterance(id, false); // Wake the waiting task at once instead of after the audio drains
+        return SUCCEEDED(hr);
+    }
+
+private:
+    // Event thread, sleeps until the voice queues events or the wake event is set
+    void Run() {
+        CoInitialize(NULL);
+        while (!stopping.load()) {
+            HANDLE handles[2] = { hWake, NULL };
+            DWORD count = 1;
+            {
+                std::lock_guard<std::mutex> lock(pVoiceMtx);
+                HANDLE hNotify = pVoice ? pVoice->GetNotifyEventHandle() : NULL;
+                if (hNotify && DuplicateHandle(GetCurrentProcess(), hNotify, GetCurrentProcess(), &handles[1], 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+                    count = 2; // Own copy stays valid if the voice is released while waiting
+                }
+            }
+            DWORD result = WaitForMultipleObjects(count, handles, FALSE, INFINITE);
+            if (count == 2) CloseHandle(handles[1]);
+            if (result == WAIT_OBJECT_0 + 1) DrainEvents();
+        }
+        CoUninitialize();
+    }
+
+    // Forward queued word boundaries and stream ends of the current utterance
+    void DrainEvents() {
+        struct Progress {
+            uint64_t id;
+            SPEVENTENUM kind;
+            size_t offset;
+            size_t length;
+        };
+        std::vector<Progress> progress;
+        {
+            std::lock_guard<std::mutex> lock(pVoiceMtx);
+            if (!pVoice) return;
+            SPEVENT event;
+            ULONG fetched = 0;
+            while (SUCCEEDED(pVoice->GetEvents(1, &event, &fetched)) && fetched == 1) {
+                if (!streamUtterance || event.ulStreamNum != currentStream) continue; // Purged or replaced stream
+                if (event.eEventId == SPEI_START_INPUT_STREAM) {
+                    progress.push_back({ streamUtterance, SPEI_START_INPUT_STREAM, 0, 0 });
+                }
+                else if (event.eEventId == SPEI_WORD_BOUNDARY) {
+                    progress.push_back({ streamUtterance, SPEI_WORD_BOUNDARY, static_cast<size_t>(event.lParam), static_cast<size_t>(event.wParam) });
+                }
+                else if (event.eEventId == SPEI_END_INPUT_STREAM) {
+                    progress.push_back({ streamUtterance, SPEI_END_INPUT_STREAM, 0, 0 });
+                    streamUtterance = 0;
+                }
+            }
+        }
+        for (const Progress& item : progress) { // Callbacks run without pVoiceMtx so they may speak or purge
+            if (item.kind == SPEI_START_INPUT_STREAM) ReportStart(item.id);
+            else if (item.kind == SPEI_WORD_BOUNDARY) ReportWord(item.id, item.offset, item.length);
+            else EndUtterance(item.id, true);
+        }
+    }
+
+    HANDLE hWake = NULL; // Wakes the event thread to stop or to switch voices
+    std::thread eventThread; // Thread draining the voice's event queue
+    std::atomic<bool> stopping{ false }; // Set once the event thread should exit
+    ULONG currentStream = 0; // SAPI stream number of the current utterance, guarded by pVoiceMtx
+    uint64_t streamUtterance = 0; // Utterance playing on currentStream or zero, guarded by pVoiceMtx
+};
+
+SapiSpeechBackend speechBackend; // Speech synthesizer used for all output
+
+// Renders texts for the audio cache on a voice of its own, so the speaking voice is never blocked
+class SapiAudioRenderer : public AudioRenderer {
+public:
+    bool Render(const AudioCacheKey& key, AudioClip& clip) override {
+        std::lock_guard<std::mutex> lock(renderMtx);
+        if (!pRenderVoice) {
+            HRESULT hr = CoCreateInstance(CLSID_SpVoice, NULL, CLSCTX_ALL, IID_ISpVoice, (void**)&pRenderVoice);
+            if (FAILED(hr)) {
+                DebugLog(L"Failed to create rendering voice: " + std::to_wstring(hr));
+                return false;
+            }
+        }
+        if (VoiceIdOf(pRenderVoice) != key.voice) return false; // Audio would not match what the key promises
+        pRenderVoice->SetVolume(key.volume);
+        pRenderVoice->SetRate(key.rate);
+
+        clip.format = AudioFormat();
+        CComPtr<IStream> pMemory;
+        CComPtr<ISpStream> pStream = CreateAudioStream(clip.format, nullptr, pMemory);
+        if (!pStream || FAILED(pRenderVoice->SetOutput(pStream, TRUE))) return false;
+        HRESULT hr = pRenderVoice->Speak(key.text.c_str(), SPF_DEFAULT, NULL); // Synchronous, the stream holds the whole clip afterwards
+        pRenderVoice->SetOutput(NULL, TRUE);
+        if (FAILED(hr)) {
+            DebugLog(L"Failed to render speech: " + std::to_wstring(hr));
+            return false;
+        }
+
+        STATSTG stat = {};
+        LARGE_INTEGER start = {};
+        if (FAILED(pMemory->Stat(&stat, STATFLAG_NONAME)) || FAILED(pMemory->Seek(start, STREAM_SEEK_SET, NULL))) return false;
+        clip.samples.resize(static_cast<size_t>(stat.cbSize.QuadPart));
+        ULONG read = 0;
+        if (clip.samples.empty() || FAILED(pMemory->Read(clip.samples.data(), static_cast<ULONG>(clip.samples.size()), &read))) return false;
+        clip.samples.resize(read);
+        return true;
+    }
+
+    // Release the rendering voice
+    void Close() {
+        std::lock_guard<std::mutex> lock(renderMtx);
+        pRenderVoice.Release();
+    }
+
+private:
+    std::mutex renderMtx; // Mutex for thread-safe access to the rendering voice
+    CComPtr<ISpVoice> pRenderVoice = NULL; // Voice whose output goes to memory
+};
+
+SapiAudioRenderer audioRenderer; // Fills the audio cache in the background
+
+// Cache key for a text spoken with the current voice settings
+AudioCacheKey SpeechKey(const std::wstring& text) {
+    std::lock_guard<std::mutex> lock(pVoiceMtx);
+    return { text, speechVoiceId, SPEECH_RATE, SPEECH_VOLUME };
+}
+
+// Map the on-disk tier of the audio cache so common strings are warm right after startup
+HANDLE hAudioCacheFile = INVALID_HANDLE_VALUE; // File backing the mapped tier
+HANDLE hAudioCacheMapping = NULL; // Mapping of that file
+const uint8_t* pAudioCacheView = NULL; // Mapped bytes handed to the cache
+
+void LoadAudioCache() {
+    hAudioCacheFile = CreateFile(AUDIO_CACHE_FILE, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hAudioCacheFile == INVALID_HANDLE_VALUE) return; // First run, nothing persisted yet
+    LARGE_INTEGER size = {};
+    if (GetFileSizeEx(hAudioCacheFile, &size) && size.QuadPart > 0) {
+        hAudioCacheMapping = CreateFileMapping(hAudioCacheFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (hAudioCacheMapping) {
+            pAudioCacheView = static_cast<const uint8_t*>(MapViewOfFile(hAudioCacheMapping, FILE_MAP_READ, 0, 0, 0)); // Pages load lazily on first hit
+        }
+    }
+    if (!pAudioCacheView || !audioCache.AttachDisk(pAudioCacheView, static_cast<size_t>(size.QuadPart))) {
+        DebugLog(L"Ignoring unreadable audio cache file");
+    }
+}
+
+// Release the mapping of the on-disk tier
+void UnloadAudioCache() {
+    audioCache.DetachDisk();
+    if (pAudioCacheView) UnmapViewOfFile(pAudioCacheView);
+    if (hAudioCacheMapping) CloseHandle(hAudioCacheMapping);
+    if (hAudioCacheFile != INVALID_HANDLE_VALUE) CloseHandle(hAudioCacheFile);
+    pAudioCacheView = NULL;
+    hAudioCacheMapping = NULL;
+    hAudioCacheFile = INVALID_HANDLE_VALUE;
+}
+
+// Persist the most recently used clips for the next start
+void SaveAudioCache() {
+    AudioPack::Entries entries = audioCache.Persistable(32 * 1024 * 1024); // Copied out before the mapping goes away
+    UnloadAudioCache();
+    std::vector<uint8_t> pack = AudioPack::Serialize(entries);
+    HANDLE hFile = CreateFile(AUDIO_CACHE_FILE, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    DWORD written = 0;
+    if (hFile == INVALID_HANDLE_VALUE || !WriteFile(hFile, pack.data(), static_cast<DWORD>(pack.size()), &written, NULL) || written != pack.size()) {
+        DebugLog(L"Failed to write audio cache file: " + std::to_wstring(GetLastError()));
+    }
+    if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+}
 
-    // Get the DPI scaling factor
-    RECT scaledRect = {
-        static_cast<LONG>(rect.left * scaleX),
-        static_cast<LONG>(rect.top * scaleY),
-        static_cast<LONG>(rect.right * scaleX),
-        static_cast<LONG>(rect.bottom * scaleY)
+// Map the profiles saved by the previous session; profiles are decoded only when their application is hovered
+HANDLE hProfileFile = INVALID_HANDLE_VALUE; // File backing the mapped profiles
+HANDLE hProfileMapping = NULL; // Mapping of that file
+const uint8_t* pProfileView = NULL; // Mapped bytes handed to the profile store
+
+void LoadAppProfiles() {
+    auto started = std::chrono::steady_clock::now();
+    hProfileFile = CreateFile(PROFILE_FILE, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hProfileFile == INVALID_HANDLE_VALUE) return; // First run, nothing learned yet
+    LARGE_INTEGER size = {};
+    if (GetFileSizeEx(hProfileFile, &size) && size.QuadPart > 0) {
+        hProfileMapping = CreateFileMapping(hProfileFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (hProfileMapping) {
+            pProfileView = static_cast<const uint8_t*>(MapViewOfFile(hProfileMapping, FILE_MAP_READ, 0, 0, 0));
+        }
+    }
+    if (!pProfileView || !appProfiles.AttachDisk(pProfileView, static_cast<size_t>(size.QuadPart))) {
+        DebugLog(L"Ignoring unreadable or outdated application profiles"); // Overwritten at shutdown
+        return;
+    }
+    DebugLog(L"Application profiles mapped in " +
+        std::to_wstring(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count()) + L"us");
+}
+
+// Release the mapping of the saved profiles
+void UnloadAppProfiles() {
+    appProfiles.DetachDisk();
+    if (pProfileView) UnmapViewOfFile(pProfileView);
+    if (hProfileMapping) CloseHandle(hProfileMapping);
+    if (hProfileFile != INVALID_HANDLE_VALUE) CloseHandle(hProfileFile);
+    pProfileView = NULL;
+    hProfileMapping = NULL;
+    hProfileFile = INVALID_HANDLE_VALUE;
+}
+
+// Persist what was learned about each application for the next start
+void SaveAppProfiles() {
+    std::vector<AppProfile> profiles = appProfiles.Persistable(); // Copied out before the mapping goes away
+    UnloadAppProfiles();
+    std::vector<uint8_t> pack = ProfilePack::Serialize(profiles);
+    HANDLE hFile = CreateFile(PROFILE_TEMP_FILE, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    DWORD written = 0;
+    bool complete = hFile != INVALID_HANDLE_VALUE && WriteFile(hFile, pack.data(), static_cast<DWORD>(pack.size()), &written, NULL) && written == pack.size();
+    if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+    if (!complete || !MoveFileEx(PROFILE_TEMP_FILE, PROFILE_FILE, MOVEFILE_REPLACE_EXISTING)) {
+        DebugLog(L"Failed to write application profiles: " + std::to_wstring(GetLastError()));
+    }
+}
+
+// Callbacks timing the first sample of an utterance requested at started
+SpeechCallbacks FirstSampleCallbacks(std::chrono::steady_clock::time_point started, bool cached) {
+    SpeechCallbacks callbacks;
+    callbacks.onStart = [started, cached, interaction = LatencyTracer::Current()]() {
+        auto now = std::chrono::steady_clock::now();
+        audioCache.RecordFirstSample(cached, now - started); // Time to first sample
+        tracer.Record(TraceStage::Synthesis, interaction, started, now);
+        tracer.Answer(interaction, now); // Completes the interaction on its first utterance only
     };
+    return callbacks;
+}
+
+// Speak one utterance and block until it ends
+// Repeated UI strings play their cached audio instead of being synthesized again
+void SpeakUtterance(const std::wstring& utterance, bool cacheable, const CancellationToken& cancelToken) {
+    auto started = std::chrono::steady_clock::now();
+    AudioCacheKey key = SpeechKey(utterance);
+    std::shared_ptr<const AudioClip> clip = cacheable ? audioCache.Find(key) : nullptr;
+
+    // Block without polling until the utterance ends; StopCurrentProcesses purges the backend, which ends the wait at once,
+    // and if it cancelled just before the utterance started, the token makes SpeakAndWait purge it as soon as it has
+    SpeakAndWait(speechBackend, utterance, clip.get(), FirstSampleCallbacks(started, clip != nullptr), cancelToken);
+
+    if (cacheable && !clip) {
+        pool.Detach(TaskLane::Background, [key]() { audioCache.Warm(audioRenderer, key); }); // Render for next time on the second voice
+    }
+}
+
+// Task to speak text and manage rectangle
+// Asynchronously processes text for speech and manages the associated rectangle
+void SpeakTextTask(std::wstring_view textToSpeak, CancellationToken cancelToken) {
+    // Check if the task should be canceled before starting
+    if (cancelToken.IsCancelled()) { return; } // Exit if cancellation is requested
 
     try {
-        HDC hdc = GetDC(NULL); // Get the device context for drawing on the screen
-        if (hdc) {
-            if (draw) {
-                // Delay handling is managed outside the critical section to avoid locking overhead
-                HGDIOBJ hOldPen = SelectObject(hdc, hPen); // Select the pen for drawing
-                HGDIOBJ hOldBrush = SelectObject(hdc, hBrush); // Select the brush for drawing
-
-                if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-                    ReleaseDC(NULL, hdc); // Release the device context before returning
-                    return;
-                } // Exit if cancellation is requested
-
-                std::this_thread::sleep_for(std::chrono::milliseconds(30)); // Sleep to simulate drawing delay
-
-                if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-                    ReleaseDC(NULL, hdc); // Release the device context before returning
-                    return;
-                } // Exit if cancellation is requested
-
-                std::this_thread::sleep_for(std::chrono::milliseconds(30)); // Sleep to simulate drawing delay
-
-                if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-                    ReleaseDC(NULL, hdc); // Release the device context before returning
-                    return;
-                } // Exit if cancellation is requested
-
-                Rectangle(hdc, scaledRect.left, scaledRect.top, scaledRect.right, scaledRect.bottom); // Draw the rectangle
-
-                SelectObject(hdc, hOldPen); // Restore the previous pen
-                SelectObject(hdc, hOldBrush); // Restore the previous brush
-                rectangleDrawn.store(true); // Mark the rectangle as drawn
-                {
-                    // Lock the rectangle resource to ensure thread-safe access
-                    std::lock_guard<std::mutex> rectLock(rectMtx);
-                    currentRect = rect; // Update the current rectangle with the scaled rectangle
+        std::wstring normalized;
+        TextNormalizer::Normalize(textToSpeak, normalized); // Drop what the synthesizer would stumble over or read out
+        if (normalized.empty()) { return; } // Nothing but whitespace, separators and invisible characters
+
+        PrintText(normalized); // Output the text to the console and log it
+
+        speaking.store(true); // Set the speaking flag to true, indicating speech is in progress
+
+        // Check for cancellation again before starting speech
+        if (cancelToken.IsCancelled()) { return; } // Exit if cancellation is requested
+
+        if (normalized.size() <= MAX_CACHED_TEXT) {
+            SpeakUtterance(normalized, true, cancelToken); // UI strings stay whole so their audio can be cached
+        }
+        else {
+            // Longer text is spoken sentence by sentence, so a stop never waits on a long utterance to be synthesized
+            std::vector<std::wstring_view> sentences;
+            TextNormalizer::SplitSentences(std::wstring_view(normalized), MAX_SENTENCE_CHARS, sentences);
+            for (std::wstring_view sentence : sentences) {
+                if (cancelToken.IsCancelled()) break;
+                SpeakUtterance(std::wstring(sentence), false, cancelToken);
+            }
+        }
+
+        speaking.store(false); // Reset the speaking flag to indicate speech is complete
+    }
+    catch (const std::exception& e) {
+        // Log any exceptions that occur during the task
+        DebugLog(L"Exception in SpeakTextTask: " + Utf8ToWstring(e.what()));
+    }
+}
+
+
+// Class to manage the queue for processing TextRect objects
+// Traversals push into a bounded lock-free ring, a dedicated consumer thread speaks and highlights the entries in order
+class ProcessTextRectQueue {
+public:
+    // Enqueue a TextRect object for processing
+    // Blocks while the ring is full, so a large traversal cannot run arbitrarily far ahead of speech
+    static void Enqueue(TextRect textRect, CancellationToken cancelToken) {
+        if (cancelToken.IsCancelled()) { return; } // Exit if cancellation is requested
+        TraceSpan span(tracer, TraceStage::Enqueue);
+        textRectQueue.Push({ std::move(textRect), std::move(cancelToken), LatencyTracer::Current(), std::chrono::steady_clock::now() }); // Gives up if the queue is cleared meanwhile
+    }
+
+    // Start the consumer thread
+    static void Start() {
+        consumer = std::thread(&ProcessTextRectQueue::Run);
+    }
+
+    // Stop the consumer thread, cutting off the entry being spoken
+    static void Stop() {
+        textRectQueue.Close();
+        speechBackend.Purge(); // Release the consumer if it waits for an utterance
+        if (consumer.joinable()) consumer.join();
+    }
+
+    // Clear the TextRect queue
+    // Drops every queued entry in constant time; the consumer skips them when it reaches them
+    static void ClearQueue() {
+        textRectQueue.Clear();
+    }
+
+    // Close the document being read, so a consumer waiting for its next chunk returns without waiting on the read in flight
+    static void CloseDocument() {
+        std::shared_ptr<TextStream> stream;
+        {
+            std::lock_guard<std::mutex> lock(documentMutex);
+            stream = document;
+        }
+        if (stream) stream->Close();
+    }
+
+private:
+    struct QueuedText {
+        TextRect textRect; // Text and rectangle to process
+        CancellationToken cancelToken; // Cancellation state of the traversal that found the text
+        InteractionRef interaction; // Input event the text is spoken in response to
+        std::chrono::steady_clock::time_point enqueued; // When the text entered the queue
+    };
+
+    // Consumer loop, takes entries in batches so the ring is touched once per batch
+    // Runs of short uncached texts are merged into one utterance; anything else flushes the run and is spoken on its own
+    static void Run() {
+        CoInitialize(NULL); // Joined once for the life of the thread; cached clips are played through COM streams
+        std::vector<QueuedText> batch;
+        std::vector<QueuedText> merged; // Entries whose texts are in utterance, in order
+        UtteranceBatch utterance(batchPolicy);
+        std::wstring normalized;
+        while (textRectQueue.WaitDrain(batch, 16)) {
+            for (QueuedText& item : batch) {
+                if (item.cancelToken.IsCancelled()) continue; // Canceled after the batch was taken
+                tracer.Record(TraceStage::Queued, item.interaction, item.enqueued, std::chrono::steady_clock::now());
+                if (!item.textRect.stream) {
+                    TextNormalizer::Normalize(item.textRect.text, normalized);
+                    if (normalized.empty()) continue; // Nothing to say and nothing to highlight
+                    if (utterance.Accepts(normalized) && !audioCache.Contains(SpeechKey(normalized))) { // Cached audio starts faster alone
+                        if (!utterance.Add(normalized)) {
+                            SpeakMerged(utterance, merged);
+                            utterance.Add(normalized);
+                        }
+                        merged.push_back(std::move(item));
+                        continue;
+                    }
                 }
+                SpeakMerged(utterance, merged);
+                TraceScope scope(item.interaction);
+                Process(item.textRect, item.cancelToken);
+            }
+            SpeakMerged(utterance, merged); // Texts queued later are spoken after this run, not merged into it
+            batch.clear();
+        }
+        batch.clear(); // Entries may hold document readers, released while COM is still joined
+        CoUninitialize();
+    }
+
+    // Speak the merged run, moving the highlight from entry to entry as their words are reached
+    // A run of one is spoken like any other entry, so its audio can be cached
+    static void SpeakMerged(UtteranceBatch& utterance, std::vector<QueuedText>& merged) {
+        if (merged.size() == 1) {
+            TraceScope scope(merged.front().interaction);
+            Process(merged.front().textRect, merged.front().cancelToken);
+        }
+        else if (!merged.empty() && !merged.front().cancelToken.IsCancelled()) { // Entries of a run share their traversal
+            TraceScope scope(merged.front().interaction);
+            PrintText(utterance.Text());
+            std::vector<RECT> rects;
+            for (const QueuedText& item : merged) rects.push_back(item.textRect.rect);
+            speaking.store(true);
+            SpeakBatch(speechBackend, utterance, merged.front().cancelToken, [rects](size_t item) { ShowHighlight(rects[item]); },
+                FirstSampleCallbacks(std::chrono::steady_clock::now(), false));
+            speaking.store(false);
+            overlay.Hide(SPOKEN_HIGHLIGHT);
+        }
+        utterance.Clear();
+        merged.clear();
+    }
+
+    // Handles the drawing and speaking of the text and rectangle
+    static void Process(const TextRect& textRect, CancellationToken cancelToken) {
+        if (textRect.stream) {
+            ProcessDocument(textRect, cancelToken);
+            return;
+        }
+        ShowHighlight(textRect.rect); // Highlight the text while it is being spoken
+        SpeakTextTask(textRect.text, cancelToken); // Speak the text, returns when the utterance ends or is purged
+        overlay.Hide(SPOKEN_HIGHLIGHT); // Remove the highlight after speaking is done
+    }
+
+    // Speaks a document chunk by chunk while the next chunks are read ahead, highlighting each chunk on its own
+    static void ProcessDocument(const TextRect& textRect, CancellationToken cancelToken) {
+        {
+            std::lock_guard<std::mutex> lock(documentMutex);
+            document = textRect.stream; // A stop cancelling before this is seen by Next, one cancelling after closes it
+        }
+        TextChunk chunk;
+        while (textRect.stream->Next(chunk, cancelToken)) {
+            bool visible = chunk.rect.right > chunk.rect.left && chunk.rect.bottom > chunk.rect.top;
+            ShowHighlight(visible ? RECT{ chunk.rect.left, chunk.rect.top, chunk.rect.right, chunk.rect.bottom } : textRect.rect); // Chunks scrolled out of view highlight the element
+            SpeakTextTask(chunk.text, cancelToken); // Returns early when purged, the next Next then sees the cancellation
+        }
+        textRect.stream->Close(); // Stop reading ahead
+        {
+            std::lock_guard<std::mutex> lock(documentMutex);
+            document.reset();
+        }
+        overlay.Hide(SPOKEN_HIGHLIGHT);
+    }
+
+    static WorkQueue<QueuedText> textRectQueue; // Ring of entries waiting to be processed
+    static std::thread consumer; // Dedicated consumer thread
+    static std::mutex documentMutex; // Guards document
+    static std::shared_ptr<TextStream> document; // Document the consumer is reading, closed by a stop
+};
+
+WorkQueue<ProcessTextRectQueue::QueuedText> ProcessTextRectQueue::textRectQueue(1024); // Initialize the static ring
+std::thread ProcessTextRectQueue::consumer; // Initialize the static consumer thread
+std::mutex ProcessTextRectQueue::documentMutex;
+std::shared_ptr<TextStream> ProcessTextRectQueue::document;
+
+// Wrap a UI Automation element in a provider handle
+// The handle owns one reference to the element and releases it when the last copy goes away
+ElementHandle WrapElement(CComPtr<IUIAutomationElement> pElement) {
+    if (!pElement) return ElementHandle();
+    return ElementHandle(pElement.Detach(), [](void* p) { static_cast<IUIAutomationElement*>(p)->Release(); });
+}
+
+// Retrieve the UI Automation element stored in a provider handle
+IUIAutomationElement* UnwrapElement(const ElementHandle& handle) {
+    return static_cast<IUIAutomationElement*>(handle.get());
+}
+
+// Convert a provider rectangle to a Win32 RECT
+RECT ToRect(const ElementRect& rect) {
+    return { rect.left, rect.top, rect.right, rect.bottom };
+}
+
+// Copy a runtime id out of the SAFEARRAY returned by UI Automation
+RuntimeId ToRuntimeId(SAFEARRAY* pArray) {
+    RuntimeId runtimeId;
+    LONG lower = 0, upper = -1;
+    if (!pArray || FAILED(SafeArrayGetLBound(pArray, 1, &lower)) || FAILED(SafeArrayGetUBound(pArray, 1, &upper))) return runtimeId;
+    int* pData = NULL;
+    if (upper < lower || FAILED(SafeArrayAccessData(pArray, reinterpret_cast<void**>(&pData)))) return runtimeId;
+    runtimeId.assign(pData, pData + (upper - lower + 1));
+    SafeArrayUnaccessData(pArray);
+    return runtimeId;
+}
+
+// Union of the line rectangles returned by IUIAutomationTextRange::GetBoundingRectangles
+// The array holds left, top, width and height for every visible line
+ElementRect ToChunkRect(SAFEARRAY* pArray) {
+    ElementRect bounds;
+    LONG lower = 0, upper = -1;
+    if (!pArray || FAILED(SafeArrayGetLBound(pArray, 1, &lower)) || FAILED(SafeArrayGetUBound(pArray, 1, &upper))) return bounds;
+    double* pData = NULL;
+    if (upper < lower || FAILED(SafeArrayAccessData(pArray, reinterpret_cast<void**>(&pData)))) return bounds;
+    bool first = true;
+    for (LONG i = 0; i + 3 <= upper - lower; i += 4) {
+        ElementRect line = { static_cast<long>(pData[i]), static_cast<long>(pData[i + 1]),
+            static_cast<long>(pData[i] + pData[i + 2]), static_cast<long>(pData[i + 1] + pData[i + 3]) };
+        if (line.right <= line.left || line.bottom <= line.top) continue;
+        if (first) bounds = line;
+        bounds.left = (std::min)(bounds.left, line.left);
+        bounds.top = (std::min)(bounds.top, line.top);
+        bounds.right = (std::max)(bounds.right, line.right);
+        bounds.bottom = (std::max)(bounds.bottom, line.bottom);
+        first = false;
+    }
+    SafeArrayUnaccessData(pArray);
+    return bounds;
+}
+
+// Text source walking a UI Automation document range one unit at a time
+// Each chunk costs a few round trips regardless of the document size, and only the chunk itself is copied out
+class UiaTextRangeSource : public TextRangeSource {
+public:
+    UiaTextRangeSource(CComPtr<IUIAutomationTextRange> cursor, ChunkUnit unit, size_t maxChunkChars)
+        : cursor(cursor), unit(unit == ChunkUnit::Line ? TextUnit_Line : TextUnit_Paragraph), maxChunkChars(static_cast<int>(maxChunkChars)) {
+    }
+
+    bool Next(TextChunk& chunk) override {
+        if (!cursor) return false;
+
+        CComPtr<IUIAutomationTextRange> pChunk = NULL;
+        int moved = 0;
+        HRESULT hr = cursor->Clone(&pChunk); // Degenerate range at the read position
+        if (SUCCEEDED(hr)) hr = pChunk->MoveEndpointByUnit(TextPatternRangeEndpoint_End, unit, 1, &moved); // Extend to the next unit boundary
+        if (FAILED(hr) || moved == 0) {
+            cursor.Release(); // End of the document or the document went away
+            return false;
+        }
+
+        CComBSTR text;
+        hr = pChunk->GetText(maxChunkChars + 1, &text);
+        if (FAILED(hr) || text == NULL) {
+            cursor.Release();
+            return false;
+        }
+        if (static_cast<int>(text.Length()) > maxChunkChars) {
+            // An oversized unit is read in pieces, so the rest of it is the next chunk
+            pChunk->MoveEndpointByRange(TextPatternRangeEndpoint_End, pChunk, TextPatternRangeEndpoint_Start);
+            pChunk->MoveEndpointByUnit(TextPatternRangeEndpoint_End, TextUnit_Character, maxChunkChars, &moved);
+            text.Empty();
+            if (FAILED(pChunk->GetText(maxChunkChars, &text)) || text == NULL) {
+                cursor.Release();
+                return false;
             }
-            else {
-                InvalidateRect(NULL, &scaledRect, TRUE); // Clear the rectangle
-                rectangleDrawn.store(false); // Mark the rectangle as not drawn
+        }
+        chunk.text.assign(static_cast<wchar_t*>(text), text.Length());
+
+        SAFEARRAY* pRects = NULL;
+        chunk.rect = SUCCEEDED(pChunk->GetBoundingRectangles(&pRects)) ? ToChunkRect(pRects) : ElementRect();
+        if (pRects) SafeArrayDestroy(pRects);
+
+        cursor->MoveEndpointByRange(TextPatternRangeEndpoint_Start, pChunk, TextPatternRangeEndpoint_End); // Continue after the chunk
+        return true;
+    }
+
+private:
+    CComPtr<IUIAutomationTextRange> cursor; // Degenerate range at the read position, released at the end
+    TextUnit unit; // UI Automation unit chunks end at
+    int maxChunkChars; // Longest chunk returned
+};
+
+// Element provider backed by UI Automation
+// Batched fetches use a subtree cache request so per-node work reads cached properties locally
+class UiaElementProvider : public ElementProvider {
+public:
+    bool FetchElement(const ElementHandle& element, ElementSnapshot& snapshot) override {
+        IUIAutomationElement* pElement = UnwrapElement(element);
+        if (!pElement) return false;
+
+        CComBSTR name;
+        RECT rect = {};
+        CONTROLTYPEID controlType = 0;
+        VARIANT textPattern;
+        VariantInit(&textPattern);
+        CountRoundTrips(4);
+        if (FAILED(pElement->get_CurrentName(&name)) || FAILED(pElement->get_CurrentBoundingRectangle(&rect))) return false;
+        pElement->get_CurrentControlType(&controlType); // Optional, left at zero on failure
+        HRESULT hr = pElement->GetCurrentPropertyValue(UIA_IsTextPatternAvailablePropertyId, &textPattern);
+
+        snapshot.handle = element;
+        GetRuntimeId(element, snapshot.runtimeId); // Optional, left empty on failure
+        snapshot.name = name != NULL ? std::wstring(static_cast<wchar_t*>(name)) : std::wstring();
+        snapshot.rect = { rect.left, rect.top, rect.right, rect.bottom };
+        snapshot.controlType = controlType;
+        snapshot.hasTextPattern = SUCCEEDED(hr) && textPattern.vt == VT_BOOL && textPattern.boolVal == VARIANT_TRUE;
+        VariantClear(&textPattern);
+        return true;
+    }
+
+    bool FetchChildren(const ElementHandle& element, std::vector<ElementHandle>& children) override {
+        IUIAutomationElement* pElement = UnwrapElement(element);
+        if (!pElement) return false;
+
+        CComPtr<IUIAutomationTreeWalker> pQueryWalker = QueryWalker(); // Offscreen children are skipped in the target process
+        if (!pQueryWalker) return false;
+
+        CComPtr<IUIAutomationElement> pChild;
+        CountRoundTrips();
+        HRESULT hr = pQueryWalker->GetFirstChildElement(pElement, &pChild); // Get the first child element
+        if (FAILED(hr)) {
+            DebugLog(L"Failed to get first child element: " + std::to_wstring(hr)); // Log failure to get child element
+            return false;
+        }
+
+        while (SUCCEEDED(hr) && pChild) { // Check if there are children
+            CComPtr<IUIAutomationElement> pNextSibling;
+            CountRoundTrips();
+            hr = pQueryWalker->GetNextSiblingElement(pChild, &pNextSibling); // Get the next sibling element
+            children.push_back(WrapElement(pChild)); // Hand the child over to the caller
+            if (FAILED(hr)) {
+                DebugLog(L"Failed to get next sibling element: " + std::to_wstring(hr)); // Log failure to get sibling element
+                break;
             }
-            ReleaseDC(NULL, hdc); // Release the device context
+            pChild = pNextSibling; // Move to the next sibling
         }
-        else {
-            DebugLog(L"Failed to get device context."); // Log failure if device context is not available
+        return true;
+    }
+
+    bool FetchSubtree(const ElementHandle& root, int maxDepth, std::vector<ElementSnapshot>& snapshots) override {
+        IUIAutomationElement* pRoot = UnwrapElement(root);
+        std::shared_ptr<IUIAutomation> pAutomation = automation.Acquire(); // Kept for the whole fetch even if a new instance is published
+        if (!pRoot || !pAutomation) return false;
+
+        // Only as deep as asked, so a request for the root alone costs one element rather than the whole subtree
+        TreeScope scope = maxDepth <= 1 ? TreeScope_Element : maxDepth == 2 ? static_cast<TreeScope>(TreeScope_Element | TreeScope_Children) : TreeScope_Subtree;
+        CComPtr<IUIAutomationCacheRequest> pCacheRequest = CreateSnapshotCacheRequest(pAutomation.get(), scope);
+        if (!pCacheRequest) return false;
+
+        CComPtr<IUIAutomationElement> pCachedRoot;
+        CountRoundTrips();
+        HRESULT hr = pRoot->BuildUpdatedCache(pCacheRequest, &pCachedRoot); // One cross-process request for the whole subtree
+        if (FAILED(hr) || !pCachedRoot) {
+            DebugLog(L"Failed to build subtree cache: " + std::to_wstring(hr));
+            return false;
+        }
+
+        struct CachedElement {
+            CComPtr<IUIAutomationElement> element; // Element carrying cached properties
+            int depth{ 0 }; // Depth below the root
+            int parent{ -1 }; // Index of the parent snapshot
+        };
+        std::queue<CachedElement> pending;
+        pending.push({ pCachedRoot, 0, -1 });
+
+        while (!pending.empty()) {
+            CachedElement current = std::move(pending.front());
+            pending.pop();
+
+            ElementSnapshot snapshot;
+            ReadCachedSnapshot(current.element, snapshot);
+            snapshot.depth = current.depth;
+            snapshot.parent = current.parent;
+
+            CComPtr<IUIAutomationElementArray> pChildren;
+            if (current.depth + 1 < maxDepth) {
+                current.element->GetCachedChildren(&pChildren); // Local read of the cached structure
+            }
+            snapshots.push_back(std::move(snapshot));
+
+            int self = static_cast<int>(snapshots.size()) - 1;
+            int length = 0;
+            if (pChildren && SUCCEEDED(pChildren->get_Length(&length))) {
+                for (int i = 0; i < length; ++i) {
+                    CComPtr<IUIAutomationElement> pChild;
+                    if (SUCCEEDED(pChildren->GetElement(i, &pChild)) && pChild) {
+                        pending.push({ pChild, current.depth + 1, self });
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    bool GetDocumentText(const ElementSnapshot& element, std::wstring& text) override {
+        CComPtr<IUIAutomationTextRange> pTextRange = GetDocumentRange(element);
+        if (!pTextRange) return false;
+
+        CComBSTR documentText;
+        CountRoundTrips();
+        HRESULT hr = pTextRange->GetText(-1, &documentText); // Get the text within the text range
+        if (FAILED(hr) || documentText == NULL) return false;
+        text.assign(static_cast<wchar_t*>(documentText)); // Convert the BSTR text to std::wstring
+        return true;
+    }
+
+    std::unique_ptr<TextRangeSource> OpenDocument(const ElementSnapshot& element, ChunkUnit unit, size_t maxChunkChars) override {
+        CComPtr<IUIAutomationTextRange> pTextRange = GetDocumentRange(element);
+        if (!pTextRange) return nullptr;
+        CountRoundTrips();
+        HRESULT hr = pTextRange->MoveEndpointByRange(TextPatternRangeEndpoint_End, pTextRange, TextPatternRangeEndpoint_Start); // Collapse to the start
+        if (FAILED(hr)) return nullptr;
+        return std::make_unique<UiaTextRangeSource>(pTextRange, unit, maxChunkChars);
+    }
+
+    bool GetRuntimeId(const ElementHandle& element, RuntimeId& runtimeId) override {
+        IUIAutomationElement* pElement = UnwrapElement(element);
+        if (!pElement) return false;
+
+        SAFEARRAY* pArray = NULL;
+        CountRoundTrips();
+        HRESULT hr = pElement->GetRuntimeId(&pArray);
+        if (FAILED(hr) || !pArray) return false;
+        runtimeId = ToRuntimeId(pArray);
+        SafeArrayDestroy(pArray);
+        return !runtimeId.empty();
+    }
+
+    bool FetchNeighbors(const ElementHandle& element, ElementNeighbors& neighbors) override {
+        IUIAutomationElement* pElement = UnwrapElement(element);
+        if (!pElement) return false;
+        CComPtr<IUIAutomationTreeWalker> pControlWalker = ControlWalker();
+        if (!pControlWalker) return false;
+
+        CComPtr<IUIAutomationElement> pParent, pFirstChild, pNextSibling, pPreviousSibling;
+        CountRoundTrips(4);
+        HRESULT hr = pControlWalker->GetParentElement(pElement, &pParent);
+        if (FAILED(hr)) {
+            DebugLog(L"Failed to get parent element: " + std::to_wstring(hr));
+            return false;
+        }
+        pControlWalker->GetFirstChildElement(pElement, &pFirstChild); // Directions that fail are treated as having no element
+        pControlWalker->GetNextSiblingElement(pElement, &pNextSibling);
+        pControlWalker->GetPreviousSiblingElement(pElement, &pPreviousSibling);
+
+        neighbors.parent = WrapElement(pParent);
+        neighbors.firstChild = WrapElement(pFirstChild);
+        neighbors.nextSibling = WrapElement(pNextSibling);
+        neighbors.previousSibling = WrapElement(pPreviousSibling);
+        return true;
+    }
+
+private:
+    // Control view walker of the current automation instance, used for navigation
+    CComPtr<IUIAutomationTreeWalker> ControlWalker() {
+        std::lock_guard<std::mutex> lock(walkerMtx);
+        return RefreshWalkersLocked() ? pControlWalker : NULL;
+    }
+
+    // Control view walker narrowed by the query filter, used for traversals
+    CComPtr<IUIAutomationTreeWalker> QueryWalker() {
+        std::lock_guard<std::mutex> lock(walkerMtx);
+        return RefreshWalkersLocked() ? pQueryWalker : NULL;
+    }
+
+    // Create the walkers once per instance instead of once per call, and again after the instance is recreated
+    bool RefreshWalkersLocked() {
+        std::shared_ptr<IUIAutomation> pAutomation = automation.Acquire();
+        if (pControlWalker && pQueryWalker && pWalkerAutomation == pAutomation) return true;
+        pControlWalker.Release();
+        pQueryWalker.Release();
+        pWalkerAutomation = std::move(pAutomation);
+        if (!pWalkerAutomation) return false;
+        HRESULT hr = pWalkerAutomation->get_ControlViewWalker(&pControlWalker); // Get the tree walker for UI Automation
+        if (FAILED(hr)) {
+            DebugLog(L"Failed to get ControlViewWalker: " + std::to_wstring(hr)); // Log failure to get tree walker
+            return false;
+        }
+        CComPtr<IUIAutomationCondition> pCondition = QueryCondition(pWalkerAutomation.get());
+        hr = pCondition ? pWalkerAutomation->CreateTreeWalker(pCondition, &pQueryWalker) : E_FAIL;
+        if (FAILED(hr)) {
+            DebugLog(L"Failed to create query walker: " + std::to_wstring(hr));
+            pControlWalker.Release();
+            return false;
+        }
+        return true;
+    }
+
+    // Control view condition, narrowed to elements on screen when the query filter skips offscreen ones
+    // UI Automation evaluates it in the target process; the other checks of the filter would promote the children
+    // of a rejected element into its place, so they are applied to the fetched snapshots instead
+    CComPtr<IUIAutomationCondition> QueryCondition(IUIAutomation* pUia) {
+        CComPtr<IUIAutomationCondition> pControlView;
+        if (FAILED(pUia->get_ControlViewCondition(&pControlView))) return NULL;
+        if (!QueryFilter().skipOffscreen) return pControlView;
+
+        VARIANT onscreen;
+        VariantInit(&onscreen);
+        onscreen.vt = VT_BOOL;
+        onscreen.boolVal = VARIANT_FALSE;
+        CComPtr<IUIAutomationCondition> pOnscreen, pCondition;
+        if (FAILED(pUia->CreatePropertyCondition(UIA_IsOffscreenPropertyId, onscreen, &pOnscreen)) ||
+            FAILED(pUia->CreateAndCondition(pControlView, pOnscreen, &pCondition))) {
+            return pControlView; // Offscreen elements are then read like any other
+        }
+        return pCondition;
+    }
+
+    // Cache request for the properties a snapshot holds, over the view the query condition defines
+    CComPtr<IUIAutomationCacheRequest> CreateSnapshotCacheRequest(IUIAutomation* pUia, TreeScope scope) {
+        CComPtr<IUIAutomationCacheRequest> pCacheRequest;
+        HRESULT hr = pUia->CreateCacheRequest(&pCacheRequest); // Cache requests are built in-process
+        if (FAILED(hr)) {
+            DebugLog(L"Failed to create cache request: " + std::to_wstring(hr));
+            return NULL;
+        }
+        CComPtr<IUIAutomationCondition> pTreeFilter = QueryCondition(pUia); // Match the view walked in live mode
+        if (!pTreeFilter) return NULL;
+
+        pCacheRequest->AddProperty(UIA_NamePropertyId);
+        pCacheRequest->AddProperty(UIA_BoundingRectanglePropertyId);
+        pCacheRequest->AddProperty(UIA_ControlTypePropertyId);
+        pCacheRequest->AddProperty(UIA_IsTextPatternAvailablePropertyId);
+        pCacheRequest->AddProperty(UIA_RuntimeIdPropertyId); // Keys the element in the tree mirror
+        pCacheRequest->AddProperty(UIA_IsOffscreenPropertyId);
+        pCacheRequest->AddPattern(UIA_TextPatternId); // Lets GetCachedPatternAs skip a round trip when reading text
+        pCacheRequest->put_TreeFilter(pTreeFilter);
+        pCacheRequest->put_TreeScope(scope);
+        return pCacheRequest;
+    }
+
+    // Fill a snapshot from the cached properties of an element, without a cross-process call
+    void ReadCachedSnapshot(IUIAutomationElement* pElement, ElementSnapshot& snapshot) {
+        CComBSTR name;
+        RECT rect = {};
+        CONTROLTYPEID controlType = 0;
+        BOOL offscreen = FALSE;
+        VARIANT textPattern, runtimeId;
+        VariantInit(&textPattern);
+        VariantInit(&runtimeId);
+        pElement->get_CachedName(&name);
+        pElement->get_CachedBoundingRectangle(&rect);
+        pElement->get_CachedControlType(&controlType);
+        pElement->get_CachedIsOffscreen(&offscreen);
+        HRESULT hr = pElement->GetCachedPropertyValue(UIA_IsTextPatternAvailablePropertyId, &textPattern);
+        snapshot.name = name != NULL ? std::wstring(static_cast<wchar_t*>(name)) : std::wstring();
+        snapshot.rect = { rect.left, rect.top, rect.right, rect.bottom };
+        snapshot.controlType = controlType;
+        snapshot.offscreen = offscreen != FALSE; // Only the root can be offscreen when the query filter skips them
+        snapshot.hasTextPattern = SUCCEEDED(hr) && textPattern.vt == VT_BOOL && textPattern.boolVal == VARIANT_TRUE;
+        if (SUCCEEDED(pElement->GetCachedPropertyValue(UIA_RuntimeIdPropertyId, &runtimeId)) && runtimeId.vt == (VT_I4 | VT_ARRAY)) {
+            snapshot.runtimeId = ToRuntimeId(runtimeId.parray);
         }
+        snapshot.handle = WrapElement(pElement);
+        VariantClear(&textPattern);
+        VariantClear(&runtimeId);
     }
-    catch (const std::exception& e) {
-        DebugLog(L"Exception in ProcessRectangle: " + Utf8ToWstring(e.what())); // Log any exceptions that occur
+
+    // Document range of an element exposing the text pattern
+    CComPtr<IUIAutomationTextRange> GetDocumentRange(const ElementSnapshot& element) {
+        IUIAutomationElement* pElement = UnwrapElement(element.handle);
+        if (!pElement) return NULL;
+
+        CComPtr<IUIAutomationTextPattern> pTextPattern = NULL;
+        HRESULT hr = pElement->GetCachedPatternAs(UIA_TextPatternId, IID_PPV_ARGS(&pTextPattern)); // Served from the subtree cache when available
+        if (FAILED(hr) || !pTextPattern) {
+            pTextPattern.Release();
+            CountRoundTrips();
+            hr = pElement->GetCurrentPatternAs(UIA_TextPatternId, IID_PPV_ARGS(&pTextPattern)); // Get the text pattern from the element
+            if (FAILED(hr) || !pTextPattern) return NULL;
+        }
+
+        CComPtr<IUIAutomationTextRange> pTextRange = NULL;
+        CountRoundTrips();
+        hr = pTextPattern->get_DocumentRange(&pTextRange); // Get the text range from the text pattern
+        if (FAILED(hr) || !pTextRange) return NULL;
+        return pTextRange;
     }
-}
 
+    std::mutex walkerMtx; // Guards the cached walkers
+    std::shared_ptr<IUIAutomation> pWalkerAutomation; // Automation instance the walkers belong to, kept alive with them
+    CComPtr<IUIAutomationTreeWalker> pControlWalker; // Control view walker shared by all calls
+    CComPtr<IUIAutomationTreeWalker> pQueryWalker; // Walker that honors the query filter, shared by all traversals
+};
 
-// Function to print text to the console and log it
-// Outputs text to the console and also logs it for debugging
-void PrintText(const std::wstring& text) {
-    std::wcout << text << std::endl; // Output the text to the console
-    std::wcout.flush(); // Flush the console output
+UiaElementProvider elementProvider; // Provider used for all tree traversals
+TreeMirror treeMirror; // Elements fetched by earlier batched traversals, kept current by change notifications
+
+std::mutex elementIndexMtx; // Mutex for thread-safe access to the element index
+SpatialIndex elementIndex; // Rectangles of the elements visited by the last traversal
+std::vector<ElementHandle> indexedElements; // Elements referenced by the ids in elementIndex
+HWND indexedWindow = NULL; // Top-level window the indexed elements belong to
+CComPtr<IUIAutomationElement> pIndexedRoot = NULL; // Element whose traversal fills the index
+uint64_t indexGeneration = 0; // Bumped whenever the index is reset, so late inserts from older traversals are ignored
+
+// Top-level window under a screen point
+// Cheap local call used to detect when indexed elements may be covered by another window
+HWND RootWindowFromPoint(POINT point) {
+    HWND hWnd = WindowFromPoint(point);
+    return hWnd ? GetAncestor(hWnd, GA_ROOT) : NULL;
 }
 
-// Task to speak text and manage rectangle
-// Asynchronously processes text for speech and manages the associated rectangle
-void SpeakTextTask(const std::wstring& textToSpeak, std::shared_future<void> cancelFuture) {
-    // Check if the task should be canceled before starting
-    if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) { return; } // Exit if cancellation is requested
+// Drop all indexed elements so the next lookups fall back to ElementFromPoint
+void InvalidateElementIndex() {
+    std::lock_guard<std::mutex> lock(elementIndexMtx);
+    elementIndex.Clear();
+    indexedElements.clear();
+    indexedWindow = NULL;
+    pIndexedRoot.Release();
+    ++indexGeneration;
+}
 
-    try {
-        // If the text is empty or cancellation is requested, exit early
-        if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) { return; } // Exit if cancellation is requested
+// Drop indexed elements overlapping an area reported by a change notification
+// An empty area means the change could not be located, so the whole index goes
+void InvalidateIndexedArea(const ElementRect& area) {
+    if (area.right <= area.left || area.bottom <= area.top) {
+        InvalidateElementIndex();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(elementIndexMtx);
+    elementIndex.RemoveIntersecting(area);
+}
 
-        PrintText(textToSpeak); // Output the text to the console and log it
+// Start a new index filled by the traversal of the element hit-tested at the given point
+// Returns the top-level window the index now belongs to
+HWND ResetElementIndex(POINT point, CComPtr<IUIAutomationElement> pRoot) {
+    HWND hRoot = RootWindowFromPoint(point);
+    std::lock_guard<std::mutex> lock(elementIndexMtx);
+    elementIndex.Clear();
+    indexedElements.clear();
+    indexedWindow = hRoot;
+    pIndexedRoot = pRoot;
+    ++indexGeneration;
+    return hRoot;
+}
 
-        speaking.store(true); // Set the speaking flag to true, indicating speech is in progress
+// Index generation a traversal starting at the given element should fill, 0 if it should not index
+// Traversals of locally resolved or navigated elements leave the current index untouched
+uint64_t IndexGenerationFor(IUIAutomationElement* pElement) {
+    std::lock_guard<std::mutex> lock(elementIndexMtx);
+    return pElement && pElement == pIndexedRoot.p ? indexGeneration : 0;
+}
 
-        {
-            // Lock the speech synthesis resource to ensure thread-safe access
-            std::lock_guard<std::mutex> lock(pVoiceMtx);
-            if (pVoice) { // Check if the speech synthesis object is valid
-                // Check for cancellation again before starting speech
-                if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) { return; } // Exit if cancellation is requested
+// Add a visited element to the index
+void IndexElement(uint64_t generation, const ElementSnapshot& element) {
+    std::lock_guard<std::mutex> lock(elementIndexMtx);
+    if (generation != indexGeneration || !indexedWindow) return; // Index was reset or invalidated while the traversal was running
+    elementIndex.Insert(static_cast<uint32_t>(indexedElements.size()), element.rect);
+    indexedElements.push_back(element.handle);
+}
 
-                // Purge any previous speech to start fresh
-                HRESULT hr = pVoice->Speak(nullptr, SPF_PURGEBEFORESPEAK, nullptr);
-                if (FAILED(hr)) {
-                    DebugLog(L"Failed to purge speech: " + std::to_wstring(hr)); // Log failure to purge
-                    speaking.store(false); // Reset the speaking flag if purging failed
-                    return;
-                }
+// Resolve the element under a point from the index
+// Returns NULL on a miss or when the point lies over a different top-level window
+CComPtr<IUIAutomationElement> LookupIndexedElement(POINT point) {
+    HWND hRoot = RootWindowFromPoint(point);
+    std::lock_guard<std::mutex> lock(elementIndexMtx);
+    if (!indexedWindow || hRoot != indexedWindow) return NULL;
+    std::optional<uint32_t> id = elementIndex.Query(point.x, point.y);
+    if (!id) return NULL;
+    return CComPtr<IUIAutomationElement>(UnwrapElement(indexedElements[*id]));
+}
 
-                // Start speaking the text asynchronously
-                hr = pVoice->Speak(textToSpeak.c_str(), SPF_ASYNC, nullptr);
-                if (FAILED(hr)) {
-                    DebugLog(L"Failed to speak text: " + textToSpeak + L" Error: " + std::to_wstring(hr)); // Log failure to speak
-                    speaking.store(false); // Reset the speaking flag if speaking failed
-                    return;
-                }
-            }
+// Tree event source backed by UI Automation event handlers
+// Focus changes are watched desktop-wide, structure and property changes only below the hovered window
+class UiaTreeEventSource : public TreeEventSource,
+    public IUIAutomationStructureChangedEventHandler,
+    public IUIAutomationFocusChangedEventHandler,
+    public IUIAutomationPropertyChangedEventHandler {
+public:
+    bool Start(Sink newSink) override {
+        {
+            std::lock_guard<std::mutex> lock(sinkMtx);
+            sink = std::move(newSink);
         }
+        std::shared_ptr<IUIAutomation> pAutomation = automation.Acquire();
+        if (!pAutomation) return false;
+        {
+            std::lock_guard<std::mutex> lock(watchMtx);
+            pEventAutomation = pAutomation; // Handlers are removed from the instance they were added to
+        }
+        HRESULT hr = pAutomation->AddFocusChangedEventHandler(CreateEventCacheRequest(pAutomation.get()), this);
+        if (FAILED(hr)) {
+            DebugLog(L"Failed to add focus changed handler: " + std::to_wstring(hr));
+            return false;
+        }
+        return true;
+    }
 
-        SPVOICESTATUS status; // Structure to hold the status of the speech synthesis
-        while (true) {
-            // Check for cancellation every 10 milliseconds
-            if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) { return; } // Exit if cancellation is requested
-
-            // Lock the speech synthesis resource to check its status
-            std::lock_guard<std::mutex> lock(pVoiceMtx);
-            if (pVoice) { // Check if the speech synthesis object is valid
-                HRESULT hr = pVoice->GetStatus(&status, nullptr); // Get the current status of the speech synthesis
-                if (FAILED(hr)) {
-                    DebugLog(L"Failed to get status: " + std::to_wstring(hr)); // Log failure to get status
-                    break; // Exit the loop if getting the status failed
-                }
+    bool Watch(const ElementHandle& root) override {
+        std::lock_guard<std::mutex> lock(watchMtx);
+        RemoveWatch();
+        IUIAutomationElement* pRoot = UnwrapElement(root);
+        if (!pRoot || !pEventAutomation) return false;
 
-                // Check if the speech synthesis has completed
-                if (status.dwRunningState == SPRS_DONE) {
-                    break; // Exit the loop if the speech is done
-                }
-            }
+        CComPtr<IUIAutomationCacheRequest> pCacheRequest = CreateEventCacheRequest(pEventAutomation.get());
+        HRESULT hr = pEventAutomation->AddStructureChangedEventHandler(pRoot, TreeScope_Subtree, pCacheRequest, this);
+        if (FAILED(hr)) {
+            DebugLog(L"Failed to add structure changed handler: " + std::to_wstring(hr));
+            return false;
         }
-
-        speaking.store(false); // Reset the speaking flag to indicate speech is complete
-    }
-    catch (const std::exception& e) {
-        // Log any exceptions that occur during the task
-        DebugLog(L"Exception in SpeakTextTask: " + Utf8ToWstring(e.what()));
+        PROPERTYID properties[] = { UIA_BoundingRectanglePropertyId, UIA_IsOffscreenPropertyId, UIA_NamePropertyId }; // Properties the element index and tree mirror depend on
+        hr = pEventAutomation->AddPropertyChangedEventHandlerNativeArray(pRoot, TreeScope_Subtree, pCacheRequest, this, properties, ARRAYSIZE(properties));
+        if (FAILED(hr)) {
+            DebugLog(L"Failed to add property changed handler: " + std::to_wstring(hr));
+        }
+        pWatched = pRoot;
+        return true;
     }
-}
 
-
-// Class to manage the queue for processing TextRect objects
-// Handles the queuing and processing of text and associated rectangles asynchronously
-class ProcessTextRectQueue {
-public:
-    // Enqueue a TextRect object for processing
-    // This function adds a TextRect to the queue and triggers processing if not already speaking
-    static void Enqueue(TextRect textRect, std::shared_future<void> cancelFuture) {
-        if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) { return; } // Exit if cancellation is requested
+    // Watch the subtree of a top-level window unless it is already being watched
+    void WatchWindow(HWND hWnd) {
+        if (!hWnd) return;
+        std::shared_ptr<IUIAutomation> pAutomation;
         {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            textRectQueue.push(textRect); // Add the TextRect to the queue
+            std::lock_guard<std::mutex> lock(watchMtx);
+            if (!pEventAutomation || hWnd == watchedWindow) return;
+            watchedWindow = hWnd;
+            pAutomation = pEventAutomation;
         }
-        if (!speaking.load()) {
-            pool.detach_task(std::bind(&ProcessTextRectQueue::DequeueAndProcess, cancelFuture)); // Start processing if not already speaking
+        CComPtr<IUIAutomationElement> pWindow;
+        if (SUCCEEDED(pAutomation->ElementFromHandle(hWnd, &pWindow)) && pWindow) {
+            Watch(WrapElement(pWindow));
         }
     }
 
-    // Dequeue and process the next TextRect in the queue
-// Handles the drawing and speaking of the text and rectangle
-    static void DequeueAndProcess(std::shared_future<void> cancelFuture) {
-        if (textRectQueue.empty() || cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-            speaking.store(false); // Reset the speaking flag if queue is empty or canceled
-            return;
+    void Stop() override {
+        std::shared_ptr<IUIAutomation> pAutomation;
+        {
+            std::lock_guard<std::mutex> lock(watchMtx);
+            RemoveWatch();
+            watchedWindow = NULL;
+            pAutomation = std::move(pEventAutomation);
+        }
+        if (pAutomation) {
+            pAutomation->RemoveFocusChangedEventHandler(this);
         }
+        std::lock_guard<std::mutex> lock(sinkMtx);
+        sink = nullptr;
+    }
 
-        speaking.store(true); // Set the speaking flag to true
-        TextRect textRect;
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            textRect = textRectQueue.front(); // Get the next TextRect from the queue
-            textRectQueue.pop(); // Remove it from the queue
+    // IUnknown, the source lives for the whole program so the count never frees it
+    IFACEMETHODIMP QueryInterface(REFIID riid, void** ppv) override {
+        if (!ppv) return E_POINTER;
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IUIAutomationStructureChangedEventHandler)) {
+            *ppv = static_cast<IUIAutomationStructureChangedEventHandler*>(this);
+        }
+        else if (riid == __uuidof(IUIAutomationFocusChangedEventHandler)) {
+            *ppv = static_cast<IUIAutomationFocusChangedEventHandler*>(this);
+        }
+        else if (riid == __uuidof(IUIAutomationPropertyChangedEventHandler)) {
+            *ppv = static_cast<IUIAutomationPropertyChangedEventHandler*>(this);
+        }
+        else {
+            *ppv = NULL;
+            return E_NOINTERFACE;
         }
+        AddRef();
+        return S_OK;
+    }
+    IFACEMETHODIMP_(ULONG) AddRef() override { return ++refCount; }
+    IFACEMETHODIMP_(ULONG) Release() override { return --refCount; }
 
-        // Process the rectangle drawing first
-        auto rectFuture = pool.submit_task([&]() {ProcessRectangle(textRect.rect, true, cancelFuture); });
-        // Handle the text and rectangle in a non-blocking way
-        auto future = pool.submit_task([&]() {
-            SpeakTextTask(textRect.text, cancelFuture); // Speak the text
-            });
+    // Event callbacks arrive on UI Automation threads and only touch local state
+    IFACEMETHODIMP HandleStructureChangedEvent(IUIAutomationElement* sender, StructureChangeType, SAFEARRAY*) override {
+        Deliver(TreeChangeKind::StructureChanged, sender, 0);
+        return S_OK;
+    }
+    IFACEMETHODIMP HandleFocusChangedEvent(IUIAutomationElement* sender) override {
+        Deliver(TreeChangeKind::FocusChanged, sender, 0);
+        return S_OK;
+    }
+    IFACEMETHODIMP HandlePropertyChangedEvent(IUIAutomationElement* sender, PROPERTYID propertyId, VARIANT) override {
+        Deliver(TreeChangeKind::PropertyChanged, sender, propertyId);
+        return S_OK;
+    }
 
-        future.get(); // Wait for the speaking task to complete
-        rectFuture.get();
-        // Clear the rectangle after speaking is done
-        ProcessRectangle(textRect.rect, false, cancelFuture); // Clear the rectangle
+private:
+    // Cache the properties handlers need with each event so they never call back into the target process
+    CComPtr<IUIAutomationCacheRequest> CreateEventCacheRequest(IUIAutomation* pUia) {
+        CComPtr<IUIAutomationCacheRequest> pCacheRequest;
+        if (pUia && SUCCEEDED(pUia->CreateCacheRequest(&pCacheRequest))) {
+            pCacheRequest->AddProperty(UIA_BoundingRectanglePropertyId);
+            pCacheRequest->AddProperty(UIA_RuntimeIdPropertyId);
+            pCacheRequest->AddProperty(UIA_NamePropertyId);
+        }
+        return pCacheRequest;
+    }
 
-        // Reset the speaking flag after task completion
-        pool.detach_task(std::bind(&ProcessTextRectQueue::DequeueAndProcess, cancelFuture)); // Trigger the next item in the queue
+    // Caller holds watchMtx
+    void RemoveWatch() {
+        if (pWatched && pEventAutomation) {
+            pEventAutomation->RemoveStructureChangedEventHandler(pWatched, this);
+            pEventAutomation->RemovePropertyChangedEventHandler(pWatched, this);
+        }
+        pWatched.Release();
     }
 
-    // Clear the TextRect queue
-    // Empties the queue and ensures the speaking flag is reset
-    static void ClearQueue() {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        std::queue<TextRect> empty;
-        std::swap(textRectQueue, empty); // Swap with an empty queue to clear it
-        speaking.store(false);  // Ensure that speaking flag is reset
+    void Deliver(TreeChangeKind kind, IUIAutomationElement* sender, PROPERTYID propertyId) {
+        TreeChange change;
+        change.kind = kind;
+        change.propertyId = propertyId;
+        RECT rect = {};
+        if (sender && SUCCEEDED(sender->get_CachedBoundingRectangle(&rect))) {
+            change.rect = { rect.left, rect.top, rect.right, rect.bottom };
+        }
+        VARIANT runtimeId;
+        VariantInit(&runtimeId);
+        if (sender && SUCCEEDED(sender->GetCachedPropertyValue(UIA_RuntimeIdPropertyId, &runtimeId)) && runtimeId.vt == (VT_I4 | VT_ARRAY)) {
+            change.runtimeId = ToRuntimeId(runtimeId.parray);
+        }
+        VariantClear(&runtimeId);
+        CComBSTR name;
+        if (sender && SUCCEEDED(sender->get_CachedName(&name)) && name != NULL) {
+            change.name.assign(static_cast<wchar_t*>(name));
+        }
+        Sink current;
+        {
+            std::lock_guard<std::mutex> lock(sinkMtx);
+            current = sink;
+        }
+        if (current) current(change);
     }
 
-private:
-    static std::queue<TextRect> textRectQueue; // Queue to hold TextRect objects for processing
-    static std::mutex queueMutex; // Mutex for thread-safe access to the queue
-    static std::atomic<bool> speaking; // Atomic flag indicating if speech is in progress
+    std::atomic<ULONG> refCount{ 1 }; // COM reference count
+    std::mutex sinkMtx; // Mutex for thread-safe access to the sink
+    Sink sink; // Receiver of change notifications
+    std::mutex watchMtx; // Mutex for thread-safe access to the watched element
+    std::shared_ptr<IUIAutomation> pEventAutomation; // Instance the handlers are registered on, guarded by watchMtx
+    CComPtr<IUIAutomationElement> pWatched = NULL; // Root of the watched subtree
+    HWND watchedWindow = NULL; // Top-level window of the watched subtree
 };
 
-std::queue<TextRect> ProcessTextRectQueue::textRectQueue; // Initialize the static textRectQueue
-std::mutex ProcessTextRectQueue::queueMutex; // Initialize the static queue mutex
-std::atomic<bool> ProcessTextRectQueue::speaking = false; // Initialize the static speaking flag
+UiaTreeEventSource treeEvents; // Change notifications from UI Automation
+
+// Key recording a document in processedTexts, which never matches a spoken text
+std::wstring DocumentKey(const RuntimeId& runtimeId) {
+    std::wstring key = L"\x1" L"document";
+    for (int part : runtimeId) key += L'.' + std::to_wstring(part);
+    return key;
+}
 
 // Function to read text and rectangle from a UI element
-// Extracts text and bounding rectangles from a UI element for processing
-void ReadElementText(CComPtr<IUIAutomationElement> pElement, std::shared_future<void> cancelFuture) {
-    if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) { return; } // Exit if cancellation is requested
+// Extracts text and bounding rectangles from an element snapshot for processing
+// New texts are interned in the arena of the traversal, the only copy made on their way to speech
+// Returns the interned name if one was queued
+std::wstring_view ReadElementText(const ElementSnapshot& element, const std::shared_ptr<TextArena>& arena, CancellationToken cancelToken) {
+    if (cancelToken.IsCancelled()) { return std::wstring_view(); } // Exit if cancellation is requested
 
     try {
-        // Process the text content and bounding rectangle
-        CComPtr<IUIAutomationTextPattern> pTextPattern = NULL;
-        HRESULT hr = pElement->GetCurrentPatternAs(UIA_TextPatternId, IID_PPV_ARGS(&pTextPattern)); // Get the text pattern from the element
-        if (SUCCEEDED(hr) && pTextPattern) {
-
-            CComPtr<IUIAutomationTextRange> pTextRange = NULL;
-            hr = pTextPattern->get_DocumentRange(&pTextRange); // Get the text range from the text pattern
-            if (SUCCEEDED(hr) && pTextRange) {
-                CComBSTR text;
-                hr = pTextRange->GetText(-1, &text); // Get the text within the text range
-                if (SUCCEEDED(hr) && text != NULL) {
-                    std::wstring textStr(static_cast<wchar_t*>(text)); // Convert the BSTR text to std::wstring
-                    if (!textStr.empty() && processedTexts.find(textStr) == processedTexts.end()) {
-                        RECT rect = {};
-                        hr = pElement->get_CurrentBoundingRectangle(&rect); // Get the bounding rectangle of the UI element
-                        if (SUCCEEDED(hr)) {
-                            ProcessTextRectQueue::Enqueue({ textStr, rect }, cancelFuture); // Enqueue the text and rectangle for processing
-                            processedTexts.insert(textStr);  // Add the text to the set after enqueueing to avoid reprocessing
-                        }
-                    }
-                }
+        RECT rect = ToRect(element.rect); // Bounding rectangle of the UI element, read with the snapshot
+
+        // Stream the document instead of reading it whole, so speech starts after the first chunk
+        if (element.hasTextPattern && (element.runtimeId.empty() || processedTexts.Insert(DocumentKey(element.runtimeId)))) {
+            auto readAhead = [](std::function<void()> read) { pool.Detach(TaskLane::Interactive, std::move(read)); };
+            auto stream = TextStream::Open(elementProvider.OpenDocument(element, ChunkUnit::Paragraph, MAX_CHUNK_CHARS), DOCUMENT_LOOKAHEAD, readAhead);
+            if (stream) {
+                ProcessTextRectQueue::Enqueue({ std::wstring_view(), rect, stream }, cancelToken); // Enqueue the document and its element rectangle
             }
         }
 
         // Process the name and bounding rectangle
-        CComBSTR name;
-        hr = pElement->get_CurrentName(&name); // Get the name property of the UI element
-        if (SUCCEEDED(hr) && name != NULL) {
-            std::wstring nameStr(static_cast<wchar_t*>(name)); // Convert the BSTR name to std::wstring
-            if (!nameStr.empty() && processedTexts.find(nameStr) == processedTexts.end()) {
-                RECT rect = {};
-                hr = pElement->get_CurrentBoundingRectangle(&rect); // Get the bounding rectangle of the UI element
-                if (SUCCEEDED(hr)) {
-                    ProcessTextRectQueue::Enqueue({ nameStr, rect }, cancelFuture); // Enqueue the name and rectangle for processing
-                    processedTexts.insert(nameStr);  // Add the name to the set after enqueueing to avoid reprocessing
-                }
-            }
+        const std::wstring& nameStr = element.name;
+        if (!nameStr.empty() && processedTexts.Insert(nameStr)) {
+            std::wstring_view interned = arena->Intern(nameStr);
+            ProcessTextRectQueue::Enqueue({ interned, rect, nullptr, arena }, cancelToken); // Enqueue the name and rectangle for processing
+            return interned;
         }
     }
     catch (const std::exception& e) {
         DebugLog(L"Exception in ReadElementText: " + Utf8ToWstring(e.what())); // Log any exceptions that occur
     }
+    return std::wstring_view();
 }
 
 
-// Collect UI elements using breadth-first search
-// Traverses the UI Automation tree to gather elements and process their text and rectangles
-void CollectElementsBFS(CComPtr<IUIAutomationElement> pElement, std::shared_future<void> cancelFuture) {
-    if (!pElement || cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) return;
-    processedTexts.clear(); // Clear the set of processed texts to start fresh
-    struct ElementInfo {
-        CComPtr<IUIAutomationElement> element; // The UI element to process
-        int depth{ 0 }; // The depth of the element in the UI tree
-    };
+// Fetch the subtree below an element in one request under a governor and patch what arrived into the tree mirror
+// Elements below the depth limit are mirrored without their children, so a later read fetches those again
+template <typename Visitor>
+bool FetchIntoMirror(const ElementHandle& root, int maxDepth, TraversalGovernor& governor, Visitor&& visit, std::vector<ElementSnapshot>& subtree) {
+    std::vector<bool> expanded;
+    bool completed = FetchWithinBudget(elementProvider, root, maxDepth, governor, visit, subtree, expanded);
+    if (!subtree.empty()) treeMirror.Patch(subtree, maxDepth, &expanded);
+    return completed;
+}
 
-    std::queue<ElementInfo> elementQueue;
-    elementQueue.push({ pElement, 0 }); // Start with the root element
+// Collect the mirrored subtree below an element, true if all of it is current
+// Stale parts the filter rejects are left out rather than reported, since no traversal would read below them anyway
+bool CollectFromMirror(const RuntimeId& rootId, int maxDepth, const ElementFilter& filter, std::vector<ElementSnapshot>& snapshots, std::vector<ElementSnapshot>& stale) {
+    snapshots.clear();
+    stale.clear();
+    if (!treeMirror.Collect(rootId, maxDepth, snapshots, stale)) return false;
+    stale.erase(std::remove_if(stale.begin(), stale.end(), [&](const ElementSnapshot& element) {
+        return element.depth > 0 && filter.Check(element) != PruneReason::None;
+        }), stale.end());
+    return stale.empty();
+}
 
-    while (!elementQueue.empty()) {
-        if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) return;
+// Read the subtree below an element through the tree mirror
+// Only the parts missing from the mirror or marked dirty by change notifications are fetched again, all of them
+// within one budget; returns false if parts are still missing, as when the budget ran out first
+bool ReadSubtreeFromMirror(const ElementHandle& root, TraversalBudget budget, std::vector<ElementSnapshot>& snapshots) {
+    RuntimeId rootId;
+    if (!elementProvider.GetRuntimeId(root, rootId)) return false;
+
+    TraversalGovernor governor(budget, elementProvider.QueryFilter());
+    auto keep = [](const ElementSnapshot&) { return true; };
+    for (int attempt = 0; attempt < 3; ++attempt) { // Notifications may dirty a part again while it is being fetched
+        std::vector<ElementSnapshot> stale;
+        if (CollectFromMirror(rootId, budget.maxDepth, governor.Filter(), snapshots, stale)) return true;
+        if (snapshots.empty() && stale.empty()) {
+            ElementSnapshot missing;
+            missing.handle = root;
+            stale.push_back(std::move(missing)); // Never visited, fetch the whole subtree
+        }
+        if (governor.Exhausted()) return false;
 
-        ElementInfo current = std::move(elementQueue.front()); // Get the next element in the queue
-        elementQueue.pop();
-        if (current.depth >= MAX_DEPTH) continue; // Skip elements that are too deep
+        for (const ElementSnapshot& element : stale) {
+            std::vector<ElementSnapshot> subtree;
+            FetchIntoMirror(element.handle, budget.maxDepth - element.depth, governor, keep, subtree); // Levels still needed below the stale element
+            if (subtree.empty()) return false;
+        }
+    }
+    return false;
+}
 
-        if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) return;
-        ReadElementText(current.element, cancelFuture); // Process the text and rectangle of the element
+// Lower case executable name of the process owning a window, the key of its application profile
+// Cached per process id, so only the first hover over an application opens its process
+std::wstring ExecutableOf(HWND hWnd) {
+    static std::mutex executablesMtx;
+    static std::unordered_map<DWORD, std::wstring> executables;
+    DWORD processId = 0;
+    if (!hWnd || !GetWindowThreadProcessId(hWnd, &processId) || !processId) return std::wstring();
+    std::lock_guard<std::mutex> lock(executablesMtx);
+    auto found = executables.find(processId);
+    if (found != executables.end()) return found->second;
+
+    std::wstring executable;
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (hProcess) {
+        wchar_t imagePath[MAX_PATH];
+        DWORD length = MAX_PATH;
+        if (QueryFullProcessImageName(hProcess, 0, imagePath, &length)) executable = AppProfile::KeyOf(std::wstring_view(imagePath, length));
+        CloseHandle(hProcess);
+    }
+    executables.emplace(processId, executable); // Processes that cannot be opened stay without a profile
+    return executable;
+}
 
-        CComPtr<IUIAutomationTreeWalker> pControlWalker;
-        HRESULT hr = pAutomation->get_ControlViewWalker(&pControlWalker); // Get the tree walker for UI Automation
-        if (FAILED(hr)) {
-            DebugLog(L"Failed to get ControlViewWalker: " + std::to_wstring(hr)); // Log failure to get tree walker
-            continue;
-        }
+// Path from the child of the top-level window down to an element, as recorded in application profiles
+// Walks up the control view, so it runs on the background lane only
+std::vector<PathStep> PathFromWindow(const ElementHandle& element) {
+    std::vector<PathStep> steps;
+    ElementHandle current = element;
+    for (int level = 0; current && level < 64; ++level) {
+        ElementSnapshot snapshot;
+        ElementNeighbors neighbors;
+        if (!elementProvider.FetchElement(current, snapshot) || !elementProvider.FetchNeighbors(current, neighbors)) return {};
+        steps.push_back({ snapshot.controlType, TextFingerprintSet::Fingerprint(snapshot.name) });
+        current = neighbors.parent;
+    }
+    if (current || steps.size() < 3) return {}; // Too deep, or the element is a top-level window itself
+    steps.resize(steps.size() - 2); // The desktop and the top-level window are found by handle, not by path
+    std::reverse(steps.begin(), steps.end());
+    return steps;
+}
 
-        CComPtr<IUIAutomationElement> pChild;
-        hr = pControlWalker->GetFirstChildElement(current.element, &pChild); // Get the first child element
-        if (FAILED(hr)) {
-            DebugLog(L"Failed to get first child element: " + std::to_wstring(hr)); // Log failure to get child element
-            continue;
+// Mirror the most hovered subtrees of an application and render its most spoken strings
+// Runs on the background lane the first time the application is hovered, so the hovers after it start warm
+void WarmFromProfile(HWND hWindow, const std::wstring& executable) {
+    std::optional<AppProfile> profile = appProfiles.Snapshot(executable);
+    std::shared_ptr<IUIAutomation> pAutomation = automation.Acquire();
+    if (!profile || !pAutomation) return;
+
+    CComPtr<IUIAutomationElement> pWindow = NULL;
+    if (SUCCEEDED(pAutomation->ElementFromHandle(hWindow, &pWindow)) && pWindow) {
+        ElementHandle window = WrapElement(pWindow);
+        for (size_t p = 0; p < profile->paths.size() && p < WARMED_PATHS; ++p) {
+            ElementHandle current = window;
+            for (const PathStep& step : profile->paths[p].steps) { // Follow the path by control type and name
+                std::vector<ElementHandle> children;
+                ElementHandle next;
+                if (!elementProvider.FetchChildren(current, children)) break;
+                for (const ElementHandle& child : children) {
+                    ElementSnapshot snapshot;
+                    if (elementProvider.FetchElement(child, snapshot) && snapshot.controlType == step.controlType &&
+                        TextFingerprintSet::Fingerprint(snapshot.name) == step.name) {
+                        next = child;
+                        break;
+                    }
+                }
+                current = next;
+                if (!current) break; // The window no longer looks the way it did
+            }
+            std::vector<ElementSnapshot> subtree;
+            TraversalGovernor governor(profile->Budget(traversalBudget), elementProvider.QueryFilter());
+            if (current) FetchIntoMirror(current, governor.Budget().maxDepth, governor, [](const ElementSnapshot&) { return true; }, subtree);
         }
+    }
 
-        while (SUCCEEDED(hr) && pChild) { // Check if there are children
-            if (cancelFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) return;
+    for (size_t s = 0; s < profile->strings.size() && s < WARMED_STRINGS; ++s) {
+        std::wstring normalized;
+        TextNormalizer::Normalize(std::wstring_view(profile->strings[s].text), normalized); // Same key SpeakTextTask will look up
+        if (!normalized.empty() && normalized.size() <= MAX_CACHED_TEXT) audioCache.Warm(audioRenderer, SpeechKey(normalized));
+    }
+}
 
-            elementQueue.push({ pChild, current.depth + 1 }); // Add the child element to the queue
+// Record what a traversal found in the profile of its application
+// The texts stay valid in the arena the task holds on to; the path of freshly hit-tested elements is recorded
+// one at a time, since walking up the tree costs a few round trips per level
+void LearnFromTraversal(const std::wstring& executable, const ElementHandle& root, bool fresh, int deepest,
+    std::vector<std::wstring_view> spoken, std::shared_ptr<TextArena> arena) {
+    if (executable.empty() || spoken.empty()) return;
+    pool.Detach(TaskLane::Background, [executable, deepest, spoken = std::move(spoken), arena = std::move(arena)]() {
+        appProfiles.Learn(executable, deepest, spoken);
+        });
+    if (fresh && !recordingPath.exchange(true)) {
+        pool.Detach(TaskLane::Background, [executable, root]() {
+            std::vector<PathStep> steps = PathFromWindow(root);
+            if (!steps.empty()) appProfiles.Hover(executable, steps);
+            recordingPath.store(false);
+            });
+    }
+}
 
-            CComPtr<IUIAutomationElement> pNextSibling;
-            hr = pControlWalker->GetNextSiblingElement(pChild, &pNextSibling); // Get the next sibling element
-            if (FAILED(hr)) {
-                DebugLog(L"Failed to get next sibling element: " + std::to_wstring(hr)); // Log failure to get sibling element
-                break;
-            }
+// Collect UI elements using breadth-first search
+// Traverses the UI Automation tree to gather elements and process their text and rectangles
+// The read ends at the traversal deadline or node budget, and subtrees nothing can be read from are left out
+void CollectElementsBFS(CComPtr<IUIAutomationElement> pElement, CancellationToken cancelToken) {
+    if (!pElement || cancelToken.IsCancelled()) return;
+    processedTexts.Reset(); // Start a new generation instead of freeing the recorded texts
+    uint64_t indexTarget = IndexGenerationFor(pElement); // Only the subtree under a fresh hit test is indexed
+    HWND hWindow = hoveredWindow.load();
+    std::wstring executable = ExecutableOf(hWindow);
+    if (!executable.empty() && appProfiles.MarkWarmed(executable)) {
+        pool.Detach(TaskLane::Background, [hWindow, executable]() {
+            WarmFromProfile(hWindow, executable);
+            });
+    }
+    TraversalBudget budget = appProfiles.Budget(executable, traversalBudget); // Learned limits of a known application
+    TraversalGovernor governor(budget, elementProvider.QueryFilter());
+    auto arena = std::make_shared<TextArena>(textBlocks); // Released in bulk once the traversal and its queued texts are done
+    std::vector<std::wstring_view> spoken; // Names queued, learned from once the traversal ends
+    int deepest = 0; // Deepest level a name was queued from
+
+    auto visit = [&](const ElementSnapshot& element) {
+        if (cancelToken.IsCancelled()) return false;
+        if (indexTarget) {
+            IndexElement(indexTarget, element); // Let later cursor moves over this element resolve locally
+        }
+        std::wstring_view queued = ReadElementText(element, arena, cancelToken); // Process the text and rectangle of the element
+        if (!queued.empty()) {
+            spoken.push_back(queued);
+            deepest = (std::max)(deepest, element.depth);
+        }
+        return true;
+    };
+    auto finish = [&](const ElementHandle& root) {
+        DebugLog(L"Traversal: " + governor.Finish().Describe() + L"; arena " + arena->Stats().Describe());
+        LearnFromTraversal(executable, root, indexTarget != 0, deepest, std::move(spoken), arena);
+    };
 
-            pChild = pNextSibling; // Move to the next sibling
+    // In batched mode a subtree the mirror holds in full is visited from cached properties; anything else is
+    // fetched one level at a time under the governor, so the budget bounds the requests and not just the visits
+    ElementHandle root = WrapElement(pElement);
+    std::vector<ElementSnapshot> snapshots;
+    if (traversalMode == TraversalMode::Batched) {
+        RuntimeId rootId;
+        std::vector<ElementSnapshot> stale;
+        if (elementProvider.GetRuntimeId(root, rootId) && CollectFromMirror(rootId, budget.maxDepth, governor.Filter(), snapshots, stale)) {
+            VisitWithinBudget(snapshots, governor, visit);
+            finish(root);
+            return;
+        }
+        FetchIntoMirror(root, budget.maxDepth, governor, visit, snapshots);
+        if (!snapshots.empty()) {
+            finish(root);
+            return;
         }
     }
+
+    // Live walk: the per-element calls run on the helper lane while the visits, and so the queued texts, stay in reading order
+    // Helpers queued behind another walk start once that walk ends, and return at once if this one is over by then
+    auto lend = [](std::function<void()> help) {
+        pool.Detach(TaskLane::Helper, std::move(help));
+    };
+    auto govern = [&](const ElementSnapshot& element) {
+        if (!governor.Admit(element)) return !governor.Exhausted(); // Its children were never fetched
+        return visit(element);
+    };
+    ParallelTraverseSubtree(elementProvider, root, budget.maxDepth, TRAVERSAL_HELPERS, lend, govern, governor.Filter());
+    finish(root);
 }
 
 // Function to stop current processes asynchronously
@@ -597,30 +1964,19 @@ void StopCurrentProcesses() {
 
     try {
         // Signal cancellation of current tasks
-        {
-            std::lock_guard<std::mutex> cancelLock(cancelMtx);
-            cancelPromise.set_value(); // Set the promise to cancel current tasks
-            cancelPromise = std::promise<void>();  // Reset for new tasks
-            cancelFuture = cancelPromise.get_future().share(); // Create a new shared future for cancellation
-        }
+        auto requested = std::chrono::steady_clock::now();
+        cancellation.Cancel(); // Every token taken so far reads as cancelled, sleeping ones wake up
 
         // Stop ongoing processes
         ProcessTextRectQueue::ClearQueue(); // Clear the processing queue
+        ProcessTextRectQueue::CloseDocument(); // Release the consumer if it waits for the next chunk of a document
 
-        if (rectangleDrawn.load()) {  // Clear the rectangle if one is drawn
-            std::lock_guard<std::mutex> rectLock(rectMtx);
-            pool.detach_task([=]() {ProcessRectangle(currentRect, false, cancelFuture); }); // Clear the rectangle asynchronously
-        }
+        if (batchPolicy.preemption == Preemption::Interrupt) {
+            overlay.HideAll(); // Remove the highlights, composed with the next frame
 
-        {   //Clear speech
-            std::lock_guard<std::mutex> voiceLock(pVoiceMtx);
-            if (pVoice) {
-                HRESULT hr = pVoice->Speak(nullptr, SPF_PURGEBEFORESPEAK, nullptr); // Purge any ongoing speech
-                if (FAILED(hr)) {
-                    DebugLog(L"Failed to stop speech: " + std::to_wstring(hr)); // Log failure to stop speech
-                }
-            }
-        }
+            speechBackend.Purge(); // Clear speech, which also releases the task waiting for it
+            cancelToSilence.Record(std::chrono::steady_clock::now() - requested);
+        } // Otherwise the consumer stops at the end of the item being spoken and removes its highlight itself
 
     }
     catch (const std::system_error& e) {
@@ -639,53 +1995,121 @@ void ProcessNewElement(CComPtr<IUIAutomationElement> pElement) {
     // Increment the task version to invalidate all previous tasks
     int currentVersion = ++taskVersion;
     
-    pool.detach_task([pElement, currentVersion]() {
+    pool.Detach(TaskLane::Interactive, [pElement, currentVersion, interaction = LatencyTracer::Current(), dispatched = std::chrono::steady_clock::now()]() {
         // If the current task version is outdated, skip this task
         if (currentVersion != taskVersion.load()) {
             return;
         }
 
+        TraceScope scope(interaction); // Spans below and the texts queued by the traversal belong to the triggering input
+        tracer.Record(TraceStage::Dispatch, interaction, dispatched, std::chrono::steady_clock::now());
         StopCurrentProcesses();  // Stop all current tasks
 
         // If the task is still valid, proceed with BFS to collect UI elements
         if (currentVersion == taskVersion.load()) {
-            CollectElementsBFS(pElement, cancelFuture);
+            TraceSpan span(tracer, TraceStage::Traversal);
+            CollectElementsBFS(pElement, cancellation.Token()); // Taken after the stop, so only a later stop cancels it
         }
         });
 }
 
 
-// Check if the UI element is different from the previous one
-// Compares the current UI element with the previous one to detect changes
-bool IsDifferentElement(CComPtr<IUIAutomationElement> pElement) {
-    std::shared_lock<std::shared_mutex> lock(mtx);  // Use shared_lock for read-only access
-    if (pPrevElement == NULL && pElement == NULL) {
+// Check if a UI element is different from the previous one
+// Takes no lock; the caller holds elementMutex while it reads pPrevElement and passes it in
+bool IsDifferentElement(IUIAutomationElement* pPrevious, IUIAutomationElement* pElement) {
+    if (pPrevious == NULL && pElement == NULL) {
         return false; // No elements to compare
     }
-    else if (pPrevElement == NULL || pElement == NULL) {
+    else if (pPrevious == NULL || pElement == NULL) {
         return true; // One of the elements is NULL, so they are different
     }
 
+    std::shared_ptr<IUIAutomation> pAutomation = automation.Acquire();
+    if (!pAutomation) return true; // Treat the element as new rather than compare with no instance
     BOOL areSame;
-    HRESULT hr = pAutomation->CompareElements(pPrevElement, pElement, &areSame); // Compare the elements using UI Automation
+    HRESULT hr = pAutomation->CompareElements(pPrevious, pElement, &areSame); // Compare the elements using UI Automation
     return SUCCEEDED(hr) && !areSame; // Return true if the elements are different
 }
 
+// Resolve the element at a predicted landing point together with its subtree
+// Runs on the background lane while the cursor is still moving; in batched mode the subtree lands in the mirror,
+// so the traversal that follows the hover reads it without another request
+bool SpeculateElementAt(long x, long y, const CancellationToken& token, SpeculatedArea& area) {
+    std::shared_ptr<IUIAutomation> pAutomation = automation.Acquire();
+    if (!pAutomation || token.IsCancelled()) return false;
+    POINT point = { x, y };
+    CComPtr<IUIAutomationElement> pElement = NULL;
+    HRESULT hr = pAutomation->ElementFromPoint(point, &pElement);
+    ReportAutomationResult(hr);
+    if (FAILED(hr) || !pElement || token.IsCancelled()) return false;
+
+    area.surface = reinterpret_cast<uintptr_t>(RootWindowFromPoint(point));
+    ElementHandle root = WrapElement(pElement);
+    bool fetched = traversalMode == TraversalMode::Batched && ReadSubtreeFromMirror(root, traversalBudget, area.elements);
+    if (!fetched) {
+        area.elements.clear();
+        TraversalGovernor governor(traversalBudget, elementProvider.QueryFilter());
+        auto current = [&token](const ElementSnapshot&) { return !token.IsCancelled(); };
+        if (traversalMode == TraversalMode::Batched) FetchIntoMirror(root, traversalBudget.maxDepth, governor, current, area.elements); // Claims need the elements below the point too
+        else {
+            std::vector<bool> expanded;
+            FetchWithinBudget(elementProvider, root, traversalBudget.maxDepth, governor, current, area.elements, expanded);
+        }
+        fetched = !area.elements.empty();
+    }
+    return fetched && !token.IsCancelled();
+}
+
+// Render the first text a speculated area would speak, so its speech starts from the audio cache
+void WarmSpeculatedSpeech(const SpeculatedArea& area, const CancellationToken& token) {
+    for (const ElementSnapshot& element : area.elements) {
+        if (element.name.empty()) continue;
+        std::wstring normalized;
+        TextNormalizer::Normalize(std::wstring_view(element.name), normalized); // Same key SpeakTextTask will look up
+        if (!normalized.empty() && normalized.size() <= MAX_CACHED_TEXT && !token.IsCancelled()) {
+            audioCache.Warm(audioRenderer, SpeechKey(normalized));
+        }
+        return;
+    }
+}
+
 // Process cursor position and detect UI elements
 // Retrieves the UI element under the cursor and triggers processing if it has changed
 void ProcessCursorPosition(POINT point) {
-    CComPtr<IUIAutomationElement> pElement = NULL;
-    HRESULT hr = pAutomation->ElementFromPoint(point, &pElement); // Get the UI element under the cursor
+    std::shared_ptr<IUIAutomation> pAutomation = automation.Acquire(); // A recreated instance is published without a gap, this one stays valid meanwhile
+    if (!pAutomation) return; // Automation is not ready yet or has been shut down
+    HRESULT hr = S_OK;
+    CComPtr<IUIAutomationElement> pElement = LookupIndexedElement(point); // Try the elements visited by the last traversal first
+    bool resolvedLocally = pElement != NULL;
+    if (!resolvedLocally && speculator) {
+        pElement = UnwrapElement(speculator->Claim(point.x, point.y, reinterpret_cast<uintptr_t>(RootWindowFromPoint(point)))); // Resolved while the cursor was on its way
+    }
+    if (!pElement) {
+        hr = pAutomation->ElementFromPoint(point, &pElement); // Get the UI element under the cursor
+        ReportAutomationResult(hr); // Track whether the automation instance still works
+    }
 
     if (SUCCEEDED(hr) && pElement) {
-        if (IsDifferentElement(pElement)) { // Check if the element is different from the previous one
-            pPrevElement.Release(); // Release the previous element
-            pPrevElement = pElement; // Update the previous element to the current one
+        bool changed;
+        {
+            std::unique_lock<std::shared_mutex> lock(elementMutex); // Compare and replace in one step, navigation may move the current element meanwhile
+            changed = IsDifferentElement(pPrevElement, pElement); // Check if the element is different from the previous one
+            if (changed) pPrevElement = pElement; // Update the previous element to the current one, releasing the old one
+        }
+        if (changed) {
+            if (navigation) {
+                navigation->SetCurrent(WrapElement(pElement), capsLockOverride.load()); // Keyboard navigation continues from here, prefetched only while it is enabled
+            }
+            if (!resolvedLocally) {
+                HWND hWindow = ResetElementIndex(point, pElement); // A fresh hit test starts a fresh index for the new subtree
+                hoveredWindow.store(hWindow); // Traversals look up the profile of its application
+                treeEvents.WatchWindow(hWindow); // Keep the index in step with changes in that window
+            }
             ProcessNewElement(pElement); // Process the new element
         }
     }
     else {
-        DebugLog(L"Failed to retrieve UI element from point: " + std::to_wstring(hr)); // Log failure to retrieve the element
+        Log<LogLevel::Trace>(logger, L"Failed to retrieve UI element from point: " + std::to_wstring(hr)); // Runs on every hover, compiled out unless tracing
     }
 }
 
@@ -695,66 +2119,170 @@ LRESULT CALLBACK MouseProc(int nCode, WPARAM wParam, LPARAM lParam) {
     if (nCode >= 0 && wParam == WM_MOUSEMOVE) {
         POINT point;
         GetCursorPos(&point); // Get the current cursor position
-        pool.detach_task([point]() {ProcessCursorPosition(point);}); // Process the cursor position to detect UI elements
+        if (hoverScheduler) {
+            hoverScheduler->Post(point.x, point.y); // Replace any position still waiting for its hit test
+        }
+        if (speculator) {
+            speculator->Post(point.x, point.y); // Start resolving where the cursor is heading
+        }
     }
     return CallNextHookEx(hMouseHook, nCode, wParam, lParam); // Pass the event to the next hook in the chain
 }
 
-// Reinitialize UI Automation and COM components
-// Resets and reinitializes UI Automation and speech synthesis components periodically
-void ReinitializeAutomation() {
+// Check whether a failed call means the object behind it is gone rather than just busy
+bool IsDisconnectError(HRESULT hr) {
+    return hr == RPC_E_DISCONNECTED || hr == RPC_E_SERVER_DIED || hr == RPC_E_SERVER_DIED_DNE || hr == CO_E_OBJNOTCONNECTED ||
+        hr == HRESULT_FROM_WIN32(RPC_S_SERVER_UNAVAILABLE) || hr == HRESULT_FROM_WIN32(RPC_S_CALL_FAILED);
+}
 
-    if (pAutomation) {
-        pAutomation.Release(); // Release the existing UI Automation instance
+// Create a UI Automation instance, shared by the snapshots taken of it
+// The last snapshot to be dropped releases the instance, whichever thread holds it
+std::shared_ptr<IUIAutomation> CreateAutomation() {
+    CComPtr<IUIAutomation> pCreated;
+    HRESULT hr = CoCreateInstance(__uuidof(CUIAutomation), NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pCreated)); // Create a new UI Automation instance
+    if (FAILED(hr)) {
+        DebugLog(L"Failed to create UI Automation instance: " + std::to_wstring(hr)); // Log failure to create UI Automation instance
+        return nullptr;
     }
-    if (pPrevElement) {
+    return std::shared_ptr<IUIAutomation>(pCreated.Detach(), [](IUIAutomation* pUia) { pUia->Release(); });
+}
+
+// Create a SAPI voice with the speech settings applied, ready to be swapped in
+CComPtr<ISpVoice> CreateVoice() {
+    CComPtr<ISpVoice> pCreated;
+    HRESULT hr = CoCreateInstance(CLSID_SpVoice, NULL, CLSCTX_ALL, IID_ISpVoice, (void**)&pCreated); // Create a new speech synthesis instance
+    if (FAILED(hr)) {
+        DebugLog(L"Failed to initialize SAPI: " + std::to_wstring(hr)); // Log failure to initialize SAPI
+        return NULL;
+    }
+    pCreated->SetVolume(SPEECH_VOLUME); // Set the volume of the speech synthesis
+    pCreated->SetRate(SPEECH_RATE); // Set the rate of the speech synthesis
+    return pCreated;
+}
+
+// Recreate the UI Automation instance
+// The new instance is built while the old one keeps serving hovers; only then is the state tied to the old one dropped
+// and the new one published, and the old one is released once the last call still using it returns
+// Runs on the background lane, whose workers joined COM when they started
+bool RecreateAutomation() {
+    std::shared_ptr<IUIAutomation> pCreated = CreateAutomation();
+    if (!pCreated) {
+        DebugLog(L"Failed to reinitialize UI Automation, keeping the current instance");
+        return false;
+    }
+
+    treeEvents.Stop(); // Unregister handlers from the instance being replaced
+    InvalidateElementIndex(); // Indexed elements belong to the instance being replaced
+    if (speculator) {
+        speculator->Invalidate(); // So do speculated ones
+    }
+    treeMirror.Clear(); // So do mirrored elements
+    appProfiles.ResetWarmed(); // Including those warmed from application profiles, so warm them again
+    {
+        std::unique_lock<std::shared_mutex> lock(elementMutex);
         pPrevElement.Release(); // Release the previous UI element
     }
+    automation.Publish(std::move(pCreated)); // Calls in flight finish on the old instance
+    invalidationHub.Attach(treeEvents); // Subscribe the new instance to change notifications
+    return true;
+}
+
+// Recreate the SAPI voice
+// The new voice is created without holding pVoiceMtx, so speech requests keep going to the old voice until the swap,
+// with no gap and no wait on construction as ComponentHolder gives UI Automation; the voice stays behind the mutex
+// because the backend's stream state must change with it, and nothing done under the lock blocks for long
+// Runs on the background lane, whose workers joined COM when they started
+bool RecreateVoice() {
+    CComPtr<ISpVoice> pCreated = CreateVoice();
+    if (!pCreated) return false;
+
+    CComPtr<ISpVoice> pReplaced; // Released after the lock, a broken voice may take its time to go
     {
         std::lock_guard<std::mutex> lock(pVoiceMtx);
-        if (pVoice) {
-            pVoice.Release(); // Release the existing speech synthesis instance
-        }
+        pReplaced.Attach(pVoice.Detach());
+        pVoice = pCreated;
+        speechBackend.Attach(); // Deliver completion and word events of the new voice
     }
+    return true;
+}
 
-    HRESULT hr = CoInitialize(NULL);
-    if (FAILED(hr)) {
-        DebugLog(L"Failed to reinitialize COM library: " + std::to_wstring(hr)); // Log failure to reinitialize COM
-        return;
+// Rebuild the components that were found broken
+// Healthy components and their caches are left untouched
+void RepairBrokenComponents() {
+    if (automationHealth.IsBroken()) {
+        DebugLog(L"UI Automation found broken, recreating it");
+        if (RecreateAutomation()) automationHealth.MarkRebuilt();
+    }
+    if (speechHealth.IsBroken()) {
+        DebugLog(L"Speech synthesis found broken, recreating it");
+        if (RecreateVoice()) speechHealth.MarkRebuilt();
     }
+    repairScheduled.store(false);
+}
 
-    hr = CoCreateInstance(__uuidof(CUIAutomation), NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pAutomation)); // Create a new UI Automation instance
-    if (FAILED(hr)) {
-        DebugLog(L"Failed to reinitialize UI Automation: " + std::to_wstring(hr)); // Log failure to reinitialize UI Automation
-        CoUninitialize();
-        return;
+// Queue a repair task unless one is already waiting
+void ScheduleRepair() {
+    if (!repairScheduled.exchange(true)) {
+        pool.Detach(TaskLane::Background, RepairBrokenComponents);
     }
+}
 
-    hr = CoCreateInstance(CLSID_SpVoice, NULL, CLSCTX_ALL, IID_ISpVoice, (void**)&pVoice); // Create a new speech synthesis instance
-    if (FAILED(hr)) {
-        DebugLog(L"Failed to reinitialize SAPI: " + std::to_wstring(hr)); // Log failure to reinitialize SAPI
-        pAutomation.Release();
-        CoUninitialize();
-        return;
+// Record the result of a call on the UI Automation instance
+void ReportAutomationResult(HRESULT hr) {
+    if (SUCCEEDED(hr)) {
+        automationHealth.ReportSuccess();
+    }
+    else if (automationHealth.ReportFailure(IsDisconnectError(hr))) {
+        ScheduleRepair();
     }
+}
 
-    {
-        std::lock_guard<std::mutex> lock(pVoiceMtx);
-        pVoice->SetVolume(100); // Set the volume of the speech synthesis
-        pVoice->SetRate(2); // Set the rate of the speech synthesis
+// Record the result of a call on the SAPI voice
+void ReportSpeechResult(HRESULT hr) {
+    if (SUCCEEDED(hr)) {
+        speechHealth.ReportSuccess();
+    }
+    else if (speechHealth.ReportFailure(IsDisconnectError(hr))) {
+        ScheduleRepair();
     }
 }
 
-// Schedule reinitialization task
-// Sets up a periodic task to reinitialize UI Automation and speech synthesis components
-void ScheduleReinitialization() {
-    // Submit the reinitialization task with a delay
-    pool.detach_task([]() {
-        while (true) {
-            std::this_thread::sleep_for(std::chrono::minutes(10)); // Wait for 10 minutes
-            ReinitializeAutomation(); // Reinitialize the components
+// Register the caches that change notifications can make stale
+// Each handler only drops the state overlapping the changed element
+void SubscribeInvalidation() {
+    invalidationHub.Subscribe(TreeChangeKind::StructureChanged, [](const TreeChange& change) {
+        InvalidateIndexedArea(change.rect); // Children under the sender were added, removed or reordered
+        if (navigation) {
+            navigation->Invalidate(); // Prefetched neighbors may have moved or gone away
+        }
+        if (speculator) {
+            speculator->Invalidate(); // So may the elements resolved ahead of the cursor
+        }
+        if (change.runtimeId.empty()) {
+            treeMirror.MarkAllDirty(); // Sender unknown, so any mirrored subtree may contain it
+        }
+        else {
+            treeMirror.MarkDirty(change.runtimeId); // Unmirrored senders have no mirrored children to refresh
+        }
+        });
+    invalidationHub.Subscribe(TreeChangeKind::PropertyChanged, [](const TreeChange& change) {
+        if (change.propertyId == UIA_NamePropertyId) {
+            treeMirror.UpdateName(change.runtimeId, change.name); // Patched in place, the element index is unaffected
+        }
+        else if (change.propertyId == UIA_BoundingRectanglePropertyId) {
+            InvalidateElementIndex(); // The old position of a moved element is unknown
+            treeMirror.UpdateRect(change.runtimeId, change.rect);
+        }
+        else {
+            InvalidateIndexedArea(change.rect); // Visibility changed in place
+            if (change.runtimeId.empty() || !treeMirror.MarkDirty(change.runtimeId)) {
+                treeMirror.MarkAllDirty(); // Elements coming into view were never fetched, so no mirrored ancestor lists them
+            }
         }
-        }); // Detach the task so it runs independently
+        });
+    invalidationHub.Subscribe(TreeChangeKind::FocusChanged, [](const TreeChange& change) {
+        InvalidateIndexedArea(change.rect); // Focused elements often expand, collapse or redraw
+        });
 }
 
 
@@ -763,16 +2291,54 @@ void ScheduleReinitialization() {
 void Shutdown() {
 
     UnhookWindowsHookEx(hMouseHook); // Unhook the mouse hook
+    treeEvents.Stop(); // Stop change notifications before the automation instance goes away
+    if (hoverScheduler) {
+        hoverScheduler->Stop(); // Finish any hit test in flight before COM objects go away
+        DebugLog(L"Hover-to-hit-test latency: " + hoverScheduler->Latency().Describe() +
+            L" dropped=" + std::to_wstring(hoverScheduler->Dropped())); // Report coalescing statistics
+    }
+    if (speculator) {
+        speculator->Stop(); // Finish speculations in flight before COM objects go away
+        DebugLog(L"Hover prediction: " + speculator->Describe());
+    }
 
-    std::lock_guard<std::mutex> lock(pVoiceMtx);
-    pVoice.Release(); // Release the speech synthesis instance
+    if (navigation) {
+        navigation->Stop(); // Finish prefetches in flight before COM objects go away
+        DebugLog(L"Navigation: " + navigation->Describe());
+        DebugLog(L"Navigation keypress-to-speech latency: " + tracer.FirstAudio(TraceOrigin::Navigate).Describe());
+    }
+
+    speechBackend.Stop(); // Stop the speech event thread before the voice goes away
+    DebugLog(L"Audio cache: " + audioCache.Describe()); // Report hit rate and time to first sample
+    DebugLog(L"Task queue wait: " + pool.Describe()); // Report how long each lane kept tasks waiting
+    DebugLog(L"Cancel-to-silence latency: " + cancelToSilence.Describe());
+    DebugLog(L"Input-to-audio stages: " + tracer.Describe()); // Report where interactions spent their time
+    DebugLog(L"Overlay: " + overlay.Describe()); // Report frame count, coalescing and repainted area
+    if (overlayThread.joinable()) {
+        HWND window = overlaySurface.Window();
+        if (window) PostMessage(window, WM_CLOSE, 0, 0); // Destroys the window and ends the overlay thread
+        overlayThread.join();
+    }
+    SaveAudioCache();
+    DebugLog(L"Application profiles: " + appProfiles.Describe());
+    SaveAppProfiles();
+    audioRenderer.Close(); // Release the rendering voice
+
+    {
+        std::lock_guard<std::mutex> lock(pVoiceMtx);
+        pVoice.Release(); // Release the speech synthesis instance
+    }
 
-    pAutomation.Release(); // Release the UI Automation instance
-    pPrevElement.Release(); // Release the previous UI element
-    DeleteObject(hPen); // Delete the pen used for drawing rectangles
+    automation.Publish(nullptr); // Release the UI Automation instance once the last snapshot of it is dropped
+    {
+        std::unique_lock<std::shared_mutex> lock(elementMutex);
+        pPrevElement.Release(); // Release the previous UI element
+    }
 
     CoUninitialize(); // Uninitialize COM
 
+    if (logger.Dropped()) DebugLog(L"Log records dropped: " + std::to_wstring(logger.Dropped()));
+    logger.Flush(); // Make sure everything logged during shutdown reaches the file
 }
 
 // Mouse Input Thread Function
@@ -794,6 +2360,19 @@ void MouseInputThread() {
     UnhookWindowsHookEx(hMouseHook); // Unhook the mouse hook when the message loop exits
 }
 
+// Elements a traversal can read something from
+// Scroll bars, thumbs and separators never carry text, and neither do elements offscreen or without bounds
+ElementFilter ReadableElements() {
+    ElementFilter filter;
+    filter.skipOffscreen = true;
+    filter.skipEmpty = true;
+    for (int controlType = UIA_ButtonControlTypeId; controlType <= UIA_AppBarControlTypeId; ++controlType) {
+        if (controlType == UIA_ScrollBarControlTypeId || controlType == UIA_ThumbControlTypeId || controlType == UIA_SeparatorControlTypeId) continue;
+        filter.controlTypes.push_back(controlType);
+    }
+    return filter;
+}
+
 // Updated Initialize Function
 // Sets up the initial state, including console buffer, COM initialization, and hook setup
 void Initialize() {
@@ -818,37 +2397,64 @@ void Initialize() {
             throw std::runtime_error("Failed to initialize COM library");
         }
 
-        pAutomation.Release(); // Release any existing UI Automation instance
-
-        hr = CoCreateInstance(__uuidof(CUIAutomation), NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pAutomation)); // Create a new UI Automation instance
-        if (FAILED(hr)) {
-            DebugLog(L"Failed to create UI Automation instance: " + std::to_wstring(hr)); // Log failure to create UI Automation instance
+        // Create UI Automation and the voice side by side, each with the cache that does not depend on the other
+        auto started = std::chrono::steady_clock::now();
+        std::future<std::shared_ptr<IUIAutomation>> automationReady = pool.Submit(TaskLane::Interactive, []() {
+            std::shared_ptr<IUIAutomation> pCreated = CreateAutomation();
+            LoadAppProfiles(); // Map what was learned about each application, decoded when it is first hovered
+            return pCreated;
+            });
+        std::future<CComPtr<ISpVoice>> voiceReady = pool.Submit(TaskLane::Interactive, []() {
+            CComPtr<ISpVoice> pCreated = CreateVoice();
+            LoadAudioCache(); // Warm the audio cache from the previous session
+            return pCreated;
+            });
+        std::shared_ptr<IUIAutomation> pCreatedAutomation = automationReady.get();
+        CComPtr<ISpVoice> pCreatedVoice = voiceReady.get();
+        if (!pCreatedAutomation) {
             CoUninitialize();
             throw std::runtime_error("Failed to create UI Automation instance");
         }
-
+        if (!pCreatedVoice) {
+            CoUninitialize();
+            throw std::runtime_error("Failed to initialize SAPI");
+        }
+        automation.Publish(std::move(pCreatedAutomation));
         {
             std::lock_guard<std::mutex> lock(pVoiceMtx);
-
-            pVoice.Release(); // Release any existing speech synthesis instance
-
-            hr = CoCreateInstance(CLSID_SpVoice, NULL, CLSCTX_ALL, IID_ISpVoice, (void**)&pVoice); // Create a new speech synthesis instance
-            if (FAILED(hr)) {
-                DebugLog(L"Failed to initialize SAPI: " + std::to_wstring(hr)); // Log failure to initialize SAPI
-                pAutomation.Release();
-                CoUninitialize();
-                throw std::runtime_error("Failed to initialize SAPI");
-            }
-
-            pVoice->SetVolume(100); // Set the volume of the speech synthesis
-            pVoice->SetRate(2); // Set the rate of the speech synthesis
+            pVoice = pCreatedVoice;
+            speechBackend.Attach(); // Deliver completion and word events instead of polling the voice
         }
+        DebugLog(L"Automation and speech ready in " +
+            std::to_wstring(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count()) + L"ms");
+        overlayThread = std::thread(OverlayThread); // Create the highlight overlay before anything is highlighted
+        ProcessTextRectQueue::Start(); // Start the consumer that speaks and highlights queued texts
+
+        elementProvider.SetQueryFilter(ReadableElements()); // Before the first traversal builds its walker
+        // Start the navigation thread before the keyboard hook can queue any moves
+        navigation = std::make_unique<NavigationCache>(elementProvider, ArriveAtElement, [](std::function<void()> prefetch) {
+            pool.Detach(TaskLane::Interactive, std::move(prefetch));
+            }, &tracer);
+
+        // Speculate on the background lane, so a wrong guess never delays a hover or navigation task
+        speculator = std::make_unique<HoverSpeculator>(SpeculateElementAt, [](std::function<void()> speculation) {
+            pool.Detach(TaskLane::Background, std::move(speculation)); // Background workers are in COM already
+            }, WarmSpeculatedSpeech, predictionPolicy);
+
+        // Start the hit-test thread before the hook can deliver any mouse moves
+        hoverScheduler = std::make_unique<HoverScheduler>([](const CursorSample& sample) {
+            TraceScope scope(tracer.Begin(TraceOrigin::Hover, sample.time)); // The interaction starts at the mouse event
+            tracer.Record(TraceStage::Debounce, LatencyTracer::Current(), sample.time, std::chrono::steady_clock::now());
+            TraceSpan span(tracer, TraceStage::HitTest);
+            ProcessCursorPosition({ sample.x, sample.y });
+            }, hoverPolicy);
 
         // Start mouse input thread inside Initialize
         std::thread mouseThread(MouseInputThread); // Start the mouse input thread
         mouseThread.detach(); // Detach the thread to allow it to run independently
 
-        ScheduleReinitialization(); // Schedule periodic reinitialization of components
+        SubscribeInvalidation(); // Route change notifications to the caches they affect
+        invalidationHub.Attach(treeEvents); // Components are rebuilt only when found broken, caches only where changed
 
         //boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard(io_context.get_executor()); // Prevent the io_context from running out of work
 
@@ -867,17 +2473,14 @@ int main() {
     try {
         Initialize(); // Initialize the application
 
-        // Schedule any initial tasks needed using the thread pool
-        // For example, if you need to start periodic reinitialization:
-        ScheduleReinitialization();
-
         MSG msg;
         while (GetMessage(&msg, NULL, 0, 0)) {
             TranslateMessage(&msg);
             DispatchMessage(&msg); // Process Windows messages
         }
 
-        pool.wait(); // Wait for all tasks to complete before shutting down
+        ProcessTextRectQueue::Stop(); // Stop speaking and release traversals blocked on a full queue
+        pool.Wait(); // Wait for all tasks to complete before shutting down
         Shutdown(); // Shutdown the application
     }
     catch (const std::exception& e) {
@@ -0,0 +1,141 @@
+#ifndef SIGHTSPEAK_SPATIAL_INDEX_HPP
+#define SIGHTSPEAK_SPATIAL_INDEX_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "element-provider.hpp"
+
+// Uniform-grid index over element rectangles
+// Resolves a screen point to the smallest rectangle containing it without asking the target process
+class SpatialIndex {
+public:
+    explicit SpatialIndex(long cellSize = 64, size_t maxCellsPerRect = 256)
+        : cellSize(cellSize > 0 ? cellSize : 64), maxCellsPerRect(maxCellsPerRect) {
+    }
+
+    // Add a rectangle under the given id, replacing any rectangle already stored for it
+    // Empty rectangles are ignored because no point can resolve to them
+    void Insert(uint32_t id, const ElementRect& rect) {
+        Remove(id);
+        if (rect.right <= rect.left || rect.bottom <= rect.top) return;
+        rects.emplace(id, rect);
+        if (CellsCovered(rect) > maxCellsPerRect) {
+            oversized.push_back(id); // Window-sized panes would otherwise be copied into hundreds of cells
+            return;
+        }
+        ForEachCell(rect, [&](uint64_t key) { cells[key].push_back({ id, rect }); });
+    }
+
+    // Remove the rectangle stored under the given id
+    bool Remove(uint32_t id) {
+        auto found = rects.find(id);
+        if (found == rects.end()) return false;
+        ElementRect rect = found->second;
+        rects.erase(found);
+
+        auto large = std::find(oversized.begin(), oversized.end(), id);
+        if (large != oversized.end()) {
+            *large = oversized.back();
+            oversized.pop_back();
+            return true;
+        }
+        ForEachCell(rect, [&](uint64_t key) {
+            auto cell = cells.find(key);
+            if (cell == cells.end()) return;
+            std::vector<Entry>& entries = cell->second;
+            auto entry = std::find_if(entries.begin(), entries.end(), [id](const Entry& e) { return e.id == id; });
+            if (entry != entries.end()) {
+                *entry = entries.back();
+                entries.pop_back();
+            }
+            if (entries.empty()) cells.erase(cell);
+            });
+        return true;
+    }
+
+    // Remove every rectangle overlapping the given area and return how many were removed
+    size_t RemoveIntersecting(const ElementRect& area) {
+        if (area.right <= area.left || area.bottom <= area.top) return 0;
+        std::vector<uint32_t> hits;
+        for (const auto& [id, rect] : rects) {
+            if (rect.left < area.right && area.left < rect.right && rect.top < area.bottom && area.top < rect.bottom) {
+                hits.push_back(id);
+            }
+        }
+        for (uint32_t id : hits) Remove(id);
+        return hits.size();
+    }
+
+    // Drop every rectangle
+    void Clear() {
+        cells.clear();
+        rects.clear();
+        oversized.clear();
+    }
+
+    // Id of the smallest rectangle containing the point; later ids win ties since they were found deeper
+    std::optional<uint32_t> Query(long x, long y) const {
+        std::optional<uint32_t> best;
+        long long bestArea = 0;
+        auto consider = [&](uint32_t id, const ElementRect& rect) {
+            if (x < rect.left || x >= rect.right || y < rect.top || y >= rect.bottom) return;
+            long long area = static_cast<long long>(rect.right - rect.left) * (rect.bottom - rect.top);
+            if (!best || area < bestArea || (area == bestArea && id > *best)) {
+                best = id;
+                bestArea = area;
+            }
+        };
+
+        auto cell = cells.find(CellKey(CellOf(x), CellOf(y)));
+        if (cell != cells.end()) {
+            for (const Entry& entry : cell->second) consider(entry.id, entry.rect);
+        }
+        for (uint32_t id : oversized) consider(id, rects.at(id));
+        return best;
+    }
+
+    // Number of rectangles in the index
+    size_t Size() const { return rects.size(); }
+
+private:
+    // Rectangle copied into each cell it overlaps so queries never leave the cell
+    struct Entry {
+        uint32_t id;
+        ElementRect rect;
+    };
+
+    long CellOf(long coordinate) const {
+        return coordinate >= 0 ? coordinate / cellSize : -((-coordinate + cellSize - 1) / cellSize); // Floor division for negative monitors
+    }
+
+    static uint64_t CellKey(long column, long row) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(column)) << 32) | static_cast<uint32_t>(row);
+    }
+
+    size_t CellsCovered(const ElementRect& rect) const {
+        size_t columns = static_cast<size_t>(CellOf(rect.right - 1) - CellOf(rect.left) + 1);
+        size_t rows = static_cast<size_t>(CellOf(rect.bottom - 1) - CellOf(rect.top) + 1);
+        return columns * rows;
+    }
+
+    template <typename Callback>
+    void ForEachCell(const ElementRect& rect, Callback&& callback) const {
+        for (long column = CellOf(rect.left); column <= CellOf(rect.right - 1); ++column) {
+            for (long row = CellOf(rect.top); row <= CellOf(rect.bottom - 1); ++row) {
+                callback(CellKey(column, row));
+            }
+        }
+    }
+
+    long cellSize; // Width and height of a grid cell in pixels
+    size_t maxCellsPerRect; // Rectangles spanning more cells are kept in the oversized list
+    std::unordered_map<uint64_t, std::vector<Entry>> cells; // Rectangles overlapping each cell
+    std::unordered_map<uint32_t, ElementRect> rects; // Rectangle stored for each id
+    std::vector<uint32_t> oversized; // Ids of rectangles too large for the grid, scanned on every query
+};
+
+#endif // SIGHTSPEAK_SPATIAL_INDEX_HPP
@@ -0,0 +1,279 @@
+#ifndef SIGHTSPEAK_SPEECH_BACKEND_HPP
+#define SIGHTSPEAK_SPEECH_BACKEND_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cwctype>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "audio-cache.hpp"
+#include "cancellation.hpp"
+
+// Notifications raised while an utterance plays
+// Both run on a backend thread and must return quickly
+struct SpeechCallbacks {
+    std::function<void()> onStart; // The first sample of the utterance is being played
+    std::function<void(size_t offset, size_t length)> onWord; // A word of the text starts playing
+    std::function<void(bool finished)> onDone; // Raised exactly once; finished is false when the utterance was purged or failed
+};
+
+// Speech synthesizer that reports progress through callbacks instead of being polled
+// Backed by SAPI in the reader and by FakeSpeechBackend for portable runs
+class SpeechBackend {
+public:
+    virtual ~SpeechBackend() = default;
+
+    // Start speaking asynchronously, purging whatever is playing
+    virtual bool Speak(const std::wstring& text, SpeechCallbacks callbacks) = 0;
+
+    // Play previously synthesized audio asynchronously, purging whatever is playing
+    // Cached clips report no word boundaries
+    virtual bool Play(const AudioClip& clip, SpeechCallbacks callbacks) = 0;
+
+    // Stop speaking; the current utterance ends with onDone(false)
+    virtual bool Purge() = 0;
+
+protected:
+    // Make callbacks current for a new utterance, ending the previous one as interrupted
+    // Returns the id under which the backend reports progress for it
+    uint64_t BeginUtterance(SpeechCallbacks callbacks) {
+        SpeechCallbacks previous;
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(utteranceMutex);
+            previous = std::exchange(current, std::move(callbacks));
+            id = ++currentId;
+        }
+        if (previous.onDone) previous.onDone(false);
+        return id;
+    }
+
+    // Report that playback started, ignored unless the utterance is still current
+    void ReportStart(uint64_t id) {
+        std::function<void()> onStart;
+        {
+            std::lock_guard<std::mutex> lock(utteranceMutex);
+            if (id != currentId) return;
+            onStart = current.onStart;
+        }
+        if (onStart) onStart();
+    }
+
+    // Report a word boundary, ignored unless the utterance is still current
+    void ReportWord(uint64_t id, size_t offset, size_t length) {
+        std::function<void(size_t, size_t)> onWord;
+        {
+            std::lock_guard<std::mutex> lock(utteranceMutex);
+            if (id != currentId) return;
+            onWord = current.onWord;
+        }
+        if (onWord) onWord(offset, length);
+    }
+
+    // End an utterance, ignored unless it is still current
+    void EndUtterance(uint64_t id, bool finished) {
+        SpeechCallbacks ended;
+        {
+            std::lock_guard<std::mutex> lock(utteranceMutex);
+            if (id != currentId) return;
+            ended = std::exchange(current, SpeechCallbacks());
+            ++currentId; // Late events for the ended utterance no longer match
+        }
+        if (ended.onDone) ended.onDone(finished);
+    }
+
+    // Id of the utterance currently playing
+    uint64_t CurrentUtterance() {
+        std::lock_guard<std::mutex> lock(utteranceMutex);
+        return currentId;
+    }
+
+private:
+    std::mutex utteranceMutex; // Guards current and currentId
+    SpeechCallbacks current; // Callbacks of the utterance playing
+    uint64_t currentId{ 0 }; // Id of the utterance playing
+};
+
+// Speak a text, or play its cached audio when clip is set, and block until it ends without polling the backend
+// A cancellation that purged the backend just before the utterance started is caught once it has started, and purges it
+// Returns true if the utterance played to the end, false if it was purged, cancelled or failed to start
+inline bool SpeakAndWait(SpeechBackend& backend, const std::wstring& text, const AudioClip* clip = nullptr, SpeechCallbacks callbacks = SpeechCallbacks(),
+    const CancellationToken& token = CancellationToken()) {
+    struct Completion {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool done{ false };
+        bool finished{ false };
+    };
+    auto completion = std::make_shared<Completion>(); // Shared so a late callback never touches a dead stack frame
+
+    callbacks.onDone = [completion](bool finished) {
+        {
+            std::lock_guard<std::mutex> lock(completion->mutex);
+            completion->done = true;
+            completion->finished = finished;
+        }
+        completion->cv.notify_all();
+    };
+    bool started = clip ? backend.Play(*clip, std::move(callbacks)) : backend.Speak(text, std::move(callbacks));
+    if (!started) return false;
+    if (token.IsCancelled()) backend.Purge(); // The purge of the cancellation may have found nothing playing yet
+
+    std::unique_lock<std::mutex> lock(completion->mutex);
+    completion->cv.wait(lock, [&] { return completion->done; });
+    return completion->finished;
+}
+
+// Backend with deterministic timing that plays nothing
+// Each word takes perCharacter times its length and clips their sample length, and every utterance starts
+// startup after it was requested, so pipelines can be tested and profiled without a synthesizer
+class FakeSpeechBackend : public SpeechBackend {
+public:
+    explicit FakeSpeechBackend(std::chrono::microseconds perCharacter = std::chrono::microseconds(100),
+        std::chrono::microseconds startup = std::chrono::microseconds(0))
+        : perCharacter(perCharacter), startup(startup), worker(&FakeSpeechBackend::Run, this) {
+    }
+
+    ~FakeSpeechBackend() override {
+        {
+            std::lock_guard<std::mutex> lock(playMutex);
+            stopping = true;
+        }
+        playCv.notify_one();
+        if (worker.joinable()) worker.join();
+        EndUtterance(CurrentUtterance(), false);
+    }
+
+    FakeSpeechBackend(const FakeSpeechBackend&) = delete;
+    FakeSpeechBackend& operator=(const FakeSpeechBackend&) = delete;
+
+    bool Speak(const std::wstring& text, SpeechCallbacks callbacks) override {
+        return Start(std::move(callbacks), SplitWords(text), std::chrono::microseconds(0));
+    }
+
+    bool Play(const AudioClip& clip, SpeechCallbacks callbacks) override {
+        uint32_t bytesPerSecond = clip.format.BytesPerSecond();
+        auto length = std::chrono::microseconds(bytesPerSecond ? clip.samples.size() * 1000000 / bytesPerSecond : 0);
+        return Start(std::move(callbacks), std::vector<Word>(), length);
+    }
+
+    bool Purge() override {
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(playMutex);
+            id = playing;
+            playing = 0;
+            words.clear();
+            ++purged;
+        }
+        playCv.notify_one();
+        if (id) EndUtterance(id, false);
+        return true;
+    }
+
+    // Number of utterances started
+    uint64_t Spoken() {
+        std::lock_guard<std::mutex> lock(playMutex);
+        return spoken;
+    }
+
+    // Number of purge requests
+    uint64_t Purged() {
+        std::lock_guard<std::mutex> lock(playMutex);
+        return purged;
+    }
+
+private:
+    struct Word {
+        size_t offset;
+        size_t length;
+    };
+
+    static std::vector<Word> SplitWords(const std::wstring& text) {
+        std::vector<Word> result;
+        size_t i = 0;
+        while (i < text.size()) {
+            while (i < text.size() && iswspace(text[i])) ++i;
+            size_t start = i;
+            while (i < text.size() && !iswspace(text[i])) ++i;
+            if (i > start) result.push_back({ start, i - start });
+        }
+        return result;
+    }
+
+    bool Start(SpeechCallbacks callbacks, std::vector<Word> newWords, std::chrono::microseconds newTail) {
+        uint64_t id = BeginUtterance(std::move(callbacks));
+        {
+            std::lock_guard<std::mutex> lock(playMutex);
+            playing = id;
+            started = false;
+            words = std::move(newWords);
+            nextWord = 0;
+            tail = newTail;
+            due = std::chrono::steady_clock::now() + startup;
+            ++spoken;
+        }
+        playCv.notify_one();
+        return true;
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(playMutex);
+        while (!stopping) {
+            if (!playing) {
+                playCv.wait(lock);
+                continue;
+            }
+            if (playCv.wait_until(lock, due) == std::cv_status::no_timeout) continue; // Purged, replaced or stopping
+
+            uint64_t id = playing;
+            if (!started) {
+                started = true;
+                lock.unlock();
+                ReportStart(id);
+                lock.lock();
+                continue;
+            }
+            if (nextWord == words.size()) {
+                if (tail.count() > 0) {
+                    due += std::exchange(tail, std::chrono::microseconds(0)); // Clip playback has no words
+                    continue;
+                }
+                playing = 0;
+                lock.unlock();
+                EndUtterance(id, true);
+                lock.lock();
+                continue;
+            }
+            Word word = words[nextWord++];
+            due += perCharacter * static_cast<long long>(word.length);
+            lock.unlock();
+            ReportWord(id, word.offset, word.length);
+            lock.lock();
+        }
+    }
+
+    std::chrono::microseconds perCharacter; // Playback time per character
+    std::chrono::microseconds startup; // Time from a request until the utterance starts, like a synthesizer warming up
+    std::mutex playMutex; // Guards the playback state below
+    std::condition_variable playCv; // Signals new utterances, purges and shutdown
+    uint64_t playing{ 0 }; // Utterance being played, zero when idle
+    bool started{ false }; // Start of the utterance was reported
+    std::vector<Word> words; // Words of the utterance being played
+    size_t nextWord{ 0 }; // Next word to report
+    std::chrono::microseconds tail{ 0 }; // Playback left after the last word, used for clips
+    std::chrono::steady_clock::time_point due; // When the next word or the end is reported
+    uint64_t spoken{ 0 }; // Utterances started
+    uint64_t purged{ 0 }; // Purge requests
+    bool stopping{ false }; // Set once the backend is being destroyed
+    std::thread worker; // Playback thread, started last so every member is ready
+};
+
+#endif // SIGHTSPEAK_SPEECH_BACKEND_HPP
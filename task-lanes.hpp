@@ -0,0 +1,93 @@
+#ifndef SIGHTSPEAK_TASK_LANES_HPP
+#define SIGHTSPEAK_TASK_LANES_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "external/BS_thread_pool.hpp"
+#include "latency-histogram.hpp"
+
+// Priority class of a pool task
+enum class TaskLane {
+    Interactive, // Hover, navigation and highlighting, a user is waiting for it
+    Background, // Cache warming, repairs and anything else that may be late
+    Helper, // Workers lent to a walk in progress, which hold on to them until the walk ends
+};
+
+// Thread pools with their own workers, so background tasks that block or run long, and helpers waiting for a walk
+// to hand them work, can never occupy the workers interactive tasks need
+// The time every task spends queued is recorded per lane
+class TaskLanes {
+public:
+    // workerInit runs once on every worker of every lane as it starts, with the lane the worker belongs to,
+    // so per-thread setup such as joining COM never has to be repeated by the tasks
+    TaskLanes(size_t interactiveThreads, size_t backgroundThreads, const std::function<void(TaskLane)>& workerInit = [](TaskLane) {}, size_t helperThreads = 1)
+        : interactive(static_cast<BS::concurrency_t>(interactiveThreads ? interactiveThreads : 1), [workerInit] { workerInit(TaskLane::Interactive); }),
+        helpers(static_cast<BS::concurrency_t>(helperThreads ? helperThreads : 1), [workerInit] { workerInit(TaskLane::Helper); }),
+        background(static_cast<BS::concurrency_t>(backgroundThreads ? backgroundThreads : 1), [workerInit] { workerInit(TaskLane::Background); }) {
+    }
+
+    TaskLanes(const TaskLanes&) = delete;
+    TaskLanes& operator=(const TaskLanes&) = delete;
+
+    // Run a task on a lane without waiting for its result
+    template <typename F>
+    void Detach(TaskLane lane, F&& task) {
+        Pool(lane).detach_task(Timed(lane, std::forward<F>(task)));
+    }
+
+    // Run a task on a lane and get a future for its result
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    std::future<R> Submit(TaskLane lane, F&& task) {
+        return Pool(lane).submit_task(Timed(lane, std::forward<F>(task)));
+    }
+
+    // Block until every lane is idle
+    void Wait() {
+        interactive.wait();
+        helpers.wait();
+        background.wait();
+    }
+
+    // Queue wait of the tasks run on a lane
+    const LatencyHistogram& QueueWait(TaskLane lane) const {
+        return lane == TaskLane::Interactive ? interactiveWait : lane == TaskLane::Helper ? helperWait : backgroundWait;
+    }
+
+    // Number of tasks queued but not started on a lane
+    size_t Queued(TaskLane lane) { return Pool(lane).get_tasks_queued(); }
+
+    // Short human readable summary for the debug log
+    std::wstring Describe() const {
+        return L"interactive wait " + interactiveWait.Describe() + L", helper wait " + helperWait.Describe() + L", background wait " + backgroundWait.Describe();
+    }
+
+private:
+    BS::thread_pool& Pool(TaskLane lane) {
+        return lane == TaskLane::Interactive ? interactive : lane == TaskLane::Helper ? helpers : background;
+    }
+
+    // Wrap a task so it records how long it sat in the queue before a worker picked it up
+    template <typename F>
+    auto Timed(TaskLane lane, F&& task) {
+        LatencyHistogram* wait = lane == TaskLane::Interactive ? &interactiveWait : lane == TaskLane::Helper ? &helperWait : &backgroundWait;
+        return [wait, queued = std::chrono::steady_clock::now(), task = std::forward<F>(task)]() {
+            wait->Record(std::chrono::steady_clock::now() - queued);
+            return task();
+        };
+    }
+
+    LatencyHistogram interactiveWait; // Queue wait of interactive tasks
+    LatencyHistogram backgroundWait; // Queue wait of background tasks
+    LatencyHistogram helperWait; // Queue wait of walk helpers, long while other walks hold every helper
+    BS::thread_pool interactive; // Workers reserved for interactive tasks
+    BS::thread_pool helpers; // Workers lent to walks, bounded so concurrent walks queue their helpers; stop before the walks they serve
+    BS::thread_pool background; // Workers for everything else, declared last so they stop first
+};
+
+#endif // SIGHTSPEAK_TASK_LANES_HPP
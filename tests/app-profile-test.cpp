@@ -0,0 +1,153 @@
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "app-profile.hpp"
+#include "check.hpp"
+
+// Profile with a traversal history, two hot paths and two spoken strings
+AppProfile MakeProfile(const std::wstring& executable, uint32_t traversals) {
+    AppProfile profile;
+    profile.executable = executable;
+    for (uint32_t i = 0; i < traversals; ++i) profile.Learn(static_cast<int>(i % 4), i % 30);
+    profile.Hover({ { 50033, 11 }, { 50000, 12 } });
+    profile.Hover({ { 50033, 11 }, { 50000, 12 } });
+    profile.Hover({ { 50032, 13 } });
+    profile.Spoke(L"Inbox");
+    profile.Spoke(L"Ünread – 3");
+    return profile;
+}
+
+bool SameProfile(const AppProfile& a, const AppProfile& b) {
+    if (a.executable != b.executable || a.traversals != b.traversals || a.depth != b.depth || a.texts != b.texts) return false;
+    if (a.paths.size() != b.paths.size() || a.strings.size() != b.strings.size()) return false;
+    for (size_t i = 0; i < a.paths.size(); ++i) {
+        if (a.paths[i].steps != b.paths[i].steps || a.paths[i].hits != b.paths[i].hits) return false;
+    }
+    for (size_t i = 0; i < a.strings.size(); ++i) {
+        if (a.strings[i].text != b.strings[i].text || a.strings[i].count != b.strings[i].count) return false;
+    }
+    return true;
+}
+
+// Budgets stay at the defaults until enough traversals were learned from, then shrink to what the application needed
+void TestLearning() {
+    CHECK(AppProfile::KeyOf(L"C:\\Program Files\\Microsoft Office\\OUTLOOK.EXE") == L"outlook.exe");
+    CHECK(AppProfile::KeyOf(L"notepad.exe") == L"notepad.exe");
+
+    TraversalBudget defaults;
+    AppProfile profile = MakeProfile(L"outlook.exe", AppProfile::MinTraversals - 1);
+    CHECK(profile.Budget(defaults).maxDepth == defaults.maxDepth); // Not trusted yet
+    CHECK(profile.Budget(defaults).maxNodes == defaults.maxNodes);
+    profile.Learn(3, 10);
+    CHECK(profile.Budget(defaults).maxDepth == 3 + AppProfile::DepthMargin + 1);
+    CHECK(profile.Budget(defaults).maxNodes == 64); // Twice the most texts seen, but never below 64
+    CHECK(profile.paths.size() == 2 && profile.paths[0].hits == 2);
+
+    profile.Spoke(L"Ünread – 3");
+    profile.Spoke(L"Ünread – 3");
+    profile.Trim(1, 1);
+    CHECK(profile.paths.size() == 1 && profile.paths[0].steps.size() == 2);
+    CHECK(profile.strings.size() == 1 && profile.strings[0].text == L"Ünread – 3");
+}
+
+// Every profile comes back from a pack as it went in, and unknown applications are not found
+void TestRoundTrip() {
+    std::vector<AppProfile> profiles;
+    for (int i = 0; i < 50; ++i) profiles.push_back(MakeProfile(L"app" + std::to_wstring(i) + L".exe", 10 + i));
+    profiles.push_back(AppProfile()); // No name, nothing learned
+    std::vector<uint8_t> bytes = ProfilePack::Serialize(profiles);
+
+    ProfilePack pack(bytes.data(), bytes.size());
+    CHECK(pack.Valid());
+    CHECK(pack.Size() == profiles.size());
+    for (const AppProfile& profile : profiles) {
+        std::optional<AppProfile> found = pack.Find(profile.executable);
+        CHECK(found && SameProfile(*found, profile));
+    }
+    CHECK(!pack.Find(L"unknown.exe"));
+    CHECK(pack.All().size() == profiles.size());
+
+    std::vector<uint8_t> empty = ProfilePack::Serialize({});
+    CHECK(ProfilePack(empty.data(), empty.size()).Valid());
+    CHECK(ProfilePack(empty.data(), empty.size()).Size() == 0);
+}
+
+// A damaged or cut record is skipped on its own; a damaged header or index, or an unknown version, leaves an invalid pack;
+// no single damaged byte anywhere makes a read go out of bounds
+void TestCorruption() {
+    std::vector<AppProfile> profiles{ MakeProfile(L"first.exe", 30), MakeProfile(L"second.exe", 40), MakeProfile(L"third.exe", 50) };
+    const std::vector<uint8_t> bytes = ProfilePack::Serialize(profiles);
+
+    std::vector<uint8_t> damaged = bytes;
+    damaged.back() ^= 0x01; // Last byte of the last record
+    ProfilePack pack(damaged.data(), damaged.size());
+    CHECK(pack.Valid());
+    CHECK(pack.All().size() == 2);
+
+    damaged = bytes;
+    damaged[16] ^= 0x01; // First index entry
+    CHECK(!ProfilePack(damaged.data(), damaged.size()).Valid());
+    damaged = bytes;
+    damaged[4] = 2; // Version
+    CHECK(!ProfilePack(damaged.data(), damaged.size()).Valid());
+    CHECK(!ProfilePack(bytes.data(), 20).Valid()); // Cut inside the index
+    CHECK(!ProfilePack(nullptr, 0).Valid());
+
+    ProfilePack cut(bytes.data(), bytes.size() - 1); // Cut inside the last record
+    CHECK(cut.Valid());
+    CHECK(cut.All().size() == 2);
+
+    for (size_t offset = 0; offset < bytes.size(); ++offset) {
+        damaged = bytes;
+        damaged[offset] ^= 0x5A;
+        ProfilePack flipped(damaged.data(), damaged.size());
+        std::vector<AppProfile> intact = flipped.All();
+        CHECK(intact.size() >= (flipped.Valid() ? 2u : 0u)); // At most the record holding the byte is lost
+        for (const AppProfile& profile : profiles) flipped.Find(profile.executable);
+    }
+}
+
+// A store serves profiles from an attached pack until it learns, and persists learned and stored profiles together
+void TestStore() {
+    TraversalBudget defaults;
+    std::vector<uint8_t> bytes = ProfilePack::Serialize({ MakeProfile(L"outlook.exe", 40), MakeProfile(L"excel.exe", 5) });
+
+    ProfileLimits limits;
+    limits.maxProfiles = 2;
+    limits.maxPaths = 1;
+    ProfileStore store(limits);
+    CHECK(!store.AttachDisk(bytes.data(), 10));
+    CHECK(store.AttachDisk(bytes.data(), bytes.size()));
+    CHECK(store.Budget(L"outlook.exe", defaults).maxDepth < defaults.maxDepth); // Learned in an earlier session
+    CHECK(store.Budget(L"excel.exe", defaults).maxDepth == defaults.maxDepth); // Too few traversals to trust
+    CHECK(store.Budget(L"word.exe", defaults).maxDepth == defaults.maxDepth);
+
+    store.Learn(L"word.exe", 2, { L"Document1", L"Save" });
+    store.Hover(L"word.exe", { { 50000, 7 } });
+    std::optional<AppProfile> word = store.Snapshot(L"word.exe");
+    CHECK(word && word->traversals == 1 && word->strings.size() == 2 && word->paths.size() == 1);
+    store.DetachDisk();
+    CHECK(store.Snapshot(L"outlook.exe")); // Decoded before the pack went away
+    CHECK(store.Snapshot(L"excel.exe")); // Budget decoded it too
+    CHECK(store.MarkWarmed(L"word.exe"));
+    CHECK(!store.MarkWarmed(L"word.exe"));
+    store.ResetWarmed();
+    CHECK(store.MarkWarmed(L"word.exe"));
+
+    std::vector<AppProfile> persisted = store.Persistable();
+    CHECK(persisted.size() == 2); // The most used two
+    if (persisted.size() == 2) {
+        CHECK(persisted[0].executable == L"outlook.exe");
+        CHECK(persisted[0].paths.size() == 1);
+    }
+}
+
+// Learning, budgets, and the on-disk pack of per-application profiles
+int main() {
+    TestLearning();
+    TestRoundTrip();
+    TestCorruption();
+    TestStore();
+    return CheckResult();
+}
@@ -0,0 +1,137 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "async-log.hpp"
+#include "check.hpp"
+
+// Scratch directory of the test, emptied before each case
+std::filesystem::path Scratch(const char* name) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "sightspeak-async-log-test" / name;
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+std::string ReadFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+std::vector<std::string> Lines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    return lines;
+}
+
+// Records come out as one UTF-8 line each, with level and thread in the prefix, and long messages truncated
+void TestFormat() {
+    LogSettings settings;
+    settings.path = Scratch("format") / "debug.log";
+    std::vector<std::wstring> echoed;
+    settings.echo = [&echoed](const std::wstring& line) { echoed.push_back(line); };
+    AsyncLog log(settings);
+    log.Write(LogLevel::Info, L"plain");
+    log.Write(LogLevel::Warning, L"café € \U0001F600");
+    log.Write(LogLevel::Error, std::wstring(5000, L'x'));
+    Log<LogLevel::Trace>(log, L"compiled out");
+    log.Flush();
+    CHECK(log.Written() == 3);
+    CHECK(log.Dropped() == 0);
+    CHECK(echoed.size() == 3);
+
+    std::vector<std::string> lines = Lines(ReadFile(settings.path));
+    CHECK(lines.size() == 3);
+    if (lines.size() == 3) {
+        CHECK(lines[0].find("] INFO  t1 plain") != std::string::npos);
+        CHECK(lines[1].find("] WARN  t1 caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80") != std::string::npos);
+        CHECK(lines[2].find(std::string(1024, 'x')) != std::string::npos);
+        CHECK(lines[2].find(std::string(1025, 'x')) == std::string::npos);
+    }
+}
+
+// Records of several threads all reach the file, each thread's in the order it wrote them,
+// including those of threads that exited before the writer got to them
+void TestThreads() {
+    constexpr int threadCount = 4;
+    constexpr int records = 2000;
+    LogSettings settings;
+    settings.path = Scratch("threads") / "debug.log";
+    settings.ringBytes = 1024 * 1024; // Room for every record, so none is dropped
+    AsyncLog log(settings);
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < threadCount; ++thread) {
+        threads.emplace_back([&log, thread]() {
+            for (int record = 0; record < records; ++record) {
+                log.Write(LogLevel::Info, L"w" + std::to_wstring(thread) + L" " + std::to_wstring(record));
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    log.Flush();
+    CHECK(log.Written() == threadCount * records);
+    CHECK(log.Dropped() == 0);
+
+    std::vector<int> next(threadCount, 0);
+    for (const std::string& line : Lines(ReadFile(settings.path))) {
+        size_t at = line.find(" w");
+        if (at == std::string::npos) continue;
+        int thread = 0, record = 0;
+        std::istringstream(line.substr(at + 2)) >> thread >> record;
+        if (thread < 0 || thread >= threadCount) continue;
+        CHECK(record == next[thread]);
+        next[thread] = record + 1;
+    }
+    CHECK((next == std::vector<int>(threadCount, records)));
+}
+
+// A full buffer drops records instead of blocking, and every record is either written or counted as dropped
+void TestDrops() {
+    LogSettings settings;
+    settings.path = Scratch("drops") / "debug.log";
+    settings.ringBytes = 4096; // The smallest ring
+    settings.flushInterval = std::chrono::milliseconds(10000); // The writer only runs when flushed
+    AsyncLog log(settings);
+    for (int record = 0; record < 1000; ++record) log.Write(LogLevel::Info, L"record " + std::to_wstring(record));
+    log.Flush();
+    CHECK(log.Dropped() > 0);
+    CHECK(log.Written() + log.Dropped() == 1000);
+    log.Write(LogLevel::Info, L"after the drain");
+    log.Flush();
+    CHECK(Lines(ReadFile(settings.path)).back().find("after the drain") != std::string::npos);
+}
+
+// The file rotates once it reaches maxFileBytes, keeping keepFiles older files
+void TestRotation() {
+    LogSettings settings;
+    std::filesystem::path directory = Scratch("rotation");
+    settings.path = directory / "debug.log";
+    settings.maxFileBytes = 100;
+    settings.keepFiles = 2;
+    AsyncLog log(settings);
+    for (int pass = 0; pass < 5; ++pass) {
+        for (int record = 0; record < 5; ++record) log.Write(LogLevel::Info, L"pass " + std::to_wstring(pass));
+        log.Flush(); // Each pass outgrows the limit on its own
+    }
+    log.Stop();
+    CHECK(!std::filesystem::exists(settings.path)); // The last pass was rotated away too
+    CHECK(ReadFile(directory / "debug.log.1").find("pass 4") != std::string::npos);
+    CHECK(ReadFile(directory / "debug.log.2").find("pass 3") != std::string::npos);
+    CHECK(!std::filesystem::exists(directory / "debug.log.3"));
+    CHECK(log.Written() == 25);
+}
+
+// Formatting, ordering, dropping and rotation of the asynchronous logger
+int main() {
+    TestFormat();
+    TestThreads();
+    TestDrops();
+    TestRotation();
+    std::filesystem::remove_all(std::filesystem::temp_directory_path() / "sightspeak-async-log-test");
+    return CheckResult();
+}
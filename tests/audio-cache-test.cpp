@@ -0,0 +1,130 @@
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "audio-cache.hpp"
+#include "check.hpp"
+
+AudioCacheKey Key(const std::wstring& text, long rate = 0) {
+    AudioCacheKey key;
+    key.text = text;
+    key.voice = L"voice";
+    key.rate = rate;
+    return key;
+}
+
+std::shared_ptr<const AudioClip> Clip(size_t bytes, uint8_t fill = 0) {
+    auto clip = std::make_shared<AudioClip>();
+    clip->samples.assign(bytes, fill);
+    return clip;
+}
+
+// Every field of a key tells clips apart, and text cannot run into the voice
+void TestKeys() {
+    AudioCacheKey joined = Key(L"ab");
+    joined.voice = L"";
+    AudioCacheKey split = Key(L"a");
+    split.voice = L"b";
+    CHECK(!(joined == split));
+    CHECK(joined.Hash() != split.Hash());
+    CHECK(!(Key(L"Save") == Key(L"Save", 2)));
+    AudioCacheKey louder = Key(L"Save");
+    louder.volume = 80;
+    CHECK(!(louder == Key(L"Save")));
+}
+
+// The memory tier keeps the most recently used clips within its byte budget
+void TestLeastRecentlyUsed() {
+    AudioCache cache(3000);
+    cache.Insert(Key(L"a"), Clip(1000));
+    cache.Insert(Key(L"b"), Clip(1000));
+    cache.Insert(Key(L"c"), Clip(1000));
+    CHECK(cache.Find(Key(L"a")) != nullptr); // a is now the most recent, b the least
+    cache.Insert(Key(L"d"), Clip(1000));
+    CHECK(!cache.Contains(Key(L"b")));
+    CHECK(cache.Contains(Key(L"a")) && cache.Contains(Key(L"c")) && cache.Contains(Key(L"d")));
+
+    cache.Insert(Key(L"a"), Clip(500)); // Replacing a clip releases the bytes of the old one
+    cache.Insert(Key(L"too long"), Clip(4000)); // Larger than the whole budget, never kept
+    CHECK(!cache.Contains(Key(L"too long")));
+    AudioCacheStats stats = cache.Stats();
+    CHECK(stats.bytes == 2500);
+    CHECK(stats.clips == 3);
+    CHECK(stats.evictions == 1);
+    CHECK(stats.hits == 1);
+
+    CHECK(!cache.Find(Key(L"b")));
+    CHECK(cache.Stats().misses == 1);
+}
+
+// Warm renders a text once, and again only for a different voice setting
+void TestWarm() {
+    AudioCache cache;
+    StubAudioRenderer renderer;
+    CHECK(cache.Warm(renderer, Key(L"Save")));
+    CHECK(cache.Warm(renderer, Key(L"Save")));
+    CHECK(renderer.Renders() == 1);
+    CHECK(cache.Warm(renderer, Key(L"Save", 3)));
+    CHECK(renderer.Renders() == 2);
+    CHECK(!cache.Warm(renderer, Key(L""))); // Nothing to play
+    std::shared_ptr<const AudioClip> clip = cache.Find(Key(L"Save"));
+    CHECK(clip && clip->samples.size() == 4 * 60 * AudioFormat().BytesPerSecond() / 1000);
+}
+
+// Clips persisted by one session are served from the mapped pack by the next, then promoted into memory
+void TestDiskTier() {
+    AudioCache first;
+    first.Insert(Key(L"old"), Clip(100, 1));
+    first.Insert(Key(L"new"), Clip(200, 2));
+    first.Insert(Key(L"too much"), Clip(5000, 3));
+    AudioPack::Entries persisted = first.Persistable(1000);
+    CHECK(persisted.size() == 2); // The newest clip would pass the limit and is left out, smaller older ones still fit
+    std::vector<uint8_t> bytes = AudioPack::Serialize(persisted);
+
+    AudioCache second;
+    CHECK(!second.AttachDisk(bytes.data(), 8));
+    CHECK(second.AttachDisk(bytes.data(), bytes.size()));
+    std::shared_ptr<const AudioClip> clip = second.Find(Key(L"new"));
+    CHECK(clip && clip->samples == std::vector<uint8_t>(200, 2));
+    second.DetachDisk(); // Promoted clips outlive the mapping
+    CHECK(second.Find(Key(L"new")) != nullptr);
+    CHECK(!second.Find(Key(L"old")));
+    AudioCacheStats stats = second.Stats();
+    CHECK(stats.diskHits == 1 && stats.hits == 1 && stats.misses == 1);
+    CHECK(stats.HitRate() > 0.66 && stats.HitRate() < 0.67);
+}
+
+// A damaged pack loses clips but never reads out of bounds, including lengths crafted to wrap the size check
+void TestDamagedPack() {
+    AudioPack::Entries entries{ { Key(L"ab"), Clip(4, 7) }, { Key(L"cd"), Clip(8, 9) } };
+    const std::vector<uint8_t> bytes = AudioPack::Serialize(entries);
+    for (size_t offset = 0; offset < bytes.size(); ++offset) {
+        std::vector<uint8_t> damaged = bytes;
+        damaged[offset] ^= 0x5A;
+        AudioPack pack(damaged.data(), damaged.size());
+        pack.All();
+        for (const auto& [key, clip] : entries) pack.Find(key);
+    }
+
+    std::vector<uint8_t> wrapped = AudioPack::Serialize({ { Key(L"ab"), Clip(4, 7) } });
+    const size_t record = 16 + 24; // Header, then one index entry
+    uint32_t textLength = 0x80000000u; // Twice this is 2^32
+    uint64_t available = 2 * (2 + 5) + 4; // Text, voice and samples of the real record
+    uint64_t sampleBytes = available - (uint64_t{ textLength } + 5) * 2; // Wraps, so the claimed lengths add up to available again
+    std::memcpy(&wrapped[record + 16], &textLength, 4);
+    std::memcpy(&wrapped[record + 24], &sampleBytes, 8);
+    AudioPack pack(wrapped.data(), wrapped.size());
+    CHECK(pack.Valid());
+    CHECK(pack.All().empty());
+}
+
+// Keys, the memory and disk tiers, and the on-disk pack of the synthesized audio cache
+int main() {
+    TestKeys();
+    TestLeastRecentlyUsed();
+    TestWarm();
+    TestDiskTier();
+    TestDamagedPack();
+    return CheckResult();
+}
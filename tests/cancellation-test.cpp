@@ -0,0 +1,74 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "cancellation.hpp"
+#include "latency-histogram.hpp"
+#include "check.hpp"
+
+// Threads take tokens and wait on them, half polling and half sleeping in WaitFor, while one thread cancels in a loop
+// Every token taken before a Cancel must observe it, no token may read as cancelled before one, and no sleeper may
+// miss its wakeup; the time from Cancel to each waiter noticing it is reported
+int main() {
+    const int rounds = 2000;
+    const unsigned waiters = 4;
+    CancellationSource source;
+    std::vector<std::atomic<int64_t>> cancelledAt(rounds + 2); // Steady clock ticks of the Cancel that produced each generation
+    LatencyHistogram pollWakeup, sleepWakeup;
+    std::atomic<bool> stopping{ false };
+    std::atomic<unsigned> running{ waiters }; // Waiters that have not returned yet
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < waiters; ++w) {
+        threads.emplace_back([&, sleeps = w % 2 == 1]() {
+            while (!stopping.load()) {
+                CancellationToken token = source.Token();
+                uint64_t generation = token.Generation();
+                bool cancelled;
+                if (sleeps) {
+                    cancelled = token.WaitFor(std::chrono::seconds(5)); // Cancels come every few hundred microseconds
+                }
+                else {
+                    auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                    while (!token.IsCancelled() && std::chrono::steady_clock::now() < giveUp) std::this_thread::yield();
+                    cancelled = token.IsCancelled();
+                }
+                auto woke = std::chrono::steady_clock::now();
+                CHECK(cancelled); // A timeout means a lost cancellation
+                if (!cancelled || generation + 1 >= cancelledAt.size()) continue;
+                int64_t at = 0;
+                while ((at = cancelledAt[generation + 1].load()) == 0) std::this_thread::yield(); // Stamped right after the bump
+                (sleeps ? sleepWakeup : pollWakeup).Record(woke - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(at)));
+            }
+            running.fetch_sub(1);
+        });
+    }
+
+    for (int round = 0; round < rounds; ++round) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200)); // Let the waiters take fresh tokens
+        CancellationToken before = source.Token();
+        CHECK(!before.IsCancelled());
+        auto requested = std::chrono::steady_clock::now();
+        uint64_t generation = source.Cancel();
+        cancelledAt[generation].store(requested.time_since_epoch().count());
+        CHECK(before.IsCancelled()); // Taken before the cancel, must see it
+        CHECK(!source.Token().IsCancelled()); // Taken after it, must not
+    }
+    stopping.store(true);
+    while (running.load()) { // Release the waiters, including any that took a token just before seeing stopping
+        auto requested = std::chrono::steady_clock::now();
+        uint64_t generation = source.Cancel();
+        if (generation < cancelledAt.size()) cancelledAt[generation].store(requested.time_since_epoch().count());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    CHECK(pollWakeup.Count() > 0);
+    CHECK(sleepWakeup.Count() > 0);
+    std::cout << "cancel-to-wakeup polling: n=" << pollWakeup.Count() << " p50=" << pollWakeup.PercentileMicros(0.50) << "us p99="
+        << pollWakeup.PercentileMicros(0.99) << "us max=" << pollWakeup.MaxMicros() << "us\n";
+    std::cout << "cancel-to-wakeup WaitFor: n=" << sleepWakeup.Count() << " p50=" << sleepWakeup.PercentileMicros(0.50) << "us p99="
+        << sleepWakeup.PercentileMicros(0.99) << "us max=" << sleepWakeup.MaxMicros() << "us\n";
+    return CheckResult();
+}
@@ -0,0 +1,28 @@
+#ifndef SIGHTSPEAK_TESTS_CHECK_HPP
+#define SIGHTSPEAK_TESTS_CHECK_HPP
+
+#include <atomic>
+#include <iostream>
+
+// Minimal checks for the portable tests, safe to use from several threads
+// A failed check is reported with its location and makes CheckResult non-zero, so ctest sees the failure
+inline std::atomic<int>& CheckFailures() {
+    static std::atomic<int> failures{ 0 };
+    return failures;
+}
+
+inline bool CheckThat(bool passed, const char* expression, const char* file, int line) {
+    if (!passed && CheckFailures().fetch_add(1) < 20) std::cerr << file << ":" << line << ": check failed: " << expression << "\n"; // The first few are enough
+    return passed;
+}
+
+#define CHECK(expression) CheckThat(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+// Exit code of a test: zero if every check passed
+inline int CheckResult() {
+    int failures = CheckFailures().load();
+    if (failures) std::cerr << failures << " check(s) failed\n";
+    return failures ? 1 : 0;
+}
+
+#endif // SIGHTSPEAK_TESTS_CHECK_HPP
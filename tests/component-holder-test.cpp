@@ -0,0 +1,94 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "component-holder.hpp"
+#include "check.hpp"
+
+// Stand-in for UI Automation or a voice that counts its live instances and fails calls once destroyed
+struct Component {
+    explicit Component(int generation) : generation(generation) { alive.fetch_add(1); }
+    ~Component() {
+        destroyed.store(true);
+        alive.fetch_sub(1);
+    }
+
+    bool Call() {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        return !destroyed.load();
+    }
+
+    static inline std::atomic<int> alive{ 0 }; // Instances not yet destroyed
+    int generation; // Order in which the instance was built
+    std::atomic<bool> destroyed{ false };
+    std::atomic<uint64_t> calls{ 0 };
+};
+
+void TestPublishAndRetire() {
+    {
+        ComponentHolder<Component> holder;
+        CHECK(!holder.Acquire()); // Nothing before the first Publish
+        CHECK(!holder.Publish(std::make_shared<Component>(1)));
+
+        auto held = holder.Acquire(); // A user in the middle of an operation
+        auto previous = holder.Publish(std::make_shared<Component>(2));
+        CHECK(previous == held);
+        previous.reset();
+        CHECK(holder.Acquire()->generation == 2);
+        CHECK(holder.Retiring() == 1);
+        CHECK(Component::alive == 2); // The old instance lives on for its user
+        held.reset();
+        CHECK(holder.Retiring() == 0);
+        CHECK(Component::alive == 1);
+
+        CHECK(!holder.Rebuild([] { return std::shared_ptr<Component>(); })); // A failed rebuild keeps the working instance
+        CHECK(holder.Acquire()->generation == 2);
+        CHECK(holder.Rebuild([] { return std::make_shared<Component>(3); }));
+        CHECK(holder.Acquire()->generation == 3);
+        CHECK(holder.Published() == 3);
+        CHECK(holder.Failed() == 1);
+    }
+    CHECK(Component::alive == 0);
+}
+
+// Readers call whatever instance is current while another thread keeps rebuilding it
+// No reader may ever find no instance or call into a destroyed one, and every replaced instance is freed in the end
+void TestRebuildUnderLoad() {
+    {
+        ComponentHolder<Component> holder;
+        holder.Publish(std::make_shared<Component>(0));
+        std::atomic<bool> stopping{ false };
+        std::atomic<uint64_t> failures{ 0 };
+        std::vector<std::thread> readers;
+        for (int reader = 0; reader < 4; ++reader) {
+            readers.emplace_back([&]() {
+                int lastGeneration = 0;
+                while (!stopping.load()) {
+                    auto component = holder.Acquire();
+                    if (!component || !component->Call() || component->generation < lastGeneration) failures.fetch_add(1);
+                    if (component) lastGeneration = component->generation; // Generations only move forward
+                    std::this_thread::yield();
+                }
+            });
+        }
+        for (int generation = 1; generation <= 200; ++generation) {
+            holder.Rebuild([generation] { return std::make_shared<Component>(generation); });
+            if (generation % 20 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        stopping.store(true);
+        for (std::thread& reader : readers) reader.join();
+        CHECK(failures == 0);
+        CHECK(holder.Retiring() == 0);
+        CHECK(Component::alive == 1);
+        CHECK(holder.Published() == 201);
+    }
+    CHECK(Component::alive == 0);
+}
+
+// Snapshot lifetimes of the holder UI Automation and the voice are rebuilt through
+int main() {
+    TestPublishAndRetire();
+    TestRebuildUnderLoad();
+    return CheckResult();
+}
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "cursor-prediction.hpp"
+#include "hover-scheduler.hpp"
+#include "check.hpp"
+
+// Hit test run for a replayed trace: when it ran, in milliseconds after the first sample, and for which position
+struct HitTestAt {
+    long millis;
+    long x;
+    long y;
+    bool operator==(const HitTestAt& other) const { return millis == other.millis && x == other.x && y == other.y; }
+};
+
+// Replay a recorded mouse path through a debouncer the way the hit-test thread drives it:
+// the pending sample is taken the moment its deadline passes, unless a newer sample arrives first
+std::vector<HitTestAt> Replay(const std::string& trace, HoverPolicy policy, uint64_t* dropped = nullptr) {
+    std::istringstream in(trace);
+    std::vector<CursorSample> samples = CursorTrace::Read(in);
+    HoverDebouncer debouncer(policy);
+    std::vector<HitTestAt> hitTests;
+    auto take = [&](std::chrono::steady_clock::time_point now) {
+        std::optional<CursorSample> due = debouncer.TakeDue(now);
+        CHECK(due.has_value());
+        if (due) hitTests.push_back({ static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count()), due->x, due->y });
+    };
+    for (const CursorSample& sample : samples) {
+        auto deadline = debouncer.Deadline();
+        if (deadline && *deadline < sample.time) {
+            CHECK(!debouncer.TakeDue(*deadline - std::chrono::milliseconds(1))); // Never early
+            take(*deadline);
+        }
+        debouncer.Offer(sample);
+    }
+    if (auto deadline = debouncer.Deadline()) take(*deadline);
+    CHECK(!debouncer.Deadline()); // Nothing left pending
+    if (dropped) *dropped = debouncer.Dropped();
+    return hitTests;
+}
+
+// Path from (fromX, y) to (toX, y) with one sample every stepMillis, as "ms x y" lines starting at startMillis
+std::string Sweep(long startMillis, long stepMillis, long fromX, long toX, long y, long stepPixels) {
+    std::ostringstream out;
+    long millis = startMillis;
+    for (long x = fromX; fromX <= toX ? x <= toX : x >= toX; x += fromX <= toX ? stepPixels : -stepPixels, millis += stepMillis) {
+        out << millis << ' ' << x << ' ' << y << '\n';
+    }
+    return out.str();
+}
+
+void TestRest() {
+    HoverPolicy policy; // 30 ms dwell, 120 ms cap, 3 px tolerance
+    CHECK((Replay("0 100 100\n", policy) == std::vector<HitTestAt>{ { 30, 100, 100 } }));
+
+    uint64_t dropped = 0; // Hand tremor within the tolerance does not restart the dwell, the newest position is tested
+    CHECK((Replay("0 100 100\n10 102 99\n20 101 102\n", policy, &dropped) == std::vector<HitTestAt>{ { 30, 101, 102 } }));
+    CHECK(dropped == 2);
+
+    CHECK((Replay("0 100 100\n20 110 100\n", policy) == std::vector<HitTestAt>{ { 50, 110, 100 } })); // A real move does
+    CHECK((Replay("0 100 100\n100 300 300\n", policy) == std::vector<HitTestAt>{ { 30, 100, 100 }, { 130, 300, 300 } }));
+}
+
+// A fast sweep across a toolbar and a stop on the target: one hit test, for where the cursor came to rest
+void TestFling() {
+    HoverPolicy policy;
+    uint64_t dropped = 0;
+    std::string trace = Sweep(0, 8, 0, 800, 50, 80) + "88 805 50\n"; // Overshoots a little and settles
+    CHECK((Replay(trace, policy, &dropped) == std::vector<HitTestAt>{ { 118, 805, 50 } }));
+    CHECK(dropped == 11);
+}
+
+// A slow continuous drag never rests, so the cap forces a hit test every maxDelay with the position at that time
+void TestSlowDrag() {
+    HoverPolicy policy;
+    std::vector<HitTestAt> hitTests = Replay(Sweep(0, 10, 0, 500, 200, 5), policy);
+    CHECK(hitTests.size() == 8);
+    if (hitTests.size() == 8) {
+        CHECK((hitTests[0] == HitTestAt{ 120, 60, 200 })); // Capped at the oldest pending sample plus maxDelay
+        CHECK((hitTests[1] == HitTestAt{ 250, 125, 200 })); // The next window opens with the first sample after a hit test
+        CHECK((hitTests[7] == HitTestAt{ 1030, 500, 200 })); // The drag ends, and the last position rests for the dwell
+    }
+
+    policy.maxDelay = std::chrono::milliseconds(1000); // Without a cap worth the name, nothing is tested until the end
+    CHECK((Replay(Sweep(0, 10, 0, 500, 200, 5), policy) == std::vector<HitTestAt>{ { 1000, 500, 200 } }));
+}
+
+// Replays of recorded and synthetic mouse paths through the hover debouncer with a synthetic clock
+int main() {
+    TestRest();
+    TestFling();
+    TestSlowDrag();
+    return CheckResult();
+}
@@ -0,0 +1,250 @@
+#include <chrono>
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "latency-trace.hpp"
+#include "check.hpp"
+
+// Parsed JSON value, just enough of JSON for the traces the tracer writes
+struct Json {
+    enum class Type { Null, Bool, Number, String, Array, Object } type{ Type::Null };
+    double number{ 0 };
+    std::string text;
+    std::vector<Json> items;
+    std::map<std::string, Json> fields;
+
+    const Json& operator[](const std::string& name) const {
+        static const Json missing;
+        auto found = fields.find(name);
+        return found == fields.end() ? missing : found->second;
+    }
+};
+
+// Strict recursive descent parser; ok turns false at the first malformed character
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& input) : input(input) {}
+
+    bool Parse(Json& value) {
+        ok = true;
+        position = 0;
+        value = Value();
+        Space();
+        return ok && position == input.size();
+    }
+
+private:
+    Json Value() {
+        Json value;
+        Space();
+        if (position >= input.size()) return Fail();
+        char c = input[position];
+        if (c == '{') {
+            value.type = Json::Type::Object;
+            ++position;
+            Space();
+            if (Take('}')) return value;
+            do {
+                Space();
+                Json name = String();
+                Space();
+                if (!Take(':')) return Fail();
+                value.fields[name.text] = Value();
+                Space();
+            } while (ok && Take(','));
+            if (!Take('}')) return Fail();
+        }
+        else if (c == '[') {
+            value.type = Json::Type::Array;
+            ++position;
+            Space();
+            if (Take(']')) return value;
+            do {
+                value.items.push_back(Value());
+                Space();
+            } while (ok && Take(','));
+            if (!Take(']')) return Fail();
+        }
+        else if (c == '"') value = String();
+        else if (input.compare(position, 4, "true") == 0 || input.compare(position, 5, "false") == 0) {
+            value.type = Json::Type::Bool;
+            value.number = c == 't';
+            position += c == 't' ? 4 : 5;
+        }
+        else if (input.compare(position, 4, "null") == 0) position += 4;
+        else if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) {
+            const char* begin = input.c_str() + position;
+            char* end = nullptr;
+            value.type = Json::Type::Number;
+            value.number = std::strtod(begin, &end);
+            position += end - begin;
+        }
+        else return Fail();
+        return value;
+    }
+
+    Json String() {
+        Json value;
+        value.type = Json::Type::String;
+        if (!Take('"')) return Fail();
+        while (position < input.size() && input[position] != '"') {
+            if (input[position] == '\\' || static_cast<unsigned char>(input[position]) < 0x20) return Fail(); // Never written by the tracer
+            value.text += input[position++];
+        }
+        if (!Take('"')) return Fail();
+        return value;
+    }
+
+    void Space() {
+        while (position < input.size() && std::isspace(static_cast<unsigned char>(input[position]))) ++position;
+    }
+
+    bool Take(char c) {
+        if (position >= input.size() || input[position] != c) return false;
+        ++position;
+        return true;
+    }
+
+    Json Fail() {
+        ok = false;
+        return Json();
+    }
+
+    const std::string& input;
+    size_t position{ 0 };
+    bool ok{ true };
+};
+
+// Events of a Chrome trace written by the tracer, empty if it is not valid JSON of the expected shape
+std::vector<Json> TraceEvents(const LatencyTracer& tracer) {
+    std::ostringstream out;
+    tracer.WriteChromeTrace(out);
+    Json trace;
+    if (!CHECK(JsonParser(out.str()).Parse(trace))) return {};
+    if (!CHECK(trace["traceEvents"].type == Json::Type::Array)) return {};
+    return trace["traceEvents"].items;
+}
+
+// Spans pick up the interaction made current by a scope, on whichever thread the scope is opened, and scopes nest
+void TestScopePropagation() {
+    LatencyTracer tracer;
+    InteractionRef hover = tracer.Begin(TraceOrigin::Hover);
+    InteractionRef navigate = tracer.Begin(TraceOrigin::Navigate);
+    CHECK(hover->id != navigate->id);
+    CHECK(!LatencyTracer::Current());
+    {
+        TraceScope scope(hover);
+        { TraceSpan span(tracer, TraceStage::HitTest); }
+        std::thread worker([&tracer, interaction = LatencyTracer::Current()]() {
+            CHECK(!LatencyTracer::Current()); // Nothing is inherited without a scope
+            TraceScope adopted(interaction);
+            TraceSpan span(tracer, TraceStage::Traversal);
+        });
+        worker.join();
+        {
+            TraceScope nested(navigate);
+            TraceSpan span(tracer, TraceStage::Navigate);
+        }
+        CHECK(LatencyTracer::Current() == hover);
+    }
+    CHECK(!LatencyTracer::Current());
+    { TraceSpan span(tracer, TraceStage::Enqueue); }
+
+    std::vector<Json> events = TraceEvents(tracer);
+    if (!CHECK(events.size() == 4)) return;
+    std::vector<std::pair<std::string, double>> spans;
+    for (const Json& event : events) spans.push_back({ event["name"].text, event["args"]["interaction"].number });
+    CHECK((spans == std::vector<std::pair<std::string, double>>{
+        { "HitTest", double(hover->id) }, { "Traversal", double(hover->id) }, { "Navigate", double(navigate->id) }, { "Enqueue", 0.0 } }));
+    CHECK(events[0]["tid"].number != events[1]["tid"].number); // Recorded on the worker
+    CHECK(tracer.Stage(TraceStage::Traversal).Count() == 1);
+}
+
+// Only the first audio sample of an interaction counts towards its latency
+void TestFirstAnswer() {
+    LatencyTracer tracer;
+    auto started = std::chrono::steady_clock::now();
+    InteractionRef hover = tracer.Begin(TraceOrigin::Hover, started);
+    tracer.Answer(hover, started + std::chrono::milliseconds(30));
+    tracer.Answer(hover, started + std::chrono::milliseconds(900));
+    tracer.Answer(nullptr);
+    const LatencyHistogram& latency = tracer.FirstAudio(TraceOrigin::Hover);
+    CHECK(latency.Count() == 1);
+    CHECK(latency.MaxMicros() >= 30000 && latency.MaxMicros() < 900000);
+    CHECK(tracer.FirstAudio(TraceOrigin::Navigate).Count() == 0);
+    CHECK(tracer.Recorded() == 1);
+}
+
+// A full ring keeps the most recent events, oldest first, while the count includes the overwritten ones
+void TestRingOverwrite() {
+    LatencyTracer tracer(4);
+    auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; ++i) {
+        InteractionRef interaction = tracer.Begin(TraceOrigin::Navigate, now);
+        tracer.Record(TraceStage::Dispatch, interaction, now, now + std::chrono::microseconds(i));
+    }
+    CHECK(tracer.Recorded() == 10);
+    CHECK(tracer.Stage(TraceStage::Dispatch).Count() == 10);
+    std::vector<Json> events = TraceEvents(tracer);
+    std::vector<double> kept;
+    for (const Json& event : events) kept.push_back(event["args"]["interaction"].number);
+    CHECK((kept == std::vector<double>{ 7, 8, 9, 10 }));
+}
+
+// Exported traces are valid JSON, each answered interaction a b/e pair with one id, in order, around its spans
+void TestChromeTrace() {
+    LatencyTracer tracer;
+    auto now = std::chrono::steady_clock::now();
+    std::vector<InteractionRef> interactions;
+    for (int i = 0; i < 5; ++i) {
+        interactions.push_back(tracer.Begin(i % 2 ? TraceOrigin::Navigate : TraceOrigin::Hover, now + std::chrono::milliseconds(i)));
+        tracer.Record(TraceStage::Synthesis, interactions.back(), now + std::chrono::milliseconds(i + 1), now + std::chrono::milliseconds(i + 2));
+    }
+    for (const InteractionRef& interaction : interactions) tracer.Answer(interaction, interaction->started + std::chrono::microseconds(2500));
+    tracer.Answer(interactions[0]);
+
+    std::vector<Json> events = TraceEvents(tracer);
+    CHECK(events.size() == 5 + 2 * 5);
+    std::map<double, const Json*> begun;
+    size_t pairs = 0, spans = 0;
+    for (const Json& event : events) {
+        const std::string& phase = event["ph"].text;
+        CHECK(event["ts"].type == Json::Type::Number && event["pid"].number == 1);
+        if (phase == "X") {
+            CHECK(event["cat"].text == "stage" && event["name"].text == "Synthesis");
+            CHECK(event["dur"].number > 999 && event["dur"].number < 1001);
+            ++spans;
+        }
+        else if (phase == "b") {
+            CHECK(begun.count(event["id"].number) == 0);
+            begun[event["id"].number] = &event;
+        }
+        else if (CHECK(phase == "e")) {
+            auto found = begun.find(event["id"].number);
+            if (!CHECK(found != begun.end())) continue;
+            const Json& begin = *found->second;
+            CHECK(begin["name"].text == event["name"].text);
+            CHECK(event["ts"].number - begin["ts"].number > 2499 && event["ts"].number - begin["ts"].number < 2501);
+            begun.erase(found);
+            ++pairs;
+        }
+    }
+    CHECK(spans == 5);
+    CHECK(pairs == 5);
+    CHECK(begun.empty());
+    CHECK(events.size() > 6 && events[5]["ph"].text == "b" && events[5]["name"].text == "Hover" && events[7]["name"].text == "Navigate");
+}
+
+// Interaction propagation, first-audio latency, the event ring and Chrome trace export of the latency tracer
+int main() {
+    TestScopePropagation();
+    TestFirstAnswer();
+    TestRingOverwrite();
+    TestChromeTrace();
+    return CheckResult();
+}
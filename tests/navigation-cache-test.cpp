@@ -0,0 +1,223 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "navigation-cache.hpp"
+#include "check.hpp"
+
+// Root 0 with children 1, 2 and 3; 1 has children 4 and 5, 2 has child 6
+void BuildTree(MockElementProvider& provider) {
+    int root = provider.AddElement(-1, L"window", { 0, 0, 400, 300 });
+    int first = provider.AddElement(root, L"toolbar", { 0, 0, 400, 30 });
+    int second = provider.AddElement(root, L"list", { 0, 30, 400, 270 });
+    provider.AddElement(root, L"status", { 0, 270, 400, 300 });
+    provider.AddElement(first, L"open", { 0, 0, 30, 30 });
+    provider.AddElement(first, L"save", { 30, 0, 60, 30 });
+    provider.AddElement(second, L"item", { 0, 30, 400, 50 });
+}
+
+// Elements the cursor arrived at, by mock index, in order
+struct Arrivals {
+    NavigationCache::Arrive Callback() {
+        return [this](const ElementHandle& element) {
+            std::lock_guard<std::mutex> lock(mutex);
+            indices.push_back(*static_cast<const int*>(element.get()));
+            cv.notify_all();
+        };
+    }
+
+    // Arrivals once there are at least count of them, or whatever came within the timeout
+    std::vector<int> Wait(size_t count, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, timeout, [&] { return indices.size() >= count; });
+        return indices;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<int> indices;
+};
+
+// Prefetches on threads of their own, started at once or held back until released
+struct Workers {
+    explicit Workers(bool deferred = false) : deferred(deferred) {}
+
+    NavigationCache::Launcher Launcher() {
+        return [this](std::function<void()> prefetch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (deferred) held.push_back(std::move(prefetch));
+            else threads.emplace_back(std::move(prefetch));
+        };
+    }
+
+    // Start every prefetch held back so far
+    void Release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::function<void()>& prefetch : held) threads.emplace_back(std::move(prefetch));
+        held.clear();
+    }
+
+    size_t Held() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return held.size();
+    }
+
+    // Wait until at least count prefetches are held back
+    bool WaitHeld(size_t count) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (Held() < count) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    ~Workers() {
+        Release();
+        for (std::thread& thread : threads) thread.join();
+    }
+
+    bool deferred;
+    std::mutex mutex;
+    std::vector<std::function<void()>> held;
+    std::vector<std::thread> threads;
+};
+
+// Wait until the provider has seen at least count round trips
+bool WaitRoundTrips(const MockElementProvider& provider, size_t count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (provider.RoundTrips() < count) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+bool Contains(const std::wstring& text, const std::wstring& part) { return text.find(part) != std::wstring::npos; }
+
+// Moves follow the parent, child and sibling relations of the tree, and with the neighbors prefetched after every
+// move, including the links back to where the cursor came from, none of them waits for a fetch
+void TestMoves() {
+    MockElementProvider provider;
+    BuildTree(provider);
+    Arrivals arrivals;
+    NavigationCache cache(provider, arrivals.Callback());
+    CHECK(!cache.Queue(NavigationMove::FirstChild)); // No cursor yet
+
+    cache.SetCurrent(provider.Handle(1), true);
+    for (NavigationMove move : { NavigationMove::FirstChild, NavigationMove::NextSibling, NavigationMove::NextSibling, NavigationMove::Parent,
+        NavigationMove::NextSibling, NavigationMove::FirstChild, NavigationMove::PreviousSibling, NavigationMove::Parent,
+        NavigationMove::PreviousSibling, NavigationMove::Parent, NavigationMove::Parent }) {
+        CHECK(cache.Queue(move));
+    }
+    std::vector<int> visited = arrivals.Wait(8);
+    CHECK((visited == std::vector<int>{ 4, 5, 1, 2, 6, 2, 1, 0 })); // Past the last sibling, before the first child and above the root there is nothing
+    cache.Queue(NavigationMove::FirstChild); // Lands after the moves before it, so they were all applied
+    CHECK((arrivals.Wait(9) == std::vector<int>{ 4, 5, 1, 2, 6, 2, 1, 0, 1 }));
+    std::wstring stats = cache.Describe();
+    CHECK(Contains(stats, L"misses=0 "));
+    CHECK(Contains(stats, L"blocked=0 "));
+    CHECK(cache.Latency().Count() == 9);
+}
+
+// A mouse move or tree change during a prefetch starts a new graph around the cursor, and what the old prefetch
+// fetched is dropped
+void TestReset() {
+    MockElementProvider provider;
+    BuildTree(provider);
+    provider.SetCallLatency(std::chrono::milliseconds(40)); // 160 ms per neighbor fetch
+    Workers workers;
+    Arrivals arrivals;
+    NavigationCache cache(provider, arrivals.Callback(), workers.Launcher());
+
+    cache.SetCurrent(provider.Handle(1), true);
+    CHECK(WaitRoundTrips(provider, 4)); // Neighbors of 1 on their way
+    cache.SetCurrent(provider.Handle(6), false);
+    cache.Queue(NavigationMove::Parent);
+    CHECK((arrivals.Wait(1) == std::vector<int>{ 2 }));
+    CHECK(Contains(cache.Describe(), L"misses=1 "));
+
+    CHECK(WaitRoundTrips(provider, 12)); // The prefetch around 2, after the dropped one and the miss
+    cache.Invalidate();
+    cache.Queue(NavigationMove::NextSibling);
+    CHECK((arrivals.Wait(2) == std::vector<int>{ 2, 3 }));
+    CHECK(Contains(cache.Describe(), L"misses=2 "));
+}
+
+// A keypress arriving while the prefetch it needs is in flight waits for that prefetch instead of fetching again
+void TestBlockedMove() {
+    MockElementProvider provider;
+    BuildTree(provider);
+    provider.SetCallLatency(std::chrono::milliseconds(40));
+    Workers workers;
+    Arrivals arrivals;
+    NavigationCache cache(provider, arrivals.Callback(), workers.Launcher());
+    cache.SetCurrent(provider.Handle(0), true);
+    CHECK(WaitRoundTrips(provider, 4));
+    cache.Queue(NavigationMove::FirstChild);
+    CHECK((arrivals.Wait(1) == std::vector<int>{ 1 }));
+    std::wstring stats = cache.Describe();
+    CHECK(Contains(stats, L"blocked=1 "));
+    CHECK(Contains(stats, L"misses=0 "));
+}
+
+// Stop waits for prefetches queued on workers, which then skip their fetches, and for a fetch in flight
+void TestStop() {
+    MockElementProvider provider;
+    BuildTree(provider);
+    {
+        Workers workers(true);
+        Arrivals arrivals;
+        NavigationCache cache(provider, arrivals.Callback(), workers.Launcher());
+        cache.SetCurrent(provider.Handle(0), true);
+        cache.Queue(NavigationMove::FirstChild);
+        CHECK((arrivals.Wait(1) == std::vector<int>{ 1 }));
+        CHECK(workers.WaitHeld(2)); // Around the root, and around the element arrived at once the move is done
+        CHECK(workers.Held() == 2);
+        size_t before = provider.RoundTrips();
+
+        std::atomic<bool> stopped{ false };
+        std::thread stopper([&]() {
+            cache.Stop();
+            stopped = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(!stopped);
+        workers.Release();
+        stopper.join();
+        CHECK(provider.RoundTrips() == before);
+        CHECK(!cache.Queue(NavigationMove::NextSibling));
+        cache.SetCurrent(provider.Handle(2), true);
+        CHECK(workers.Held() == 0);
+    }
+
+    provider.SetCallLatency(std::chrono::milliseconds(25));
+    provider.ResetRoundTrips();
+    Workers workers;
+    Arrivals arrivals;
+    {
+        NavigationCache cache(provider, arrivals.Callback(), workers.Launcher());
+        cache.SetCurrent(provider.Handle(0), true);
+        CHECK(WaitRoundTrips(provider, 4));
+        cache.Stop(); // Returns once the fetch in flight is back, without the fetches of the neighbors after it
+    }
+    size_t stoppedAt = provider.RoundTrips();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(stoppedAt == 4);
+    CHECK(provider.RoundTrips() == stoppedAt);
+    CHECK(arrivals.Wait(1, std::chrono::milliseconds(0)).empty());
+}
+
+// Moves, graph resets and shutdown of the prefetching navigation cache
+int main() {
+    TestMoves();
+    TestReset();
+    TestBlockedMove();
+    TestStop();
+    return CheckResult();
+}
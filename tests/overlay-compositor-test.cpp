@@ -0,0 +1,162 @@
+#include <cstdint>
+#include <vector>
+#include "overlay-compositor.hpp"
+#include "check.hpp"
+
+constexpr long Size = 200; // Width and height of the test framebuffers
+
+// Framebuffer that also keeps the dirty areas of every frame it presents
+class RecordingSurface : public FramebufferSurface {
+public:
+    RecordingSurface() : FramebufferSurface(0, 0, Size, Size) {}
+
+    void Present(const std::vector<OverlayHighlight>& scene, const std::vector<ElementRect>& dirty) override {
+        presented.push_back(dirty);
+        FramebufferSurface::Present(scene, dirty);
+    }
+
+    std::vector<std::vector<ElementRect>> presented; // Dirty areas by frame
+};
+
+// Pixels covered by any of the rectangles, row by row
+std::vector<bool> Covered(const std::vector<ElementRect>& rects) {
+    std::vector<bool> covered(Size * Size, false);
+    for (const ElementRect& rect : rects) {
+        ElementRect clipped = ClipRect(rect, { 0, 0, Size, Size });
+        for (long y = clipped.top; y < clipped.bottom; ++y) {
+            for (long x = clipped.left; x < clipped.right; ++x) covered[y * Size + x] = true;
+        }
+    }
+    return covered;
+}
+
+// Whether the surface shows exactly the scene, as a full repaint of it would
+bool Shows(const FramebufferSurface& surface, const std::vector<OverlayHighlight>& scene) {
+    FramebufferSurface reference(0, 0, Size, Size);
+    reference.Present(scene, { reference.Bounds() });
+    for (long y = 0; y < Size; ++y) {
+        for (long x = 0; x < Size; ++x) {
+            if (surface.Pixel(x, y) != reference.Pixel(x, y)) return false;
+        }
+    }
+    return true;
+}
+
+// Moving a highlight repaints the outline strips it left and entered, and no pixel of the highlights that stayed
+void TestRepaintedStrips() {
+    RecordingSurface surface;
+    OverlayCompositor compositor(surface);
+    OverlayHighlight moving{ 1, { 10, 10, 60, 40 }, 0xFFFF0000, 2 };
+    OverlayHighlight still{ 2, { 100, 100, 150, 150 }, 0xFF00FF00, 3 };
+    compositor.Show(moving);
+    compositor.Show(still);
+    CHECK(compositor.ComposeFrame());
+    CHECK(Shows(surface, { moving, still }));
+    CHECK(surface.Pixel(10, 10) == 0xFFFF0000);
+    CHECK(surface.Pixel(30, 25) == 0); // Inside the outline
+
+    std::vector<ElementRect> changed = OutlineStrips(moving.rect, moving.thickness);
+    moving.rect = { 20, 15, 70, 45 };
+    for (const ElementRect& strip : OutlineStrips(moving.rect, moving.thickness)) changed.push_back(strip);
+    compositor.Show(moving);
+    uint64_t dirtyBefore = compositor.DirtyPixels();
+    CHECK(compositor.ComposeFrame());
+    CHECK(Shows(surface, { moving, still }));
+
+    std::vector<bool> strips = Covered(changed);
+    std::vector<bool> repainted = Covered(surface.presented.back());
+    std::vector<bool> kept = Covered(OutlineStrips(still.rect, still.thickness));
+    uint64_t stripPixels = 0;
+    bool covered = true, untouched = true;
+    for (size_t pixel = 0; pixel < strips.size(); ++pixel) {
+        stripPixels += strips[pixel];
+        covered = covered && (!strips[pixel] || repainted[pixel]);
+        untouched = untouched && !(kept[pixel] && repainted[pixel]);
+    }
+    CHECK(covered);
+    CHECK(untouched);
+    uint64_t dirty = compositor.DirtyPixels() - dirtyBefore;
+    CHECK(dirty >= stripPixels);
+    CHECK(dirty <= stripPixels * 2); // Merging overlapping strips adds little, never the whole outline box
+    CHECK(dirty < 50 * 30);
+
+    compositor.Show(moving); // Showing the same highlight again is a change, but paints nothing
+    uint64_t frames = surface.presented.size();
+    CHECK(compositor.ComposeFrame());
+    CHECK(surface.presented.size() == frames);
+}
+
+// A burst of moves requests a single frame, which paints only where the highlight ended up
+void TestBurstCoalesces() {
+    RecordingSurface surface;
+    int requests = 0;
+    OverlayCompositor compositor(surface, [&requests]() { ++requests; });
+    OverlayHighlight highlight{ 1, {}, 0xFF0000FF, 2 };
+    for (long step = 0; step < 100; ++step) {
+        highlight.rect = { step, step, step + 40, step + 20 };
+        compositor.Show(highlight);
+    }
+    compositor.Show({ 2, { 0, 150, 50, 190 }, 0xFFFFFFFF, 2 }); // Shown and hidden before any frame
+    compositor.Hide(2);
+    CHECK(requests == 1);
+
+    CHECK(compositor.ComposeFrame());
+    CHECK(compositor.Frames() == 1);
+    CHECK(compositor.Changes() == 102);
+    CHECK(surface.presented.size() == 1);
+    CHECK(Shows(surface, { highlight }));
+    CHECK(compositor.DirtyPixels() <= 2 * (2 * 40 * 2 + 2 * 16 * 2));
+    CHECK(surface.Pixel(10, 10) == 0); // An earlier position was never painted
+    CHECK(surface.Pixel(0, 150) == 0);
+
+    CHECK(!compositor.ComposeFrame());
+    CHECK(compositor.Frames() == 1);
+    highlight.rect = { 5, 5, 45, 25 };
+    compositor.Show(highlight); // Changes after a frame request the next one
+    CHECK(requests == 2);
+}
+
+// Many scattered changes are presented as their bounding box rather than as dozens of strips
+void TestScatteredChanges() {
+    RecordingSurface surface;
+    OverlayCompositor compositor(surface);
+    std::vector<OverlayHighlight> scene;
+    for (uint32_t id = 0; id < 16; ++id) {
+        long x = static_cast<long>(id % 4) * 50, y = static_cast<long>(id / 4) * 50;
+        scene.push_back({ id, { x + 5, y + 5, x + 45, y + 35 }, 0xFF808080, 2 });
+        compositor.Show(scene.back());
+    }
+    CHECK(compositor.ComposeFrame());
+    CHECK(surface.presented.size() == 1 && surface.presented[0].size() == 1);
+    CHECK(Shows(surface, scene));
+}
+
+// HideAll clears every outline from the surface, and once hidden there is nothing left to change
+void TestHideAll() {
+    RecordingSurface surface;
+    int requests = 0;
+    OverlayCompositor compositor(surface, [&requests]() { ++requests; });
+    compositor.Show({ 1, { 10, 10, 60, 40 }, 0xFFFF0000, 2 });
+    compositor.Show({ 2, { 30, 20, 90, 80 }, 0xFF00FF00, 4 });
+    compositor.Show({ 3, { 150, 150, 154, 154 }, 0xFF0000FF, 3 }); // Thick enough to fill its rectangle
+    CHECK(compositor.ComposeFrame());
+    CHECK(surface.Pixel(152, 152) == 0xFF0000FF);
+
+    compositor.HideAll();
+    CHECK(compositor.ComposeFrame());
+    CHECK(Shows(surface, {}));
+    requests = 0;
+    compositor.HideAll();
+    compositor.Hide(1);
+    CHECK(requests == 0);
+    CHECK(!compositor.ComposeFrame());
+}
+
+// Dirty areas, frame coalescing and clearing of the retained highlight compositor
+int main() {
+    TestRepaintedStrips();
+    TestBurstCoalesces();
+    TestScatteredChanges();
+    TestHideAll();
+    return CheckResult();
+}
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "element-provider.hpp"
+#include "parallel-traversal.hpp"
+#include "check.hpp"
+
+// Random tree whose elements are named by index
+void BuildRandomTree(MockElementProvider& provider, int count, unsigned seed) {
+    std::mt19937 random(seed);
+    provider.AddElement(-1, L"0", ElementRect{ 0, 0, 100, 100 });
+    for (int i = 1; i < count; ++i) {
+        int parent = std::uniform_int_distribution<int>(std::max(0, i - 12), i - 1)(random);
+        provider.AddElement(parent, std::to_wstring(i), ElementRect{ 0, 0, 10, 10 });
+    }
+}
+
+// Helpers as real threads, joined by the test once it has checked what it wants
+struct Threads {
+    ParallelFrontier::Launcher Launcher() {
+        return [this](std::function<void()> help) { threads.emplace_back(std::move(help)); };
+    }
+
+    void Join() {
+        for (std::thread& thread : threads) thread.join();
+        threads.clear();
+    }
+
+    std::vector<std::thread> threads;
+};
+
+// The reader alone: Await fetches on the calling thread, and children carry their index path as key
+void TestAwaitWithoutHelpers() {
+    MockElementProvider provider;
+    int root = provider.AddElement(-1, L"root", ElementRect{ 0, 0, 10, 10 });
+    int first = provider.AddElement(root, L"first", ElementRect{ 0, 0, 10, 10 });
+    provider.AddElement(root, L"second", ElementRect{ 0, 0, 10, 10 });
+    provider.AddElement(first, L"below", ElementRect{ 0, 0, 10, 10 });
+
+    ParallelFrontier frontier(provider, 32, 0);
+    auto node = frontier.Start(provider.Handle(root));
+    frontier.Await(node);
+    CHECK(node->state.load() == ParallelFrontier::Fetched);
+    CHECK(node->snapshot.name == L"root");
+    CHECK(node->key.empty());
+    CHECK(node->children.size() == 2);
+    if (node->children.size() == 2) {
+        CHECK(node->children[1]->key == std::vector<uint32_t>{ 1 });
+        frontier.Await(node->children[0]);
+        CHECK(node->children[0]->children.size() == 1);
+        CHECK((node->children[0]->children[0]->key == std::vector<uint32_t>{ 0, 0 }));
+    }
+    frontier.Stop();
+    CHECK(frontier.Stolen() == 0);
+}
+
+// Every element is fetched exactly once however the helpers race the reader, so the calls match a serial walk
+void TestFetchedOnce() {
+    for (size_t helpers : { 1, 3, 6 }) {
+        MockElementProvider provider;
+        BuildRandomTree(provider, 300, static_cast<unsigned>(helpers));
+        TraverseSubtree(provider, provider.Handle(0), 1000, TraversalMode::Live, [](const ElementSnapshot&) { return true; });
+        size_t serial = provider.RoundTrips();
+
+        provider.ResetRoundTrips();
+        provider.SetCallLatency(std::chrono::microseconds(20));
+        Threads threads;
+        size_t visited = 0;
+        CHECK(ParallelTraverseSubtree(provider, provider.Handle(0), 1000, helpers, threads.Launcher(), [&](const ElementSnapshot&) { ++visited; return true; }));
+        threads.Join();
+        CHECK(visited == 300);
+        CHECK(provider.RoundTrips() == serial);
+    }
+}
+
+// A visitor that stops early ends the walk: Stop waits for fetches in flight, after which no helper calls the provider
+void TestStopEndsHelpers() {
+    MockElementProvider provider;
+    BuildRandomTree(provider, 400, 7);
+    provider.SetCallLatency(std::chrono::microseconds(50));
+    Threads threads;
+    int visited = 0;
+    CHECK(!ParallelTraverseSubtree(provider, provider.Handle(0), 32, 3, threads.Launcher(), [&](const ElementSnapshot&) { return ++visited < 10; }));
+    size_t calls = provider.RoundTrips();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(provider.RoundTrips() == calls);
+    threads.Join();
+    CHECK(visited == 10);
+}
+
+// Helpers that only get a worker after the walk ended return at once, without touching the provider
+void TestLateHelpers() {
+    std::vector<std::function<void()>> deferred;
+    size_t calls = 0;
+    {
+        MockElementProvider provider;
+        BuildRandomTree(provider, 50, 3);
+        ParallelFrontier::Launcher later = [&deferred](std::function<void()> help) { deferred.push_back(std::move(help)); };
+        size_t visited = 0;
+        CHECK(ParallelTraverseSubtree(provider, provider.Handle(0), 1000, 4, later, [&](const ElementSnapshot&) { ++visited; return true; }));
+        CHECK(visited == 50); // The reader fetched everything itself
+        calls = provider.RoundTrips();
+    } // The provider is gone before the helpers run
+    CHECK(deferred.size() == 4);
+    CHECK(calls > 0);
+    for (const std::function<void()>& help : deferred) help();
+}
+
+// Fetch, steal and shutdown behaviour of the frontier behind the parallel live walk
+int main() {
+    TestAwaitWithoutHelpers();
+    TestFetchedOnce();
+    TestStopEndsHelpers();
+    TestLateHelpers();
+    return CheckResult();
+}
@@ -0,0 +1,138 @@
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <random>
+#include "spatial-index.hpp"
+#include "check.hpp"
+
+// Rectangles by id, resolved by looking at every one
+class BruteForceIndex {
+public:
+    void Insert(uint32_t id, const ElementRect& rect) {
+        rects.erase(id);
+        if (rect.right > rect.left && rect.bottom > rect.top) rects[id] = rect;
+    }
+
+    bool Remove(uint32_t id) { return rects.erase(id) > 0; }
+
+    size_t RemoveIntersecting(const ElementRect& area) {
+        if (area.right <= area.left || area.bottom <= area.top) return 0;
+        size_t removed = 0;
+        for (auto entry = rects.begin(); entry != rects.end();) {
+            const ElementRect& rect = entry->second;
+            if (rect.left < area.right && area.left < rect.right && rect.top < area.bottom && area.top < rect.bottom) {
+                entry = rects.erase(entry);
+                ++removed;
+            }
+            else ++entry;
+        }
+        return removed;
+    }
+
+    std::optional<uint32_t> Query(long x, long y) const {
+        std::optional<uint32_t> best;
+        long long bestArea = 0;
+        for (const auto& [id, rect] : rects) { // Ascending ids, so a later id of equal area wins
+            if (x < rect.left || x >= rect.right || y < rect.top || y >= rect.bottom) continue;
+            long long area = static_cast<long long>(rect.right - rect.left) * (rect.bottom - rect.top);
+            if (!best || area <= bestArea) {
+                best = id;
+                bestArea = area;
+            }
+        }
+        return best;
+    }
+
+    size_t Size() const { return rects.size(); }
+
+private:
+    std::map<uint32_t, ElementRect> rects;
+};
+
+// Rectangle of random size anywhere on two monitors, sometimes empty and sometimes too large for the grid
+ElementRect RandomRect(std::mt19937& random) {
+    std::uniform_int_distribution<long> x(-600, 600), y(-400, 400), size(0, 120);
+    long left = x(random), top = y(random);
+    long width = size(random), height = size(random);
+    if (random() % 16 == 0) width *= 8; // Spans more cells than the index copies a rectangle into
+    if (random() % 32 == 0) height = 0; // No area, never returned
+    return { left, top, left + width, top + height };
+}
+
+// Query random points and the edges of a rectangle in both indices; returns the number of disagreements
+size_t Compare(const SpatialIndex& index, const BruteForceIndex& model, std::mt19937& random, const ElementRect& edges) {
+    size_t disagreements = 0;
+    auto check = [&](long x, long y) {
+        if (index.Query(x, y) != model.Query(x, y)) ++disagreements;
+    };
+    std::uniform_int_distribution<long> x(-700, 1700), y(-500, 1100);
+    for (int i = 0; i < 200; ++i) check(x(random), y(random));
+    for (long dx : { -1L, 0L, 1L }) { // Right and bottom edges are exclusive
+        check(edges.left + dx, edges.top);
+        check(edges.right + dx - 1, edges.bottom - 1);
+        check(edges.right + dx, edges.bottom + dx);
+    }
+    return disagreements;
+}
+
+// Insert, replace, remove and clear at random against the brute-force index, with several grid settings
+void TestAgainstBruteForce(long cellSize, size_t maxCellsPerRect, unsigned seed) {
+    std::mt19937 random(seed);
+    SpatialIndex index(cellSize, maxCellsPerRect);
+    BruteForceIndex model;
+    size_t disagreements = 0;
+    for (int step = 0; step < 4000; ++step) {
+        uint32_t id = random() % 500;
+        ElementRect rect = RandomRect(random);
+        switch (random() % 10) {
+        case 0:
+        case 1:
+            CHECK(index.Remove(id) == model.Remove(id));
+            break;
+        case 2:
+            if (random() % 20 == 0) CHECK(index.RemoveIntersecting(rect) == model.RemoveIntersecting(rect)); // Drops whole screen areas
+            break;
+        default:
+            index.Insert(id, rect); // Replaces the rectangle already stored under the id, if any
+            model.Insert(id, rect);
+            break;
+        }
+        CHECK(index.Size() == model.Size());
+        if (step % 50 == 0) disagreements += Compare(index, model, random, rect);
+        if (step == 2500) {
+            index.Clear();
+            model = BruteForceIndex();
+        }
+    }
+    CHECK(disagreements == 0);
+}
+
+void TestSmallestWins() {
+    SpatialIndex index(64, 4);
+    index.Insert(1, { 0, 0, 1000, 1000 }); // Oversized, kept outside the grid
+    index.Insert(2, { 100, 100, 200, 200 });
+    index.Insert(3, { 120, 120, 140, 140 });
+    index.Insert(4, { 120, 120, 140, 140 }); // Same area, found deeper, wins the tie
+    CHECK(index.Query(130, 130) == std::optional<uint32_t>(4));
+    CHECK(index.Query(150, 150) == std::optional<uint32_t>(2));
+    CHECK(index.Query(500, 500) == std::optional<uint32_t>(1));
+    CHECK(!index.Query(1000, 1000)); // Outside every rectangle, right and bottom edges excluded
+
+    CHECK(index.Remove(4));
+    CHECK(!index.Remove(4));
+    CHECK(index.Query(130, 130) == std::optional<uint32_t>(3));
+    index.Insert(3, { -50, -50, -10, -10 }); // Moved to a monitor left of and above the primary one
+    CHECK(index.Query(130, 130) == std::optional<uint32_t>(2));
+    CHECK(index.Query(-20, -20) == std::optional<uint32_t>(3));
+    CHECK(index.RemoveIntersecting({ 90, 90, 110, 110 }) == 2); // The oversized pane and the one below the area
+    CHECK(index.Size() == 1);
+}
+
+// Queries of the grid index must match a scan of every rectangle after any sequence of updates
+int main() {
+    TestSmallestWins();
+    TestAgainstBruteForce(64, 256, 1);
+    TestAgainstBruteForce(16, 4, 2); // Small cells, many rectangles in the oversized list
+    TestAgainstBruteForce(4, 2000, 3); // Tiny cells, every rectangle copied into many
+    return CheckResult();
+}
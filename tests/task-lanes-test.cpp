@@ -0,0 +1,53 @@
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "task-lanes.hpp"
+#include "check.hpp"
+
+// Every worker of every lane runs the init hook once, before any task, and tasks find it already done on their thread
+void TestWorkerInit() {
+    std::mutex mutex;
+    std::vector<std::pair<TaskLane, std::thread::id>> inits;
+    {
+        TaskLanes lanes(3, 2, [&](TaskLane lane) {
+            std::lock_guard<std::mutex> lock(mutex);
+            inits.push_back({ lane, std::this_thread::get_id() });
+            }, 4);
+        std::atomic<int> uninitialized{ 0 };
+        std::vector<std::future<void>> done;
+        for (int task = 0; task < 50; ++task) {
+            for (TaskLane lane : { TaskLane::Interactive, TaskLane::Background, TaskLane::Helper }) {
+                done.push_back(lanes.Submit(lane, [&, lane]() {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    bool found = false;
+                    for (const auto& [initLane, thread] : inits) found = found || (initLane == lane && thread == std::this_thread::get_id());
+                    if (!found) uninitialized.fetch_add(1);
+                }));
+            }
+        }
+        for (std::future<void>& task : done) task.get();
+        CHECK(uninitialized == 0);
+    }
+
+    std::set<std::thread::id> threads;
+    int perLane[3] = { 0, 0, 0 };
+    for (const auto& [lane, thread] : inits) {
+        threads.insert(thread);
+        ++perLane[static_cast<int>(lane)];
+    }
+    CHECK(inits.size() == 9); // Once per worker, never per task
+    CHECK(threads.size() == 9); // Lanes never share a worker
+    CHECK(perLane[static_cast<int>(TaskLane::Interactive)] == 3);
+    CHECK(perLane[static_cast<int>(TaskLane::Background)] == 2);
+    CHECK(perLane[static_cast<int>(TaskLane::Helper)] == 4);
+}
+
+// Per-worker setup of the interactive, background and helper lanes
+int main() {
+    TestWorkerInit();
+    return CheckResult();
+}
@@ -0,0 +1,62 @@
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "text-arena.hpp"
+#include "check.hpp"
+
+// Interned texts are equal, terminated copies that stay in place while later texts fill and add blocks
+void TestIntern() {
+    TextArena arena;
+    std::wstring source = L"Save as";
+    std::wstring_view saved = arena.Intern(source);
+    source = L"changed";
+    CHECK(saved == L"Save as");
+    CHECK(saved.data()[saved.size()] == L'\0');
+    CHECK(arena.Intern(L"").empty());
+
+    std::vector<std::wstring> texts;
+    std::vector<std::wstring_view> views;
+    for (int i = 0; i < 5000; ++i) {
+        texts.push_back(L"item " + std::to_wstring(i) + std::wstring(i % 17, L'x'));
+        views.push_back(arena.Intern(texts.back()));
+    }
+    std::wstring huge(TextBlockPool::BlockChars + 10, L'h'); // Too long for a block
+    std::wstring_view hugeView = arena.Intern(huge);
+    bool intact = saved == L"Save as" && hugeView == huge;
+    for (size_t i = 0; i < texts.size(); ++i) intact = intact && views[i] == texts[i];
+    CHECK(intact);
+
+    const TextArenaStats& stats = arena.Stats();
+    CHECK(stats.texts == 5003);
+    CHECK(stats.allocations > 2); // Several blocks and the oversized text
+    CHECK(stats.reused == 0);
+    CHECK(stats.usedBytes <= stats.reservedBytes);
+}
+
+// Arenas of later traversals take their blocks from the pool instead of the heap, up to the pool limit
+void TestPool() {
+    auto pool = std::make_shared<TextBlockPool>(2);
+    {
+        TextArena arena(pool);
+        for (int i = 0; i < 3; ++i) arena.Intern(std::wstring(TextBlockPool::BlockChars - 1, L'a')); // One block each
+        arena.Intern(std::wstring(TextBlockPool::BlockChars + 1, L'b')); // Oversized, never pooled
+        CHECK(arena.Stats().allocations == 4);
+    }
+    CHECK(pool->Free() == 2);
+
+    TextArena next(pool);
+    next.Intern(std::wstring(TextBlockPool::BlockChars - 1, L'c'));
+    next.Intern(std::wstring(TextBlockPool::BlockChars - 1, L'd'));
+    next.Intern(L"e");
+    CHECK(next.Stats().reused == 2);
+    CHECK(next.Stats().allocations == 1);
+    CHECK(pool->Free() == 0);
+}
+
+// Interning, block reuse and statistics of the per-traversal text arena
+int main() {
+    TestIntern();
+    TestPool();
+    return CheckResult();
+}
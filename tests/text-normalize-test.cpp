@@ -0,0 +1,112 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "text-normalize.hpp"
+#include "check.hpp"
+
+// Code units that sit on either side of every rule of the normalizer, including the signed compare boundaries of the vector paths
+const char16_t interesting[] = { u' ', u' ', u'\t', u'\n', u'\r', 0x0B, 0x01, 0x1F, 0x7F, 0x80, 0x85, 0x9F, 0xA0, 0xAD, 0xB7,
+    u'!', u'!', u'.', u'.', u'?', u',', u'-', u'/', u':', u'@', u'[', u'`', u'{', u'~', u'0', u'9', u'1', u'1', u'A', u'Z', u'a', u'z', u'z',
+    0x1FFF, 0x2000, 0x200A, 0x200B, 0x200F, 0x2013, 0x2026, 0x2028, 0x202A, 0x2060, 0x2500, 0x259F, 0x3000, 0x3002, 0x4E2D,
+    0x7FFF, 0x8000, 0xD83D, 0xDE00, 0xFE0F, 0xFEFF, 0xFF01, 0xFF0E, 0xFF1F, 0xFFFB, 0xFFFF };
+
+// Random text mixing long clean ASCII runs, which the vector paths take, with units that need the scalar rules
+std::u16string RandomText(std::mt19937& random) {
+    static const size_t lengths[] = { 0, 1, 7, 8, 9, 15, 16, 17, 18, 31, 33, 64, 200, 1000 }; // Around the vector widths
+    size_t length = random() % 4 ? lengths[random() % (sizeof(lengths) / sizeof(lengths[0]))] : random() % 3000;
+    std::u16string text;
+    while (text.size() < length) {
+        switch (random() % 6) {
+        case 0:
+            text += interesting[random() % (sizeof(interesting) / sizeof(interesting[0]))];
+            break;
+        case 1: {
+            char16_t repeated = interesting[random() % (sizeof(interesting) / sizeof(interesting[0]))];
+            text.append(1 + random() % 20, repeated); // Runs that collapse, or digits and letters that must not
+            break;
+        }
+        case 2:
+            text += static_cast<char16_t>(random() % 0x10000);
+            break;
+        default:
+            for (size_t run = random() % 40; run > 0; --run) text += static_cast<char16_t>(0x20 + random() % 0x5F); // Printable ASCII
+            break;
+        }
+    }
+    text.resize(length);
+    return text;
+}
+
+std::u32string Widen(const std::u16string& text) {
+    return std::u32string(text.begin(), text.end()); // Unit by unit, so four byte units take only the scalar paths
+}
+
+// Offset and length of each sentence within the text it was split from
+template <typename Char>
+std::vector<std::pair<size_t, size_t>> Spans(std::basic_string_view<Char> text, const std::vector<std::basic_string_view<Char>>& sentences) {
+    std::vector<std::pair<size_t, size_t>> spans;
+    for (const auto& sentence : sentences) spans.push_back({ static_cast<size_t>(sentence.data() - text.data()), sentence.size() });
+    return spans;
+}
+
+// The vector path compiled in, the unit-at-a-time reference and the scalar fallback must agree on every input
+void TestPathsAgree(unsigned seed, int inputs) {
+    std::mt19937 random(seed);
+    int differences = 0;
+    for (int input = 0; input < inputs; ++input) {
+        std::u16string text = RandomText(random);
+        std::u16string vector, reference;
+        TextNormalizer::Normalize(std::u16string_view(text), vector);
+        TextNormalizer::NormalizeScalar(std::u16string_view(text), reference);
+        std::u32string wide = Widen(text), fallback;
+        TextNormalizer::Normalize(std::u32string_view(wide), fallback);
+        bool same = vector == reference && Widen(vector) == fallback;
+
+        size_t maxChars = random() % 2 ? 0 : 1 + random() % 120;
+        std::vector<std::u16string_view> sentences;
+        std::vector<std::u32string_view> wideSentences;
+        std::u32string_view wideNormalized(fallback);
+        TextNormalizer::SplitSentences(std::u16string_view(vector), maxChars, sentences);
+        TextNormalizer::SplitSentences(wideNormalized, maxChars, wideSentences);
+        same = same && Spans(std::u16string_view(vector), sentences) == Spans(wideNormalized, wideSentences);
+        if (!CHECK(same) && ++differences == 1) {
+            std::cerr << "first differing input, " << text.size() << " units:";
+            for (char16_t unit : text) std::cerr << ' ' << std::hex << static_cast<unsigned>(unit) << std::dec;
+            std::cerr << "\n";
+        }
+    }
+}
+
+void TestRules() {
+    auto normalize = [](const std::u16string& text) {
+        std::u16string out;
+        TextNormalizer::Normalize(std::u16string_view(text), out);
+        return out;
+    };
+    CHECK(normalize(u"  Save\u00A0\u00A0as\u200B...  ") == u"Save as."); // Spaces collapse and trim, zero-width goes, repeats collapse
+    CHECK(normalize(u"Wait!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! 2000 items") == u"Wait! 2000 items"); // Digits repeat freely
+    CHECK(normalize(u"\u2500\u2500\u2500Menu\u2502File\u2500\u2500") == u"Menu File");
+    CHECK(normalize(u"a long clean run of plain ascii text well past sixteen units") == u"a long clean run of plain ascii text well past sixteen units");
+
+    std::u16string text = u"One. two? Three! Four\u3002Five";
+    std::vector<std::u16string_view> sentences;
+    TextNormalizer::SplitSentences(std::u16string_view(text), 0, sentences);
+    std::vector<std::u16string_view> expected = { u"One. two?", u"Three!", u"Four\u3002", u"Five" }; // No break before a lowercase word
+    CHECK(sentences == expected);
+}
+
+// Checks the vector path against the scalar ones; built once with the default target and once more with AVX2 where it runs
+int main() {
+    std::cout << "vector path: " << TextNormalizer::VectorPath() << "\n";
+#if defined(SIGHTSPEAK_EXPECT_AVX2)
+    CHECK(std::strcmp(TextNormalizer::VectorPath(), "AVX2") == 0);
+#endif
+    TestRules();
+    for (unsigned seed = 1; seed <= 4; ++seed) TestPathsAgree(seed, 5000);
+    return CheckResult();
+}
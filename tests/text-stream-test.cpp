@@ -0,0 +1,153 @@
+#include <chrono>
+#include <cwctype>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "cancellation.hpp"
+#include "element-provider.hpp"
+#include "text-stream.hpp"
+#include "check.hpp"
+
+constexpr size_t ChunkChars = 4096; // Longest chunk the mock source returns
+
+// Reads as real threads, joined by the test once the stream is done with them
+struct Readers {
+    TextStream::Launcher Launcher() {
+        return [this](std::function<void()> read) {
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.emplace_back(std::move(read));
+        };
+    }
+
+    void Join() {
+        for (;;) { // Joined reads may have launched the next ones
+            std::vector<std::thread> started;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                started.swap(threads);
+            }
+            if (started.empty()) return;
+            for (std::thread& thread : started) thread.join();
+        }
+    }
+
+    ~Readers() { Join(); }
+
+    std::mutex mutex;
+    std::vector<std::thread> threads;
+};
+
+// Document of paragraphs separated by blank lines, about chars characters long
+std::shared_ptr<const std::wstring> Paragraphs(size_t chars) {
+    auto text = std::make_shared<std::wstring>();
+    text->reserve(chars + 128);
+    for (size_t paragraph = 0; text->size() < chars; ++paragraph) {
+        for (int sentence = 0; sentence < 6; ++sentence) *text += L"Paragraph " + std::to_wstring(paragraph) + L" says something worth reading. ";
+        *text += L"\n\n";
+    }
+    return text;
+}
+
+std::unique_ptr<TextRangeSource> Source(std::shared_ptr<const std::wstring> text, std::chrono::microseconds latency = std::chrono::microseconds(0)) {
+    return std::make_unique<MockTextRangeSource>(std::move(text), ChunkUnit::Paragraph, ChunkChars, ElementRect{ 0, 0, 100, 20 }, latency);
+}
+
+size_t NonBlankChars(const std::wstring& text) {
+    size_t count = 0;
+    for (wchar_t c : text) count += !iswspace(c);
+    return count;
+}
+
+// The first chunk of a multi-megabyte document arrives after a single read, not after the document
+void TestFirstChunk() {
+    auto text = Paragraphs(2 * 1024 * 1024); // 8 MB of wchar_t on Linux
+    Readers readers;
+    auto started = std::chrono::steady_clock::now();
+    auto stream = TextStream::Open(Source(text, std::chrono::milliseconds(2)), 4, readers.Launcher());
+    TextChunk chunk;
+    CHECK(stream->Next(chunk));
+    CHECK(std::chrono::steady_clock::now() - started < std::chrono::milliseconds(200)); // Thousands of reads would take seconds
+    CHECK(chunk.text.rfind(L"Paragraph 0 ", 0) == 0);
+    stream->Close();
+    readers.Join();
+}
+
+// Reading a whole multi-megabyte document delivers every non-blank character, while the window never holds more
+// than the lookahead allows
+void TestBoundedWindow() {
+    auto text = Paragraphs(2 * 1024 * 1024);
+    for (bool launched : { false, true }) {
+        Readers readers;
+        auto stream = TextStream::Open(Source(text), 4, launched ? readers.Launcher() : nullptr);
+        TextChunk chunk;
+        size_t chars = 0;
+        while (stream->Next(chunk)) chars += NonBlankChars(chunk.text);
+        readers.Join();
+        CHECK(chars == NonBlankChars(*text));
+        CHECK(stream->Delivered() > 100);
+        CHECK(stream->PeakBufferedChars() > 0);
+        CHECK(stream->PeakBufferedChars() <= 4 * ChunkChars);
+    }
+}
+
+// Close, or a stop that cancels and closes, ends a wait at once rather than after the slow read in flight
+void TestStopDuringRead() {
+    auto text = Paragraphs(64 * 1024);
+    for (bool cancelled : { false, true }) {
+        Readers readers;
+        CancellationSource source;
+        auto stream = TextStream::Open(Source(text, std::chrono::milliseconds(800)), 4, readers.Launcher());
+        std::thread stopper([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            if (cancelled) source.Cancel();
+            stream->Close();
+        });
+        auto started = std::chrono::steady_clock::now();
+        TextChunk chunk;
+        CHECK(!stream->Next(chunk, source.Token()));
+        CHECK(std::chrono::steady_clock::now() - started < std::chrono::milliseconds(400));
+        stopper.join();
+        CHECK(stream->Delivered() == 0);
+        readers.Join(); // The read in flight finishes and its chunk is dropped
+        CHECK(!stream->Next(chunk));
+    }
+
+    CancellationSource source; // A token cancelled before the call never waits at all
+    CancellationToken token = source.Token();
+    source.Cancel();
+    Readers readers;
+    auto stream = TextStream::Open(Source(text, std::chrono::milliseconds(800)), 4, readers.Launcher());
+    TextChunk chunk;
+    auto started = std::chrono::steady_clock::now();
+    CHECK(!stream->Next(chunk, token));
+    CHECK(std::chrono::steady_clock::now() - started < std::chrono::milliseconds(400));
+}
+
+// Chunks with nothing but whitespace are read past, never handed to the reader
+void TestBlankChunks() {
+    auto text = std::make_shared<const std::wstring>(L"\n\nFirst\n\n   \n\n\t\t\n\n \n\nSecond\n\n\n\n");
+    for (bool launched : { false, true }) {
+        Readers readers;
+        auto stream = TextStream::Open(Source(text), 2, launched ? readers.Launcher() : nullptr);
+        std::vector<std::wstring> chunks;
+        TextChunk chunk;
+        while (stream->Next(chunk)) chunks.push_back(chunk.text);
+        readers.Join();
+        CHECK(chunks.size() == 2);
+        CHECK(chunks.size() == 2 && chunks[0].find(L"First") != std::wstring::npos && chunks[1].find(L"Second") != std::wstring::npos);
+    }
+    CHECK(!TextStream::Open(nullptr));
+}
+
+// Read-ahead, bounded buffering and stopping of streamed documents
+int main() {
+    TestFirstChunk();
+    TestBoundedWindow();
+    TestStopDuringRead();
+    TestBlankChunks();
+    return CheckResult();
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "element-provider.hpp"
+#include "parallel-traversal.hpp"
+#include "traversal-budget.hpp"
+#include "check.hpp"
+
+// Mock whose elements can vanish, the way a window closing mid-walk makes UI Automation calls fail
+class VanishingProvider : public MockElementProvider {
+public:
+    void Vanish(int index) { vanished.insert(index); }
+
+    bool FetchElement(const ElementHandle& element, ElementSnapshot& snapshot) override {
+        return !Gone(element) && MockElementProvider::FetchElement(element, snapshot);
+    }
+
+    bool FetchChildren(const ElementHandle& element, std::vector<ElementHandle>& children) override {
+        return !Gone(element) && MockElementProvider::FetchChildren(element, children);
+    }
+
+    bool FetchSubtree(const ElementHandle& root, int maxDepth, std::vector<ElementSnapshot>& snapshots) override {
+        return !Gone(root) && MockElementProvider::FetchSubtree(root, maxDepth, snapshots);
+    }
+
+private:
+    bool Gone(const ElementHandle& element) const { return element && vanished.count(*static_cast<const int*>(element.get())) > 0; }
+
+    std::set<int> vanished; // Indices of elements that no longer answer
+};
+
+using Visit = std::pair<std::wstring, int>; // Name and depth of a visited element
+
+// root -> A, B, C; A -> A1, A2; B -> B1; A1 -> A1x
+void BuildSmallTree(MockElementProvider& provider) {
+    ElementRect rect{ 0, 0, 10, 10 };
+    int root = provider.AddElement(-1, L"root", rect);
+    int a = provider.AddElement(root, L"A", rect);
+    int b = provider.AddElement(root, L"B", rect);
+    provider.AddElement(root, L"C", rect);
+    int a1 = provider.AddElement(a, L"A1", rect);
+    provider.AddElement(a, L"A2", rect);
+    provider.AddElement(b, L"B1", rect);
+    provider.AddElement(a1, L"A1x", rect);
+}
+
+// Random tree whose elements are named by index, so orders can be compared element by element
+void BuildRandomTree(MockElementProvider& provider, int count, unsigned seed) {
+    std::mt19937 random(seed);
+    provider.AddElement(-1, L"0", ElementRect{ 0, 0, 100, 100 });
+    for (int i = 1; i < count; ++i) {
+        int parent = std::uniform_int_distribution<int>(std::max(0, i - 12), i - 1)(random); // Mostly deep and narrow, sometimes wide
+        provider.AddElement(parent, std::to_wstring(i), ElementRect{ 0, 0, 10, 10 });
+    }
+}
+
+std::vector<Visit> Walk(ElementProvider& provider, const ElementHandle& root, int maxDepth, TraversalMode mode) {
+    std::vector<Visit> visits;
+    TraverseSubtree(provider, root, maxDepth, mode, [&](const ElementSnapshot& element) {
+        visits.push_back({ element.name, element.depth });
+        return true;
+        });
+    return visits;
+}
+
+// Parallel walk with real threads as helpers, joined once the walk is over
+std::vector<Visit> WalkInParallel(ElementProvider& provider, const ElementHandle& root, int maxDepth, size_t helpers,
+    const ElementFilter& filter = ElementFilter()) {
+    std::vector<std::thread> threads;
+    std::vector<Visit> visits;
+    bool completed = ParallelTraverseSubtree(provider, root, maxDepth, helpers,
+        [&threads](std::function<void()> help) { threads.emplace_back(std::move(help)); },
+        [&](const ElementSnapshot& element) {
+            visits.push_back({ element.name, element.depth });
+            return true;
+        }, filter);
+    CHECK(completed);
+    for (std::thread& thread : threads) thread.join();
+    return visits;
+}
+
+void TestBreadthFirstOrder() {
+    MockElementProvider provider;
+    BuildSmallTree(provider);
+    std::vector<Visit> expected = { { L"root", 0 }, { L"A", 1 }, { L"B", 1 }, { L"C", 1 }, { L"A1", 2 }, { L"A2", 2 }, { L"B1", 2 }, { L"A1x", 3 } };
+    CHECK(Walk(provider, provider.Handle(0), 32, TraversalMode::Live) == expected);
+    CHECK(Walk(provider, provider.Handle(0), 32, TraversalMode::Batched) == expected);
+
+    std::vector<Visit> shallow(expected.begin(), expected.begin() + 4); // Depth 2 keeps the root and its children
+    CHECK(Walk(provider, provider.Handle(0), 2, TraversalMode::Live) == shallow);
+    CHECK(Walk(provider, provider.Handle(0), 2, TraversalMode::Batched) == shallow);
+    CHECK(Walk(provider, provider.Handle(0), 0, TraversalMode::Live).empty());
+    CHECK(Walk(provider, nullptr, 32, TraversalMode::Batched).empty());
+
+    std::vector<Visit> subtree = { { L"A", 0 }, { L"A1", 1 }, { L"A2", 1 }, { L"A1x", 2 } }; // Depths are relative to the walk's root
+    CHECK(Walk(provider, provider.Handle(1), 32, TraversalMode::Live) == subtree);
+    CHECK(Walk(provider, provider.Handle(1), 32, TraversalMode::Batched) == subtree);
+}
+
+void TestRoundTrips() {
+    MockElementProvider provider;
+    BuildSmallTree(provider);
+    Walk(provider, provider.Handle(0), 32, TraversalMode::Batched);
+    CHECK(provider.RoundTrips() == 1); // One cache request for the whole subtree
+
+    provider.ResetRoundTrips();
+    Walk(provider, provider.Handle(0), 32, TraversalMode::Live);
+    CHECK(provider.RoundTrips() == 8 * 5 + 7 + 8); // Five properties per element, one call per child and one per child list end
+
+    provider.ResetRoundTrips(); // A budgeted walk is still a single request, the budget applies to what it returned
+    TraversalBudget budget;
+    budget.maxNodes = 3;
+    TraversalGovernor governor(budget, ElementFilter());
+    std::vector<ElementSnapshot> fetched;
+    std::vector<bool> expanded;
+    int visited = 0;
+    CHECK(FetchWithinBudget(provider, provider.Handle(0), 3, governor, [&](const ElementSnapshot&) { return ++visited > 0; }, fetched, expanded));
+    CHECK(provider.RoundTrips() == 1);
+    CHECK(visited == 3);
+    CHECK(fetched.size() == 7); // Everything above the depth limit
+    CHECK((expanded == std::vector<bool>{ true, true, true, true, false, false, false }));
+    CHECK(governor.Finish().Pruned(PruneReason::Budget) == 4); // C, A1, A2 and B1, each recorded once
+}
+
+void TestStopEarly() {
+    MockElementProvider provider;
+    BuildSmallTree(provider);
+    for (TraversalMode mode : { TraversalMode::Live, TraversalMode::Batched }) {
+        int visited = 0;
+        bool completed = TraverseSubtree(provider, provider.Handle(0), 32, mode, [&](const ElementSnapshot&) { return ++visited < 3; });
+        CHECK(!completed);
+        CHECK(visited == 3);
+    }
+    int visited = 0;
+    bool completed = ParallelTraverseSubtree(provider, provider.Handle(0), 32, 0, nullptr, [&](const ElementSnapshot&) { return ++visited < 3; });
+    CHECK(!completed);
+    CHECK(visited == 3);
+}
+
+void TestVanishedElements() {
+    VanishingProvider provider;
+    BuildSmallTree(provider);
+    provider.Vanish(2); // B, and with it the way to B1
+    std::vector<Visit> expected = { { L"root", 0 }, { L"A", 1 }, { L"C", 1 }, { L"A1", 2 }, { L"A2", 2 }, { L"A1x", 3 } };
+    CHECK(Walk(provider, provider.Handle(0), 32, TraversalMode::Live) == expected);
+    CHECK(WalkInParallel(provider, provider.Handle(0), 32, 0) == expected);
+    CHECK(WalkInParallel(provider, provider.Handle(0), 32, 3) == expected);
+
+    provider.Vanish(0); // The root itself: nothing to read, and batched mode falls back to the live walk
+    CHECK(Walk(provider, provider.Handle(0), 32, TraversalMode::Live).empty());
+    CHECK(Walk(provider, provider.Handle(0), 32, TraversalMode::Batched).empty());
+    CHECK(WalkInParallel(provider, provider.Handle(0), 32, 2).empty());
+}
+
+void TestFilteredView() {
+    MockElementProvider provider;
+    BuildSmallTree(provider);
+    provider.SetOffscreen(2, true); // B is scrolled away, B1 is not
+    ElementFilter filter;
+    filter.skipOffscreen = true;
+    provider.SetQueryFilter(filter);
+    std::vector<Visit> expected = { { L"root", 0 }, { L"A", 1 }, { L"B1", 1 }, { L"C", 1 }, { L"A1", 2 }, { L"A2", 2 }, { L"A1x", 3 } };
+    CHECK(Walk(provider, provider.Handle(0), 32, TraversalMode::Live) == expected); // B1 takes the place of B, as in a UI Automation condition view
+    CHECK(Walk(provider, provider.Handle(0), 32, TraversalMode::Batched) == expected);
+}
+
+void TestParallelMatchesSerial() {
+    for (unsigned seed = 1; seed <= 4; ++seed) {
+        MockElementProvider provider;
+        BuildRandomTree(provider, 400, seed);
+        std::vector<Visit> serial = Walk(provider, provider.Handle(0), 32, TraversalMode::Live);
+        CHECK(!serial.empty());
+        CHECK(WalkInParallel(provider, provider.Handle(0), 32, 0) == serial);
+        CHECK(WalkInParallel(provider, provider.Handle(0), 32, 3) == serial);
+
+        provider.SetCallLatency(std::chrono::microseconds(20)); // Lets helpers run ahead of the reader and steal from each other
+        CHECK(WalkInParallel(provider, provider.Handle(0), 6, 4) == Walk(provider, provider.Handle(0), 6, TraversalMode::Live));
+    }
+}
+
+void TestParallelFilter() {
+    MockElementProvider provider;
+    ElementRect rect{ 0, 0, 10, 10 };
+    int root = provider.AddElement(-1, L"root", ElementRect{}, 50033); // Rejected on two counts, read all the same
+    int hidden = provider.AddElement(root, L"hidden", ElementRect{}); // No area: visited so it can be recorded, not expanded
+    provider.AddElement(hidden, L"below", rect);
+    int shown = provider.AddElement(root, L"shown", rect);
+    provider.AddElement(shown, L"leaf", rect);
+    ElementFilter filter;
+    filter.skipEmpty = true;
+    filter.controlTypes = { 50000 };
+    std::vector<Visit> expected = { { L"root", 0 }, { L"hidden", 1 }, { L"shown", 1 }, { L"leaf", 2 } };
+    CHECK(WalkInParallel(provider, provider.Handle(root), 32, 0, filter) == expected);
+    CHECK(WalkInParallel(provider, provider.Handle(root), 32, 2, filter) == expected);
+}
+
+// Visit order, depths and vanish handling of the serial walks in both modes and of the parallel walk
+int main() {
+    TestBreadthFirstOrder();
+    TestRoundTrips();
+    TestStopEarly();
+    TestVanishedElements();
+    TestFilteredView();
+    TestParallelMatchesSerial();
+    TestParallelFilter();
+    return CheckResult();
+}
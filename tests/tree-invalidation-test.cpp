@@ -0,0 +1,73 @@
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tree-invalidation.hpp"
+#include "check.hpp"
+
+// Changes reach the handlers of their kind only, through a hub attached to an event source
+void TestHub() {
+    MockTreeEventSource source;
+    InvalidationHub hub;
+    std::vector<std::wstring> structure, focus;
+    hub.Subscribe(TreeChangeKind::StructureChanged, [&structure](const TreeChange& change) { structure.push_back(change.name); });
+    hub.Subscribe(TreeChangeKind::StructureChanged, [&structure](const TreeChange& change) { structure.push_back(change.name + L" again"); });
+    hub.Subscribe(TreeChangeKind::FocusChanged, [&focus](const TreeChange& change) { focus.push_back(change.name); });
+
+    source.Emit({ TreeChangeKind::StructureChanged, {}, {}, L"dropped", 0 }); // Not started yet
+    CHECK(hub.Attach(source));
+    source.Emit({ TreeChangeKind::StructureChanged, {}, {}, L"list", 0 });
+    source.Emit({ TreeChangeKind::FocusChanged, {}, {}, L"button", 0 });
+    source.Emit({ TreeChangeKind::PropertyChanged, {}, {}, L"nobody listens", 30005 });
+    CHECK((structure == std::vector<std::wstring>{ L"list", L"list again" }));
+    CHECK((focus == std::vector<std::wstring>{ L"button" }));
+    CHECK(hub.Published(TreeChangeKind::StructureChanged) == 1);
+    CHECK(hub.Published(TreeChangeKind::PropertyChanged) == 1);
+
+    ElementHandle root = std::make_shared<int>(7);
+    CHECK(source.Watch(root));
+    CHECK(source.Watched() == root);
+    source.Stop();
+    CHECK(!source.Watched());
+    source.Emit({ TreeChangeKind::FocusChanged, {}, {}, L"after stop", 0 });
+    CHECK(focus.size() == 1);
+}
+
+// Ordinary failures break a component only several in a row, a disconnect at once, and each break is reported once
+void TestHealth() {
+    ComponentHealth health(3);
+    CHECK(!health.ReportFailure(false));
+    CHECK(!health.ReportFailure(false));
+    health.ReportSuccess(); // Starts the count over
+    CHECK(!health.ReportFailure(false));
+    CHECK(!health.ReportFailure(false));
+    CHECK(!health.IsBroken());
+    CHECK(health.ReportFailure(false));
+    CHECK(health.IsBroken());
+    CHECK(!health.ReportFailure(true)); // Already broken, nobody rebuilds it twice
+
+    health.MarkRebuilt();
+    CHECK(!health.IsBroken());
+    CHECK(health.ReportFailure(true));
+
+    health.MarkRebuilt(); // Many threads failing at once still trigger a single rebuild
+    std::atomic<int> rebuilds{ 0 };
+    std::vector<std::thread> callers;
+    for (int caller = 0; caller < 8; ++caller) {
+        callers.emplace_back([&]() {
+            for (int call = 0; call < 100; ++call) {
+                if (health.ReportFailure(call % 10 == 9)) rebuilds.fetch_add(1);
+            }
+        });
+    }
+    for (std::thread& caller : callers) caller.join();
+    CHECK(rebuilds == 1);
+}
+
+// Routing of tree change notifications and the broken state of shared components
+int main() {
+    TestHub();
+    TestHealth();
+    return CheckResult();
+}
@@ -0,0 +1,177 @@
+#include <string>
+#include <vector>
+#include "element-provider.hpp"
+#include "tree-mirror.hpp"
+#include "check.hpp"
+
+// Root with two children, the first of which has a child of its own: root, a, b, a1
+void BuildSmallTree(MockElementProvider& provider) {
+    int root = provider.AddElement(-1, L"root", ElementRect{ 0, 0, 100, 100 });
+    int a = provider.AddElement(root, L"a", ElementRect{ 0, 0, 50, 50 });
+    provider.AddElement(root, L"b", ElementRect{ 50, 0, 100, 50 });
+    provider.AddElement(a, L"a1", ElementRect{ 0, 0, 10, 10 });
+}
+
+std::vector<ElementSnapshot> Fetch(MockElementProvider& provider, int index, int maxDepth) {
+    std::vector<ElementSnapshot> snapshots;
+    CHECK(provider.FetchSubtree(provider.Handle(index), maxDepth, snapshots));
+    return snapshots;
+}
+
+std::vector<std::wstring> Names(const std::vector<ElementSnapshot>& snapshots) {
+    std::vector<std::wstring> names;
+    for (const ElementSnapshot& snapshot : snapshots) names.push_back(snapshot.name);
+    return names;
+}
+
+// A patched subtree reads back as the same breadth-first snapshots, parents and depths included
+void TestPatchAndCollect() {
+    MockElementProvider provider;
+    BuildSmallTree(provider);
+    std::vector<ElementSnapshot> fetched = Fetch(provider, 0, 32);
+    TreeMirror mirror;
+    MirrorPatchStats stats = mirror.Patch(fetched, 32);
+    CHECK(stats.added == 4);
+    CHECK(mirror.Size() == 4);
+
+    std::vector<ElementSnapshot> snapshots, stale;
+    CHECK(mirror.Collect(fetched[0].runtimeId, 32, snapshots, stale));
+    CHECK(stale.empty());
+    CHECK(snapshots.size() == fetched.size());
+    for (size_t i = 0; i < snapshots.size() && i < fetched.size(); ++i) {
+        CHECK(snapshots[i].runtimeId == fetched[i].runtimeId);
+        CHECK(snapshots[i].name == fetched[i].name);
+        CHECK(snapshots[i].parent == fetched[i].parent);
+        CHECK(snapshots[i].depth == fetched[i].depth);
+        CHECK(snapshots[i].handle == fetched[i].handle);
+    }
+
+    snapshots.clear(); // Collecting from an inner element gives depths relative to it
+    CHECK(mirror.Collect(fetched[1].runtimeId, 31, snapshots, stale));
+    CHECK((Names(snapshots) == std::vector<std::wstring>{ L"a", L"a1" }));
+    CHECK(snapshots.size() == 2 && snapshots[1].depth == 1 && snapshots[1].parent == 0);
+    CHECK(stale.empty());
+    CHECK(mirror.Collect(fetched[1].runtimeId, 32, snapshots, stale)); // a was fetched one level short of that
+    CHECK((Names(stale) == std::vector<std::wstring>{ L"a" }));
+    stale.clear();
+    CHECK(!mirror.Collect(RuntimeId{ 1, 2, 3 }, 32, snapshots, stale)); // Never mirrored
+
+    CHECK(mirror.UpdateName(fetched[2].runtimeId, L"b renamed"));
+    CHECK(!mirror.UpdateName(RuntimeId{ 1, 2, 3 }, L"missing"));
+    snapshots.clear();
+    mirror.Collect(fetched[0].runtimeId, 32, snapshots, stale);
+    CHECK((Names(snapshots) == std::vector<std::wstring>{ L"root", L"a", L"b renamed", L"a1" }));
+}
+
+// Elements that are dirty or were fetched too shallow are reported stale and not descended into
+void TestStale() {
+    MockElementProvider provider;
+    BuildSmallTree(provider);
+    std::vector<ElementSnapshot> fetched = Fetch(provider, 0, 32);
+    TreeMirror mirror;
+    mirror.Patch(fetched, 32);
+
+    CHECK(mirror.MarkDirty(fetched[1].runtimeId));
+    CHECK(!mirror.MarkDirty(RuntimeId{ 1, 2, 3 }));
+    std::vector<ElementSnapshot> snapshots, stale;
+    mirror.Collect(fetched[0].runtimeId, 32, snapshots, stale);
+    CHECK((Names(snapshots) == std::vector<std::wstring>{ L"root", L"b" }));
+    CHECK((Names(stale) == std::vector<std::wstring>{ L"a" })); // a1 is left for the fresh walk of a
+    CHECK(stale.size() == 1 && stale[0].depth == 1 && stale[0].parent == 0);
+
+    mirror.Patch(Fetch(provider, 1, 32), 32); // The fresh walk patches a back in
+    snapshots.clear();
+    stale.clear();
+    mirror.Collect(fetched[0].runtimeId, 32, snapshots, stale);
+    CHECK(snapshots.size() == 4);
+    CHECK(stale.empty());
+
+    TreeMirror shallow; // Fetched two levels deep, so the children of root are known to no depth
+    shallow.Patch(Fetch(provider, 0, 2), 2);
+    snapshots.clear();
+    shallow.Collect(fetched[0].runtimeId, 2, snapshots, stale);
+    CHECK((Names(snapshots) == std::vector<std::wstring>{ L"root", L"a", L"b" }));
+    snapshots.clear();
+    shallow.Collect(fetched[0].runtimeId, 3, snapshots, stale);
+    CHECK(snapshots.empty());
+    CHECK((Names(stale) == std::vector<std::wstring>{ L"root" })); // Root itself is not complete three levels down
+
+    TreeMirror partial; // A budgeted fetch that did not expand a
+    std::vector<bool> expanded{ true, false, true, true };
+    std::vector<ElementSnapshot> cut = Fetch(provider, 0, 32);
+    cut.pop_back(); // a1 never arrived
+    expanded.pop_back();
+    partial.Patch(cut, 32, &expanded);
+    snapshots.clear();
+    stale.clear();
+    partial.Collect(fetched[0].runtimeId, 32, snapshots, stale);
+    CHECK((Names(snapshots) == std::vector<std::wstring>{ L"root", L"b" }));
+    CHECK((Names(stale) == std::vector<std::wstring>{ L"a" }));
+
+    mirror.MarkAllDirty();
+    snapshots.clear();
+    stale.clear();
+    mirror.Collect(fetched[0].runtimeId, 32, snapshots, stale);
+    CHECK(snapshots.empty());
+    CHECK(stale.size() == 1);
+}
+
+// Re-patching drops elements that disappeared and relinks elements that moved, including from outside the patched root
+void TestRemoveAndMove() {
+    MockElementProvider before;
+    BuildSmallTree(before);
+    TreeMirror mirror;
+    std::vector<ElementSnapshot> fetched = Fetch(before, 0, 32);
+    mirror.Patch(fetched, 32);
+
+    MockElementProvider gone; // Same runtime ids for root, a and b, a1 closed
+    gone.AddElement(-1, L"root", ElementRect{ 0, 0, 100, 100 });
+    gone.AddElement(0, L"a", ElementRect{ 0, 0, 50, 50 });
+    gone.AddElement(0, L"b", ElementRect{ 50, 0, 100, 50 });
+    MirrorPatchStats stats = mirror.Patch(Fetch(gone, 0, 32), 32);
+    CHECK(stats.added == 0);
+    CHECK(stats.updated == 3);
+    CHECK(stats.removed == 1);
+    CHECK(mirror.Size() == 3);
+
+    MockElementProvider underB; // a1 reappears below b
+    underB.AddElement(-1, L"root", ElementRect{ 0, 0, 100, 100 });
+    underB.AddElement(0, L"a", ElementRect{ 0, 0, 50, 50 });
+    underB.AddElement(0, L"b", ElementRect{ 50, 0, 100, 50 });
+    underB.AddElement(2, L"a1", ElementRect{ 60, 0, 70, 10 });
+    stats = mirror.Patch(Fetch(underB, 0, 32), 32);
+    CHECK(stats.added == 1);
+    CHECK(mirror.Size() == 4);
+
+    MockElementProvider underA; // Then moves back below a, and only a is fetched again
+    BuildSmallTree(underA);
+    stats = mirror.Patch(Fetch(underA, 1, 32), 32);
+    CHECK(stats.updated == 2);
+    CHECK(stats.removed == 0);
+    std::vector<ElementSnapshot> snapshots, stale;
+    mirror.Collect(fetched[0].runtimeId, 32, snapshots, stale);
+    CHECK((Names(snapshots) == std::vector<std::wstring>{ L"root", L"a", L"b", L"a1" }));
+    CHECK(snapshots.size() == 4 && snapshots[3].parent == 1); // Unlinked from b, so listed once
+}
+
+// A mirror about to outgrow its capacity starts over with the incoming subtree
+void TestCapacity() {
+    MockElementProvider provider;
+    BuildSmallTree(provider);
+    TreeMirror mirror(5);
+    mirror.Patch(Fetch(provider, 0, 32), 32);
+    CHECK(mirror.Size() == 4);
+    mirror.Patch(Fetch(provider, 1, 32), 32);
+    CHECK(mirror.Size() == 2);
+    mirror.Clear();
+    CHECK(mirror.Size() == 0);
+}
+
+// Patching, collecting and invalidating the mirror of fetched accessibility subtrees
+int main() {
+    TestPatchAndCollect();
+    TestStale();
+    TestRemoveAndMove();
+    TestCapacity();
+    return CheckResult();
+}
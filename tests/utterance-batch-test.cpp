@@ -0,0 +1,152 @@
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cancellation.hpp"
+#include "speech-backend.hpp"
+#include "utterance-batch.hpp"
+#include "check.hpp"
+
+void TestMergeRules() {
+    BatchPolicy policy;
+    policy.maxItems = 3;
+    policy.maxItemChars = 10;
+    policy.maxChars = 20;
+    UtteranceBatch batch(policy);
+    CHECK(!batch.Accepts(L""));
+    CHECK(!batch.Accepts(L"Eleven char")); // Long enough to be spoken on its own
+    CHECK(batch.Add(L"Save"));
+    CHECK(batch.Add(L"Done."));
+    CHECK(batch.Add(L"Print"));
+    CHECK(batch.Text() == L"Save, Done. Print"); // A comma between items, unless one already ends with punctuation
+    CHECK(!batch.Add(L"More")); // Full at three items
+    CHECK(batch.Size() == 3);
+    CHECK(batch.Text() == L"Save, Done. Print");
+
+    CHECK(batch.ItemAt(0) == 0);
+    CHECK(batch.ItemAt(4) == 0); // The separator belongs to the item before it
+    CHECK(batch.ItemAt(6) == 1);
+    CHECK(batch.ItemAt(12) == 2);
+    CHECK(batch.ItemAt(100) == 2);
+
+    batch.Clear();
+    CHECK(batch.Empty());
+    CHECK(batch.Add(L"Open file"));
+    CHECK(!batch.Add(L"Open again")); // Would make the utterance longer than maxChars
+    CHECK(batch.Text() == L"Open file");
+
+    policy.maxItems = 1; // Every item spoken on its own
+    CHECK(!UtteranceBatch(policy).Accepts(L"Save"));
+}
+
+// Items reported while a batch plays, in the order the backend reaches them
+struct ItemLog {
+    void operator()(size_t item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        items.push_back(item);
+    }
+
+    std::vector<size_t> Items() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items;
+    }
+
+    std::mutex mutex;
+    std::vector<size_t> items;
+};
+
+UtteranceBatch Toolbar(Preemption preemption) {
+    BatchPolicy policy;
+    policy.preemption = preemption;
+    UtteranceBatch batch(policy);
+    for (const wchar_t* label : { L"Back", L"Forward", L"Reload page", L"Home" }) batch.Add(label);
+    return batch;
+}
+
+void TestSpeakBatch() {
+    FakeSpeechBackend backend(std::chrono::microseconds(50));
+    CancellationSource source;
+    ItemLog log;
+    CHECK(SpeakBatch(backend, Toolbar(Preemption::Interrupt), source.Token(), [&log](size_t item) { log(item); }));
+    CHECK((log.Items() == std::vector<size_t>{ 0, 1, 2, 3 })); // Each item once, the one with two words too
+
+    CancellationToken cancelled = source.Token();
+    source.Cancel();
+    CHECK(!SpeakBatch(backend, Toolbar(Preemption::Interrupt), cancelled, nullptr)); // Superseded before it started
+    CHECK(!SpeakBatch(backend, UtteranceBatch(), source.Token(), nullptr));
+    CHECK(backend.Spoken() == 1);
+}
+
+// A hover arriving mid-item: under FinishItem the utterance ends where the next item would start,
+// under Interrupt the batch leaves stopping to whoever purges the backend
+void TestPreemption() {
+    for (Preemption preemption : { Preemption::FinishItem, Preemption::Interrupt }) {
+        FakeSpeechBackend backend(std::chrono::milliseconds(2));
+        CancellationSource source;
+        ItemLog log;
+        bool finished = true;
+        std::thread speaker([&]() {
+            finished = SpeakBatch(backend, Toolbar(preemption), source.Token(), [&log](size_t item) { log(item); });
+        });
+        while (log.Items().size() < 2) std::this_thread::yield(); // Speaking the second item
+        source.Cancel();
+        speaker.join();
+        std::vector<size_t> items = log.Items();
+        if (preemption == Preemption::FinishItem) {
+            CHECK(!finished);
+            CHECK((items == std::vector<size_t>{ 0, 1 })); // The third item never starts
+            CHECK(backend.Purged() == 1);
+        }
+        else {
+            CHECK(finished);
+            CHECK(items.size() == 4);
+            CHECK(backend.Purged() == 0);
+        }
+    }
+}
+
+// Fake backend that lets a stop land between the caller's last cancellation check and the start of the utterance
+class RacedSpeechBackend : public FakeSpeechBackend {
+public:
+    explicit RacedSpeechBackend(std::function<void()> beforeSpeak) : FakeSpeechBackend(std::chrono::milliseconds(20)), beforeSpeak(std::move(beforeSpeak)) {}
+
+    bool Speak(const std::wstring& text, SpeechCallbacks callbacks) override {
+        if (beforeSpeak) beforeSpeak();
+        return FakeSpeechBackend::Speak(text, std::move(callbacks));
+    }
+
+private:
+    std::function<void()> beforeSpeak; // Runs before every utterance starts
+};
+
+// A stop that cancels and purges while nothing plays yet must still end the utterance started right after it,
+// instead of letting the stale text play out; at 20 ms per character the toolbar would take well over a second
+void TestCancelBeforeSpeak() {
+    for (bool batched : { false, true }) {
+        CancellationSource source;
+        CancellationToken token = source.Token();
+        RacedSpeechBackend* raced = nullptr;
+        RacedSpeechBackend backend([&source, &raced]() {
+            source.Cancel(); // As StopCurrentProcesses does, the purge finds no utterance to end
+            raced->Purge();
+        });
+        raced = &backend;
+        auto started = std::chrono::steady_clock::now();
+        bool finished = batched ? SpeakBatch(backend, Toolbar(Preemption::Interrupt), token, nullptr)
+            : SpeakAndWait(backend, L"Back, Forward, Reload page, Home", nullptr, SpeechCallbacks(), token);
+        CHECK(!finished);
+        CHECK(std::chrono::steady_clock::now() - started < std::chrono::milliseconds(500));
+        CHECK(backend.Purged() == 2);
+    }
+}
+
+// Merge rules of utterance batches and how a merged utterance reports and ends its items
+int main() {
+    TestMergeRules();
+    TestSpeakBatch();
+    TestPreemption();
+    TestCancelBeforeSpeak();
+    return CheckResult();
+}
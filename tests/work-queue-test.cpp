@@ -0,0 +1,131 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "work-queue.hpp"
+#include "check.hpp"
+
+struct Tagged {
+    unsigned producer; // Thread that pushed the entry
+    uint64_t sequence; // Position among that thread's pushes
+};
+
+// Wait until a condition holds, for at most a few seconds so a lost wakeup fails instead of hanging
+template <typename Condition>
+bool Eventually(Condition condition) {
+    auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > giveUp) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+void TestFifoAndFull() {
+    WorkQueue<std::unique_ptr<int>> queue(5);
+    CHECK(queue.Capacity() == 8); // Rounded up to a power of two
+    for (int lap = 0; lap < 3; ++lap) { // Positions wrap around the ring
+        for (int i = 0; i < 8; ++i) CHECK(queue.TryPush(std::make_unique<int>(lap * 8 + i)));
+        auto extra = std::make_unique<int>(-1);
+        CHECK(!queue.TryPush(std::move(extra)));
+        CHECK(extra && *extra == -1); // Left alone when rejected
+
+        std::vector<std::unique_ptr<int>> out;
+        CHECK(queue.Drain(out, 3) == 3);
+        CHECK(queue.Drain(out, 100) == 5);
+        CHECK(queue.Drain(out, 100) == 0);
+        for (int i = 0; i < 8; ++i) CHECK(*out[i] == lap * 8 + i);
+    }
+    CHECK(queue.Rejected() == 3);
+}
+
+void TestClear() {
+    WorkQueue<int> queue(8);
+    for (int i = 0; i < 3; ++i) queue.TryPush(int(i));
+    queue.Clear();
+    queue.TryPush(10);
+    queue.TryPush(11);
+    std::vector<int> out;
+    CHECK(queue.Drain(out, 100) == 2);
+    CHECK((out == std::vector<int>{ 10, 11 }));
+    CHECK(queue.Discarded() == 3);
+}
+
+void TestWakeups() {
+    WorkQueue<int> queue(2);
+    queue.TryPush(1);
+    queue.TryPush(2);
+    std::atomic<int> result{ -1 };
+    std::thread producer([&]() { result = queue.Push(3) ? 1 : 0; });
+    CHECK(Eventually([&] { return queue.Blocked() == 1; })); // Asleep on the full ring
+    queue.Clear();
+    producer.join();
+    CHECK(result == 0); // Gave up on its item rather than pushing into the new epoch
+
+    std::vector<int> out;
+    CHECK(queue.Drain(out, 100) == 0); // Everything queued before the Clear is skipped
+    std::thread consumer([&]() { result = queue.WaitDrain(out, 100) ? 1 : 0; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    queue.TryPush(4);
+    CHECK(Eventually([&] { return result == 1; }));
+    consumer.join();
+    CHECK(out == std::vector<int>{ 4 });
+
+    result = -1;
+    out.clear();
+    std::thread closing([&]() { result = queue.WaitDrain(out, 100) ? 1 : 0; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    queue.Close();
+    closing.join();
+    CHECK(result == 0);
+    CHECK(!queue.TryPush(5));
+    CHECK(!queue.Push(6));
+}
+
+// Producers push into a small ring while the consumer drains it and sometimes clears it
+// Every accepted entry is either received or discarded, once, and each producer's entries arrive in order
+void TestProducersAndConsumer(unsigned producers, uint64_t perProducer, int clearEvery) {
+    WorkQueue<Tagged> queue(64);
+    std::atomic<uint64_t> accepted{ 0 };
+    uint64_t received = 0;
+    std::vector<uint64_t> next(producers, 0); // Lowest sequence each producer may still deliver
+    std::thread consumer([&]() {
+        std::vector<Tagged> batch;
+        int drains = 0;
+        while (queue.WaitDrain(batch, 16)) {
+            for (const Tagged& entry : batch) {
+                CHECK(clearEvery ? entry.sequence >= next[entry.producer] : entry.sequence == next[entry.producer]); // Gaps only where a Clear dropped entries
+                next[entry.producer] = entry.sequence + 1;
+            }
+            received += batch.size();
+            batch.clear();
+            if (clearEvery && ++drains % clearEvery == 0) queue.Clear();
+        }
+    });
+    std::vector<std::thread> threads;
+    for (unsigned producer = 0; producer < producers; ++producer) {
+        threads.emplace_back([&, producer]() {
+            for (uint64_t i = 0; i < perProducer; ++i) {
+                if (queue.Push({ producer, i })) accepted.fetch_add(1);
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    queue.Close();
+    consumer.join();
+    CHECK(received + queue.Discarded() == accepted.load());
+    if (!clearEvery) CHECK(received == producers * perProducer);
+}
+
+// Ordering, capacity, Clear and the blocking paths of the speech queue
+int main() {
+    TestFifoAndFull();
+    TestClear();
+    TestWakeups();
+    TestProducersAndConsumer(1, 200000, 0);
+    TestProducersAndConsumer(4, 50000, 0);
+    TestProducersAndConsumer(4, 50000, 7);
+    return CheckResult();
+}
@@ -0,0 +1,125 @@
+#ifndef SIGHTSPEAK_TEXT_ARENA_HPP
+#define SIGHTSPEAK_TEXT_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Blocks of released text arenas, kept for the traversals that follow
+// Once the first traversals have grown the pool, a steady stream of hovers interns text without touching the heap
+class TextBlockPool {
+public:
+    static constexpr size_t BlockChars = 16 * 1024; // UTF-16 code units per block
+
+    explicit TextBlockPool(size_t maxBlocks = 64) : maxBlocks(maxBlocks) {}
+
+    // Take a free block, or null if none is left
+    std::unique_ptr<wchar_t[]> Take() {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (blocks.empty()) return nullptr;
+        std::unique_ptr<wchar_t[]> block = std::move(blocks.back());
+        blocks.pop_back();
+        return block;
+    }
+
+    // Keep a block for a later arena; blocks beyond the limit are freed
+    void Give(std::unique_ptr<wchar_t[]> block) {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (blocks.size() < maxBlocks) blocks.push_back(std::move(block));
+    }
+
+    // Number of blocks waiting to be reused
+    size_t Free() const {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        return blocks.size();
+    }
+
+private:
+    mutable std::mutex poolMutex; // Guards blocks
+    std::vector<std::unique_ptr<wchar_t[]>> blocks; // Free blocks of BlockChars code units
+    size_t maxBlocks; // Free blocks kept at most
+};
+
+// Allocation statistics of one arena
+struct TextArenaStats {
+    size_t texts{ 0 }; // Texts interned
+    size_t usedBytes{ 0 }; // Bytes taken by the texts and their terminators
+    size_t reservedBytes{ 0 }; // Bytes held in blocks; an arena never shrinks, so this is also its peak
+    size_t allocations{ 0 }; // Blocks taken from the heap
+    size_t reused{ 0 }; // Blocks taken from the pool
+
+    // Short human readable summary for the debug log
+    std::wstring Describe() const {
+        return L"texts=" + std::to_wstring(texts) + L" used=" + std::to_wstring(usedBytes) + L"B peak=" + std::to_wstring(reservedBytes) +
+            L"B allocations=" + std::to_wstring(allocations) + L" reused=" + std::to_wstring(reused);
+    }
+};
+
+// Texts of one traversal, each copied once into shared blocks and released together with the arena
+// Interned texts are NUL-terminated and never move, so views of them travel through dedup, the queue and speech
+// without further copies; Intern is called from one thread at a time, and a view may be read on another thread
+// once handed over through a synchronizing queue, for as long as the arena is kept alive
+class TextArena {
+public:
+    explicit TextArena(std::shared_ptr<TextBlockPool> pool = nullptr) : pool(std::move(pool)) {}
+
+    ~TextArena() {
+        if (!pool) return;
+        for (std::unique_ptr<wchar_t[]>& block : blocks) pool->Give(std::move(block));
+    }
+
+    TextArena(const TextArena&) = delete;
+    TextArena& operator=(const TextArena&) = delete;
+
+    // Copy a text into the arena and return a view of the copy, which stays valid as long as the arena
+    std::wstring_view Intern(std::wstring_view text) {
+        size_t needed = text.size() + 1; // Room for the terminator
+        wchar_t* target;
+        if (needed > TextBlockPool::BlockChars) {
+            oversized.emplace_back(new wchar_t[needed]); // Too long to share a block, gets an allocation of its own
+            ++stats.allocations;
+            stats.reservedBytes += needed * sizeof(wchar_t);
+            target = oversized.back().get();
+        }
+        else {
+            if (blocks.empty() || TextBlockPool::BlockChars - blockUsed < needed) AddBlock();
+            target = blocks.back().get() + blockUsed;
+            blockUsed += needed;
+        }
+        text.copy(target, text.size());
+        target[text.size()] = L'\0';
+        ++stats.texts;
+        stats.usedBytes += needed * sizeof(wchar_t);
+        return std::wstring_view(target, text.size());
+    }
+
+    // Allocation statistics so far
+    const TextArenaStats& Stats() const { return stats; }
+
+private:
+    void AddBlock() {
+        std::unique_ptr<wchar_t[]> block = pool ? pool->Take() : nullptr;
+        if (block) {
+            ++stats.reused;
+        }
+        else {
+            block.reset(new wchar_t[TextBlockPool::BlockChars]); // Left uninitialized, every code unit handed out is written first
+            ++stats.allocations;
+        }
+        stats.reservedBytes += TextBlockPool::BlockChars * sizeof(wchar_t);
+        blocks.push_back(std::move(block));
+        blockUsed = 0;
+    }
+
+    std::shared_ptr<TextBlockPool> pool; // Source and destination of blocks, if set
+    std::vector<std::unique_ptr<wchar_t[]>> blocks; // Blocks in the order they were filled, the last one is current
+    std::vector<std::unique_ptr<wchar_t[]>> oversized; // Texts longer than a block, freed rather than pooled
+    size_t blockUsed{ 0 }; // Code units taken from the current block
+    TextArenaStats stats; // Counted as texts are interned
+};
+
+#endif // SIGHTSPEAK_TEXT_ARENA_HPP
@@ -0,0 +1,92 @@
+#ifndef SIGHTSPEAK_TEXT_FINGERPRINT_HPP
+#define SIGHTSPEAK_TEXT_FINGERPRINT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// Concurrent set of text fingerprints used to skip texts already queued during a traversal
+// Stores a 48-bit hash and a 16-bit generation tag per slot instead of the text itself,
+// so memory stays within a fixed budget however large the texts are, and Reset is a single increment
+class TextFingerprintSet {
+public:
+    explicit TextFingerprintSet(size_t memoryBudget = 256 * 1024) {
+        size_t slots = 64;
+        while (slots * 2 * sizeof(std::atomic<uint64_t>) <= memoryBudget) slots *= 2; // Power of two so probing can mask
+        slotMask = slots - 1;
+        table = std::make_unique<std::atomic<uint64_t>[]>(slots);
+        for (size_t i = 0; i < slots; ++i) table[i].store(0, std::memory_order_relaxed);
+    }
+
+    // Record a text; returns true if it was not yet seen in the current generation
+    // When the probe window is full the text is reported as new without being recorded
+    bool Insert(std::wstring_view text) {
+        uint64_t tag = generation.load(std::memory_order_acquire);
+        uint64_t entry = (Fingerprint(text) & HashMask) | (tag << HashBits);
+        size_t slot = static_cast<size_t>(entry) & slotMask;
+        for (size_t probe = 0; probe < MaxProbes; ++probe, slot = (slot + 1) & slotMask) {
+            uint64_t current = table[slot].load(std::memory_order_acquire);
+            while ((current >> HashBits) != tag) { // Empty or left over from an older generation, claim it
+                if (table[slot].compare_exchange_weak(current, entry, std::memory_order_acq_rel)) return true;
+            }
+            if (current == entry) return false;
+        }
+        overflows.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Check whether a text was seen in the current generation
+    bool Contains(std::wstring_view text) const {
+        uint64_t tag = generation.load(std::memory_order_acquire);
+        uint64_t entry = (Fingerprint(text) & HashMask) | (tag << HashBits);
+        size_t slot = static_cast<size_t>(entry) & slotMask;
+        for (size_t probe = 0; probe < MaxProbes; ++probe, slot = (slot + 1) & slotMask) {
+            uint64_t current = table[slot].load(std::memory_order_acquire);
+            if ((current >> HashBits) != tag) return false; // Slots are claimed in probe order, so the chain ends here
+            if (current == entry) return true;
+        }
+        return false;
+    }
+
+    // Forget every recorded text by moving to the next generation
+    // The slots are only wiped when the 16-bit tag wraps around
+    void Reset() {
+        uint64_t next = (generation.load(std::memory_order_relaxed) + 1) & TagMask;
+        if (next == 0) {
+            for (size_t i = 0; i <= slotMask; ++i) table[i].store(0, std::memory_order_relaxed);
+            next = 1; // Tag zero marks never used slots
+        }
+        generation.store(next, std::memory_order_release);
+    }
+
+    // Number of texts that could not be recorded because their probe window was full
+    uint64_t Overflows() const { return overflows.load(std::memory_order_relaxed); }
+
+    // Number of slots in the table
+    size_t Capacity() const { return slotMask + 1; }
+
+    // 64-bit FNV-1a hash over the UTF-16 code units of a text
+    static uint64_t Fingerprint(std::wstring_view text) {
+        uint64_t hash = 14695981039346656037ull;
+        for (wchar_t c : text) {
+            hash ^= static_cast<uint64_t>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash ^ (hash >> 32); // Fold the well mixed high bits into the low bits used for the slot
+    }
+
+private:
+    static constexpr int HashBits = 48; // Low bits of a slot hold the fingerprint
+    static constexpr uint64_t HashMask = (uint64_t{ 1 } << HashBits) - 1;
+    static constexpr uint64_t TagMask = 0xFFFF; // High bits hold the generation tag
+    static constexpr size_t MaxProbes = 32; // Slots examined before a text is reported as new without being recorded
+
+    std::unique_ptr<std::atomic<uint64_t>[]> table; // Fingerprint and generation tag per slot
+    size_t slotMask{ 0 }; // Slot count minus one
+    std::atomic<uint64_t> generation{ 1 }; // Tag of the current generation
+    std::atomic<uint64_t> overflows{ 0 }; // Texts reported as new without being recorded
+};
+
+#endif // SIGHTSPEAK_TEXT_FINGERPRINT_HPP
@@ -0,0 +1,303 @@
+#ifndef SIGHTSPEAK_TEXT_NORMALIZE_HPP
+#define SIGHTSPEAK_TEXT_NORMALIZE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIGHTSPEAK_NORMALIZE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIGHTSPEAK_NORMALIZE_SSE2 1
+#endif
+
+// Cleans text before it reaches the synthesizer and cuts it into sentences
+// Whitespace runs collapse to one space, zero-width and other ignorable code points are dropped,
+// box-drawing characters count as whitespace and runs of the same punctuation mark collapse to one
+// Works on UTF-16 code units; runs of plain ASCII are classified 8 or 16 units at a time with SSE2 or AVX2
+class TextNormalizer {
+public:
+    // Normalize text into out, replacing its contents
+    template <typename Char>
+    static void Normalize(std::basic_string_view<Char> text, std::basic_string<Char>& out) {
+        out.clear();
+        out.reserve(text.size());
+        const Char* units = text.data();
+        size_t size = text.size();
+        bool pendingSpace = false;
+        size_t i = 0;
+        while (i < size) {
+            size_t clean = CleanPrefix(units + i, size - i);
+            Emit(units[i], out, pendingSpace);
+            if (clean > 1) {
+                FlushSpace(out, pendingSpace); // The unit after a clean space is never a space, so the space is due
+                out.append(units + i + 1, clean - 1); // Clean units are emitted unchanged
+                i += clean;
+            }
+            else {
+                ++i;
+            }
+        }
+        if (!out.empty() && out.back() == static_cast<Char>(' ')) out.pop_back();
+    }
+
+    // Same result as Normalize, one code unit at a time; kept as the reference for the vector paths
+    template <typename Char>
+    static void NormalizeScalar(std::basic_string_view<Char> text, std::basic_string<Char>& out) {
+        out.clear();
+        out.reserve(text.size());
+        bool pendingSpace = false;
+        for (Char c : text) Emit(c, out, pendingSpace);
+        if (!out.empty() && out.back() == static_cast<Char>(' ')) out.pop_back();
+    }
+
+    // Split normalized text into sentences no longer than maxChars, appended to sentences
+    // A sentence ends after terminal punctuation followed by a space and anything but a lowercase letter,
+    // or after CJK terminal punctuation; longer sentences are cut at their last space
+    template <typename Char>
+    static void SplitSentences(std::basic_string_view<Char> text, size_t maxChars, std::vector<std::basic_string_view<Char>>& sentences) {
+        if (maxChars == 0) maxChars = text.size() ? text.size() : 1;
+        size_t start = SkipSpaces(text, 0);
+        while (start < text.size()) {
+            size_t end = text.size();
+            size_t i = start;
+            while (i < text.size()) {
+                i = NextTerminatorCandidate(text.data(), text.size(), i);
+                if (i == text.size()) break;
+                uint32_t unit = Unit(text[i]);
+                if (!IsTerminator(unit)) {
+                    ++i; // Candidate was some other unit above the ASCII range
+                    continue;
+                }
+                size_t after = i + 1;
+                while (after < text.size() && IsTerminator(Unit(text[after]))) ++after; // "?!" and "..." end together
+                i = after;
+                if (IsWideTerminator(unit) || after == text.size() ||
+                    (text[after] == static_cast<Char>(' ') && (after + 1 == text.size() || !IsLower(Unit(text[after + 1]))))) {
+                    end = after;
+                    break;
+                }
+            }
+
+            while (end - start > maxChars) { // Cut overlong sentences at their last space
+                size_t cut = start + maxChars;
+                size_t space = cut;
+                while (space > start && text[space] != static_cast<Char>(' ')) --space;
+                if (space > start) cut = space;
+                else if (IsHighSurrogate(Unit(text[cut - 1]))) cut = cut - 1 > start ? cut - 1 : cut + 1; // Never split a surrogate pair, nor cut nothing
+                AddSentence(text, start, cut, sentences);
+                start = SkipSpaces(text, cut);
+            }
+            AddSentence(text, start, end, sentences);
+            start = SkipSpaces(text, end);
+        }
+    }
+
+    // Name of the vector path compiled in
+    static const char* VectorPath() {
+#if defined(SIGHTSPEAK_NORMALIZE_AVX2)
+        return "AVX2";
+#elif defined(SIGHTSPEAK_NORMALIZE_SSE2)
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+
+private:
+    template <typename Char>
+    static uint32_t Unit(Char c) {
+        return static_cast<uint32_t>(static_cast<std::make_unsigned_t<Char>>(c));
+    }
+
+    static bool IsSpace(uint32_t u) {
+        if (u <= 0x20) return u == 0x20 || (u >= 0x09 && u <= 0x0D);
+        if (u < 0x85) return false;
+        return u == 0x85 || u == 0xA0 || u == 0x1680 || (u >= 0x2000 && u <= 0x200A) || u == 0x2028 || u == 0x2029 ||
+            u == 0x202F || u == 0x205F || u == 0x3000 ||
+            (u >= 0x2500 && u <= 0x259F); // Box drawing and block elements separate like whitespace
+    }
+
+    static bool IsIgnorable(uint32_t u) {
+        if (u < 0x20) return true; // Control characters other than whitespace, which is handled first
+        if (u < 0x7F) return false;
+        return u <= 0x9F || u == 0xAD || (u >= 0x200B && u <= 0x200F) || (u >= 0x202A && u <= 0x202E) ||
+            (u >= 0x2060 && u <= 0x2064) || (u >= 0x2066 && u <= 0x2069) || (u >= 0xFE00 && u <= 0xFE0F) ||
+            u == 0xFEFF || (u >= 0xFFF9 && u <= 0xFFFB);
+    }
+
+    // Punctuation whose repetitions are read out one by one
+    static bool IsCollapsible(uint32_t u) {
+        if (u < 0x80) {
+            return (u >= 0x21 && u <= 0x2F) || (u >= 0x3A && u <= 0x40) || (u >= 0x5B && u <= 0x60) || (u >= 0x7B && u <= 0x7E);
+        }
+        return u == 0xB7 || u == 0x2013 || u == 0x2014 || u == 0x2022 || u == 0x2026;
+    }
+
+    static bool IsWideTerminator(uint32_t u) { return u == 0x3002 || u == 0xFF01 || u == 0xFF0E || u == 0xFF1F; }
+
+    static bool IsTerminator(uint32_t u) { return u == '.' || u == '!' || u == '?' || u == 0x2026 || IsWideTerminator(u); }
+
+    static bool IsLower(uint32_t u) { return u >= 'a' && u <= 'z'; }
+
+    static bool IsHighSurrogate(uint32_t u) { return u >= 0xD800 && u <= 0xDBFF; }
+
+    template <typename Char>
+    static void FlushSpace(std::basic_string<Char>& out, bool& pendingSpace) {
+        if (pendingSpace && !out.empty() && out.back() != static_cast<Char>(' ')) out.push_back(static_cast<Char>(' '));
+        pendingSpace = false;
+    }
+
+    // Append one code unit with whitespace, ignorable and repetition rules applied
+    template <typename Char>
+    static void Emit(Char c, std::basic_string<Char>& out, bool& pendingSpace) {
+        uint32_t u = Unit(c);
+        if (IsSpace(u)) {
+            if (!out.empty() && out.back() != static_cast<Char>(' ')) pendingSpace = true; // Leading whitespace is dropped
+            return;
+        }
+        if (IsIgnorable(u)) return;
+        FlushSpace(out, pendingSpace);
+        if (IsCollapsible(u) && !out.empty() && Unit(out.back()) == u) return;
+        out.push_back(c);
+    }
+
+    // Number of units from the start that Emit would copy unchanged given the unit before them was emitted:
+    // printable ASCII and spaces, except a space or punctuation mark followed by the same unit
+    // Zero or one means the first unit needs Emit; units near the end are always left to Emit
+    template <typename Char>
+    static size_t CleanPrefix(const Char* units, size_t size) {
+        size_t clean = 0;
+        if constexpr (sizeof(Char) == 2) {
+            bool stopped = false;
+            const void* words = units;
+#if defined(SIGHTSPEAK_NORMALIZE_AVX2)
+            clean = CleanPrefixAvx2(static_cast<const uint16_t*>(words), size, clean, stopped);
+            if (stopped) return clean;
+#endif
+#if defined(SIGHTSPEAK_NORMALIZE_SSE2)
+            clean = CleanPrefixSse2(static_cast<const uint16_t*>(words), size, clean, stopped);
+            if (stopped) return clean;
+#endif
+            (void)words;
+            (void)stopped;
+        }
+        while (clean + 1 < size) { // Scalar tail and fallback, same rule as the vector paths
+            uint32_t u = Unit(units[clean]);
+            if (u < 0x20 || u > 0x7E) break;
+            if (u == Unit(units[clean + 1]) && IsCollapsibleOrSpace(u)) break;
+            ++clean;
+        }
+        return clean;
+    }
+
+#if defined(SIGHTSPEAK_NORMALIZE_AVX2)
+    // CleanPrefix over 16 units per step, starting at clean; sets stopped when a unit needing Emit was found
+    static size_t CleanPrefixAvx2(const uint16_t* units, size_t size, size_t clean, bool& stopped) {
+        const __m256i space = _mm256_set1_epi16(0x1F), tilde = _mm256_set1_epi16(0x7F);
+        const __m256i digitLow = _mm256_set1_epi16(0x2F), digitHigh = _mm256_set1_epi16(0x3A);
+        const __m256i letterLow = _mm256_set1_epi16(0x60), letterHigh = _mm256_set1_epi16(0x7B), caseBit = _mm256_set1_epi16(0x20);
+        while (clean + 17 <= size) { // The following unit is loaded as well
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(units + clean));
+            __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(units + clean + 1));
+            // Signed compares: units at 0x8000 and above are negative and fall out of the printable range
+            __m256i printable = _mm256_and_si256(_mm256_cmpgt_epi16(v, space), _mm256_cmpgt_epi16(tilde, v));
+            __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi16(v, digitLow), _mm256_cmpgt_epi16(digitHigh, v));
+            __m256i folded = _mm256_or_si256(v, caseBit);
+            __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi16(folded, letterLow), _mm256_cmpgt_epi16(letterHigh, folded));
+            __m256i repeated = _mm256_andnot_si256(_mm256_or_si256(digit, letter), _mm256_cmpeq_epi16(v, next));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_andnot_si256(repeated, printable)));
+            if (mask != 0xFFFFFFFFu) {
+                stopped = true;
+                return clean + CountTrailingOnes(mask) / 2; // Two mask bits per unit
+            }
+            clean += 16;
+        }
+        return clean;
+    }
+#endif
+
+#if defined(SIGHTSPEAK_NORMALIZE_SSE2)
+    // CleanPrefix over 8 units per step, starting at clean; sets stopped when a unit needing Emit was found
+    static size_t CleanPrefixSse2(const uint16_t* units, size_t size, size_t clean, bool& stopped) {
+        const __m128i space = _mm_set1_epi16(0x1F), tilde = _mm_set1_epi16(0x7F);
+        const __m128i digitLow = _mm_set1_epi16(0x2F), digitHigh = _mm_set1_epi16(0x3A);
+        const __m128i letterLow = _mm_set1_epi16(0x60), letterHigh = _mm_set1_epi16(0x7B), caseBit = _mm_set1_epi16(0x20);
+        while (clean + 9 <= size) { // The following unit is loaded as well
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(units + clean));
+            __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(units + clean + 1));
+            __m128i printable = _mm_and_si128(_mm_cmpgt_epi16(v, space), _mm_cmplt_epi16(v, tilde));
+            __m128i digit = _mm_and_si128(_mm_cmpgt_epi16(v, digitLow), _mm_cmplt_epi16(v, digitHigh));
+            __m128i folded = _mm_or_si128(v, caseBit);
+            __m128i letter = _mm_and_si128(_mm_cmpgt_epi16(folded, letterLow), _mm_cmplt_epi16(folded, letterHigh));
+            __m128i repeated = _mm_andnot_si128(_mm_or_si128(digit, letter), _mm_cmpeq_epi16(v, next));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_andnot_si128(repeated, printable)));
+            if (mask != 0xFFFFu) {
+                stopped = true;
+                return clean + CountTrailingOnes(mask) / 2;
+            }
+            clean += 8;
+        }
+        return clean;
+    }
+#endif
+
+    // Index of the next unit at or after from that may end a sentence: '.', '!', '?' or anything from U+2000 up
+    template <typename Char>
+    static size_t NextTerminatorCandidate(const Char* units, size_t size, size_t from) {
+        size_t i = from;
+        if constexpr (sizeof(Char) == 2) {
+#if defined(SIGHTSPEAK_NORMALIZE_SSE2)
+            const __m128i period = _mm_set1_epi16('.'), bang = _mm_set1_epi16('!'), question = _mm_set1_epi16('?');
+            const __m128i wide = _mm_set1_epi16(0x1FFF);
+            while (i + 8 <= size) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(units + i));
+                __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(v, period), _mm_cmpeq_epi16(v, bang)), _mm_cmpeq_epi16(v, question));
+                // Units from 0x2000 up: above 0x1FFF as signed, or negative when 0x8000 and above
+                hit = _mm_or_si128(hit, _mm_or_si128(_mm_cmpgt_epi16(v, wide), _mm_cmplt_epi16(v, _mm_setzero_si128())));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+                if (mask) return i + CountTrailingZeros(mask) / 2;
+                i += 8;
+            }
+#endif
+        }
+        for (; i < size; ++i) {
+            uint32_t u = Unit(units[i]);
+            if (u == '.' || u == '!' || u == '?' || u >= 0x2000) return i;
+        }
+        return size;
+    }
+
+    static bool IsCollapsibleOrSpace(uint32_t u) { return u == 0x20 || IsCollapsible(u); }
+
+    static int CountTrailingZeros(uint32_t mask) {
+        int count = 0;
+        while (!(mask & 1u) && count < 32) {
+            mask >>= 1;
+            ++count;
+        }
+        return count;
+    }
+
+    static int CountTrailingOnes(uint32_t mask) { return CountTrailingZeros(~mask); }
+
+    template <typename Char>
+    static size_t SkipSpaces(std::basic_string_view<Char> text, size_t i) {
+        while (i < text.size() && text[i] == static_cast<Char>(' ')) ++i;
+        return i;
+    }
+
+    template <typename Char>
+    static void AddSentence(std::basic_string_view<Char> text, size_t start, size_t end, std::vector<std::basic_string_view<Char>>& sentences) {
+        while (end > start && text[end - 1] == static_cast<Char>(' ')) --end;
+        if (end > start) sentences.push_back(text.substr(start, end - start));
+    }
+};
+
+#endif // SIGHTSPEAK_TEXT_NORMALIZE_HPP
@@ -0,0 +1,151 @@
+#ifndef SIGHTSPEAK_TEXT_STREAM_HPP
+#define SIGHTSPEAK_TEXT_STREAM_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cwctype>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "cancellation.hpp"
+#include "element-provider.hpp"
+
+// Reads a document ahead of the reader, a bounded number of chunks at a time
+// Chunks are fetched one after another on workers supplied by launch while earlier chunks are spoken,
+// so the first chunk is available after a single read and memory stays flat however long the document is
+class TextStream : public std::enable_shared_from_this<TextStream> {
+public:
+    using Launcher = std::function<void(std::function<void()>)>; // Runs a read on some worker
+
+    // Without a launcher chunks are read on the thread calling Next
+    static std::shared_ptr<TextStream> Open(std::unique_ptr<TextRangeSource> source, size_t lookahead = 4, Launcher launch = nullptr) {
+        if (!source) return nullptr;
+        return std::shared_ptr<TextStream>(new TextStream(std::move(source), lookahead, std::move(launch)));
+    }
+
+    TextStream(const TextStream&) = delete;
+    TextStream& operator=(const TextStream&) = delete;
+
+    // Take the next chunk, waiting for it to be read if necessary
+    // Returns false at the end of the document, after Close, or once cancelToken is cancelled; a cancellation alone is
+    // only noticed when the read in flight returns, so whoever cancels closes the stream too to end a wait at once
+    bool Next(TextChunk& chunk, const CancellationToken& cancelToken = CancellationToken()) {
+        std::unique_lock<std::mutex> lock(streamMutex);
+        for (;;) {
+            if (closed || cancelToken.IsCancelled()) return false;
+            if (!buffered.empty()) {
+                chunk = std::move(buffered.front());
+                buffered.pop_front();
+                bufferedChars -= chunk.text.size();
+                ++delivered;
+                Refill(lock); // A slot in the window became free
+                return true;
+            }
+            if (ended) return false;
+            if (!launch) {
+                ReadOneLocked(lock); // Read inline on the caller
+                continue;
+            }
+            Refill(lock); // Drops the lock while launching, so the read may already have finished
+            readCv.wait(lock, [&] { return closed || ended || !buffered.empty() || cancelToken.IsCancelled(); }); // Woken by the read in flight or Close
+        }
+    }
+
+    // Stop reading ahead; reads already in flight finish but their chunks are dropped
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(streamMutex);
+            closed = true;
+            buffered.clear();
+            bufferedChars = 0;
+        }
+        readCv.notify_all();
+    }
+
+    // Number of chunks handed to the reader
+    uint64_t Delivered() {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        return delivered;
+    }
+
+    // Largest number of characters held in the lookahead window at any time
+    size_t PeakBufferedChars() {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        return peakBufferedChars;
+    }
+
+private:
+    TextStream(std::unique_ptr<TextRangeSource> source, size_t lookahead, Launcher launch)
+        : source(std::move(source)), lookahead(lookahead ? lookahead : 1), launch(std::move(launch)) {
+    }
+
+    static bool Blank(const std::wstring& text) {
+        for (wchar_t c : text) {
+            if (!iswspace(c)) return false;
+        }
+        return true;
+    }
+
+    // Start the next read unless one is in flight or the window is full; called with the lock held
+    void Refill(std::unique_lock<std::mutex>& lock) {
+        if (!launch || reading || ended || closed || buffered.size() >= lookahead) return;
+        reading = true;
+        std::weak_ptr<TextStream> self = weak_from_this();
+        lock.unlock();
+        launch([self]() {
+            if (auto stream = self.lock()) stream->ReadOne();
+        });
+        lock.lock();
+    }
+
+    // Read one non-blank chunk on a worker and keep the window filling
+    void ReadOne() {
+        std::unique_lock<std::mutex> lock(streamMutex);
+        ReadOneLocked(lock);
+        reading = false;
+        Refill(lock);
+        lock.unlock();
+        readCv.notify_all();
+    }
+
+    // Read one non-blank chunk into the window; the source is used without the lock held
+    void ReadOneLocked(std::unique_lock<std::mutex>& lock) {
+        if (closed) return;
+        lock.unlock();
+        TextChunk chunk;
+        bool found = false;
+        while (source->Next(chunk)) {
+            if (!Blank(chunk.text)) {
+                found = true;
+                break;
+            }
+        }
+        lock.lock();
+        if (!found) {
+            ended = true;
+            return;
+        }
+        if (closed) return;
+        bufferedChars += chunk.text.size();
+        if (bufferedChars > peakBufferedChars) peakBufferedChars = bufferedChars;
+        buffered.push_back(std::move(chunk));
+    }
+
+    std::unique_ptr<TextRangeSource> source; // Document cursor, used by one read at a time
+    size_t lookahead; // Most chunks buffered ahead of the reader
+    Launcher launch; // Runs reads on workers
+    std::mutex streamMutex; // Guards the state below
+    std::condition_variable readCv; // Signals finished reads and Close
+    std::deque<TextChunk> buffered; // Chunks read but not yet taken
+    size_t bufferedChars{ 0 }; // Characters in buffered
+    size_t peakBufferedChars{ 0 }; // Largest value of bufferedChars
+    uint64_t delivered{ 0 }; // Chunks taken by the reader
+    bool reading{ false }; // A read is in flight on a worker
+    bool ended{ false }; // The source has no more chunks
+    bool closed{ false }; // The reader gave up on the stream
+};
+
+#endif // SIGHTSPEAK_TEXT_STREAM_HPP
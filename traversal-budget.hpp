@@ -0,0 +1,208 @@
+#ifndef SIGHTSPEAK_TRAVERSAL_BUDGET_HPP
+#define SIGHTSPEAK_TRAVERSAL_BUDGET_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+#include "element-provider.hpp"
+
+// Limits of one traversal
+// The deadline and node budget decide how much is read; the depth only guards against pathological trees
+// Only elements with something to say count against the node budget, so nameless layout panels
+// cost time but never crowd out the fields nested below them
+struct TraversalBudget {
+    std::chrono::milliseconds deadline{ 300 }; // No element is read once this much time has passed
+    size_t maxNodes{ 800 }; // Elements with a name or document read at most
+    int maxDepth{ 32 }; // Elements this deep or deeper are never fetched
+};
+
+// Root of a subtree a traversal left out
+struct PrunedSubtree {
+    std::wstring name; // Name of the element, for the log
+    RuntimeId runtimeId; // Identity of the element
+    int depth{ 0 }; // Depth below the traversal root
+    PruneReason reason{ PruneReason::None };
+};
+
+// What a traversal read and what it left out
+struct TraversalReport {
+    size_t visited{ 0 }; // Elements read
+    size_t spent{ 0 }; // Elements read that counted against the node budget
+    std::array<size_t, static_cast<size_t>(PruneReason::Count)> pruned{}; // Subtrees left out, by reason
+    std::vector<PrunedSubtree> examples; // First subtrees left out, in the order they were met
+    std::chrono::steady_clock::duration elapsed{}; // Time from the start of the traversal to its end
+
+    // Subtrees left out for a reason
+    size_t Pruned(PruneReason reason) const { return pruned[static_cast<size_t>(reason)]; }
+
+    // True if the deadline or node budget ended the traversal early
+    bool Exhausted() const { return Pruned(PruneReason::Budget) > 0; }
+
+    // Short human readable summary for the debug log
+    std::wstring Describe() const {
+        std::wstring summary = L"visited=" + std::to_wstring(visited) + L" texts=" + std::to_wstring(spent) + L" in " +
+            std::to_wstring(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()) + L"us";
+        for (size_t reason = 1; reason < pruned.size(); ++reason) {
+            if (pruned[reason]) summary += L" " + ReasonName(static_cast<PruneReason>(reason)) + L"=" + std::to_wstring(pruned[reason]);
+        }
+        for (const PrunedSubtree& example : examples) {
+            summary += L"; pruned " + ReasonName(example.reason) + L" \"" + example.name + L"\" at depth " + std::to_wstring(example.depth);
+        }
+        return summary;
+    }
+
+    static std::wstring ReasonName(PruneReason reason) {
+        switch (reason) {
+        case PruneReason::Offscreen: return L"offscreen";
+        case PruneReason::Empty: return L"empty";
+        case PruneReason::ControlType: return L"control-type";
+        case PruneReason::Budget: return L"budget";
+        case PruneReason::None:
+        case PruneReason::Count: break;
+        }
+        return L"none";
+    }
+};
+
+// Decides element by element what a traversal reads, within its budget and filter, and records what it leaves out
+// Used on the visiting thread only; the root is always read, whatever the filter says about it
+class TraversalGovernor {
+public:
+    TraversalGovernor(TraversalBudget budget, ElementFilter filter, size_t maxExamples = 8,
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now())
+        : budget(budget), filter(std::move(filter)), maxExamples(maxExamples), started(started), deadline(started + budget.deadline) {
+    }
+
+    // True if the element is to be read; otherwise it is recorded and nothing below it may be read
+    bool Admit(const ElementSnapshot& element) {
+        PruneReason reason = PruneReason::None;
+        if (Exhausted()) reason = PruneReason::Budget;
+        else if (element.depth > 0) reason = filter.Check(element);
+        if (reason != PruneReason::None) {
+            Prune(element, reason);
+            return false;
+        }
+        ++report.visited;
+        if (!element.name.empty() || element.hasTextPattern) ++report.spent;
+        return true;
+    }
+
+    // True once the deadline or the node budget is spent
+    bool Exhausted() const {
+        return report.spent >= budget.maxNodes || std::chrono::steady_clock::now() >= deadline;
+    }
+
+    // Settings the traversal runs under
+    const TraversalBudget& Budget() const { return budget; }
+    const ElementFilter& Filter() const { return filter; }
+
+    // End the traversal and return its report
+    const TraversalReport& Finish() {
+        report.elapsed = std::chrono::steady_clock::now() - started;
+        return report;
+    }
+
+private:
+    void Prune(const ElementSnapshot& element, PruneReason reason) {
+        ++report.pruned[static_cast<size_t>(reason)];
+        if (report.examples.size() < maxExamples) report.examples.push_back({ element.name, element.runtimeId, element.depth, reason });
+    }
+
+    TraversalBudget budget; // Limits of the traversal
+    ElementFilter filter; // Elements left out whatever the budget
+    size_t maxExamples; // Pruned subtrees kept by name in the report
+    std::chrono::steady_clock::time_point started; // Start of the traversal
+    std::chrono::steady_clock::time_point deadline; // No element is read after this
+    TraversalReport report; // Filled as the traversal goes
+};
+
+// Hand the elements of a fetched subtree to the visitor as far as the governor admits them
+// Snapshots must be in breadth-first order with parent indices, as FetchSubtree and TreeMirror::Collect produce them;
+// the descendants of an element left out are skipped without being recorded, and once the budget is spent each
+// remaining subtree is recorded once; returns false if the visitor stopped the walk
+template <typename Visitor>
+bool VisitWithinBudget(const std::vector<ElementSnapshot>& snapshots, TraversalGovernor& governor, Visitor&& visit) {
+    std::vector<bool> left(snapshots.size(), false); // Element and so its subtree was left out
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        const ElementSnapshot& element = snapshots[i];
+        if ((element.parent >= 0 && left[element.parent]) || !governor.Admit(element)) {
+            left[i] = true;
+            continue;
+        }
+        if (!visit(element)) return false;
+    }
+    return true;
+}
+
+// Fetch the subtree below root in one request and visit it as far as the governor admits, see VisitWithinBudget
+// A request per admitted parent would read only what the budget allows, but costs a round trip per parent where the
+// whole subtree costs one; the query filter still keeps rejected elements out of the request itself
+// fetched receives every element read in breadth-first order with parent indices, and expanded whether its children
+// were fetched as well, which is what a mirror needs to patch the result in
+// Returns false if the visitor stopped the walk; fetched stays empty if the root could not be read
+template <typename Visitor>
+bool FetchWithinBudget(ElementProvider& provider, const ElementHandle& root, int maxDepth, TraversalGovernor& governor, Visitor&& visit,
+    std::vector<ElementSnapshot>& fetched, std::vector<bool>& expanded) {
+    fetched.clear();
+    expanded.clear();
+    if (!root || maxDepth <= 0 || !provider.FetchSubtree(root, maxDepth, fetched) || fetched.empty()) {
+        fetched.clear();
+        return true;
+    }
+    expanded.reserve(fetched.size());
+    for (const ElementSnapshot& element : fetched) expanded.push_back(element.depth + 1 < maxDepth);
+    return VisitWithinBudget(fetched, governor, std::forward<Visitor>(visit));
+}
+
+// Walk the subtree below root the way TraverseSubtree does, under a governor instead of a fixed depth
+// Batched mode fetches the subtree in one request with FetchWithinBudget; the live walk never fetches below an element left out
+// and stops as soon as the budget is spent, since what lies beyond is not known without fetching it
+template <typename Visitor>
+bool TraverseWithinBudget(ElementProvider& provider, const ElementHandle& root, TraversalMode mode, TraversalGovernor& governor, Visitor&& visit) {
+    int maxDepth = governor.Budget().maxDepth;
+    if (!root || maxDepth <= 0) return true;
+
+    if (mode == TraversalMode::Batched) {
+        std::vector<ElementSnapshot> snapshots;
+        std::vector<bool> expanded;
+        bool completed = FetchWithinBudget(provider, root, maxDepth, governor, visit, snapshots, expanded);
+        if (!snapshots.empty()) return completed; // Otherwise the root could not be read in one request, walk it live
+    }
+
+    struct PendingElement {
+        ElementHandle handle; // Element still to be read
+        int depth{ 0 }; // Depth of the element below the root
+    };
+
+    std::queue<PendingElement> pending;
+    pending.push({ root, 0 });
+    std::vector<ElementHandle> children;
+    while (!pending.empty()) {
+        PendingElement current = std::move(pending.front());
+        pending.pop();
+
+        ElementSnapshot snapshot;
+        if (!provider.FetchElement(current.handle, snapshot)) continue; // Skip elements that vanished mid-walk
+        snapshot.depth = current.depth;
+        if (!governor.Admit(snapshot)) {
+            if (governor.Exhausted()) return true;
+            continue;
+        }
+        if (!visit(snapshot)) return false;
+
+        if (current.depth + 1 >= maxDepth) continue; // Children would be too deep
+        children.clear();
+        if (!provider.FetchChildren(current.handle, children)) continue;
+        for (ElementHandle& child : children) {
+            pending.push({ std::move(child), current.depth + 1 });
+        }
+    }
+    return true;
+}
+
+#endif // SIGHTSPEAK_TRAVERSAL_BUDGET_HPP
@@ -0,0 +1,164 @@
+#ifndef SIGHTSPEAK_TREE_INVALIDATION_HPP
+#define SIGHTSPEAK_TREE_INVALIDATION_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "element-provider.hpp"
+
+// Kind of change reported by the accessibility tree
+enum class TreeChangeKind {
+    StructureChanged, // Children were added, removed or reordered below an element
+    FocusChanged, // Keyboard focus moved to an element
+    PropertyChanged // A watched property of an element changed
+};
+
+// A single change notification
+struct TreeChange {
+    TreeChangeKind kind{ TreeChangeKind::StructureChanged };
+    ElementRect rect; // Bounding rectangle of the element the change was reported on, empty if unknown
+    RuntimeId runtimeId; // Runtime id of the element the change was reported on, empty if unknown
+    std::wstring name; // Current name of the element, used to patch name changes in place
+    int propertyId{ 0 }; // Changed property for PropertyChanged notifications
+};
+
+// Source of change notifications
+// Backed by UI Automation event handlers in the reader and by MockTreeEventSource for portable runs
+class TreeEventSource {
+public:
+    using Sink = std::function<void(const TreeChange&)>;
+
+    virtual ~TreeEventSource() = default;
+
+    // Start delivering notifications; focus changes are reported for the whole desktop
+    virtual bool Start(Sink sink) = 0;
+
+    // Report structure and property changes below root, replacing the previously watched element
+    virtual bool Watch(const ElementHandle& root) = 0;
+
+    // Stop delivering notifications
+    virtual void Stop() = 0;
+};
+
+// Event source fed by hand
+class MockTreeEventSource : public TreeEventSource {
+public:
+    bool Start(Sink newSink) override {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        sink = std::move(newSink);
+        return true;
+    }
+
+    bool Watch(const ElementHandle& root) override {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        watched = root;
+        return true;
+    }
+
+    void Stop() override {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        sink = nullptr;
+        watched.reset();
+    }
+
+    // Deliver a notification as if the accessibility tree had raised it
+    void Emit(const TreeChange& change) {
+        Sink current;
+        {
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            current = sink;
+        }
+        if (current) current(change);
+    }
+
+    // Element currently being watched
+    ElementHandle Watched() {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        return watched;
+    }
+
+private:
+    std::mutex sinkMutex; // Guards sink and watched
+    Sink sink; // Receiver of notifications
+    ElementHandle watched; // Root of the watched subtree
+};
+
+// Dispatches change notifications to the cached state they affect
+// Each cache registers for the kinds of change that can make it stale
+class InvalidationHub {
+public:
+    using Handler = std::function<void(const TreeChange&)>;
+
+    // Register a handler for one kind of change
+    void Subscribe(TreeChangeKind kind, Handler handler) {
+        std::lock_guard<std::mutex> lock(handlersMutex);
+        handlers[Slot(kind)].push_back(std::move(handler));
+    }
+
+    // Route the notifications of an event source through this hub
+    bool Attach(TreeEventSource& source) {
+        return source.Start([this](const TreeChange& change) { Publish(change); });
+    }
+
+    // Deliver a change to every handler registered for its kind
+    void Publish(const TreeChange& change) {
+        counts[Slot(change.kind)].fetch_add(1, std::memory_order_relaxed);
+        std::vector<Handler> current;
+        {
+            std::lock_guard<std::mutex> lock(handlersMutex);
+            current = handlers[Slot(change.kind)];
+        }
+        for (const Handler& handler : current) handler(change);
+    }
+
+    // Number of changes of one kind published so far
+    uint64_t Published(TreeChangeKind kind) const {
+        return counts[Slot(kind)].load(std::memory_order_relaxed);
+    }
+
+private:
+    static size_t Slot(TreeChangeKind kind) { return static_cast<size_t>(kind); }
+
+    std::mutex handlersMutex; // Guards handlers
+    std::array<std::vector<Handler>, 3> handlers; // Handlers per change kind
+    std::array<std::atomic<uint64_t>, 3> counts{}; // Published changes per kind
+};
+
+// Tracks whether a shared component such as the automation or speech object is broken
+// A disconnect marks it broken at once; other failures only after several in a row
+class ComponentHealth {
+public:
+    explicit ComponentHealth(int failureThreshold = 3) : failureThreshold(failureThreshold) {}
+
+    // Record a failed call; returns true exactly once when the component becomes broken
+    bool ReportFailure(bool disconnected) {
+        int failures = consecutiveFailures.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (!disconnected && failures < failureThreshold) return false;
+        return !broken.exchange(true, std::memory_order_acq_rel);
+    }
+
+    // Record a successful call
+    void ReportSuccess() { consecutiveFailures.store(0, std::memory_order_relaxed); }
+
+    // True while the component waits to be rebuilt
+    bool IsBroken() const { return broken.load(std::memory_order_acquire); }
+
+    // Clear the broken state after the component was rebuilt
+    void MarkRebuilt() {
+        consecutiveFailures.store(0, std::memory_order_relaxed);
+        broken.store(false, std::memory_order_release);
+    }
+
+private:
+    int failureThreshold; // Ordinary failures in a row that count as broken
+    std::atomic<int> consecutiveFailures{ 0 }; // Failures since the last success
+    std::atomic<bool> broken{ false }; // Set until the component is rebuilt
+};
+
+#endif // SIGHTSPEAK_TREE_INVALIDATION_HPP
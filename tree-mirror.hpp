@@ -0,0 +1,327 @@
+#ifndef SIGHTSPEAK_TREE_MIRROR_HPP
+#define SIGHTSPEAK_TREE_MIRROR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "element-provider.hpp"
+
+// Hash for runtime ids so they can key an unordered_map
+struct RuntimeIdHash {
+    size_t operator()(const RuntimeId& id) const {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a over the id components
+        for (int part : id) {
+            hash ^= static_cast<uint32_t>(part);
+            hash *= 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+// Counts of what a patch changed in the mirror
+struct MirrorPatchStats {
+    size_t added{ 0 }; // Elements seen for the first time
+    size_t updated{ 0 }; // Elements already mirrored and refreshed in place
+    size_t removed{ 0 }; // Mirrored elements no longer present below the patched root
+};
+
+// In-process mirror of the visited accessibility tree, keyed by runtime id
+// Node properties live in parallel arrays so walks touch only the columns they need
+// Fetched subtrees are patched in, change notifications patch properties or mark subtrees dirty
+class TreeMirror {
+public:
+    explicit TreeMirror(size_t maxNodes = 200000) : maxNodes(maxNodes) {}
+
+    // Merge a fetched subtree, as produced by ElementProvider::FetchSubtree with the given depth limit
+    // Elements that disappeared from below the root are dropped, moved elements are relinked; when expanded is given,
+    // as FetchWithinBudget fills it, elements whose children were not fetched count as known to no depth
+    MirrorPatchStats Patch(const std::vector<ElementSnapshot>& subtree, int maxDepth, const std::vector<bool>* expanded = nullptr) {
+        std::unique_lock<std::shared_mutex> lock(mirrorMutex);
+        MirrorPatchStats stats;
+        if (subtree.empty()) return stats;
+        if (byRuntimeId.size() + subtree.size() > maxNodes) ClearLocked(); // Start over rather than grow without bound
+
+        ++patchStamp;
+        uint32_t oldRoot = FindLocked(subtree[0].runtimeId);
+        std::vector<uint32_t> candidates; // Old descendants of the root, removed unless seen again
+        if (oldRoot != None) {
+            ForEachDescendant(oldRoot, [&](uint32_t node) {
+                stamp[node] = patchStamp;
+                candidates.push_back(node);
+                });
+        }
+
+        std::vector<uint32_t> slots(subtree.size());
+        for (size_t i = 0; i < subtree.size(); ++i) {
+            const ElementSnapshot& snapshot = subtree[i];
+            uint32_t node = snapshot.runtimeId.empty() ? None : FindLocked(snapshot.runtimeId);
+            if (node == None) {
+                node = Allocate(snapshot.runtimeId);
+                ++stats.added;
+            }
+            else {
+                if (i > 0 && stamp[node] != patchStamp) Unlink(node); // Moved in from outside the old subtree
+                ++stats.updated;
+            }
+            stamp[node] = 0; // Still present, keep it
+            handles[node] = snapshot.handle;
+            names[node] = snapshot.name;
+            rects[node] = snapshot.rect;
+            controlTypes[node] = snapshot.controlType;
+            hasTextPattern[node] = snapshot.hasTextPattern;
+            offscreen[node] = snapshot.offscreen;
+            dirty[node] = false;
+            int below = expanded && !(*expanded)[i] ? 0 : maxDepth - snapshot.depth - 1;
+            fetchedDepth[node] = below > 0 ? below : 0;
+            firstChild[node] = None;
+            slots[i] = node;
+        }
+
+        std::vector<uint32_t> lastChild(subtree.size(), None);
+        for (size_t i = 1; i < subtree.size(); ++i) {
+            int parentIndex = subtree[i].parent;
+            if (parentIndex < 0) continue;
+            uint32_t parentNode = slots[parentIndex];
+            uint32_t node = slots[i];
+            parents[node] = parentNode;
+            nextSibling[node] = None;
+            if (lastChild[parentIndex] == None) firstChild[parentNode] = node;
+            else nextSibling[lastChild[parentIndex]] = node;
+            lastChild[parentIndex] = node;
+        }
+        if (oldRoot == None) {
+            parents[slots[0]] = None; // A new root stays detached until a fetch from higher up links it
+            nextSibling[slots[0]] = None;
+        }
+
+        for (uint32_t node : candidates) {
+            if (stamp[node] == patchStamp) {
+                Free(node);
+                ++stats.removed;
+            }
+        }
+        return stats;
+    }
+
+    // Collect the mirrored subtree below root in breadth-first order, down to maxDepth levels
+    // Dirty elements and elements fetched too shallow are reported in stale, with depths relative to root,
+    // and are not descended into; returns false if root is not mirrored at all
+    bool Collect(const RuntimeId& root, int maxDepth, std::vector<ElementSnapshot>& snapshots, std::vector<ElementSnapshot>& stale) const {
+        std::shared_lock<std::shared_mutex> lock(mirrorMutex);
+        uint32_t rootNode = FindLocked(root);
+        if (rootNode == None || maxDepth <= 0) return false;
+
+        std::queue<std::pair<uint32_t, int>> pending; // Node and index of its parent snapshot
+        pending.push({ rootNode, -1 });
+        while (!pending.empty()) {
+            auto [node, parentIndex] = pending.front();
+            pending.pop();
+
+            ElementSnapshot snapshot = SnapshotLocked(node);
+            snapshot.depth = parentIndex >= 0 ? snapshots[parentIndex].depth + 1 : 0;
+            snapshot.parent = parentIndex;
+            int needed = maxDepth - snapshot.depth - 1; // Levels that must be complete below this element
+            if (dirty[node] || fetchedDepth[node] < needed) {
+                stale.push_back(std::move(snapshot));
+                continue;
+            }
+            snapshots.push_back(std::move(snapshot));
+
+            int self = static_cast<int>(snapshots.size()) - 1;
+            if (needed <= 0) continue;
+            for (uint32_t child = firstChild[node]; child != None; child = nextSibling[child]) {
+                pending.push({ child, self });
+            }
+        }
+        return true;
+    }
+
+    // Mark the subtree below an element as needing a fresh walk
+    // Returns false if the element is not mirrored
+    bool MarkDirty(const RuntimeId& runtimeId) {
+        std::unique_lock<std::shared_mutex> lock(mirrorMutex);
+        uint32_t node = FindLocked(runtimeId);
+        if (node == None) return false;
+        dirty[node] = true;
+        return true;
+    }
+
+    // Mark every mirrored element as needing a fresh walk
+    void MarkAllDirty() {
+        std::unique_lock<std::shared_mutex> lock(mirrorMutex);
+        for (uint32_t node = 0; node < dirty.size(); ++node) dirty[node] = true;
+    }
+
+    // Patch the name of a mirrored element in place
+    bool UpdateName(const RuntimeId& runtimeId, const std::wstring& name) {
+        std::unique_lock<std::shared_mutex> lock(mirrorMutex);
+        uint32_t node = FindLocked(runtimeId);
+        if (node == None) return false;
+        names[node] = name;
+        return true;
+    }
+
+    // Patch the bounding rectangle of a mirrored element in place
+    bool UpdateRect(const RuntimeId& runtimeId, const ElementRect& rect) {
+        std::unique_lock<std::shared_mutex> lock(mirrorMutex);
+        uint32_t node = FindLocked(runtimeId);
+        if (node == None) return false;
+        rects[node] = rect;
+        return true;
+    }
+
+    // Drop everything
+    void Clear() {
+        std::unique_lock<std::shared_mutex> lock(mirrorMutex);
+        ClearLocked();
+    }
+
+    // Number of mirrored elements
+    size_t Size() const {
+        std::shared_lock<std::shared_mutex> lock(mirrorMutex);
+        return byRuntimeId.size();
+    }
+
+private:
+    static constexpr uint32_t None = UINT32_MAX; // Missing node in links and lookups
+
+    uint32_t FindLocked(const RuntimeId& runtimeId) const {
+        auto found = byRuntimeId.find(runtimeId);
+        return found != byRuntimeId.end() ? found->second : None;
+    }
+
+    ElementSnapshot SnapshotLocked(uint32_t node) const {
+        ElementSnapshot snapshot;
+        snapshot.handle = handles[node];
+        snapshot.runtimeId = runtimeIds[node];
+        snapshot.name = names[node];
+        snapshot.rect = rects[node];
+        snapshot.controlType = controlTypes[node];
+        snapshot.hasTextPattern = hasTextPattern[node];
+        snapshot.offscreen = offscreen[node];
+        return snapshot;
+    }
+
+    template <typename Callback>
+    void ForEachDescendant(uint32_t root, Callback&& callback) const {
+        std::vector<uint32_t> pending{ root };
+        while (!pending.empty()) {
+            uint32_t node = pending.back();
+            pending.pop_back();
+            for (uint32_t child = firstChild[node]; child != None; child = nextSibling[child]) {
+                callback(child);
+                pending.push_back(child);
+            }
+        }
+    }
+
+    uint32_t Allocate(const RuntimeId& runtimeId) {
+        uint32_t node;
+        if (!freeNodes.empty()) {
+            node = freeNodes.back();
+            freeNodes.pop_back();
+        }
+        else {
+            node = static_cast<uint32_t>(runtimeIds.size());
+            runtimeIds.emplace_back();
+            handles.emplace_back();
+            names.emplace_back();
+            rects.emplace_back();
+            controlTypes.push_back(0);
+            hasTextPattern.push_back(false);
+            offscreen.push_back(false);
+            dirty.push_back(false);
+            fetchedDepth.push_back(0);
+            parents.push_back(None);
+            firstChild.push_back(None);
+            nextSibling.push_back(None);
+            stamp.push_back(0);
+        }
+        runtimeIds[node] = runtimeId;
+        parents[node] = None;
+        firstChild[node] = None;
+        nextSibling[node] = None;
+        stamp[node] = 0;
+        if (!runtimeId.empty()) byRuntimeId[runtimeId] = node;
+        return node;
+    }
+
+    void Free(uint32_t node) {
+        if (!runtimeIds[node].empty()) byRuntimeId.erase(runtimeIds[node]);
+        runtimeIds[node].clear();
+        handles[node].reset(); // Let go of the live element right away
+        names[node].clear();
+        names[node].shrink_to_fit();
+        parents[node] = None;
+        firstChild[node] = None;
+        nextSibling[node] = None;
+        stamp[node] = 0;
+        freeNodes.push_back(node);
+    }
+
+    // Remove a node from its parent's child list
+    void Unlink(uint32_t node) {
+        uint32_t parent = parents[node];
+        if (parent == None) return;
+        if (firstChild[parent] == node) {
+            firstChild[parent] = nextSibling[node];
+        }
+        else {
+            for (uint32_t child = firstChild[parent]; child != None; child = nextSibling[child]) {
+                if (nextSibling[child] == node) {
+                    nextSibling[child] = nextSibling[node];
+                    break;
+                }
+            }
+        }
+        parents[node] = None;
+        nextSibling[node] = None;
+    }
+
+    void ClearLocked() {
+        byRuntimeId.clear();
+        runtimeIds.clear();
+        handles.clear();
+        names.clear();
+        rects.clear();
+        controlTypes.clear();
+        hasTextPattern.clear();
+        offscreen.clear();
+        dirty.clear();
+        fetchedDepth.clear();
+        parents.clear();
+        firstChild.clear();
+        nextSibling.clear();
+        stamp.clear();
+        freeNodes.clear();
+    }
+
+    size_t maxNodes; // Mirror is cleared before it would grow past this many elements
+    mutable std::shared_mutex mirrorMutex; // Walks share, patches are exclusive
+    std::unordered_map<RuntimeId, uint32_t, RuntimeIdHash> byRuntimeId; // Node of each mirrored element
+
+    // One entry per node in each column
+    std::vector<RuntimeId> runtimeIds; // Runtime id of the element
+    std::vector<ElementHandle> handles; // Live element for follow-up calls
+    std::vector<std::wstring> names; // Name property
+    std::vector<ElementRect> rects; // Bounding rectangle
+    std::vector<int> controlTypes; // Control type identifier
+    std::vector<bool> hasTextPattern; // Text pattern availability
+    std::vector<bool> offscreen; // Out of view when last fetched
+    std::vector<bool> dirty; // Subtree below needs a fresh walk
+    std::vector<int> fetchedDepth; // Levels known to be complete below the element
+    std::vector<uint32_t> parents; // Parent node
+    std::vector<uint32_t> firstChild; // First child node
+    std::vector<uint32_t> nextSibling; // Next sibling node
+    std::vector<uint64_t> stamp; // Removal mark used while patching
+    std::vector<uint32_t> freeNodes; // Released nodes ready for reuse
+    uint64_t patchStamp{ 0 }; // Identifies the patch in progress
+};
+
+#endif // SIGHTSPEAK_TREE_MIRROR_HPP
@@ -0,0 +1,112 @@
+#ifndef SIGHTSPEAK_UTTERANCE_BATCH_HPP
+#define SIGHTSPEAK_UTTERANCE_BATCH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "cancellation.hpp"
+#include "speech-backend.hpp"
+
+// When a newer hover stops the speech of an older one
+enum class Preemption {
+    Interrupt, // At once, mid-word if need be
+    FinishItem // Once the item being spoken ends; merged utterances stop at the next item, long texts after the sentence
+};
+
+// Settings deciding which queued texts are spoken together
+struct BatchPolicy {
+    size_t maxItems{ 8 }; // Items merged into one utterance at most, 1 speaks every item on its own
+    size_t maxItemChars{ 40 }; // Longer items are worth an utterance of their own
+    size_t maxChars{ 240 }; // Longest merged utterance, so a stop never waits long for synthesis to start
+    Preemption preemption{ Preemption::Interrupt };
+};
+
+// Short texts of one traversal merged into a single utterance
+// Each item starts at a known offset, so the word boundaries reported while it plays tell which item is being spoken;
+// a toolbar of a dozen buttons then costs one synthesis start instead of a dozen
+class UtteranceBatch {
+public:
+    explicit UtteranceBatch(BatchPolicy policy = BatchPolicy()) : policy(policy) {}
+
+    // True if a text may be merged with others at all
+    bool Accepts(std::wstring_view text) const {
+        return policy.maxItems > 1 && !text.empty() && text.size() <= policy.maxItemChars;
+    }
+
+    // Append a text the batch accepts; returns false, leaving the batch as it was, once it is full
+    bool Add(std::wstring_view text) {
+        if (!Accepts(text) || starts.size() >= policy.maxItems) return false;
+        std::wstring_view separator = Separator();
+        if (!starts.empty() && merged.size() + separator.size() + text.size() > policy.maxChars) return false;
+        merged.append(separator);
+        starts.push_back(merged.size());
+        merged.append(text);
+        return true;
+    }
+
+    // Item a character offset of Text falls in, as reported with a word boundary
+    size_t ItemAt(size_t offset) const {
+        auto after = std::upper_bound(starts.begin(), starts.end(), offset);
+        return after == starts.begin() ? 0 : static_cast<size_t>(after - starts.begin()) - 1;
+    }
+
+    void Clear() {
+        merged.clear();
+        starts.clear();
+    }
+
+    bool Empty() const { return starts.empty(); }
+    size_t Size() const { return starts.size(); }
+    const std::wstring& Text() const { return merged; }
+    const BatchPolicy& Policy() const { return policy; }
+
+private:
+    // A comma makes the synthesizer pause between items, unless the last one already ended with punctuation
+    std::wstring_view Separator() const {
+        if (merged.empty()) return std::wstring_view();
+        wchar_t last = merged.back();
+        return last == L'.' || last == L',' || last == L';' || last == L':' || last == L'!' || last == L'?' ? std::wstring_view(L" ") : std::wstring_view(L", ");
+    }
+
+    BatchPolicy policy; // Limits of the batch
+    std::wstring merged; // Items joined by separators
+    std::vector<size_t> starts; // Offset of each item in merged, ascending
+};
+
+// Speak a batch as one utterance and block until it ends
+// onItem is called with 0 before speaking and then on the backend thread as the first word of each later item plays;
+// under FinishItem a cancelled token ends the utterance at the next item rather than waiting for a purge
+// Returns true if the utterance played to the end
+inline bool SpeakBatch(SpeechBackend& backend, const UtteranceBatch& batch, const CancellationToken& token,
+    std::function<void(size_t item)> onItem, SpeechCallbacks callbacks = SpeechCallbacks()) {
+    if (batch.Empty() || token.IsCancelled()) return false;
+
+    struct Progress {
+        UtteranceBatch batch; // Copied, since a late word event may outlive the caller's batch
+        CancellationToken token;
+        std::function<void(size_t)> onItem;
+        bool finishItem{ false };
+        size_t current{ 0 }; // Item being spoken, touched on the backend thread only
+    };
+    auto progress = std::make_shared<Progress>(Progress{ batch, token, std::move(onItem), batch.Policy().preemption == Preemption::FinishItem });
+
+    if (progress->onItem) progress->onItem(0);
+    callbacks.onWord = [progress, &backend](size_t offset, size_t) {
+        size_t item = progress->batch.ItemAt(offset);
+        if (item == progress->current) return;
+        if (progress->finishItem && progress->token.IsCancelled()) {
+            backend.Purge(); // Superseded, stop at the boundary instead of mid-word
+            return;
+        }
+        progress->current = item;
+        if (progress->onItem) progress->onItem(item);
+    };
+    return SpeakAndWait(backend, batch.Text(), nullptr, std::move(callbacks), token);
+}
+
+#endif // SIGHTSPEAK_UTTERANCE_BATCH_HPP
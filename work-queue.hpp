@@ -0,0 +1,189 @@
+#ifndef SIGHTSPEAK_WORK_QUEUE_HPP
+#define SIGHTSPEAK_WORK_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Bounded multi-producer single-consumer ring buffer
+// Producers claim slots with a compare-and-swap on the tail; each slot carries a sequence number
+// telling producers and the consumer whose turn it is, so no lock is taken on either side
+// Clear is O(1): it bumps an epoch and the consumer discards entries pushed under an older one
+template <typename T>
+class WorkQueue {
+public:
+    explicit WorkQueue(size_t minCapacity = 1024) {
+        size_t capacity = 2;
+        while (capacity < minCapacity) capacity *= 2; // Power of two so positions can be masked
+        mask = capacity - 1;
+        slots = std::make_unique<Slot[]>(capacity);
+        for (size_t i = 0; i < capacity; ++i) slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    WorkQueue(const WorkQueue&) = delete;
+    WorkQueue& operator=(const WorkQueue&) = delete;
+
+    // Append an item unless the ring is full; the item is only moved from on success
+    bool TryPush(T&& item) {
+        if (TryPushTagged(std::move(item), epoch.load(std::memory_order_acquire))) return true;
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Append an item, blocking while the ring is full
+    // Returns false without moving the item if the queue is cleared or closed while waiting
+    bool Push(T&& item) {
+        uint64_t tag = epoch.load(std::memory_order_acquire);
+        for (;;) {
+            if (TryPushTagged(std::move(item), tag)) return true;
+            if (closed.load(std::memory_order_acquire) || epoch.load(std::memory_order_acquire) != tag) return false;
+
+            uint32_t seen = released.load(std::memory_order_seq_cst);
+            producersWaiting.fetch_add(1, std::memory_order_seq_cst);
+            if (Full() && !closed.load(std::memory_order_seq_cst) && epoch.load(std::memory_order_seq_cst) == tag) {
+                blocked.fetch_add(1, std::memory_order_relaxed);
+                released.wait(seen, std::memory_order_seq_cst); // Woken by the consumer freeing slots, Clear or Close
+            }
+            producersWaiting.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+
+    // Move up to maxItems current entries into out without blocking; returns how many were added
+    // Only the single consumer thread may call this
+    size_t Drain(std::vector<T>& out, size_t maxItems) {
+        size_t added = 0;
+        size_t freed = 0;
+        uint64_t current = epoch.load(std::memory_order_acquire);
+        while (added < maxItems) {
+            Slot& slot = slots[head & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != head + 1) break; // Empty, or a producer is still writing
+            bool stale = slot.epoch != current;
+            if (!stale) {
+                out.push_back(std::move(*slot.value));
+                ++added;
+            }
+            else {
+                discarded.fetch_add(1, std::memory_order_relaxed);
+            }
+            slot.value.reset();
+            slot.sequence.store(head + mask + 1, std::memory_order_release); // Hand the slot to the producer one lap ahead
+            ++head;
+            ++freed;
+        }
+        if (freed) WakeProducers();
+        return added;
+    }
+
+    // Block until at least one current entry is available, then drain up to maxItems of them
+    // Returns false once the queue is closed and nothing is left
+    bool WaitDrain(std::vector<T>& out, size_t maxItems) {
+        for (;;) {
+            if (Drain(out, maxItems)) return true;
+            if (closed.load(std::memory_order_acquire)) return false;
+            consumerWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with the fence in TryPushTagged
+            uint32_t seen = pushed.load(std::memory_order_relaxed);
+            if (!Readable() && !closed.load(std::memory_order_acquire)) pushed.wait(seen, std::memory_order_acquire);
+            consumerWaiting.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // Drop every queued entry in O(1); entries still in the ring are skipped by the consumer
+    // Producers blocked in Push give up on their item
+    void Clear() {
+        epoch.fetch_add(1, std::memory_order_acq_rel);
+        WakeProducers();
+    }
+
+    // Wake everyone and refuse further pushes
+    void Close() {
+        closed.store(true, std::memory_order_seq_cst);
+        pushed.fetch_add(1, std::memory_order_seq_cst);
+        pushed.notify_all();
+        released.fetch_add(1, std::memory_order_seq_cst);
+        released.notify_all();
+    }
+
+    // Number of slots
+    size_t Capacity() const { return mask + 1; }
+
+    // Number of pushes rejected because the ring was full
+    uint64_t Rejected() const { return rejected.load(std::memory_order_relaxed); }
+
+    // Number of times a producer had to wait for free slots
+    uint64_t Blocked() const { return blocked.load(std::memory_order_relaxed); }
+
+    // Number of entries skipped because the queue was cleared after they were pushed
+    uint64_t Discarded() const { return discarded.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{ 0 }; // Position the slot is ready for: pos for producers, pos + 1 for the consumer
+        uint64_t epoch{ 0 }; // Epoch the entry was pushed under
+        std::optional<T> value; // The entry, so T needs no default constructor
+    };
+
+    bool TryPushTagged(T&& item, uint64_t tag) {
+        if (closed.load(std::memory_order_acquire)) return false;
+        size_t position = tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[position & mask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            }
+            else if (difference < 0) {
+                return false; // The consumer has not freed this slot since the last lap
+            }
+            else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value.emplace(std::move(item));
+        slot->epoch = tag;
+        slot->sequence.store(position + 1, std::memory_order_release);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst); // Either the consumer sees the entry or we see it waiting
+        if (consumerWaiting.load(std::memory_order_relaxed) && consumerWaiting.exchange(false, std::memory_order_acq_rel)) {
+            pushed.fetch_add(1, std::memory_order_release); // Only the first push after the consumer fell asleep wakes it
+            pushed.notify_one();
+        }
+        return true;
+    }
+
+    bool Full() const {
+        size_t position = tail.load(std::memory_order_acquire);
+        return slots[position & mask].sequence.load(std::memory_order_acquire) < position;
+    }
+
+    bool Readable() const {
+        return slots[head & mask].sequence.load(std::memory_order_acquire) == head + 1;
+    }
+
+    void WakeProducers() {
+        released.fetch_add(1, std::memory_order_seq_cst);
+        if (producersWaiting.load(std::memory_order_seq_cst)) released.notify_all();
+    }
+
+    std::unique_ptr<Slot[]> slots; // Ring storage
+    size_t mask{ 0 }; // Capacity minus one
+    alignas(64) std::atomic<size_t> tail{ 0 }; // Next position producers claim
+    alignas(64) size_t head{ 0 }; // Next position the consumer reads, owned by the consumer
+    alignas(64) std::atomic<uint64_t> epoch{ 0 }; // Bumped by Clear
+    std::atomic<bool> closed{ false }; // Set by Close
+    std::atomic<uint32_t> pushed{ 0 }; // Bumped by the push that wakes the consumer, the consumer sleeps on it
+    std::atomic<uint32_t> released{ 0 }; // Bumped when slots are freed or the queue is cleared, producers sleep on it
+    std::atomic<bool> consumerWaiting{ false }; // Set while the consumer sleeps
+    std::atomic<uint32_t> producersWaiting{ 0 }; // Producers sleeping on a full ring
+    std::atomic<uint64_t> rejected{ 0 }; // Pushes rejected on a full ring
+    std::atomic<uint64_t> blocked{ 0 }; // Producer waits on a full ring
+    std::atomic<uint64_t> discarded{ 0 }; // Entries dropped by Clear
+};
+
+#endif // SIGHTSPEAK_WORK_QUEUE_HPP